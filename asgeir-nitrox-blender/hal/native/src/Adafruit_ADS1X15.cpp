@@ -0,0 +1,123 @@
+#include "Adafruit_ADS1X15.h"
+
+#include <math.h>
+
+#include "Arduino.h"
+
+#include "Simulator.h"
+
+static float lsbMillivolts(adsGain_t gain) {
+  switch (gain) {
+    case GAIN_TWOTHIRDS: return 0.1875f;
+    case GAIN_ONE: return 0.125f;
+    case GAIN_TWO: return 0.0625f;
+    case GAIN_FOUR: return 0.03125f;
+    case GAIN_EIGHT: return 0.015625f;
+    case GAIN_SIXTEEN: return 0.0078125f;
+  }
+  return 0.1875f;
+}
+
+bool Adafruit_ADS1X15::begin(uint8_t i2c_addr, TwoWire *wire) {
+  (void)i2c_addr;
+  (void)wire;
+  return true;
+}
+
+uint32_t Adafruit_ADS1X15::conversionTimeUs() {
+  static const uint16_t samplesPerSecond[] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+  return 1000000UL / samplesPerSecond[(m_dataRate >> 5) & 0x07];
+}
+
+int16_t Adafruit_ADS1X15::sample(uint16_t mux) {
+  float mv = 0;
+  switch (mux) {
+    case ADS1X15_REG_CONFIG_MUX_DIFF_0_1: mv = sim::cellMillivolts(0); break;
+    case ADS1X15_REG_CONFIG_MUX_DIFF_2_3: mv = sim::cellMillivolts(1); break;
+    default: break;
+  }
+  float counts = roundf(mv / lsbMillivolts(m_gain));
+  if (counts > 32767) {
+    counts = 32767;
+  } else if (counts < -32768) {
+    counts = -32768;
+  }
+  return (int16_t)counts;
+}
+
+void Adafruit_ADS1X15::scheduleReady(uint32_t generation, uint64_t atUs) {
+  sim::schedule(atUs, [this, generation, atUs]() {
+    if (generation != this->generation.load()) {
+      return;
+    }
+    sim::setDigitalInput(SIM_ADS_ALERT_PIN, LOW);
+    if (continuous) {
+      sim::schedule(atUs + 8, [this, generation]() {
+        if (generation == this->generation.load()) {
+          sim::setDigitalInput(SIM_ADS_ALERT_PIN, HIGH);
+        }
+      });
+      scheduleReady(generation, atUs + conversionTimeUs());
+    }
+  });
+}
+
+void Adafruit_ADS1X15::startADCReading(uint16_t mux, bool continuous) {
+  this->mux = mux;
+  this->continuous = continuous;
+  conversionStartedUs = sim::nowUs();
+  converting = true;
+
+  uint32_t current = ++generation;
+  sim::setDigitalInput(SIM_ADS_ALERT_PIN, HIGH);
+  scheduleReady(current, conversionStartedUs + conversionTimeUs());
+}
+
+bool Adafruit_ADS1X15::conversionComplete() {
+  return !converting || sim::nowUs() - conversionStartedUs >= conversionTimeUs();
+}
+
+int16_t Adafruit_ADS1X15::getLastConversionResults() {
+  if (converting && sim::nowUs() - conversionStartedUs >= conversionTimeUs()) {
+    lastResult = sample(mux);
+    converting = continuous;
+    if (continuous) {
+      conversionStartedUs = sim::nowUs();
+    }
+  }
+  return lastResult;
+}
+
+int16_t Adafruit_ADS1X15::readBlocking(uint16_t mux) {
+  // The Adafruit driver polls the OS bit until the single-shot conversion is done.
+  startADCReading(mux, false);
+  sim::waitUs(conversionTimeUs());
+  return getLastConversionResults();
+}
+
+int16_t Adafruit_ADS1X15::readADC_SingleEnded(uint8_t channel) {
+  if (channel > 3) {
+    return 0;
+  }
+  return readBlocking(ADS1X15_REG_CONFIG_MUX_SINGLE_0 + (channel << 12));
+}
+
+int16_t Adafruit_ADS1X15::readADC_Differential_0_1() {
+  return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_0_1);
+}
+
+int16_t Adafruit_ADS1X15::readADC_Differential_0_3() {
+  return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_0_3);
+}
+
+int16_t Adafruit_ADS1X15::readADC_Differential_1_3() {
+  return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_1_3);
+}
+
+int16_t Adafruit_ADS1X15::readADC_Differential_2_3() {
+  return readBlocking(ADS1X15_REG_CONFIG_MUX_DIFF_2_3);
+}
+
+float Adafruit_ADS1X15::computeVolts(int16_t counts) {
+  return counts * lsbMillivolts(m_gain) / 1000.0f;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "Wire.h"
+
+/*
+ * Simulated ADS1115 with the Adafruit_ADS1X15 2.x API. AIN0/AIN1 see O2 cell 0 and
+ * AIN2/AIN3 see O2 cell 1, both taken from sim::cellMillivolts(). Conversions take
+ * 1/data-rate of virtual time, a blocking read waits that long.
+ *
+ * startADCReading() configures ALERT/RDY as conversion ready output, like the real
+ * driver: the pin (SIM_ADS_ALERT_PIN) goes high when a conversion starts and low when
+ * it completes. In continuous mode it pulses low for 8 us after every conversion.
+ */
+
+#define ADS1X15_ADDRESS (0x48)
+
+#define ADS1X15_REG_CONFIG_MUX_DIFF_0_1 (0x0000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_0_3 (0x1000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_1_3 (0x2000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_2_3 (0x3000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+
+#define ADS1X15_REG_CONFIG_PGA_6_144V (0x0000)
+#define ADS1X15_REG_CONFIG_PGA_4_096V (0x0200)
+#define ADS1X15_REG_CONFIG_PGA_2_048V (0x0400)
+#define ADS1X15_REG_CONFIG_PGA_1_024V (0x0600)
+#define ADS1X15_REG_CONFIG_PGA_0_512V (0x0800)
+#define ADS1X15_REG_CONFIG_PGA_0_256V (0x0A00)
+
+typedef enum {
+  GAIN_TWOTHIRDS = ADS1X15_REG_CONFIG_PGA_6_144V,
+  GAIN_ONE = ADS1X15_REG_CONFIG_PGA_4_096V,
+  GAIN_TWO = ADS1X15_REG_CONFIG_PGA_2_048V,
+  GAIN_FOUR = ADS1X15_REG_CONFIG_PGA_1_024V,
+  GAIN_EIGHT = ADS1X15_REG_CONFIG_PGA_0_512V,
+  GAIN_SIXTEEN = ADS1X15_REG_CONFIG_PGA_0_256V
+} adsGain_t;
+
+#define RATE_ADS1115_8SPS (0x0000)
+#define RATE_ADS1115_16SPS (0x0020)
+#define RATE_ADS1115_32SPS (0x0040)
+#define RATE_ADS1115_64SPS (0x0060)
+#define RATE_ADS1115_128SPS (0x0080)
+#define RATE_ADS1115_250SPS (0x00A0)
+#define RATE_ADS1115_475SPS (0x00C0)
+#define RATE_ADS1115_860SPS (0x00E0)
+
+class Adafruit_ADS1X15 {
+public:
+  bool begin(uint8_t i2c_addr = ADS1X15_ADDRESS, TwoWire *wire = &Wire);
+
+  int16_t readADC_SingleEnded(uint8_t channel);
+  int16_t readADC_Differential_0_1();
+  int16_t readADC_Differential_0_3();
+  int16_t readADC_Differential_1_3();
+  int16_t readADC_Differential_2_3();
+  int16_t getLastConversionResults();
+  float computeVolts(int16_t counts);
+
+  void setGain(adsGain_t gain) { m_gain = gain; }
+  adsGain_t getGain() { return m_gain; }
+  void setDataRate(uint16_t rate) { m_dataRate = rate; }
+  uint16_t getDataRate() { return m_dataRate; }
+
+  void startADCReading(uint16_t mux, bool continuous);
+  bool conversionComplete();
+
+  /// @brief Virtual time one conversion takes at the configured data rate.
+  uint32_t conversionTimeUs();
+
+protected:
+  int16_t readBlocking(uint16_t mux);
+  int16_t sample(uint16_t mux);
+  void scheduleReady(uint32_t generation, uint64_t atUs);
+
+  adsGain_t m_gain = GAIN_TWOTHIRDS;
+  uint16_t m_dataRate = RATE_ADS1115_128SPS;
+
+  uint16_t mux = ADS1X15_REG_CONFIG_MUX_DIFF_0_1;
+  bool continuous = false;
+  uint64_t conversionStartedUs = 0;
+  bool converting = false;
+  int16_t lastResult = 0;
+  std::atomic<uint32_t> generation { 0 }; // Invalidates RDY events of an aborted conversion.
+};
+
+class Adafruit_ADS1115 : public Adafruit_ADS1X15 {};
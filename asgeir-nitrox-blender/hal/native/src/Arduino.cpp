@@ -0,0 +1,110 @@
+#include "Arduino.h"
+
+#include <chrono>
+
+#include "Simulator.h"
+
+EspClass ESP;
+
+unsigned long millis() {
+  // The ESP32 core returns a 32 bit value, keep the same wrap-around behaviour.
+  return (uint32_t)(sim::nowUs() / 1000);
+}
+
+unsigned long micros() {
+  return (uint32_t)sim::nowUs();
+}
+
+void delay(uint32_t ms) {
+  sim::waitUs((uint64_t)ms * 1000);
+}
+
+void delayMicroseconds(uint32_t us) {
+  sim::waitUs(us);
+}
+
+void yield() {}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+  // Same integer arithmetic as the ESP32 core, including the truncation.
+  const long run = in_max - in_min;
+  if (run == 0) {
+    return -1;
+  }
+  const long rise = out_max - out_min;
+  const long delta = x - in_min;
+  return (delta * rise) / run + out_min;
+}
+
+// Same sequence on every run unless the sketch seeds it.
+static uint32_t randomState = 1;
+
+long random(long howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  randomState = randomState * 1664525UL + 1013904223UL;
+  return (long)((randomState >> 1) % (uint32_t)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    randomState = (uint32_t)seed;
+  }
+}
+
+char *ltoa(long value, char *buffer, int radix) {
+  const char *digits = "0123456789abcdefghijklmnopqrstuvwxyz";
+  unsigned long magnitude = value < 0 && radix == 10 ? -(unsigned long)value : (unsigned long)value;
+  char reversed[8 * sizeof(long) + 1];
+  int n = 0;
+  do {
+    reversed[n++] = digits[magnitude % radix];
+    magnitude /= radix;
+  } while (magnitude > 0);
+  char *out = buffer;
+  if (value < 0 && radix == 10) {
+    *out++ = '-';
+  }
+  while (n > 0) {
+    *out++ = reversed[--n];
+  }
+  *out = 0;
+  return buffer;
+}
+
+double ledcSetup(uint8_t channel, double freq, uint8_t resolution_bits) {
+  (void)channel;
+  (void)resolution_bits;
+  return freq;
+}
+
+void ledcAttachPin(uint8_t pin, uint8_t channel) {
+  (void)pin;
+  (void)channel;
+}
+
+void ledcWrite(uint8_t channel, uint32_t duty) {
+  (void)channel;
+  (void)duty;
+}
+
+uint32_t EspClass::getCycleCount() {
+  // Virtual time covers what the firmware spends blocked in delay() or on simulated
+  // peripherals, the host clock covers the CPU work in between.
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  uint64_t hostNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  return (uint32_t)((sim::nowUs() * 1000 + hostNs) * getCpuFreqMHz() / 1000);
+}
+
+void EspClass::restart() {
+  fprintf(stderr, "ESP.restart() called, stopping simulation\n");
+  exit(1);
+}
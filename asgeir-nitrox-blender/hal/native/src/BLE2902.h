@@ -0,0 +1,17 @@
+#pragma once
+
+#include "BLEDevice.h"
+
+/// @brief Client Characteristic Configuration descriptor, the central's subscription.
+class BLE2902 : public BLEDescriptor {
+public:
+  BLE2902() : BLEDescriptor("2902") {
+    uint8_t disabled[2] = { 0, 0 };
+    setValue(disabled, sizeof(disabled));
+  }
+
+  bool getNotifications() const { return value.size() == 2 && (value[0] & 0x01); }
+  bool getIndications() const { return value.size() == 2 && (value[0] & 0x02); }
+  void setNotifications(bool enable) { value.resize(2); value[0] = (value[0] & ~0x01) | (enable ? 0x01 : 0); }
+  void setIndications(bool enable) { value.resize(2); value[0] = (value[0] & ~0x02) | (enable ? 0x02 : 0); }
+};
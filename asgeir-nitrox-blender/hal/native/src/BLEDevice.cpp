@@ -0,0 +1,312 @@
+#include "BLEDevice.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BLE2902.h"
+#include "Simulator.h"
+
+/*
+ * The simulated central, a phone subscribing to the blender. --ble-connect <s> connects
+ * it while advertising. It asks for --ble-mtu right away, writes the CCCD of every
+ * notifying characteristic 1 ms later and sends what --ble-write holds. Notifications
+ * take the air time of a 1M PHY packet, --ble-capture appends their bytes to a file.
+ */
+#define BLE_CENTRAL_MTU 247
+#define BLE_SUBSCRIBE_DELAY_US 1000
+#define BLE_CONNECTION_ID 0
+
+namespace {
+
+struct Write {
+  uint64_t atUs;
+  std::vector<uint8_t> data;
+};
+
+uint64_t connectAtUs = 0;
+uint64_t disconnectAtUs = 0;
+bool isConnectRequested = false;
+bool isDisconnectRequested = false;
+uint16_t centralMtu = BLE_CENTRAL_MTU;
+std::vector<Write> &writes = *new std::vector<Write>();
+FILE *capture = NULL;
+
+uint16_t localMtu = 23;
+BLEServer *server = NULL;
+BLEAdvertising advertising;
+bool isAdvertising = false;
+bool isConnected = false;
+uint16_t connectionMtu = 23;
+
+uint32_t connections = 0;
+uint32_t notifications = 0;
+uint64_t notifiedBytes = 0;
+uint32_t notificationsDropped = 0;
+uint32_t writesDelivered = 0;
+
+bool parseHex(const char *text, std::vector<uint8_t> &out) {
+  size_t length = strlen(text);
+  if (length % 2 != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i += 2) {
+    char byte[3] = { text[i], text[i + 1], 0 };
+    char *end;
+    out.push_back((uint8_t)strtoul(byte, &end, 16));
+    if (*end != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool registerOptions() {
+  sim::addOption("--ble-connect", "a BLE central connects at <s> simulated seconds and subscribes",
+    [](const char *value) {
+      connectAtUs = (uint64_t)(atof(value) * 1e6);
+      isConnectRequested = true;
+    });
+  sim::addOption("--ble-disconnect", "the BLE central goes away at <s> simulated seconds",
+    [](const char *value) {
+      disconnectAtUs = (uint64_t)(atof(value) * 1e6);
+      isDisconnectRequested = true;
+    });
+  sim::addOption("--ble-mtu", "MTU the BLE central asks for (default: 247, 23 to not negotiate)",
+    [](const char *value) { centralMtu = (uint16_t)atoi(value); });
+  sim::addOption("--ble-write", "<s>=<hex>: the BLE central writes the bytes to the writable characteristic",
+    [](const char *value) {
+      const char *separator = strchr(value, '=');
+      Write write;
+      if (separator == NULL || !parseHex(separator + 1, write.data)) {
+        fprintf(stderr, "--ble-write wants <s>=<hex>\n");
+        exit(2);
+      }
+      write.atUs = (uint64_t)(atof(value) * 1e6);
+      writes.push_back(write);
+    });
+  sim::addOption("--ble-capture", "append the bytes of every BLE notification to a file",
+    [](const char *value) {
+      capture = fopen(value, "wb");
+      if (capture == NULL) {
+        fprintf(stderr, "cannot open %s\n", value);
+        exit(2);
+      }
+    });
+  return true;
+}
+bool optionsRegistered = registerOptions();
+
+/// @brief 1M PHY: preamble, access address, header, L2CAP and ATT headers, MIC-less, plus the
+/// inter-frame space and the central's empty packet.
+uint32_t airtimeUs(size_t length) {
+  return (uint32_t)((length + 14) * 8 + 150 + 80 + 150);
+}
+
+void forEachCharacteristic(void (*fn)(BLECharacteristic *characteristic, void *context), void *context) {
+  if (server == NULL) {
+    return;
+  }
+  for (size_t s = 0; s < server->services().size(); s++) {
+    const std::vector<BLECharacteristic *> &list = server->services()[s]->characteristics();
+    for (size_t c = 0; c < list.size(); c++) {
+      fn(list[c], context);
+    }
+  }
+}
+
+void subscribe(BLECharacteristic *characteristic, void *context) {
+  if (characteristic->getProperties() & BLECharacteristic::PROPERTY_NOTIFY) {
+    BLE2902 *cccd = (BLE2902 *)characteristic->getDescriptorByUUID("2902");
+    if (cccd != NULL) {
+      cccd->setNotifications(*(bool *)context);
+    }
+  }
+}
+
+void deliverWrite(BLECharacteristic *characteristic, void *context) {
+  const std::vector<uint8_t> &data = *(const std::vector<uint8_t> *)context;
+  uint32_t writable = BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR;
+  if ((characteristic->getProperties() & writable) && characteristic->getCallbacks() != NULL) {
+    characteristic->setValue(std::string(data.begin(), data.end()));
+    characteristic->getCallbacks()->onWrite(characteristic);
+    writesDelivered++;
+  }
+}
+
+void connect() {
+  if (server == NULL || !isAdvertising || isConnected) {
+    return;
+  }
+  // Once, a central that went away stays away.
+  isConnectRequested = false;
+  isAdvertising = false;
+  isConnected = true;
+  connectionMtu = 23;
+  connections++;
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.connect.conn_id = BLE_CONNECTION_ID;
+  if (server->getCallbacks() != NULL) {
+    server->getCallbacks()->onConnect(server);
+    server->getCallbacks()->onConnect(server, &param);
+  }
+
+  if (centralMtu > 23) {
+    connectionMtu = centralMtu < localMtu ? centralMtu : localMtu;
+    memset(&param, 0, sizeof(param));
+    param.mtu.conn_id = BLE_CONNECTION_ID;
+    param.mtu.mtu = connectionMtu;
+    if (server->getCallbacks() != NULL) {
+      server->getCallbacks()->onMtuChanged(server, &param);
+    }
+  }
+
+  sim::schedule(sim::nowUs() + BLE_SUBSCRIBE_DELAY_US, []() {
+    bool enable = true;
+    forEachCharacteristic(subscribe, &enable);
+  });
+}
+
+void disconnect() {
+  if (!isConnected) {
+    return;
+  }
+  isConnected = false;
+  bool enable = false;
+  forEachCharacteristic(subscribe, &enable);
+
+  esp_ble_gatts_cb_param_t param;
+  memset(&param, 0, sizeof(param));
+  param.disconnect.conn_id = BLE_CONNECTION_ID;
+  if (server->getCallbacks() != NULL) {
+    server->getCallbacks()->onDisconnect(server);
+    server->getCallbacks()->onDisconnect(server, &param);
+  }
+}
+
+}
+
+BLEDescriptor *BLECharacteristic::getDescriptorByUUID(const char *uuid) {
+  for (size_t i = 0; i < descriptors.size(); i++) {
+    if (descriptors[i]->getUUID() == uuid) {
+      return descriptors[i];
+    }
+  }
+  return NULL;
+}
+
+void BLECharacteristic::notify(bool isNotification) {
+  (void)isNotification;
+  BLE2902 *cccd = (BLE2902 *)getDescriptorByUUID("2902");
+  if (!isConnected || cccd == NULL || !cccd->getNotifications()) {
+    return;
+  }
+  // The stack cuts a value longer than the MTU allows.
+  size_t length = value.size() < (size_t)(connectionMtu - 3) ? value.size() : connectionMtu - 3;
+  if (length < value.size()) {
+    notificationsDropped++;
+  }
+  sim::waitUs(airtimeUs(length));
+
+  notifications++;
+  notifiedBytes += length;
+  if (capture != NULL) {
+    fwrite(value.data(), 1, length, capture);
+    fflush(capture);
+  }
+}
+
+BLECharacteristic *BLEService::createCharacteristic(const char *uuid, uint32_t properties) {
+  BLECharacteristic *characteristic = new BLECharacteristic(uuid, properties);
+  list.push_back(characteristic);
+  return characteristic;
+}
+
+BLEService *BLEServer::createService(const char *uuid) {
+  BLEService *service = new BLEService(uuid);
+  list.push_back(service);
+  return service;
+}
+
+void BLEServer::startAdvertising() {
+  advertising.start();
+}
+
+uint32_t BLEServer::getConnectedCount() {
+  return isConnected ? 1 : 0;
+}
+
+uint16_t BLEServer::getPeerMTU(uint16_t connId) {
+  (void)connId;
+  return connectionMtu;
+}
+
+void BLEAdvertising::start() {
+  isAdvertising = true;
+  // A central that asked to connect before the server advertised does so now.
+  if (isConnectRequested && sim::nowUs() >= connectAtUs) {
+    sim::schedule(sim::nowUs(), connect);
+  }
+}
+
+void BLEAdvertising::stop() {
+  isAdvertising = false;
+}
+
+void BLEDevice::init(const std::string &deviceName) {
+  (void)deviceName;
+  if (isConnectRequested) {
+    sim::schedule(connectAtUs, connect);
+  }
+  if (isDisconnectRequested) {
+    sim::schedule(disconnectAtUs, disconnect);
+  }
+  for (size_t i = 0; i < writes.size(); i++) {
+    const std::vector<uint8_t> *data = &writes[i].data;
+    sim::schedule(writes[i].atUs, [data]() {
+      if (isConnected) {
+        forEachCharacteristic(deliverWrite, (void *)data);
+      }
+    });
+  }
+}
+
+esp_err_t BLEDevice::setMTU(uint16_t mtu) {
+  localMtu = mtu;
+  return ESP_OK;
+}
+
+uint16_t BLEDevice::getMTU() {
+  return localMtu;
+}
+
+BLEServer *BLEDevice::createServer() {
+  server = new BLEServer();
+  return server;
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+  return &advertising;
+}
+
+void BLEDevice::startAdvertising() {
+  advertising.start();
+}
+
+namespace sim {
+
+void printBleSummary() {
+  if (server == NULL) {
+    return;
+  }
+  double seconds = nowUs() / 1e6;
+  fprintf(stderr, "ble              : %u connections, MTU %u, %u writes\n", connections, connectionMtu,
+    writesDelivered);
+  fprintf(stderr, "ble              : %u notifications, %llu bytes (%.0f bytes/s, %.1f each), %u cut short\n",
+    notifications, (unsigned long long)notifiedBytes, seconds > 0 ? notifiedBytes / seconds : 0,
+    notifications ? (double)notifiedBytes / notifications : 0, notificationsDropped);
+}
+
+}
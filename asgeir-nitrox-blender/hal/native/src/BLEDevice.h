@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "esp_err.h"
+
+/*
+ * Stand-in for the Bluedroid GATT server of the Arduino core (BLEDevice, BLEServer, ...),
+ * the parts a peripheral with notifications needs. There is no radio: one simulated
+ * central, set up on the command line (--ble-connect, see BLEDevice.cpp), connects,
+ * negotiates the MTU, subscribes to every notifying characteristic and can write to
+ * the writable ones. Its callbacks run on the simulator thread, like the BLE task.
+ */
+
+typedef union {
+  struct {
+    uint16_t conn_id;
+    uint8_t remote_bda[6];
+  } connect;
+  struct {
+    uint16_t conn_id;
+    uint8_t remote_bda[6];
+    int reason;
+  } disconnect;
+  struct {
+    uint16_t conn_id;
+    uint16_t mtu;
+  } mtu;
+} esp_ble_gatts_cb_param_t;
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLEDescriptor {
+public:
+  explicit BLEDescriptor(const char *uuid) : uuid(uuid) {}
+  virtual ~BLEDescriptor() {}
+
+  void setValue(const uint8_t *data, size_t size) { value.assign(data, data + size); }
+  const std::string &getUUID() const { return uuid; }
+
+protected:
+  std::string uuid;
+  std::vector<uint8_t> value;
+};
+
+class BLECharacteristicCallbacks {
+public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onRead(BLECharacteristic *characteristic) {}
+  virtual void onWrite(BLECharacteristic *characteristic) {}
+};
+
+class BLECharacteristic {
+public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+  static const uint32_t PROPERTY_BROADCAST = 1 << 3;
+  static const uint32_t PROPERTY_INDICATE = 1 << 4;
+  static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+
+  BLECharacteristic(const char *uuid, uint32_t properties) : uuid(uuid), properties(properties) {}
+
+  void addDescriptor(BLEDescriptor *descriptor) { descriptors.push_back(descriptor); }
+  BLEDescriptor *getDescriptorByUUID(const char *uuid);
+  void setCallbacks(BLECharacteristicCallbacks *callbacks) { this->callbacks = callbacks; }
+
+  void setValue(uint8_t *data, size_t size) { value.assign((const char *)data, size); }
+  void setValue(const std::string &value) { this->value = value; }
+  std::string getValue() const { return value; }
+
+  /// @brief Send the value to the central if it subscribed. Waits for the air time.
+  void notify(bool isNotification = true);
+
+  const std::string &getUUID() const { return uuid; }
+  uint32_t getProperties() const { return properties; }
+  BLECharacteristicCallbacks *getCallbacks() const { return callbacks; }
+
+private:
+  std::string uuid;
+  uint32_t properties;
+  std::string value;
+  std::vector<BLEDescriptor *> descriptors;
+  BLECharacteristicCallbacks *callbacks = NULL;
+};
+
+class BLEService {
+public:
+  explicit BLEService(const char *uuid) : uuid(uuid) {}
+
+  BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+  void start() {}
+
+  const std::string &getUUID() const { return uuid; }
+  const std::vector<BLECharacteristic *> &characteristics() const { return list; }
+
+private:
+  std::string uuid;
+  std::vector<BLECharacteristic *> list;
+};
+
+class BLEServerCallbacks {
+public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer *server) {}
+  virtual void onConnect(BLEServer *server, esp_ble_gatts_cb_param_t *param) {}
+  virtual void onDisconnect(BLEServer *server) {}
+  virtual void onDisconnect(BLEServer *server, esp_ble_gatts_cb_param_t *param) {}
+  virtual void onMtuChanged(BLEServer *server, esp_ble_gatts_cb_param_t *param) {}
+};
+
+class BLEServer {
+public:
+  void setCallbacks(BLEServerCallbacks *callbacks) { this->callbacks = callbacks; }
+  BLEService *createService(const char *uuid);
+  void startAdvertising();
+
+  uint32_t getConnectedCount();
+  uint16_t getPeerMTU(uint16_t connId);
+
+  BLEServerCallbacks *getCallbacks() const { return callbacks; }
+  const std::vector<BLEService *> &services() const { return list; }
+
+private:
+  BLEServerCallbacks *callbacks = NULL;
+  std::vector<BLEService *> list;
+};
+
+class BLEAdvertising {
+public:
+  void addServiceUUID(const char *uuid) { (void)uuid; }
+  void start();
+  void stop();
+};
+
+class BLEDevice {
+public:
+  static void init(const std::string &deviceName);
+  static esp_err_t setMTU(uint16_t mtu);
+  static uint16_t getMTU();
+  static BLEServer *createServer();
+  static BLEAdvertising *getAdvertising();
+  static void startAdvertising();
+};
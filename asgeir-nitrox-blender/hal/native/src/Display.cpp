@@ -0,0 +1,79 @@
+#include "Simulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef TFT_HOST_FRAMEBUFFER
+
+#include <string>
+
+#include "TFT_eSPI.h"
+
+#define FRAME_INTERVAL_US 1000000ULL
+
+/*
+ * The panel emulated by the TFT_eSPI host backend: PNG files of what it shows, and its
+ * bus counters in the summary.
+ */
+
+static std::string screenshotPath;
+static std::string frameDirectory;
+static uint32_t framesWritten = 0;
+
+static void writeFrame() {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/frame-%05u.png", frameDirectory.c_str(), framesWritten + 1);
+  if (!tftHostWritePng(path)) {
+    fprintf(stderr, "cannot write %s\n", path);
+    exit(2);
+  }
+  framesWritten++;
+  sim::schedule(sim::nowUs() + FRAME_INTERVAL_US, writeFrame);
+}
+
+static bool registerOptions() {
+  sim::addOption("--screenshot", "write what the panel shows at the end of the run to a PNG file",
+    [](const char *value) { screenshotPath = value; });
+  sim::addOption("--frames", "write what the panel shows to a PNG file in this directory every simulated second",
+    [](const char *value) {
+      frameDirectory = value;
+      sim::schedule(FRAME_INTERVAL_US, writeFrame);
+    });
+  return true;
+}
+static bool optionsRegistered = registerOptions();
+
+namespace sim {
+
+void printDisplaySummary() {
+  const TFT_HostStats &stats = tftHostStats();
+  double seconds = nowUs() / 1e6;
+  fprintf(stderr, "panel            : %u transactions, %u windows, %u address sets, %u commands\n",
+    stats.transactions, stats.windows, stats.addressSets, stats.commands);
+  fprintf(stderr, "panel            : %llu bytes written (%.0f bytes/s), %llu pixels, %llu bytes read\n",
+    (unsigned long long)stats.bytes, seconds > 0 ? stats.bytes / seconds : 0, (unsigned long long)stats.pixels,
+    (unsigned long long)stats.reads);
+  if (framesWritten > 0) {
+    fprintf(stderr, "panel            : %u frames in %s\n", framesWritten, frameDirectory.c_str());
+  }
+  if (!screenshotPath.empty()) {
+    if (tftHostWritePng(screenshotPath.c_str())) {
+      fprintf(stderr, "panel            : screenshot in %s\n", screenshotPath.c_str());
+    } else {
+      fprintf(stderr, "cannot write %s\n", screenshotPath.c_str());
+    }
+  }
+}
+
+}
+
+#else
+
+namespace sim {
+
+void printDisplaySummary() {
+}
+
+}
+
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <stdint.h>
+
+/// @brief The bits of EspClass the firmware uses. The cycle counter is virtual time plus
+/// host CPU time, scaled to the ESP32-S3 core frequency.
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getFreeHeap() { return 320 * 1024; }
+  void restart();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,246 @@
+#include "FS.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "Simulator.h"
+
+#define FLASH_BLOCK_SIZE 4096
+#define FLASH_PAGE_SIZE 256
+#define FLASH_PROGRAM_US 500  // Per page
+#define FLASH_ERASE_US 45000  // Per block
+
+namespace fs {
+
+class FileImpl {
+public:
+  std::string path;      // As seen by the firmware
+  std::string hostPath;
+  FILE *file = NULL;
+  bool isDirectory = false;
+  std::vector<std::string> entries;
+  size_t nextEntry = 0;
+  FS *owner = NULL;
+
+  ~FileImpl() {
+    if (file != NULL) {
+      fclose(file);
+    }
+  }
+};
+
+static size_t roundUpToBlock(size_t size) {
+  return (size + FLASH_BLOCK_SIZE - 1) / FLASH_BLOCK_SIZE * FLASH_BLOCK_SIZE;
+}
+
+static size_t usedBytesIn(const std::string &hostPath) {
+  DIR *dir = opendir(hostPath.c_str());
+  if (dir == NULL) {
+    return 0;
+  }
+  size_t used = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    std::string name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+    std::string child = hostPath + "/" + name;
+    struct stat info;
+    if (stat(child.c_str(), &info) != 0) {
+      continue;
+    }
+    used += S_ISDIR(info.st_mode) ? FLASH_BLOCK_SIZE + usedBytesIn(child) : roundUpToBlock(info.st_size);
+  }
+  closedir(dir);
+  return used;
+}
+
+size_t File::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t File::write(const uint8_t *buffer, size_t size) {
+  if (!impl || impl->file == NULL || size == 0) {
+    return 0;
+  }
+
+  long start = ftell(impl->file);
+  size_t fileSize = this->size();
+  size_t end = start + size;
+  size_t grownBlocks = 0;
+  if (end > fileSize) {
+    grownBlocks = roundUpToBlock(end) / FLASH_BLOCK_SIZE - roundUpToBlock(fileSize) / FLASH_BLOCK_SIZE;
+    if (impl->owner->usedBytes() + grownBlocks * FLASH_BLOCK_SIZE > impl->owner->capacityBytes()) {
+      return 0;
+    }
+  }
+
+  size_t written = fwrite(buffer, 1, size, impl->file);
+  fflush(impl->file);
+
+  size_t pages = (written + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+  sim::waitUs((uint64_t)pages * FLASH_PROGRAM_US + (uint64_t)grownBlocks * FLASH_ERASE_US);
+  return written;
+}
+
+int File::available() {
+  if (!impl || impl->file == NULL) {
+    return 0;
+  }
+  return (int)(size() - position());
+}
+
+int File::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+  if (!impl || impl->file == NULL) {
+    return 0;
+  }
+  return fread(buffer, 1, size, impl->file);
+}
+
+void File::flush() {
+  if (impl && impl->file != NULL) {
+    fflush(impl->file);
+  }
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+  if (!impl || impl->file == NULL) {
+    return false;
+  }
+  static const int whence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+  return fseek(impl->file, pos, whence[mode]) == 0;
+}
+
+size_t File::position() const {
+  if (!impl || impl->file == NULL) {
+    return 0;
+  }
+  return ftell(impl->file);
+}
+
+size_t File::size() const {
+  if (!impl) {
+    return 0;
+  }
+  struct stat info;
+  return stat(impl->hostPath.c_str(), &info) == 0 ? info.st_size : 0;
+}
+
+void File::close() {
+  impl.reset();
+}
+
+File::operator bool() const {
+  return impl && (impl->file != NULL || impl->isDirectory);
+}
+
+const char *File::path() const {
+  return impl ? impl->path.c_str() : NULL;
+}
+
+const char *File::name() const {
+  if (!impl) {
+    return NULL;
+  }
+  size_t slash = impl->path.rfind('/');
+  return impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory() const {
+  return impl && impl->isDirectory;
+}
+
+File File::openNextFile(const char *mode) {
+  if (!impl || !impl->isDirectory || impl->nextEntry >= impl->entries.size()) {
+    return File();
+  }
+  std::string child = impl->path == "/" ? "/" + impl->entries[impl->nextEntry] : impl->path + "/" + impl->entries[impl->nextEntry];
+  impl->nextEntry++;
+  return impl->owner->open(child.c_str(), mode);
+}
+
+void File::rewindDirectory() {
+  if (impl) {
+    impl->nextEntry = 0;
+  }
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  (void)create;
+  if (root.empty() || path == NULL || path[0] != '/') {
+    return File();
+  }
+
+  FileImplPtr impl(new FileImpl());
+  impl->path = path;
+  impl->hostPath = hostPath(path);
+  impl->owner = this;
+
+  struct stat info;
+  if (stat(impl->hostPath.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+    DIR *dir = opendir(impl->hostPath.c_str());
+    if (dir == NULL) {
+      return File();
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+      std::string name = entry->d_name;
+      if (name != "." && name != "..") {
+        impl->entries.push_back(name);
+      }
+    }
+    closedir(dir);
+    // readdir() order is arbitrary on the host, LittleFS lists a directory sorted.
+    std::sort(impl->entries.begin(), impl->entries.end());
+    impl->isDirectory = true;
+    return File(impl);
+  }
+
+  std::string hostMode = std::string(mode) + "b";
+  impl->file = fopen(impl->hostPath.c_str(), hostMode.c_str());
+  if (impl->file == NULL) {
+    return File();
+  }
+  return File(impl);
+}
+
+bool FS::exists(const char *path) {
+  struct stat info;
+  return !root.empty() && stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::remove(const char *path) {
+  return !root.empty() && unlink(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char *from, const char *to) {
+  return !root.empty() && ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char *path) {
+  return !root.empty() && (::mkdir(hostPath(path).c_str(), 0755) == 0 || exists(path));
+}
+
+bool FS::rmdir(const char *path) {
+  return !root.empty() && ::rmdir(hostPath(path).c_str()) == 0;
+}
+
+size_t FS::usedBytes() {
+  return root.empty() ? 0 : usedBytesIn(root);
+}
+
+std::string FS::hostPath(const char *path) const {
+  return root + path;
+}
+
+} // namespace fs
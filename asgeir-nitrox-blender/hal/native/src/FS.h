@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Print.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+class FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+/// @brief Arduino-ESP32 File, a handle to a host file or directory. Copies share the handle.
+class File : public Print {
+public:
+  File(FileImplPtr impl = FileImplPtr()) : impl(impl) {}
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  int available();
+  int read();
+  size_t read(uint8_t *buffer, size_t size);
+  void flush();
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  operator bool() const;
+  const char *path() const;
+  const char *name() const;
+
+  bool isDirectory() const;
+  File openNextFile(const char *mode = FILE_READ);
+  void rewindDirectory();
+
+private:
+  FileImplPtr impl;
+};
+
+/// @brief Arduino-ESP32 FS, paths are absolute within the file system ("/log/0001.bin").
+class FS {
+public:
+  File open(const char *path, const char *mode = FILE_READ, bool create = false);
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *from, const char *to);
+  bool mkdir(const char *path);
+  bool rmdir(const char *path);
+
+  /// @brief Bytes in use, every file rounded up to whole blocks like on the flash.
+  size_t usedBytes();
+  size_t capacityBytes() const { return capacity; }
+
+protected:
+  std::string hostPath(const char *path) const;
+
+  std::string root;     // Host directory, empty until mounted.
+  size_t capacity = 0;  // Writes past this fail, like on a full partition.
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
@@ -0,0 +1,136 @@
+#include "HardwareSerial.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+#include "Simulator.h"
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+
+static std::string &uart1Path() {
+  static std::string path;
+  return path;
+}
+
+static bool registerOptions() {
+  sim::addOption("--uart1", "connect Serial1 to a file or device, \"pty\" makes a pseudo terminal and runs in real time",
+    [](const char *value) {
+      uart1Path() = value;
+      if (uart1Path() == "pty") {
+        sim::options().realtime = true;
+      }
+    });
+  return true;
+}
+static bool optionsRegistered = registerOptions();
+
+/// @return the master side of a new pseudo terminal, its raw slave side stays open so it
+/// keeps working while no host program has it open.
+static int openPty() {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+    return -1;
+  }
+  const char *name = ptsname(master);
+  int slave = open(name, O_RDWR | O_NOCTTY);
+  if (slave < 0) {
+    return -1;
+  }
+  // No echo and no line editing, the bytes go through as they are.
+  struct termios settings;
+  tcgetattr(slave, &settings);
+  cfmakeraw(&settings);
+  tcsetattr(slave, TCSANOW, &settings);
+
+  fprintf(stderr, "Serial1: %s\n", name);
+  return master;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+  (void)baud;
+  (void)config;
+  (void)rxPin;
+  (void)txPin;
+  if (port != 1 || fd >= 0 || uart1Path().empty()) {
+    return;
+  }
+
+  const std::string &path = uart1Path();
+  fd = path == "pty" ? openPty() : open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_NOCTTY, 0644);
+  if (fd < 0) {
+    fprintf(stderr, "Serial1: cannot open %s\n", path.c_str());
+    exit(1);
+  }
+  // A UART does not wait for the other end either, what the host does not take is lost.
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+  if (port == 0) {
+    if (!sim::options().quiet) {
+      fwrite(buffer, 1, size, stdout);
+    }
+  } else if (fd >= 0) {
+    size_t offset = 0;
+    while (offset < size) {
+      ssize_t count = ::write(fd, buffer + offset, size - offset);
+      if (count <= 0) {
+        break;
+      }
+      offset += count;
+    }
+  }
+  written += size;
+  return size;
+}
+
+void HardwareSerial::flush() {
+  if (port == 0) {
+    fflush(stdout);
+  }
+}
+
+void HardwareSerial::receive() {
+  if (fd < 0) {
+    return;
+  }
+  uint8_t buffer[256];
+  ssize_t count;
+  while ((count = ::read(fd, buffer, sizeof(buffer))) > 0) {
+    input.insert(input.end(), buffer, buffer + count);
+  }
+}
+
+int HardwareSerial::available() {
+  receive();
+  return (int)input.size();
+}
+
+int HardwareSerial::read() {
+  if (input.empty()) {
+    receive();
+  }
+  if (input.empty()) {
+    return -1;
+  }
+  int c = input.front();
+  input.pop_front();
+  readCount++;
+  return c;
+}
+
+int HardwareSerial::peek() {
+  if (input.empty()) {
+    receive();
+  }
+  return input.empty() ? -1 : input.front();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+
+#include "Print.h"
+
+#define SERIAL_8N1 0x800001c
+
+/*
+ * Serial ports. Serial writes to stdout and takes input queued from the host side with
+ * inject(). Serial1 is connected to what --uart1 names: a file or device, or with "pty"
+ * a new pseudo terminal that a host program can open like a USB-UART cable. Without it
+ * Serial1 swallows everything.
+ */
+class HardwareSerial : public Print {
+public:
+  explicit HardwareSerial(int port) : port(port) {}
+
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  void end() {}
+  operator bool() const { return true; }
+  size_t setRxBufferSize(size_t size) { return size; }
+  size_t setTxBufferSize(size_t size) { return size; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+  void flush();
+  int availableForWrite() { return 4096; }
+
+  int available();
+  int read();
+  int peek();
+
+  void inject(const uint8_t *data, size_t size) { input.insert(input.end(), data, data + size); }
+
+  /// @brief Bytes written and read, for the simulation summary.
+  uint64_t bytesWritten() const { return written; }
+  uint64_t bytesRead() const { return readCount; }
+
+private:
+  void receive();
+
+  int port;
+  int fd = -1;
+  uint64_t written = 0;
+  uint64_t readCount = 0;
+  std::deque<uint8_t> input;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
@@ -0,0 +1,71 @@
+#include "LittleFS.h"
+
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "Simulator.h"
+
+#define LITTLEFS_PARTITION_SIZE 0x360000 // "spiffs" in default_16MB.csv
+
+fs::LittleFSFS LittleFS;
+
+static std::string &hostDirectory() {
+  static std::string directory;
+  return directory;
+}
+
+static bool registerOptions() {
+  sim::addOption("--littlefs", "host directory holding the LittleFS files (default: a new one in /tmp)",
+    [](const char *value) { hostDirectory() = value; });
+  return true;
+}
+static bool optionsRegistered = registerOptions();
+
+namespace fs {
+
+bool LittleFSFS::begin(bool formatOnFail, const char *basePath, uint8_t maxOpen, const char *partitionLabel) {
+  (void)formatOnFail;
+  (void)basePath;
+  (void)maxOpen;
+  (void)partitionLabel;
+
+  if (hostDirectory().empty()) {
+    char directory[] = "/tmp/littlefs-XXXXXX";
+    if (mkdtemp(directory) == NULL) {
+      return false;
+    }
+    hostDirectory() = directory;
+  } else if (::mkdir(hostDirectory().c_str(), 0755) != 0) {
+    struct stat info;
+    if (stat(hostDirectory().c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+      return false;
+    }
+  }
+
+  root = hostDirectory();
+  capacity = LITTLEFS_PARTITION_SIZE;
+  fprintf(stderr, "littlefs: %s\n", root.c_str());
+  return true;
+}
+
+void LittleFSFS::end() {
+  root.clear();
+}
+
+static int removeEntry(const char *path, const struct stat *info, int type, struct FTW *ftw) {
+  (void)info;
+  (void)type;
+  // Keep the mount point itself.
+  return ftw->level == 0 ? 0 : ::remove(path);
+}
+
+bool LittleFSFS::format() {
+  if (root.empty()) {
+    return false;
+  }
+  return nftw(root.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "FS.h"
+
+namespace fs {
+
+/*
+ * LittleFS on the "spiffs" partition, backed by a directory on the host (--littlefs,
+ * a fresh directory under /tmp by default) so the files can be inspected afterwards.
+ *
+ * Writes cost virtual time like the flash does: a page program per 256 bytes and a
+ * sector erase whenever a file grows into a new 4 KB block. The calling task blocks
+ * meanwhile, so the other tasks keep running as they would on the board.
+ */
+class LittleFSFS : public FS {
+public:
+  bool begin(bool formatOnFail = false, const char *basePath = "/littlefs", uint8_t maxOpen = 10,
+    const char *partitionLabel = "spiffs");
+  void end();
+  bool format();
+  size_t totalBytes() const { return capacity; }
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
@@ -0,0 +1,176 @@
+#include "Plant.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <mutex>
+#include <vector>
+
+#include "Arduino.h"
+#include "Simulator.h"
+
+#define AIR_O2_PERCENT 20.9f
+#define PLANT_STEP_US 1000
+#define PLANT_SAMPLE_US 100000
+#define PLANT_SCORE_SAMPLES 100 // The mix is scored as a 10 s mean, ripple from the valve averages out in the cylinder.
+
+namespace sim {
+
+namespace {
+
+struct ValveChange {
+  uint64_t atUs;
+  bool isOpen;
+};
+
+PlantOptions plantOpts;
+
+std::mutex &plantMutex = *new std::mutex();
+std::vector<ValveChange> valveChanges;
+size_t delayedIndex = 0;  // Last change that reached the cells, valveChanges only grows.
+uint64_t plantUs = 0;
+float mixPercent = AIR_O2_PERCENT;    // Leaving the stick, before the transport delay.
+float cellPercent = AIR_O2_PERCENT;   // What the cells see.
+float delayedMixPercent = AIR_O2_PERCENT;
+
+// Scoring
+float target = 0;
+float scoreWindow[PLANT_SCORE_SAMPLES];
+float scoreSum = 0;
+float scoredPercent = AIR_O2_PERCENT;
+float peakPercent = AIR_O2_PERCENT;
+uint64_t lastOutsideBandUs = 0;
+uint64_t firstInBandUs = UINT64_MAX;
+uint64_t samples = 0;
+uint64_t samplesInBand = 0;
+double absErrorSum = 0;
+uint64_t openUs = 0;
+
+bool valveOpenAt(uint64_t atUs, size_t &index) {
+  while (index + 1 < valveChanges.size() && valveChanges[index + 1].atUs <= atUs) {
+    index++;
+  }
+  return !valveChanges.empty() && valveChanges[index].atUs <= atUs && valveChanges[index].isOpen;
+}
+
+/// @brief Step the model up to atUs. Lock must be held.
+void integrateTo(uint64_t atUs) {
+  const float dt = PLANT_STEP_US / 1e6f;
+  const float mixAlpha = 1 - expf(-dt / plantOpts.mixTauSeconds);
+  const float cellAlpha = 1 - expf(-dt / plantOpts.cellTauSeconds);
+  const uint64_t delayUs = (uint64_t)(plantOpts.delaySeconds * 1e6f);
+
+  size_t nowIndex = delayedIndex;
+  while (plantUs + PLANT_STEP_US <= atUs) {
+    plantUs += PLANT_STEP_US;
+
+    bool isOpen = valveOpenAt(plantUs, nowIndex);
+    if (isOpen) {
+      openUs += PLANT_STEP_US;
+    }
+    float input = AIR_O2_PERCENT + (isOpen ? plantOpts.gainPercent : 0);
+    mixPercent += (input - mixPercent) * mixAlpha;
+
+    // The cells see the gas that left the valve delayUs ago.
+    bool wasOpen = plantUs >= delayUs && valveOpenAt(plantUs - delayUs, delayedIndex);
+    float delayedInput = AIR_O2_PERCENT + (wasOpen ? plantOpts.gainPercent : 0);
+    delayedMixPercent += (delayedInput - delayedMixPercent) * mixAlpha;
+    cellPercent += (delayedMixPercent - cellPercent) * cellAlpha;
+  }
+}
+
+void sample() {
+  uint64_t now = nowUs();
+  {
+    std::lock_guard<std::mutex> lock(plantMutex);
+    integrateTo(now);
+
+    int slot = samples % PLANT_SCORE_SAMPLES;
+    scoreSum += mixPercent - (samples < PLANT_SCORE_SAMPLES ? 0 : scoreWindow[slot]);
+    scoreWindow[slot] = mixPercent;
+    samples++;
+    scoredPercent = scoreSum / (samples < PLANT_SCORE_SAMPLES ? samples : PLANT_SCORE_SAMPLES);
+
+    float error = scoredPercent - target;
+    absErrorSum += fabsf(error);
+    if (scoredPercent > peakPercent) {
+      peakPercent = scoredPercent;
+    }
+    if (fabsf(error) <= plantOpts.bandPercent) {
+      samplesInBand++;
+      if (firstInBandUs == UINT64_MAX) {
+        firstInBandUs = now;
+      }
+    } else {
+      lastOutsideBandUs = now;
+    }
+  }
+  schedule(now + PLANT_SAMPLE_US, sample);
+}
+
+}
+
+PlantOptions &plantOptions() {
+  return plantOpts;
+}
+
+void startPlant() {
+  if (plantOpts.targetPercent >= 0) {
+    target = plantOpts.targetPercent;
+  } else {
+    target = map(analogRead(plantOpts.setPointPin), 0, 4095, 0, 40);
+  }
+
+  onPinWrite([](uint8_t pin, int level, uint64_t atUs) {
+    if (pin != plantOpts.valvePin) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(plantMutex);
+    integrateTo(atUs);
+    if (valveChanges.empty() || valveChanges.back().isOpen != (level == HIGH)) {
+      valveChanges.push_back(ValveChange { atUs, level == HIGH });
+    }
+  });
+
+  setCellSource([](int cell, uint64_t atUs) {
+    std::lock_guard<std::mutex> lock(plantMutex);
+    integrateTo(atUs);
+    return options().cellMillivolts[cell] * cellPercent / AIR_O2_PERCENT;
+  });
+
+  schedule(PLANT_SAMPLE_US, sample);
+}
+
+float plantMixPercent() {
+  std::lock_guard<std::mutex> lock(plantMutex);
+  integrateTo(nowUs());
+  return mixPercent;
+}
+
+void printPlantSummary() {
+  if (!plantOpts.enabled) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(plantMutex);
+  double seconds = plantUs / 1e6;
+  bool settled = samples > 0 && lastOutsideBandUs < plantUs - PLANT_SAMPLE_US;
+
+  fprintf(stderr, "plant target     : %.1f %% O2 (band +-%.1f)\n", target, plantOpts.bandPercent);
+  fprintf(stderr, "plant final mix  : %.2f %% O2 (10 s mean), peak %.2f %% (overshoot %.2f)\n", scoredPercent, peakPercent,
+    peakPercent > target ? peakPercent - target : 0.0f);
+  if (firstInBandUs != UINT64_MAX) {
+    fprintf(stderr, "plant first in band: %.1f s\n", firstInBandUs / 1e6);
+  }
+  if (settled) {
+    fprintf(stderr, "plant settled at : %.1f s\n", lastOutsideBandUs / 1e6);
+  } else {
+    fprintf(stderr, "plant settled at : never\n");
+  }
+  fprintf(stderr, "plant in band    : %.1f %% of the time, mean abs error %.2f\n",
+    samples ? samplesInBand * 100.0 / samples : 0.0, samples ? absErrorSum / samples : 0.0);
+  fprintf(stderr, "plant valve      : open %.1f %% of the time, %u switches\n", seconds > 0 ? openUs / 1e4 / seconds : 0.0,
+    (unsigned)(valveChanges.size() > 0 ? valveChanges.size() - 1 : 0));
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Model of the blending stick and the O2 cells, enabled with --plant.
+ *
+ * Oxygen enters the stick while the solenoid pin is HIGH and raises the O2 fraction
+ * of the mixed gas by gainPercent at steady state. The mix reaches the cells after a
+ * transport delay, mixes with a first-order lag and the cells answer with another
+ * first-order lag. Each cell outputs its --cell voltage at 20.9 % and scales linearly.
+ *
+ * The mix leaving the stick (what the compressor takes in) is sampled every 100 ms
+ * and scored against the set-point: overshoot, settling time, time within the band
+ * and valve activity, printed with the simulation summary.
+ */
+namespace sim {
+
+struct PlantOptions {
+  bool enabled = false;
+  uint8_t valvePin = 3;           // PIN_SOLENOID_SIGNAL
+  uint8_t setPointPin = 2;        // PIN_POTENTIOMETER, mapped to 0-40 % like the firmware
+  float targetPercent = -1;       // Overrides the potentiometer if >= 0.
+  float gainPercent = 30.0f;      // O2 % added with the valve open all the time.
+  float delaySeconds = 3.0f;      // Transport delay from the valve to the cells.
+  float mixTauSeconds = 2.0f;
+  float cellTauSeconds = 2.5f;
+  float bandPercent = 0.5f;       // Settled when within target +- band.
+};
+
+PlantOptions &plantOptions();
+
+/// @brief Hook the plant into the pins and the ADS1115, called by parseArgs() when enabled.
+void startPlant();
+
+/// @brief O2 % of the mix leaving the stick right now.
+float plantMixPercent();
+
+void printPlantSummary();
+
+}
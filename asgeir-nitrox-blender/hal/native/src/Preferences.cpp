@@ -0,0 +1,133 @@
+#include "Preferences.h"
+
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Simulator.h"
+
+typedef std::vector<uint8_t> Blob;
+typedef std::map<std::string, Blob> Namespace;
+
+static std::map<std::string, Namespace> &storage() {
+  static std::map<std::string, Namespace> nvs;
+  return nvs;
+}
+
+template <typename T> static size_t putValue(const String &ns, const char *key, const T &value) {
+  const uint8_t *bytes = (const uint8_t *)&value;
+  storage()[ns.c_str()][key] = Blob(bytes, bytes + sizeof(T));
+  return sizeof(T);
+}
+
+template <typename T> static T getValue(const String &ns, const char *key, T defaultValue) {
+  Namespace &entries = storage()[ns.c_str()];
+  Namespace::const_iterator it = entries.find(key);
+  if (it == entries.end() || it->second.size() != sizeof(T)) {
+    return defaultValue;
+  }
+  T value;
+  memcpy(&value, it->second.data(), sizeof(T));
+  return value;
+}
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel) {
+  (void)partitionLabel;
+  ns = name;
+  started = true;
+  this->readOnly = readOnly;
+  storage()[name];
+  return true;
+}
+
+void Preferences::end() {
+  started = false;
+}
+
+bool Preferences::clear() {
+  if (!started || readOnly) {
+    return false;
+  }
+  storage()[ns.c_str()].clear();
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!started || readOnly) {
+    return false;
+  }
+  return storage()[ns.c_str()].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  return started && storage()[ns.c_str()].count(key) > 0;
+}
+
+size_t Preferences::putFloat(const char *key, float value) {
+  return started && !readOnly ? putValue(ns, key, value) : 0;
+}
+
+size_t Preferences::putInt(const char *key, int32_t value) {
+  return started && !readOnly ? putValue(ns, key, value) : 0;
+}
+
+size_t Preferences::putUInt(const char *key, uint32_t value) {
+  return started && !readOnly ? putValue(ns, key, value) : 0;
+}
+
+size_t Preferences::putBool(const char *key, bool value) {
+  return started && !readOnly ? putValue(ns, key, (uint8_t)value) : 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!started || readOnly) {
+    return 0;
+  }
+  const uint8_t *bytes = (const uint8_t *)value;
+  storage()[ns.c_str()][key] = Blob(bytes, bytes + len);
+  return len;
+}
+
+float Preferences::getFloat(const char *key, float defaultValue) {
+  return started ? getValue(ns, key, defaultValue) : defaultValue;
+}
+
+int32_t Preferences::getInt(const char *key, int32_t defaultValue) {
+  return started ? getValue(ns, key, defaultValue) : defaultValue;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue) {
+  return started ? getValue(ns, key, defaultValue) : defaultValue;
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue) {
+  return started ? getValue(ns, key, (uint8_t)defaultValue) != 0 : defaultValue;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  if (!started) {
+    return 0;
+  }
+  Namespace &entries = storage()[ns.c_str()];
+  Namespace::const_iterator it = entries.find(key);
+  return it == entries.end() ? 0 : it->second.size();
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  size_t len = getBytesLength(key);
+  if (len == 0 || len > maxLen) {
+    return 0;
+  }
+  memcpy(buf, storage()[ns.c_str()][key].data(), len);
+  return len;
+}
+
+void sim::preferencesPutFloat(const char *ns, const char *key, float value) {
+  putValue(String(ns), key, value);
+}
+
+void sim::preferencesPutInt(const char *ns, const char *key, int32_t value) {
+  putValue(String(ns), key, value);
+}
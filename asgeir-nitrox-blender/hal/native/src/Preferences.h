@@ -0,0 +1,36 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "WString.h"
+
+/// @brief In-memory NVS. Namespaces live for the lifetime of the process.
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = NULL);
+  void end();
+
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putFloat(const char *key, float value);
+  size_t putInt(const char *key, int32_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putBool(const char *key, bool value);
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  float getFloat(const char *key, float defaultValue = NAN);
+  int32_t getInt(const char *key, int32_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  bool getBool(const char *key, bool defaultValue = false);
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+  String ns;
+  bool started = false;
+  bool readOnly = false;
+};
@@ -0,0 +1,45 @@
+#include "Print.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::printf(const char *format, ...) {
+  char buffer[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  return write((const uint8_t *)buffer, std::min((size_t)len, sizeof(buffer) - 1));
+}
+
+size_t Print::print(long value, int base) {
+  if (base == DEC) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), "%ld", value);
+    return write(buffer);
+  }
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", value);
+  return write(buffer);
+}
+
+size_t Print::print(double value, int digits) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+  return write(buffer);
+}
@@ -0,0 +1,544 @@
+#include "Simulator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "Plant.h"
+
+namespace sim {
+
+namespace {
+
+struct Event {
+  uint64_t dueUs;
+  uint64_t order;
+  std::function<void()> fn;
+
+  bool operator>(const Event &other) const {
+    return dueUs != other.dueUs ? dueUs > other.dueUs : order > other.order;
+  }
+};
+
+struct Pin {
+  uint8_t mode = INPUT;
+  int level = LOW;
+  uint16_t analog = 0;
+  uint32_t transitions = 0;
+  bool driven = false;             // Level set from the host side, pull-ups don't override it.
+  void (*isr)(void) = NULL;
+  int isrMode = 0;
+};
+
+struct BlockedTask {
+  std::function<bool()> ready;
+  uint64_t wakeAtUs;
+  int priority;
+  bool blocked;
+  std::condition_variable *wake;
+};
+
+Options opts;
+std::atomic<uint64_t> clockUs(0);
+
+// Scheduler state. Allocated once and never freed: detached task threads may still
+// be blocked on the condition variable while the process exits.
+std::mutex &schedulerMutex = *new std::mutex();
+std::condition_variable &loopWake = *new std::condition_variable();
+std::condition_variable &realtimeWake = *new std::condition_variable(); // schedule() cuts a realtime wait short
+uint64_t eventOrder = 0;
+std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+std::vector<BlockedTask *> blockedTasks;
+int runnableTasks = 0;
+bool loopWaiting = false;   // loop() is in advanceUs(), until loopWakeAtUs.
+uint64_t loopWakeAtUs = 0;
+thread_local bool isTaskThread = false;
+thread_local int taskPriority = 0;
+thread_local std::condition_variable *taskWake = NULL; // Per task thread, never freed either.
+
+std::mutex &pinMutex = *new std::mutex();
+std::map<uint8_t, Pin> pins;
+std::vector<PinWriteHook> pinWriteHooks;
+
+CellSource cellSource;
+std::mt19937 noiseEngine;
+std::normal_distribution<float> noise(0.0f, 1.0f);
+
+uint64_t loopIterations = 0;
+std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+
+struct ExtraOption {
+  std::string name;
+  std::string help;
+  OptionHandler handler;
+};
+
+// Function local so addOption() works from static initializers of other files.
+std::vector<ExtraOption> &extraOptions() {
+  static std::vector<ExtraOption> registered;
+  return registered;
+}
+
+void usage(const char *program) {
+  fprintf(stderr,
+    "usage: %s [options]\n"
+    "  --duration <s>        simulated seconds to run (default 60)\n"
+    "  --tick-us <us>        virtual time per loop() iteration (default 100)\n"
+    "  --cell <i>=<mV>       constant voltage on O2 cell i (default 10.0)\n"
+    "  --noise <mV>          gaussian noise added to each cell sample\n"
+    "  --seed <n>            noise seed\n"
+    "  --analog <pin>=<raw>  value returned by analogRead(pin)\n"
+    "  --input <pin>=<0|1>   level returned by digitalRead(pin)\n"
+    "  --press <pin>@<s>     pull pin low for 100 ms at <s> simulated seconds (button)\n"
+    "  --send <s>=<text>     type text into Serial at <s> simulated seconds\n"
+    "  --pref <ns>.<key>=<f> preset a float in Preferences\n"
+    "  --pref-int <ns>.<key>=<n> preset an int in Preferences\n"
+    "  --plant               simulate the blending stick, see Plant.h\n"
+    "  --plant-gain <%%>      O2 added with the valve open (default 30)\n"
+    "  --plant-delay <s>     transport delay to the cells (default 3)\n"
+    "  --plant-tau <s>       mixing time constant (default 2)\n"
+    "  --plant-cell-tau <s>  cell time constant (default 2.5)\n"
+    "  --plant-target <%%>    score against this set-point instead of the potentiometer\n"
+    "  --realtime            let virtual time follow the wall clock\n"
+    "  --quiet               drop Serial output\n",
+    program);
+  for (size_t i = 0; i < extraOptions().size(); i++) {
+    fprintf(stderr, "  %-21s %s\n", extraOptions()[i].name.c_str(), extraOptions()[i].help.c_str());
+  }
+  exit(2);
+}
+
+bool splitAssignment(const char *arg, std::string &lhs, std::string &rhs) {
+  const char *eq = strchr(arg, '=');
+  if (eq == NULL) {
+    return false;
+  }
+  lhs.assign(arg, eq - arg);
+  rhs.assign(eq + 1);
+  return true;
+}
+
+}
+
+Options &options() {
+  return opts;
+}
+
+void addOption(const char *name, const char *help, OptionHandler handler) {
+  extraOptions().push_back(ExtraOption { name, help, handler });
+}
+
+void parseArgs(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    std::string lhs, rhs;
+
+    if (arg == "--quiet") {
+      opts.quiet = true;
+      continue;
+    }
+    if (arg == "--realtime") {
+      opts.realtime = true;
+      continue;
+    }
+    if (arg == "--plant") {
+      plantOptions().enabled = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+    }
+    const char *value = argv[++i];
+
+    bool handled = false;
+    for (size_t j = 0; j < extraOptions().size(); j++) {
+      if (arg == extraOptions()[j].name) {
+        extraOptions()[j].handler(value);
+        handled = true;
+      }
+    }
+    if (handled) {
+      continue;
+    }
+
+    if (arg == "--duration") {
+      opts.durationUs = (uint64_t)(atof(value) * 1e6);
+    } else if (arg == "--tick-us") {
+      opts.tickUs = (uint32_t)atol(value);
+    } else if (arg == "--noise") {
+      opts.cellNoiseMillivolts = atof(value);
+    } else if (arg == "--seed") {
+      opts.seed = (uint32_t)atol(value);
+    } else if (arg == "--cell" && splitAssignment(value, lhs, rhs)) {
+      int cell = atoi(lhs.c_str());
+      if (cell < 0 || cell > 1) {
+        usage(argv[0]);
+      }
+      opts.cellMillivolts[cell] = atof(rhs.c_str());
+    } else if (arg == "--analog" && splitAssignment(value, lhs, rhs)) {
+      setAnalogInput((uint8_t)atoi(lhs.c_str()), (uint16_t)atoi(rhs.c_str()));
+    } else if (arg == "--input" && splitAssignment(value, lhs, rhs)) {
+      setDigitalInput((uint8_t)atoi(lhs.c_str()), atoi(rhs.c_str()) ? HIGH : LOW);
+    } else if (arg == "--press" && strchr(value, '@') != NULL) {
+      uint8_t pin = (uint8_t)atoi(value);
+      uint64_t atUs = (uint64_t)(atof(strchr(value, '@') + 1) * 1e6);
+      setDigitalInput(pin, HIGH);
+      schedule(atUs, [pin]() { setDigitalInput(pin, LOW); });
+      schedule(atUs + 100000, [pin]() { setDigitalInput(pin, HIGH); });
+    } else if (arg == "--plant-gain") {
+      plantOptions().gainPercent = atof(value);
+    } else if (arg == "--plant-delay") {
+      plantOptions().delaySeconds = atof(value);
+    } else if (arg == "--plant-tau") {
+      plantOptions().mixTauSeconds = atof(value);
+    } else if (arg == "--plant-cell-tau") {
+      plantOptions().cellTauSeconds = atof(value);
+    } else if (arg == "--plant-target") {
+      plantOptions().targetPercent = atof(value);
+    } else if (arg == "--send" && splitAssignment(value, lhs, rhs)) {
+      uint64_t atUs = (uint64_t)(atof(lhs.c_str()) * 1e6);
+      schedule(atUs, [rhs]() { Serial.inject((const uint8_t *)rhs.data(), rhs.size()); });
+    } else if (arg == "--pref-int" && splitAssignment(value, lhs, rhs) && lhs.find('.') != std::string::npos) {
+      size_t dot = lhs.find('.');
+      preferencesPutInt(lhs.substr(0, dot).c_str(), lhs.substr(dot + 1).c_str(), atoi(rhs.c_str()));
+    } else if (arg == "--pref" && splitAssignment(value, lhs, rhs) && lhs.find('.') != std::string::npos) {
+      size_t dot = lhs.find('.');
+      preferencesPutFloat(lhs.substr(0, dot).c_str(), lhs.substr(dot + 1).c_str(), atof(rhs.c_str()));
+    } else {
+      usage(argv[0]);
+    }
+  }
+  noiseEngine.seed(opts.seed);
+
+  if (plantOptions().enabled) {
+    startPlant();
+  }
+}
+
+uint64_t nowUs() {
+  return clockUs.load();
+}
+
+/*
+ * Tasks run one at a time, like on a single core: a task is only woken once every
+ * other task is blocked again, the highest priority task that is ready goes first and
+ * the one that blocked first wins a tie. With the events also run one by one a
+ * simulation is deterministic, the same inputs give the same run.
+ *
+ * Lock must be held. The caller notifies the returned task after releasing the lock, so
+ * the woken thread does not block on the mutex right away.
+*/
+static std::condition_variable *wakeReadyTask() {
+  if (runnableTasks > 0) {
+    return NULL;
+  }
+
+  BlockedTask *next = NULL;
+  for (size_t i = 0; i < blockedTasks.size(); i++) {
+    BlockedTask *task = blockedTasks[i];
+    if (!task->blocked || (next != NULL && task->priority <= next->priority)) {
+      continue;
+    }
+    if (task->wakeAtUs <= clockUs.load() || (task->ready && task->ready())) {
+      next = task;
+    }
+  }
+  if (next == NULL) {
+    return NULL;
+  }
+
+  next->blocked = false;
+  runnableTasks++;
+  return next->wake;
+}
+
+/*
+ * Called when the running thread stops: runs the due events, wakes the next task or
+ * advances the clock. Whichever thread finds everything blocked does the work, so a
+ * task that blocks hands over to the next one directly instead of through loop().
+ * The clock only moves while loop() waits in advanceUs(), in realtime mode no faster
+ * than the wall clock. Releases the lock.
+*/
+static void dispatch(std::unique_lock<std::mutex> &lock) {
+  while (runnableTasks == 0) {
+    if (loopWaiting && !events.empty() && events.top().dueUs <= clockUs.load()) {
+      std::function<void()> due = events.top().fn;
+      events.pop();
+
+      // Events run without the lock, they act like interrupts and may wake tasks.
+      lock.unlock();
+      due();
+      lock.lock();
+      continue;
+    }
+
+    std::condition_variable *woken = wakeReadyTask();
+    if (woken != NULL) {
+      lock.unlock();
+      woken->notify_one();
+      return;
+    }
+    if (!loopWaiting) {
+      break;
+    }
+    if (clockUs.load() >= loopWakeAtUs) {
+      loopWaiting = false;
+      lock.unlock();
+      loopWake.notify_one();
+      return;
+    }
+
+    uint64_t next = loopWakeAtUs;
+    if (!events.empty() && events.top().dueUs < next) {
+      next = events.top().dueUs;
+    }
+    for (size_t i = 0; i < blockedTasks.size(); i++) {
+      if (blockedTasks[i]->blocked && blockedTasks[i]->wakeAtUs < next) {
+        next = blockedTasks[i]->wakeAtUs;
+      }
+    }
+    if (opts.realtime) {
+      // Another thread may schedule an event meanwhile, then go on from the wall clock.
+      realtimeWake.wait_until(lock, wallStart + std::chrono::microseconds(next));
+      uint64_t wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wallStart).count();
+      if (wallUs < next) {
+        clockUs.store(std::max(clockUs.load(), wallUs));
+        continue;
+      }
+    }
+    clockUs.store(next);
+  }
+  lock.unlock();
+}
+
+void advanceUs(uint64_t us) {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  loopWakeAtUs = clockUs.load() + us;
+  loopWaiting = true;
+  dispatch(lock);
+
+  lock.lock();
+  loopWake.wait(lock, []() { return !loopWaiting; });
+}
+
+void waitUs(uint64_t us) {
+  if (isTaskThread) {
+    blockTask(std::function<bool()>(), nowUs() + us);
+  } else {
+    advanceUs(us);
+  }
+}
+
+void schedule(uint64_t dueUs, std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lock(schedulerMutex);
+    events.push(Event { dueUs, eventOrder++, fn });
+  }
+  realtimeWake.notify_one();
+}
+
+void taskCreated() {
+  std::lock_guard<std::mutex> lock(schedulerMutex);
+  runnableTasks++;
+}
+
+void enterTask(int priority) {
+  isTaskThread = true;
+  taskPriority = priority;
+}
+
+void taskExited() {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  runnableTasks--;
+  dispatch(lock);
+}
+
+bool inTask() {
+  return isTaskThread;
+}
+
+bool blockTask(std::function<bool()> ready, uint64_t wakeAtUs) {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  if (ready && ready()) {
+    return true;
+  }
+  if (wakeAtUs <= clockUs.load()) {
+    return false;
+  }
+
+  BlockedTask task;
+  task.ready = ready;
+  task.wakeAtUs = wakeAtUs;
+  task.priority = taskPriority;
+  task.blocked = true;
+  if (taskWake == NULL) {
+    taskWake = new std::condition_variable();
+  }
+  task.wake = taskWake;
+  blockedTasks.push_back(&task);
+  runnableTasks--;
+  dispatch(lock);
+
+  lock.lock();
+  taskWake->wait(lock, [&task]() { return !task.blocked; });
+  blockedTasks.erase(std::find(blockedTasks.begin(), blockedTasks.end(), &task));
+  return ready && ready();
+}
+
+void signalTasks(std::function<void()> fn) {
+  std::unique_lock<std::mutex> lock(schedulerMutex);
+  fn();
+  std::condition_variable *woken = wakeReadyTask();
+  lock.unlock();
+
+  if (woken != NULL) {
+    woken->notify_one();
+  }
+}
+
+void endLoopIteration() {
+  loopIterations++;
+  advanceUs(opts.tickUs);
+}
+
+bool running() {
+  return clockUs.load() < opts.durationUs;
+}
+
+void printSummary() {
+  double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+  double simSeconds = nowUs() / 1e6;
+
+  fprintf(stderr, "\n--- simulation summary ---\n");
+  fprintf(stderr, "simulated time   : %.3f s\n", simSeconds);
+  fprintf(stderr, "wall time        : %.3f s (%.0fx real time)\n", wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0);
+  fprintf(stderr, "loop() iterations: %llu (%.0f per wall second)\n", (unsigned long long)loopIterations,
+    wallSeconds > 0 ? loopIterations / wallSeconds : 0);
+  fprintf(stderr, "esp_now frames   : %u (%llu bytes)\n", espNowFramesSent(), (unsigned long long)espNowBytesSent());
+  printEspNowSummary();
+  printBleSummary();
+  printDisplaySummary();
+  if (Serial1.bytesWritten() > 0 || Serial1.bytesRead() > 0) {
+    fprintf(stderr, "Serial1          : %llu bytes written, %llu read\n", (unsigned long long)Serial1.bytesWritten(),
+      (unsigned long long)Serial1.bytesRead());
+  }
+  std::lock_guard<std::mutex> lock(pinMutex);
+  for (std::map<uint8_t, Pin>::const_iterator it = pins.begin(); it != pins.end(); ++it) {
+    if (it->second.mode == OUTPUT) {
+      fprintf(stderr, "pin %-3u          : %s, %u transitions\n", it->first, it->second.level ? "HIGH" : "LOW",
+        it->second.transitions);
+    }
+  }
+  printPlantSummary();
+}
+
+void setDigitalInput(uint8_t pin, int level) {
+  void (*isr)(void) = NULL;
+  {
+    std::lock_guard<std::mutex> lock(pinMutex);
+    Pin &state = pins[pin];
+    bool rising = state.level == LOW && level == HIGH;
+    bool falling = state.level == HIGH && level == LOW;
+    state.level = level;
+    state.driven = true;
+
+    if ((state.isrMode == RISING && rising) || (state.isrMode == FALLING && falling) ||
+      (state.isrMode == CHANGE && (rising || falling))) {
+      isr = state.isr;
+    }
+  }
+  if (isr) {
+    isr();
+  }
+}
+
+void setAnalogInput(uint8_t pin, uint16_t value) {
+  std::lock_guard<std::mutex> lock(pinMutex);
+  pins[pin].analog = value;
+}
+
+int pinLevel(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(pinMutex);
+  return pins[pin].level;
+}
+
+uint32_t pinTransitions(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(pinMutex);
+  return pins[pin].transitions;
+}
+
+void onPinWrite(PinWriteHook hook) {
+  std::lock_guard<std::mutex> lock(pinMutex);
+  pinWriteHooks.push_back(hook);
+}
+
+void setCellSource(CellSource source) {
+  cellSource = source;
+}
+
+float cellMillivolts(int cell) {
+  float mv = cellSource ? cellSource(cell, nowUs()) : opts.cellMillivolts[cell];
+  if (opts.cellNoiseMillivolts > 0) {
+    std::lock_guard<std::mutex> lock(pinMutex);
+    mv += noise(noiseEngine) * opts.cellNoiseMillivolts;
+  }
+  return mv;
+}
+
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  std::lock_guard<std::mutex> lock(sim::pinMutex);
+  sim::pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP && !sim::pins[pin].driven) {
+    sim::pins[pin].level = HIGH;
+  }
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  int level = val ? HIGH : LOW;
+  std::vector<sim::PinWriteHook> hooks;
+  {
+    std::lock_guard<std::mutex> lock(sim::pinMutex);
+    sim::Pin &state = sim::pins[pin];
+    if (state.level != level) {
+      state.transitions++;
+    }
+    state.level = level;
+    hooks = sim::pinWriteHooks;
+  }
+  for (size_t i = 0; i < hooks.size(); i++) {
+    hooks[i](pin, level, sim::nowUs());
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(sim::pinMutex);
+  return sim::pins[pin].level;
+}
+
+uint16_t analogRead(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(sim::pinMutex);
+  return sim::pins[pin].analog;
+}
+
+void attachInterrupt(uint8_t pin, void (*isr)(void), int mode) {
+  std::lock_guard<std::mutex> lock(sim::pinMutex);
+  sim::pins[pin].isr = isr;
+  sim::pins[pin].isrMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  std::lock_guard<std::mutex> lock(sim::pinMutex);
+  sim::pins[pin].isr = NULL;
+  sim::pins[pin].isrMode = 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+
+/*
+ * Control surface of the native HAL.
+ *
+ * The firmware only sees the Arduino style API (millis(), analogRead(), ...). Everything
+ * below is for the host runner and for tools that need to drive or observe the
+ * simulated board. Time is virtual: it only moves when the runner ends a loop()
+ * iteration, when the firmware calls delay() or when a simulated peripheral blocks
+ * (e.g. a single-shot ADS1115 conversion).
+ *
+ * FreeRTOS tasks run on real threads next to loop(). The clock only moves forward
+ * once every task is blocked (in vTaskDelay(), ulTaskNotifyTake(), ...), so a task
+ * always sees its wake-up time and never falls behind virtual time.
+ */
+namespace sim {
+
+struct Options {
+  uint64_t durationUs = 60ULL * 1000 * 1000;
+  uint32_t tickUs = 100;           // Virtual time spent by one loop() iteration.
+  bool quiet = false;              // Drop everything written to Serial.
+  float cellMillivolts[2] = { 10.0f, 10.0f };
+  float cellNoiseMillivolts = 0;
+  uint32_t seed = 1;
+  bool realtime = false;           // Virtual time does not run ahead of the wall clock, for talking to other processes.
+};
+
+Options &options();
+
+typedef std::function<void(const char *value)> OptionHandler;
+
+/// @brief Add a command line option taking a value, for host programs built on the runner.
+/// Call before parseArgs(), a static initializer works.
+void addOption(const char *name, const char *help, OptionHandler handler);
+
+/// @brief Parse the runner command line. Exits with a usage message on unknown arguments.
+void parseArgs(int argc, char **argv);
+
+uint64_t nowUs();
+
+/// @brief Move virtual time forward, firing every scheduled event that falls due on the way.
+/// Only the runner thread moves time, see waitUs() for the variant usable from tasks.
+void advanceUs(uint64_t us);
+
+/// @brief Spend us of virtual time: advances the clock on the runner thread, blocks a task.
+void waitUs(uint64_t us);
+
+/// @brief Run fn when virtual time reaches dueUs. Events with equal due time run in schedule order.
+void schedule(uint64_t dueUs, std::function<void()> fn);
+
+/// @brief Called by the runner after each loop() iteration.
+void endLoopIteration();
+bool running();
+void printSummary();
+
+/* Task support for the FreeRTOS stand-in */
+
+/// @brief Register a task thread as runnable, before the thread is started.
+void taskCreated();
+/// @brief Mark the calling thread as a task thread of the given FreeRTOS priority.
+void enterTask(int priority);
+void taskExited();
+bool inTask();
+
+/// @brief Block the calling task until ready() holds or virtual time reaches wakeAtUs.
+/// ready() is evaluated with the simulator lock held.
+/// @return the final value of ready().
+bool blockTask(std::function<bool()> ready, uint64_t wakeAtUs);
+
+/// @brief Run fn under the simulator lock and then re-check every blocked task.
+void signalTasks(std::function<void()> fn);
+
+/* GPIO */
+typedef std::function<void(uint8_t pin, int level, uint64_t atUs)> PinWriteHook;
+
+/// @brief GPIO the simulated ADS1115 ALERT/RDY output is wired to (PIN_ADS_ALERT in src/blender/pin_config.h).
+#define SIM_ADS_ALERT_PIN 10
+
+void setDigitalInput(uint8_t pin, int level);
+void setAnalogInput(uint8_t pin, uint16_t value);
+int pinLevel(uint8_t pin);
+uint32_t pinTransitions(uint8_t pin);
+void onPinWrite(PinWriteHook hook);
+
+/* O2 cells wired to the ADS1115, cell 0 on AIN0/AIN1 and cell 1 on AIN2/AIN3 */
+typedef std::function<float(int cell, uint64_t atUs)> CellSource;
+
+/// @brief Replace the constant cell voltages from Options with a time dependent source.
+void setCellSource(CellSource source);
+float cellMillivolts(int cell);
+
+/* Preferences (NVS) */
+void preferencesPutFloat(const char *ns, const char *key, float value);
+void preferencesPutInt(const char *ns, const char *key, int32_t value);
+
+/* ESP-NOW */
+typedef std::function<void(const uint8_t *mac, const uint8_t *data, int len)> EspNowTxHook;
+
+void onEspNowSend(EspNowTxHook hook);
+void espNowDeliver(const uint8_t *mac, const uint8_t *data, int len);
+/// @brief Also answer to mac on the UDP medium, for a host program playing several stations.
+void espNowAddAddress(const uint8_t *mac);
+/// @brief esp_now_send() from src, one of the espNowAddAddress() addresses. Needs no peer.
+void espNowSendFrom(const uint8_t *src, const uint8_t *dest, const uint8_t *data, int len);
+uint32_t espNowFramesSent();
+uint64_t espNowBytesSent();
+/// @brief Transport statistics of the UDP medium (--esp-now-udp), if it is in use.
+void printEspNowSummary();
+
+/* BLE */
+/// @brief What the simulated central got (--ble-connect), if a GATT server was created.
+void printBleSummary();
+
+/* Display */
+/// @brief Bus counters of the emulated panel and the --screenshot, in TFT_HOST_FRAMEBUFFER builds.
+void printDisplaySummary();
+
+}
@@ -0,0 +1,93 @@
+#include "TFT_eSPI.h"
+
+#ifndef TFT_HOST_FRAMEBUFFER
+
+// Only the line height is used by the stand-in.
+const GFXfont Dialog_plain_100 = { NULL, NULL, 0x20, 0x7E, 118 };
+const GFXfont FreeSerif18pt7b = { NULL, NULL, 0x20, 0x7E, 42 };
+
+static int16_t glyphWidth(uint8_t font) {
+  switch (font) {
+    case 1: return 6;
+    case 2: return 8;
+    case 4: return 14;
+    case 6: return 24;
+    case 7: return 32;
+    case 8: return 55;
+    default: return 6;
+  }
+}
+
+void TFT_eSPI::setRotation(uint8_t r) {
+  int16_t shortSide = std::min(_width, _height);
+  int16_t longSide = std::max(_width, _height);
+  bool landscape = r & 1;
+  _width = landscape ? longSide : shortSide;
+  _height = landscape ? shortSide : longSide;
+}
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  (void)x;
+  (void)y;
+  (void)w;
+  (void)h;
+  (void)color;
+}
+
+void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  fillRect(x, y, w, 1, color);
+  fillRect(x, y + h - 1, w, 1, color);
+  fillRect(x, y, 1, h, color);
+  fillRect(x + w - 1, y, 1, h, color);
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+  (void)x;
+  (void)y;
+  (void)w;
+  (void)h;
+  (void)data;
+}
+
+int16_t TFT_eSPI::textWidth(const char *string, uint8_t font) {
+  int16_t advance = freeFont ? freeFont->yAdvance / 2 : glyphWidth(font);
+  return (int16_t)(strlen(string) * advance * textSize);
+}
+
+int16_t TFT_eSPI::fontHeight(uint8_t font) {
+  if (freeFont) {
+    return freeFont->yAdvance * textSize;
+  }
+  return glyphWidth(font) * 2 * textSize;
+}
+
+int16_t TFT_eSPI::drawFloat(float value, uint8_t dp, int32_t x, int32_t y, uint8_t font) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "%.*f", dp, value);
+  return drawString(buffer, x, y, font);
+}
+
+int16_t TFT_eSPI::drawNumber(long value, int32_t x, int32_t y, uint8_t font) {
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), "%ld", value);
+  return drawString(buffer, x, y, font);
+}
+
+size_t TFT_eSPI::write(uint8_t c) {
+  if (c == '\n') {
+    cursorX = 0;
+    cursorY += fontHeight();
+  } else if (c != '\r') {
+    cursorX += glyphWidth(textFont) * textSize;
+  }
+  return 1;
+}
+
+void *TFT_eSprite::createSprite(int16_t width, int16_t height, uint8_t frames) {
+  (void)frames;
+  _width = width;
+  _height = height;
+  return this;
+}
+
+#endif
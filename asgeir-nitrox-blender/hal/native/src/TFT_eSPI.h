@@ -0,0 +1,130 @@
+#pragma once
+
+#ifdef TFT_HOST_FRAMEBUFFER
+
+// The real library, drawing into the panel emulated by lib/TFT_eSPI/Processors/TFT_eSPI_Host.h.
+// By path, this header shadows it on the include path.
+#include "../../../lib/TFT_eSPI/TFT_eSPI.h"
+
+#else
+
+/*
+ * Display stand-in for host builds. Drawing calls are accepted and dropped; the text
+ * functions return approximate pixel widths so layout code behaves like on the panel.
+ */
+
+#include "Arduino.h"
+
+#define TFT_BLACK       0x0000
+#define TFT_NAVY        0x000F
+#define TFT_DARKGREEN   0x03E0
+#define TFT_MAROON      0x7800
+#define TFT_LIGHTGREY   0xD69A
+#define TFT_DARKGREY    0x7BEF
+#define TFT_BLUE        0x001F
+#define TFT_GREEN       0x07E0
+#define TFT_CYAN        0x07FF
+#define TFT_RED         0xF800
+#define TFT_MAGENTA     0xF81F
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_ORANGE      0xFDA0
+
+#define TL_DATUM 0
+#define TC_DATUM 1
+#define TR_DATUM 2
+#define ML_DATUM 3
+#define MC_DATUM 4
+#define MR_DATUM 5
+#define BL_DATUM 6
+#define BC_DATUM 7
+#define BR_DATUM 8
+
+typedef struct {
+  uint16_t bitmapOffset;
+  uint8_t width, height;
+  uint8_t xAdvance;
+  int8_t xOffset, yOffset;
+} GFXglyph;
+
+typedef struct {
+  uint8_t *bitmap;
+  GFXglyph *glyph;
+  uint16_t first, last;
+  uint8_t yAdvance;
+} GFXfont;
+
+extern const GFXfont Dialog_plain_100;
+extern const GFXfont FreeSerif18pt7b;
+
+class TFT_eSPI : public Print {
+public:
+  TFT_eSPI(int16_t w = 170, int16_t h = 320) : _width(w), _height(h) {}
+
+  void init(uint8_t tc = 0) { (void)tc; }
+  void begin(uint8_t tc = 0) { init(tc); }
+
+  void setRotation(uint8_t r);
+  int16_t width() { return _width; }
+  int16_t height() { return _height; }
+  void setSwapBytes(bool swap) { (void)swap; }
+
+  void fillScreen(uint32_t color) { (void)color; }
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+  void setCursor(int16_t x, int16_t y) { cursorX = x; cursorY = y; }
+  void setCursor(int16_t x, int16_t y, uint8_t font) { setCursor(x, y); setTextFont(font); }
+  void setTextSize(uint8_t size) { textSize = size ? size : 1; }
+  void setTextFont(uint8_t font) { textFont = font; freeFont = NULL; }
+  void setFreeFont(const GFXfont *font) { freeFont = font; }
+  void setTextColor(uint16_t color) { (void)color; }
+  void setTextColor(uint16_t fg, uint16_t bg, bool bgfill = false) { (void)fg; (void)bg; (void)bgfill; }
+  void setTextDatum(uint8_t datum) { (void)datum; }
+  void setTextPadding(uint16_t width) { (void)width; }
+
+  int16_t textWidth(const char *string, uint8_t font);
+  int16_t textWidth(const char *string) { return textWidth(string, textFont); }
+  int16_t fontHeight(uint8_t font);
+  int16_t fontHeight() { return fontHeight(textFont); }
+
+  int16_t drawString(const char *string, int32_t x, int32_t y, uint8_t font) { (void)x; (void)y; return textWidth(string, font); }
+  int16_t drawString(const char *string, int32_t x, int32_t y) { return drawString(string, x, y, textFont); }
+  int16_t drawString(const String &string, int32_t x, int32_t y, uint8_t font) { return drawString(string.c_str(), x, y, font); }
+  int16_t drawString(const String &string, int32_t x, int32_t y) { return drawString(string.c_str(), x, y); }
+  int16_t drawFloat(float value, uint8_t dp, int32_t x, int32_t y, uint8_t font);
+  int16_t drawFloat(float value, uint8_t dp, int32_t x, int32_t y) { return drawFloat(value, dp, x, y, textFont); }
+  int16_t drawNumber(long value, int32_t x, int32_t y, uint8_t font);
+  int16_t drawNumber(long value, int32_t x, int32_t y) { return drawNumber(value, x, y, textFont); }
+
+  size_t write(uint8_t c) override;
+  using Print::write;
+
+protected:
+  int16_t _width, _height;
+  int16_t cursorX = 0, cursorY = 0;
+  uint8_t textSize = 1;
+  uint8_t textFont = 1;
+  const GFXfont *freeFont = NULL;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+  explicit TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI(0, 0), tft(tft) {}
+
+  void *setColorDepth(int8_t bits) { colorDepth = bits; return NULL; }
+  void *createSprite(int16_t width, int16_t height, uint8_t frames = 1);
+  void deleteSprite() { _width = 0; _height = 0; }
+  bool created() { return _width > 0 && _height > 0; }
+
+  void fillSprite(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+  void pushSprite(int32_t x, int32_t y) { tft->pushImage(x, y, _width, _height, NULL); }
+  void pushSprite(int32_t x, int32_t y, uint16_t transparent) { (void)transparent; pushSprite(x, y); }
+
+private:
+  TFT_eSPI *tft;
+  int8_t colorDepth = 16;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "WString.h"
+
+#include <stdio.h>
+
+static std::string formatFloat(double value, unsigned int decimalPlaces) {
+  char buffer[48];
+  snprintf(buffer, sizeof(buffer), "%.*f", (int)decimalPlaces, value);
+  return buffer;
+}
+
+String::String(float value, unsigned int decimalPlaces) : value(formatFloat(value, decimalPlaces)) {}
+
+String::String(double value, unsigned int decimalPlaces) : value(formatFloat(value, decimalPlaces)) {}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = value.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &s, unsigned int from) const {
+  size_t pos = value.find(s.value, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    std::swap(from, to);
+  }
+  if (from >= value.size()) {
+    return String();
+  }
+  return String(value.substr(from, to - from));
+}
+
+void String::toCharArray(char *buffer, unsigned int size, unsigned int from) const {
+  if (size == 0) {
+    return;
+  }
+  size_t n = from < value.size() ? std::min<size_t>(value.size() - from, size - 1) : 0;
+  value.copy(buffer, n, from);
+  buffer[n] = 0;
+}
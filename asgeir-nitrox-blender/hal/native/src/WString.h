@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+/// @brief Minimal Arduino String backed by std::string.
+class String {
+public:
+  String() {}
+  String(const char *value) : value(value ? value : "") {}
+  String(const std::string &value) : value(value) {}
+  String(char c) : value(1, c) {}
+  explicit String(int value) : value(std::to_string(value)) {}
+  explicit String(unsigned int value) : value(std::to_string(value)) {}
+  explicit String(long value) : value(std::to_string(value)) {}
+  explicit String(unsigned long value) : value(std::to_string(value)) {}
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &s, unsigned int from = 0) const;
+  String substring(unsigned int from) const { return String(value.substr(std::min<size_t>(from, value.size()))); }
+  String substring(unsigned int from, unsigned int to) const;
+  char charAt(unsigned int index) const { return index < value.size() ? value[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  void toCharArray(char *buffer, unsigned int size, unsigned int from = 0) const;
+
+  String &operator+=(const String &rhs) { value += rhs.value; return *this; }
+  String &operator+=(const char *rhs) { value += rhs; return *this; }
+  String &operator+=(char rhs) { value += rhs; return *this; }
+
+  bool operator==(const String &rhs) const { return value == rhs.value; }
+  bool operator==(const char *rhs) const { return value == rhs; }
+  bool operator!=(const String &rhs) const { return value != rhs.value; }
+
+  friend String operator+(const String &lhs, const String &rhs) { return String(lhs.value + rhs.value); }
+  friend String operator+(const String &lhs, const char *rhs) { return String(lhs.value + rhs); }
+  friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs.value); }
+
+private:
+  std::string value;
+};
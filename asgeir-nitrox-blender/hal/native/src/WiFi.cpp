@@ -0,0 +1,42 @@
+#include "WiFi.h"
+
+#include <string.h>
+
+WiFiClass WiFi;
+
+static uint8_t stationMac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+static String formatMac(const uint8_t *mac) {
+  char buffer[18];
+  snprintf(buffer, sizeof(buffer), "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+  return String(buffer);
+}
+
+void WiFiClass::setMacAddress(const uint8_t *mac) {
+  memcpy(stationMac, mac, sizeof(stationMac));
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac) {
+  memcpy(mac, stationMac, sizeof(stationMac));
+  return mac;
+}
+
+String WiFiClass::macAddress() {
+  return formatMac(stationMac);
+}
+
+String WiFiClass::softAPmacAddress() {
+  uint8_t mac[6];
+  macAddress(mac);
+  mac[5]++;
+  return formatMac(mac);
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase, int channel, int ssidHidden) {
+  (void)ssid;
+  (void)passphrase;
+  (void)channel;
+  (void)ssidHidden;
+  currentMode = WIFI_MODE_AP;
+  return true;
+}
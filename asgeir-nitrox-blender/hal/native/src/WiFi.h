@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Arduino.h"
+#include "esp_err.h"
+
+typedef enum {
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA,
+  WIFI_MODE_MAX
+} wifi_mode_t;
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+/// @brief Radio stand-in, only tracks the mode and reports a stable station MAC.
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t mode) { currentMode = mode; return true; }
+  wifi_mode_t getMode() { return currentMode; }
+  bool disconnect(bool wifiOff = false, bool eraseAp = false) { (void)wifiOff; (void)eraseAp; return true; }
+
+  uint8_t *macAddress(uint8_t *mac);
+  String macAddress();
+  String softAPmacAddress();
+  bool softAP(const char *ssid, const char *passphrase = NULL, int channel = 1, int ssidHidden = 0);
+
+  /// @brief MAC used by the host side, defaults to a locally administered address.
+  static void setMacAddress(const uint8_t *mac);
+
+private:
+  wifi_mode_t currentMode = WIFI_MODE_NULL;
+};
+
+extern WiFiClass WiFi;
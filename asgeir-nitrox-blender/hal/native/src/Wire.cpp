@@ -0,0 +1,17 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+  (void)sda;
+  (void)scl;
+  if (frequency) {
+    clock = frequency;
+  }
+  return true;
+}
+
+bool TwoWire::setClock(uint32_t frequency) {
+  clock = frequency;
+  return true;
+}
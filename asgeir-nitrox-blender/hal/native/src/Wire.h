@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief I2C bus stand-in. Simulated devices are modelled at driver level, so the bus
+/// only has to accept the calls the firmware makes during setup.
+class TwoWire {
+public:
+  bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+  bool setClock(uint32_t frequency);
+  uint32_t getClock() { return clock; }
+
+private:
+  uint32_t clock = 100000;
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,553 @@
+#include "esp_now.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Simulator.h"
+#include "WiFi.h"
+#include "esp_wifi.h"
+
+/*
+ * Loopback medium, --esp-now-udp <port>. Every process binds the first free UDP port of
+ * port .. port + UDP_NODES - 1 on 127.0.0.1 and sends each frame to all the others,
+ * like stations on one radio channel. A receiver keeps what is addressed to its MAC or
+ * to the broadcast address and acknowledges unicast frames, so the sender's callback
+ * reports whether the frame arrived. The simulated clock then follows the wall clock,
+ * and frames carry a CLOCK_MONOTONIC time stamp, which all processes on one machine
+ * share, for the transport latency in the summary.
+ */
+#define UDP_NODES 64
+#define UDP_MAGIC 0x4E4F5745          // "EWON"
+#define UDP_DATA 1
+#define UDP_ACK 2
+#define UDP_ACK_TIMEOUT_US 20000      // After the injected delay, then the send callback reports a failure
+#define UDP_REORDER_HOLD_US 10000     // A reordered frame is held back this long
+
+#define ACTION_FRAME_HEADER_SIZE 39     // MAC header, category, OUI, random bytes, vendor element header
+#define RSSI_SPREAD_DB 4                // Received frames vary this much around --esp-now-rssi
+
+namespace {
+
+struct __attribute__((packed)) UdpHeader {
+  uint32_t magic;
+  uint8_t type;                       // UDP_DATA or UDP_ACK
+  uint8_t src[ESP_NOW_ETH_ALEN];
+  uint8_t dest[ESP_NOW_ETH_ALEN];
+  uint32_t id;                        // Of the data frame, an ack repeats it
+  uint32_t delayUs;                   // Injected delay, applied by the receiver
+  uint64_t sentAtUs;                  // CLOCK_MONOTONIC
+};
+
+struct Peer {
+  uint8_t mac[ESP_NOW_ETH_ALEN];
+};
+
+bool initialized = false;
+esp_now_recv_cb_t recvCallback = NULL;
+esp_now_send_cb_t sendCallback = NULL;
+std::vector<Peer> peers;
+std::vector<sim::EspNowTxHook> txHooks;
+uint32_t framesSent = 0;
+uint64_t bytesSent = 0;
+uint64_t airBusyUntilUs = 0;
+float lossPercent = 0;
+std::mt19937 randomEngine;
+bool isRandomSeeded = false;
+
+// Promiscuous receive, esp_wifi.h
+bool isPromiscuous = false;
+wifi_promiscuous_cb_t promiscuousCallback = NULL;
+uint32_t promiscuousMask = WIFI_PROMIS_FILTER_MASK_ALL;
+int rssiDbm = -55;
+
+// Loopback medium
+uint16_t udpBasePort = 0;
+float delayMs = 0;
+float jitterMs = 0;
+float reorderPercent = 0;
+int udpSocket = -1;
+int udpSlot = -1;
+uint32_t nextFrameId = 1;
+std::map<uint32_t, Peer> awaitingAck;   // Frame id to destination, simulator context only
+uint32_t udpReceived = 0;
+uint32_t udpLost = 0;
+uint32_t udpAcked = 0;
+uint32_t udpUnacked = 0;
+uint64_t udpLatencyTotalUs = 0;
+uint64_t udpLatencyMaxUs = 0;
+uint64_t udpBytesReceived = 0;
+
+// Further addresses this process sends from and answers to, sim::espNowAddAddress().
+std::mutex &addressMutex = *new std::mutex();
+std::vector<Peer> &extraAddresses = *new std::vector<Peer>();
+
+bool registerOptions() {
+  sim::addOption("--esp-now-loss", "percent of unicast frames the send callback reports as failed, on the UDP medium broadcasts get lost too",
+    [](const char *value) { lossPercent = atof(value); });
+  sim::addOption("--esp-now-udp", "exchange frames with other host processes over UDP ports <port> and up",
+    [](const char *value) {
+      udpBasePort = (uint16_t)atoi(value);
+      sim::options().realtime = true;
+    });
+  sim::addOption("--esp-now-delay", "ms added to every frame on the UDP medium", [](const char *value) { delayMs = atof(value); });
+  sim::addOption("--esp-now-jitter", "up to this many ms added at random on the UDP medium, frames overtake each other",
+    [](const char *value) { jitterMs = atof(value); });
+  sim::addOption("--esp-now-reorder", "percent of frames held back 10 ms on the UDP medium",
+    [](const char *value) { reorderPercent = atof(value); });
+  sim::addOption("--esp-now-rssi", "dBm of received frames, give or take 4 (default: -55)",
+    [](const char *value) { rssiDbm = atoi(value); });
+  return true;
+}
+bool optionsRegistered = registerOptions();
+
+/// @brief 1 Mbps PHY plus MAC header, FCS and inter-frame spacing.
+uint32_t airtimeUs(size_t len) {
+  return (uint32_t)((len + 43) * 8 + 100);
+}
+
+uint64_t monotonicUs() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+std::mt19937 &engine() {
+  if (!isRandomSeeded) {
+    randomEngine.seed(sim::options().seed);
+    isRandomSeeded = true;
+  }
+  return randomEngine;
+}
+
+bool chance(float percent) {
+  return percent > 0 && std::uniform_real_distribution<float>(0, 100)(engine()) < percent;
+}
+
+bool isBroadcast(const uint8_t *mac) {
+  return memcmp(mac, "\xFF\xFF\xFF\xFF\xFF\xFF", ESP_NOW_ETH_ALEN) == 0;
+}
+
+void udpSendTo(uint16_t port, const UdpHeader &header, const uint8_t *data, size_t len) {
+  uint8_t datagram[sizeof(UdpHeader) + ESP_NOW_MAX_DATA_LEN];
+  memcpy(datagram, &header, sizeof(header));
+  memcpy(datagram + sizeof(header), data, len);
+
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  sendto(udpSocket, datagram, sizeof(header) + len, 0, (struct sockaddr *)&address, sizeof(address));
+}
+
+/// @brief Hand a received frame to the promiscuous callback, as the action frame it was on the
+/// air, and then to the ESP-NOW receive callback, in the same order as the WiFi task.
+void deliver(const uint8_t *src, const uint8_t *dest, const uint8_t *data, int len) {
+  if (isPromiscuous && promiscuousCallback != NULL && (promiscuousMask & WIFI_PROMIS_FILTER_MASK_MGMT)) {
+    static const uint8_t oui[3] = { 0x18, 0xFE, 0x34 };
+    uint32_t storage[(sizeof(wifi_promiscuous_pkt_t) + ACTION_FRAME_HEADER_SIZE + ESP_NOW_MAX_DATA_LEN) / 4 + 1];
+    wifi_promiscuous_pkt_t *packet = (wifi_promiscuous_pkt_t *)storage;
+    uint8_t *frame = packet->payload;
+
+    memset(frame, 0, ACTION_FRAME_HEADER_SIZE);
+    frame[0] = 0xD0;                               // Action
+    memcpy(frame + 4, dest, ESP_NOW_ETH_ALEN);
+    memcpy(frame + 10, src, ESP_NOW_ETH_ALEN);
+    memset(frame + 16, 0xFF, ESP_NOW_ETH_ALEN);
+    frame[24] = 127;                               // Vendor specific
+    memcpy(frame + 25, oui, sizeof(oui));
+    frame[32] = 0xDD;
+    frame[33] = (uint8_t)(len + 5);
+    memcpy(frame + 34, oui, sizeof(oui));
+    frame[37] = 4;                                 // ESP-NOW
+    frame[38] = 1;
+    memcpy(frame + ACTION_FRAME_HEADER_SIZE, data, len);
+
+    packet->rx_ctrl.rssi = rssiDbm + std::uniform_int_distribution<int>(-RSSI_SPREAD_DB, RSSI_SPREAD_DB)(engine());
+    packet->rx_ctrl.channel = 1;
+    packet->rx_ctrl.sig_len = ACTION_FRAME_HEADER_SIZE + len + 4; // With the FCS
+    promiscuousCallback(packet, WIFI_PKT_MGMT);
+  }
+  if (initialized && recvCallback) {
+    recvCallback(src, data, len);
+  }
+}
+
+/// @brief Simulator context: a data frame for us arrived and its delay is over.
+void udpDeliver(const UdpHeader &header, const std::vector<uint8_t> &data, uint16_t fromPort) {
+  uint64_t latencyUs = monotonicUs() - header.sentAtUs;
+  udpReceived++;
+  udpBytesReceived += data.size();
+  udpLatencyTotalUs += latencyUs;
+  udpLatencyMaxUs = std::max(udpLatencyMaxUs, latencyUs);
+
+  if (!isBroadcast(header.dest)) {
+    UdpHeader ack = header;
+    ack.type = UDP_ACK;
+    memcpy(ack.src, header.dest, ESP_NOW_ETH_ALEN);
+    memcpy(ack.dest, header.src, ESP_NOW_ETH_ALEN);
+    udpSendTo(fromPort, ack, NULL, 0);
+  }
+  deliver(header.src, header.dest, data.data(), (int)data.size());
+}
+
+/// @brief Simulator context: the acknowledgement of one of our unicast frames arrived.
+void udpAcknowledged(uint32_t id) {
+  std::map<uint32_t, Peer>::iterator it = awaitingAck.find(id);
+  if (it == awaitingAck.end()) {
+    return; // Already reported as failed.
+  }
+  Peer dest = it->second;
+  awaitingAck.erase(it);
+  udpAcked++;
+  if (sendCallback) {
+    sendCallback(dest.mac, ESP_NOW_SEND_SUCCESS);
+  }
+}
+
+bool isOwnAddress(const uint8_t *mac) {
+  uint8_t ownMac[ESP_NOW_ETH_ALEN];
+  WiFi.macAddress(ownMac);
+  if (memcmp(mac, ownMac, ESP_NOW_ETH_ALEN) == 0) {
+    return true;
+  }
+
+  std::lock_guard<std::mutex> lock(addressMutex);
+  for (size_t i = 0; i < extraAddresses.size(); i++) {
+    if (memcmp(mac, extraAddresses[i].mac, ESP_NOW_ETH_ALEN) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void udpReceiveLoop() {
+  uint8_t datagram[sizeof(UdpHeader) + ESP_NOW_MAX_DATA_LEN];
+
+  for (;;) {
+    struct sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    ssize_t length = recvfrom(udpSocket, datagram, sizeof(datagram), 0, (struct sockaddr *)&from, &fromLength);
+    if (length < (ssize_t)sizeof(UdpHeader)) {
+      continue;
+    }
+
+    UdpHeader header;
+    memcpy(&header, datagram, sizeof(header));
+    if (header.magic != UDP_MAGIC || (!isBroadcast(header.dest) && !isOwnAddress(header.dest))) {
+      continue;
+    }
+
+    // Hand over to the simulator, the callbacks run there like in the WiFi task.
+    if (header.type == UDP_ACK) {
+      uint32_t id = header.id;
+      sim::schedule(sim::nowUs(), [id]() { udpAcknowledged(id); });
+    } else {
+      std::vector<uint8_t> data(datagram + sizeof(header), datagram + length);
+      uint16_t fromPort = ntohs(from.sin_port);
+      sim::schedule(sim::nowUs() + header.delayUs, [header, data, fromPort]() { udpDeliver(header, data, fromPort); });
+    }
+  }
+}
+
+bool udpJoin() {
+  udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (udpSocket < 0) {
+    return false;
+  }
+
+  for (int slot = 0; slot < UDP_NODES; slot++) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(udpBasePort + slot);
+    if (bind(udpSocket, (struct sockaddr *)&address, sizeof(address)) == 0) {
+      udpSlot = slot;
+      break;
+    }
+  }
+  if (udpSlot < 0) {
+    close(udpSocket);
+    udpSocket = -1;
+    return false;
+  }
+
+  // Every process needs its own MAC, the slot makes one up.
+  uint8_t mac[ESP_NOW_ETH_ALEN] = { 0x02, 0x4E, 0x58, 0x00, 0x00, (uint8_t)(udpSlot + 1) };
+  WiFiClass::setMacAddress(mac);
+  fprintf(stderr, "esp_now: UDP port %u, MAC %s\n", udpBasePort + udpSlot, WiFi.macAddress().c_str());
+
+  std::thread(udpReceiveLoop).detach();
+  return true;
+}
+
+void udpTransmit(const uint8_t *src, const uint8_t *mac, const uint8_t *data, size_t len) {
+  UdpHeader header;
+  header.magic = UDP_MAGIC;
+  header.type = UDP_DATA;
+  memcpy(header.src, src, ESP_NOW_ETH_ALEN);
+  memcpy(header.dest, mac, ESP_NOW_ETH_ALEN);
+  header.id = nextFrameId++;
+  header.delayUs = (uint32_t)(delayMs * 1000);
+  if (jitterMs > 0) {
+    header.delayUs += (uint32_t)std::uniform_real_distribution<float>(0, jitterMs * 1000)(engine());
+  }
+  if (chance(reorderPercent)) {
+    header.delayUs += UDP_REORDER_HOLD_US;
+  }
+  header.sentAtUs = monotonicUs();
+
+  if (chance(lossPercent)) {
+    udpLost++;
+  } else {
+    for (int slot = 0; slot < UDP_NODES; slot++) {
+      if (slot != udpSlot) {
+        udpSendTo(udpBasePort + slot, header, data, len);
+      }
+    }
+  }
+
+  Peer dest;
+  memcpy(dest.mac, mac, ESP_NOW_ETH_ALEN);
+  if (isBroadcast(mac)) {
+    // Nobody acknowledges a broadcast, it counts as sent once it is on the air.
+    sim::schedule(sim::nowUs() + airtimeUs(len), [dest]() {
+      if (sendCallback) {
+        sendCallback(dest.mac, ESP_NOW_SEND_SUCCESS);
+      }
+    });
+    return;
+  }
+
+  uint32_t id = header.id;
+  awaitingAck[id] = dest;
+  sim::schedule(sim::nowUs() + header.delayUs + UDP_ACK_TIMEOUT_US, [id]() {
+    std::map<uint32_t, Peer>::iterator it = awaitingAck.find(id);
+    if (it == awaitingAck.end()) {
+      return;
+    }
+    Peer dest = it->second;
+    awaitingAck.erase(it);
+    udpUnacked++;
+    if (sendCallback) {
+      sendCallback(dest.mac, ESP_NOW_SEND_FAIL);
+    }
+  });
+}
+
+int findPeer(const uint8_t *mac) {
+  for (size_t i = 0; i < peers.size(); i++) {
+    if (memcmp(peers[i].mac, mac, ESP_NOW_ETH_ALEN) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/// @param src NULL for the station MAC
+void transmit(const uint8_t *src, const uint8_t *mac, const uint8_t *data, size_t len) {
+  Peer dest;
+  memcpy(dest.mac, mac, ESP_NOW_ETH_ALEN);
+
+  framesSent++;
+  bytesSent += len;
+  for (size_t i = 0; i < txHooks.size(); i++) {
+    txHooks[i](dest.mac, data, (int)len);
+  }
+
+  if (udpSocket >= 0) {
+    uint8_t ownMac[ESP_NOW_ETH_ALEN];
+    udpTransmit(src != NULL ? src : WiFi.macAddress(ownMac), mac, data, len);
+    return;
+  }
+
+  // Like on the radio, only unicast frames are acknowledged, a broadcast always counts as sent.
+  bool isLost = !isBroadcast(mac) && chance(lossPercent);
+  esp_now_send_status_t status = isLost ? ESP_NOW_SEND_FAIL : ESP_NOW_SEND_SUCCESS;
+
+  // Frames queue up behind each other on the air, the callback fires when this one is done.
+  uint64_t start = std::max(sim::nowUs(), airBusyUntilUs);
+  airBusyUntilUs = start + airtimeUs(len);
+  sim::schedule(airBusyUntilUs, [dest, status]() {
+    if (sendCallback) {
+      sendCallback(dest.mac, status);
+    }
+  });
+}
+
+}
+
+esp_err_t esp_now_init(void) {
+  if (udpBasePort != 0 && udpSocket < 0 && !udpJoin()) {
+    fprintf(stderr, "esp_now: no free UDP port from %u\n", udpBasePort);
+    return ESP_ERR_ESPNOW_INTERNAL;
+  }
+  initialized = true;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_deinit(void) {
+  initialized = false;
+  peers.clear();
+  recvCallback = NULL;
+  sendCallback = NULL;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  recvCallback = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_recv_cb(void) {
+  recvCallback = NULL;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  sendCallback = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_unregister_send_cb(void) {
+  sendCallback = NULL;
+  return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t *peer) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (peer == NULL) {
+    return ESP_ERR_ESPNOW_ARG;
+  }
+  if (findPeer(peer->peer_addr) >= 0) {
+    return ESP_ERR_ESPNOW_EXIST;
+  }
+  if (peers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) {
+    return ESP_ERR_ESPNOW_FULL;
+  }
+  Peer entry;
+  memcpy(entry.mac, peer->peer_addr, ESP_NOW_ETH_ALEN);
+  peers.push_back(entry);
+  return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t *peer_addr) {
+  int index = findPeer(peer_addr);
+  if (index < 0) {
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+  }
+  peers.erase(peers.begin() + index);
+  return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t *peer_addr) {
+  return findPeer(peer_addr) >= 0;
+}
+
+esp_err_t esp_now_send(const uint8_t *peer_addr, const uint8_t *data, size_t len) {
+  if (!initialized) {
+    return ESP_ERR_ESPNOW_NOT_INIT;
+  }
+  if (data == NULL || len == 0 || len > ESP_NOW_MAX_DATA_LEN) {
+    return ESP_ERR_ESPNOW_ARG;
+  }
+  if (peer_addr == NULL) {
+    // NULL sends to every registered peer.
+    for (size_t i = 0; i < peers.size(); i++) {
+      transmit(NULL, peers[i].mac, data, len);
+    }
+    return ESP_OK;
+  }
+  if (findPeer(peer_addr) < 0) {
+    return ESP_ERR_ESPNOW_NOT_FOUND;
+  }
+  transmit(NULL, peer_addr, data, len);
+  return ESP_OK;
+}
+
+namespace sim {
+
+void onEspNowSend(EspNowTxHook hook) {
+  txHooks.push_back(hook);
+}
+
+void espNowAddAddress(const uint8_t *mac) {
+  Peer address;
+  memcpy(address.mac, mac, ESP_NOW_ETH_ALEN);
+  std::lock_guard<std::mutex> lock(addressMutex);
+  extraAddresses.push_back(address);
+}
+
+void espNowSendFrom(const uint8_t *src, const uint8_t *dest, const uint8_t *data, int len) {
+  if (initialized && len > 0 && len <= ESP_NOW_MAX_DATA_LEN) {
+    transmit(src, dest, data, len);
+  }
+}
+
+void espNowDeliver(const uint8_t *mac, const uint8_t *data, int len) {
+  uint8_t ownMac[ESP_NOW_ETH_ALEN];
+  WiFi.macAddress(ownMac);
+  deliver(mac, ownMac, data, len);
+}
+
+uint32_t espNowFramesSent() {
+  return framesSent;
+}
+
+uint64_t espNowBytesSent() {
+  return bytesSent;
+}
+
+void printEspNowSummary() {
+  if (udpSocket < 0) {
+    return;
+  }
+  double seconds = nowUs() / 1e6;
+  fprintf(stderr, "esp_now udp      : %u received (%.0f bytes/s), latency avg %.2f ms max %.2f ms\n",
+    udpReceived, seconds > 0 ? udpBytesReceived / seconds : 0,
+    udpReceived ? udpLatencyTotalUs / 1000.0 / udpReceived : 0, udpLatencyMaxUs / 1000.0);
+  fprintf(stderr, "esp_now udp      : %u lost on send, %u acknowledged, %u unacknowledged\n", udpLost, udpAcked,
+    udpUnacked);
+}
+
+}
+
+esp_err_t esp_wifi_set_promiscuous(bool en) {
+  isPromiscuous = en;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb) {
+  promiscuousCallback = cb;
+  return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter) {
+  if (filter == NULL) {
+    return ESP_ERR_INVALID_ARG;
+  }
+  promiscuousMask = filter->filter_mask;
+  return ESP_OK;
+}
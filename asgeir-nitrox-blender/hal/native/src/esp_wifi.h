@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/*
+ * Host stand-in for the promiscuous receive part of the ESP-IDF 4.4 WiFi API, which is
+ * where ESP-NOW receivers get the RSSI from. Every frame the ESP-NOW stand-in delivers
+ * is first handed to the promiscuous callback as a vendor specific action frame, with
+ * the RSSI set by --esp-now-rssi.
+ */
+
+typedef enum {
+  WIFI_PKT_MGMT,
+  WIFI_PKT_CTRL,
+  WIFI_PKT_DATA,
+  WIFI_PKT_MISC,
+} wifi_promiscuous_pkt_type_t;
+
+#define WIFI_PROMIS_FILTER_MASK_ALL 0xFFFFFFFF
+#define WIFI_PROMIS_FILTER_MASK_MGMT 1
+#define WIFI_PROMIS_FILTER_MASK_CTRL (1 << 1)
+#define WIFI_PROMIS_FILTER_MASK_DATA (1 << 2)
+
+typedef struct {
+  uint32_t filter_mask;
+} wifi_promiscuous_filter_t;
+
+/// @brief The fields of the real bit field the stand-in fills in.
+typedef struct {
+  signed rssi : 8;
+  unsigned channel : 4;
+  unsigned sig_len : 12;
+} wifi_pkt_rx_ctrl_t;
+
+typedef struct {
+  wifi_pkt_rx_ctrl_t rx_ctrl;
+  uint8_t payload[0];
+} wifi_promiscuous_pkt_t;
+
+typedef void (*wifi_promiscuous_cb_t)(void *buf, wifi_promiscuous_pkt_type_t type);
+
+esp_err_t esp_wifi_set_promiscuous(bool en);
+esp_err_t esp_wifi_set_promiscuous_rx_cb(wifi_promiscuous_cb_t cb);
+esp_err_t esp_wifi_set_promiscuous_filter(const wifi_promiscuous_filter_t *filter);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * FreeRTOS types and constants for the host stand-in in freertos/task.h.
+ * One tick is one millisecond, as configured for the ESP32 Arduino core.
+ */
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#define portYIELD_FROM_ISR(...)
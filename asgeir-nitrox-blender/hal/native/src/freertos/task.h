@@ -0,0 +1,36 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+/*
+ * Host stand-in for the FreeRTOS task API. Every task is a detached std::thread; core
+ * affinity and priorities are recorded but not enforced, the threads really run in
+ * parallel. Blocking calls block on the simulator clock, see Simulator.h.
+ */
+
+struct SimTask;
+typedef SimTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+  UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId);
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+  UBaseType_t priority, TaskHandle_t *createdTask);
+void vTaskDelete(TaskHandle_t task);
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+const char *pcTaskGetName(TaskHandle_t task);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID(void);
+
+TickType_t xTaskGetTickCount(void);
+TickType_t xTaskGetTickCountFromISR(void);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement);
+#define vTaskDelayUntil(previousWakeTime, timeIncrement) ((void)xTaskDelayUntil(previousWakeTime, timeIncrement))
+void taskYIELD(void);
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
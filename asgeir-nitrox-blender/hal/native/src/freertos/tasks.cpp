@@ -0,0 +1,145 @@
+#include "task.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <thread>
+
+#include "../Simulator.h"
+
+struct SimTask {
+  std::string name;
+  TaskFunction_t code;
+  void *parameters;
+  uint32_t stackDepth;
+  UBaseType_t priority;
+  BaseType_t coreId;
+  uint32_t notifyCount;
+};
+
+// The Arduino loop() runs in "loopTask" on core 1.
+static SimTask loopTask = { "loopTask", NULL, NULL, 8192, 1, 1, 0 };
+static thread_local SimTask *currentTask = &loopTask;
+
+static uint64_t timeoutToWakeAt(TickType_t ticks) {
+  return ticks == portMAX_DELAY ? UINT64_MAX : sim::nowUs() + (uint64_t)ticks * 1000 * portTICK_PERIOD_MS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+  UBaseType_t priority, TaskHandle_t *createdTask, BaseType_t coreId) {
+  // Tasks are never freed, like on the board they are expected to live forever.
+  SimTask *task = new SimTask { name ? name : "", code, parameters, stackDepth, priority, coreId, 0 };
+  if (createdTask) {
+    *createdTask = task;
+  }
+
+  sim::taskCreated();
+  std::thread([task]() {
+    currentTask = task;
+    sim::enterTask(task->priority);
+    task->code(task->parameters);
+    sim::taskExited();
+  }).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameters,
+  UBaseType_t priority, TaskHandle_t *createdTask) {
+  return xTaskCreatePinnedToCore(code, name, stackDepth, parameters, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == NULL || task == currentTask) {
+    // A task deleting itself never returns; park the thread forever.
+    sim::blockTask(std::function<bool()>(), UINT64_MAX);
+  }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+  return currentTask;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+  return (task ? task : currentTask)->name.c_str();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task) {
+  return (task ? task : currentTask)->priority;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+  return (task ? task : currentTask)->stackDepth;
+}
+
+BaseType_t xPortGetCoreID(void) {
+  return currentTask->coreId == tskNO_AFFINITY ? 0 : currentTask->coreId;
+}
+
+TickType_t xTaskGetTickCount(void) {
+  return (TickType_t)(sim::nowUs() / (1000 * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCountFromISR(void) {
+  return xTaskGetTickCount();
+}
+
+void vTaskDelay(TickType_t ticks) {
+  sim::waitUs((uint64_t)ticks * 1000 * portTICK_PERIOD_MS);
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previousWakeTime, TickType_t timeIncrement) {
+  *previousWakeTime += timeIncrement;
+  uint64_t wakeAtUs = (uint64_t)*previousWakeTime * 1000 * portTICK_PERIOD_MS;
+  uint64_t now = sim::nowUs();
+  if (wakeAtUs <= now) {
+    return pdFALSE;
+  }
+  sim::waitUs(wakeAtUs - now);
+  return pdTRUE;
+}
+
+void taskYIELD(void) {
+  std::this_thread::yield();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+  SimTask *task = currentTask;
+  uint64_t wakeAtUs = timeoutToWakeAt(ticksToWait);
+
+  if (sim::inTask()) {
+    sim::blockTask([task]() { return task->notifyCount > 0; }, wakeAtUs);
+  } else {
+    // loop() drives the clock, so it polls instead of blocking.
+    uint32_t pending = 0;
+    while (true) {
+      sim::signalTasks([task, &pending]() { pending = task->notifyCount; });
+      if (pending > 0 || sim::nowUs() >= wakeAtUs) {
+        break;
+      }
+      sim::advanceUs(1000 * portTICK_PERIOD_MS);
+    }
+  }
+
+  uint32_t value = 0;
+  sim::signalTasks([task, clearCountOnExit, &value]() {
+    value = task->notifyCount;
+    if (clearCountOnExit) {
+      task->notifyCount = 0;
+    } else if (task->notifyCount > 0) {
+      task->notifyCount--;
+    }
+  });
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  sim::signalTasks([task]() { task->notifyCount++; });
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) {
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) {
+    *higherPriorityTaskWoken = pdTRUE;
+  }
+}
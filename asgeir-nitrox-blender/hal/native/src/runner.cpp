@@ -0,0 +1,20 @@
+#include "Arduino.h"
+#include "Simulator.h"
+
+/*
+ * Host entry point: runs the sketch's setup() once and then loop() until the requested
+ * amount of virtual time has passed.
+ */
+int main(int argc, char **argv) {
+  sim::parseArgs(argc, argv);
+
+  setup();
+  while (sim::running()) {
+    loop();
+    sim::endLoopIteration();
+  }
+
+  Serial.flush();
+  sim::printSummary();
+  return 0;
+}
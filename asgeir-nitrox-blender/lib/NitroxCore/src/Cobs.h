@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Consistent Overhead Byte Stuffing. The encoded data contains no zero bytes, so a
+ * zero can delimit frames in a byte stream that also carries other output (e.g. the
+ * Serial log): a receiver resyncs on the next zero and drops whatever fails to decode.
+ */
+
+/// @brief Worst case size of the encoding of length bytes, without the delimiter.
+inline size_t cobsMaxEncodedLength(size_t length) {
+  return length + length / 254 + 1;
+}
+
+/// @return number of bytes written to out.
+inline size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *out) {
+  size_t codeIndex = 0;
+  size_t outIndex = 1;
+  uint8_t code = 1;
+
+  for (size_t i = 0; i < length; i++) {
+    if (data[i] != 0) {
+      out[outIndex++] = data[i];
+      code++;
+    }
+    if (data[i] == 0 || code == 0xFF) {
+      out[codeIndex] = code;
+      codeIndex = outIndex++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  return outIndex;
+}
+
+/// @return number of bytes written to out, 0 if the input is not valid COBS or out is too small.
+inline size_t cobsDecode(const uint8_t *data, size_t length, uint8_t *out, size_t maxLength) {
+  size_t outIndex = 0;
+  size_t i = 0;
+
+  while (i < length) {
+    uint8_t code = data[i++];
+    if (code == 0 || i + code - 1 > length) {
+      return 0;
+    }
+    for (uint8_t j = 1; j < code; j++) {
+      if (data[i] == 0 || outIndex >= maxLength) {
+        return 0;
+      }
+      out[outIndex++] = data[i++];
+    }
+    if (code != 0xFF && i < length) {
+      if (outIndex >= maxLength) {
+        return 0;
+      }
+      out[outIndex++] = 0;
+    }
+  }
+  return outIndex;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+/// @brief value * scale rounded and clamped to int16, NaN becomes 0.
+inline int16_t toFixed(float value, int scale) {
+  if (isnan(value)) {
+    return 0;
+  }
+  float scaled = value * scale;
+  if (scaled > 32767) {
+    return 32767;
+  } else if (scaled < -32768) {
+    return -32768;
+  }
+  return (int16_t)lroundf(scaled);
+}
+
+inline float fromFixed(int16_t value, int scale) {
+  return (float)value / scale;
+}
@@ -0,0 +1,14 @@
+#include "LoopProfile.h"
+
+const char* profilePhaseNames[PHASE_COUNT] = {
+  "loop",
+  "handleSensor",
+  "handlePotentiometer",
+  "handleButtons",
+  "handleSolenoid",
+  "solenoidInterval",
+  "drawMainOxygenValue",
+  "drawCellInfo",
+  "drawSolenoidValue",
+  "esp_now_send"
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * The loop profile of the blender as the client receives it, see src/blender/profiler.h.
+ * Both builds take the phases and the payload from here so they cannot drift apart.
+ */
+
+enum ProfilePhase {
+  PHASE_LOOP,
+  PHASE_SENSOR,
+  PHASE_POTENTIOMETER,
+  PHASE_BUTTONS,
+  PHASE_SOLENOID,
+  PHASE_SOLENOID_INTERVAL, // Time between two consecutive solenoid decisions.
+  PHASE_DRAW_OXYGEN,
+  PHASE_DRAW_CELLS,
+  PHASE_DRAW_SOLENOID,
+  PHASE_ESP_NOW_SEND,
+  PHASE_COUNT
+};
+
+struct __attribute__((packed)) PhaseSummary {
+  uint32_t count;
+  uint32_t p50Us;
+  uint32_t p99Us;
+  uint32_t maxUs;
+};
+
+/// @brief Payload of a FRAME_PROFILE, sent to the ESP-NOW clients with every profile report.
+struct __attribute__((packed)) ProfilePayload {
+  uint32_t windowMs;
+  PhaseSummary phases[PHASE_COUNT];
+};
+
+extern const char* profilePhaseNames[PHASE_COUNT];
@@ -0,0 +1,154 @@
+#include "Protocol.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Crc16.h"
+#include "Varint.h"
+
+size_t encodeFrame(uint8_t type, uint16_t sequence, uint32_t sentAtUs, const void *payload, size_t length,
+  uint8_t *out, size_t capacity) {
+  if (length > 255 || sizeof(FrameHeader) + length + 2 > capacity) {
+    return 0;
+  }
+
+  FrameHeader header;
+  header.magic = PROTOCOL_MAGIC;
+  header.version = PROTOCOL_VERSION;
+  header.type = type;
+  header.sequence = sequence;
+  header.sentAtUs = sentAtUs;
+  header.length = length;
+
+  memcpy(out, &header, sizeof(header));
+  if (length > 0) {
+    memcpy(out + sizeof(header), payload, length);
+  }
+
+  size_t crcOffset = sizeof(header) + length;
+  uint16_t crc = crc16(out, crcOffset);
+  out[crcOffset] = crc & 0xFF;
+  out[crcOffset + 1] = crc >> 8;
+  return crcOffset + 2;
+}
+
+FrameError decodeFrame(const uint8_t *data, size_t length, FrameHeader &header, const uint8_t *&payload) {
+  if (length < FRAME_OVERHEAD) {
+    return FRAME_TOO_SHORT;
+  }
+  memcpy(&header, data, sizeof(header));
+
+  if (header.magic != PROTOCOL_MAGIC) {
+    return FRAME_FOREIGN;
+  }
+  if (header.version != PROTOCOL_VERSION) {
+    return FRAME_BAD_VERSION;
+  }
+  if (sizeof(header) + header.length + 2 != length) {
+    return FRAME_BAD_LENGTH;
+  }
+
+  size_t crcOffset = sizeof(header) + header.length;
+  uint16_t crc = data[crcOffset] | (data[crcOffset + 1] << 8);
+  if (crc16(data, crcOffset) != crc) {
+    return FRAME_BAD_CRC;
+  }
+
+  payload = data + sizeof(header);
+  return FRAME_OK;
+}
+
+size_t frameLength(const uint8_t *data, size_t length) {
+  FrameHeader header;
+  if (length < sizeof(header)) {
+    return 0;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (header.magic != PROTOCOL_MAGIC) {
+    return 0;
+  }
+  return sizeof(header) + header.length + 2;
+}
+
+size_t encodeSampleBatch(uint16_t index, const StreamSample *samples, size_t count, uint8_t *out, size_t capacity,
+  size_t &encoded) {
+  encoded = 0;
+  if (count == 0 || capacity < sizeof(SampleBatchHeader)) {
+    return 0;
+  }
+
+  SampleBatchHeader header;
+  header.atMs = samples[0].atMs;
+  header.index = index;
+  header.cellMv[0] = samples[0].cellMv[0];
+  header.cellMv[1] = samples[0].cellMv[1];
+
+  size_t length = sizeof(header);
+  encoded = 1;
+
+  // Worst case record: a full time varint and two 3 byte deltas.
+  while (encoded < count && encoded < 255 && length + VARINT_MAX_LENGTH + 6 <= capacity) {
+    const StreamSample &previous = samples[encoded - 1];
+    const StreamSample &sample = samples[encoded];
+    length += putVarint(out + length, sample.atMs - previous.atMs);
+    length += putDelta(out + length, sample.cellMv[0], previous.cellMv[0]);
+    length += putDelta(out + length, sample.cellMv[1], previous.cellMv[1]);
+    encoded++;
+  }
+
+  header.count = encoded;
+  memcpy(out, &header, sizeof(header));
+  return length;
+}
+
+size_t decodeSampleBatch(const uint8_t *payload, size_t length, uint16_t &index, StreamSample *samples,
+  size_t capacity) {
+  SampleBatchHeader header;
+  if (length < sizeof(header)) {
+    return 0;
+  }
+  memcpy(&header, payload, sizeof(header));
+  if (header.count == 0 || header.count > capacity) {
+    return 0;
+  }
+
+  index = header.index;
+  samples[0].atMs = header.atMs;
+  samples[0].cellMv[0] = header.cellMv[0];
+  samples[0].cellMv[1] = header.cellMv[1];
+
+  size_t offset = sizeof(header);
+  for (size_t i = 1; i < header.count; i++) {
+    uint32_t values[3];
+    for (int j = 0; j < 3; j++) {
+      size_t used = getVarint(payload + offset, length - offset, values[j]);
+      if (used == 0) {
+        return 0;
+      }
+      offset += used;
+    }
+    samples[i].atMs = samples[i - 1].atMs + values[0];
+    samples[i].cellMv[0] = samples[i - 1].cellMv[0] + unzigzag(values[1]);
+    samples[i].cellMv[1] = samples[i - 1].cellMv[1] + unzigzag(values[2]);
+  }
+
+  // Trailing bytes would mean the sender and we disagree on the format.
+  return offset == length ? header.count : 0;
+}
+
+static bool exceeds(int16_t a, int16_t b, int deadband) {
+  return abs((int)a - (int)b) > deadband;
+}
+
+bool statusChanged(const StatusPayload &a, const StatusPayload &b) {
+  if (a.flags != b.flags || a.maxO2Percent != b.maxO2Percent || exceeds(a.o2, b.o2, STATUS_DEADBAND_O2)) {
+    return true;
+  }
+  for (int i = 0; i < 2; i++) {
+    if (exceeds(a.cellMv[i], b.cellMv[i], STATUS_DEADBAND_MV) || exceeds(a.cellO2[i], b.cellO2[i], STATUS_DEADBAND_O2) ||
+        a.calibrationMv[i] != b.calibrationMv[i]) {
+      return true;
+    }
+  }
+  return false;
+}
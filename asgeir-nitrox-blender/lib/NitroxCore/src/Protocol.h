@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "FixedPoint.h"
+
+/*
+ * ESP-NOW wire format shared by the blender and the client.
+ *
+ * A frame is a FrameHeader, the payload and a CRC16 (Crc16.h) over both, all little
+ * endian and packed, so it does not depend on the compiler's struct layout. Values are
+ * fixed point. The sequence number counts every frame of a sender, so a receiver can
+ * drop duplicates and frames older than the one it already shows, and the send time
+ * lets it measure how late frames arrive. FRAME_SAMPLES are counted apart, only the
+ * clients holding a stream lease get them and the others would see gaps.
+ */
+
+#define PROTOCOL_MAGIC 0x584E // "NX"
+#define PROTOCOL_VERSION 2 // 2: FrameHeader::sentAtUs
+#define PROTOCOL_MAX_FRAME_SIZE 250 // ESP_NOW_MAX_DATA_LEN
+
+#define FRAME_STATUS 1
+#define FRAME_STREAM_REQUEST 2  // Client to blender, StreamRequestPayload
+#define FRAME_SAMPLES 3         // Blender to client, SampleBatchHeader and the delta-coded samples
+#define FRAME_HELLO 4           // Client broadcast, no payload: send to me from now on
+#define FRAME_PROFILE 5         // Blender to client, ProfilePayload (LoopProfile.h)
+
+#define PROTOCOL_MV_SCALE 100 // 0.01 mV
+#define PROTOCOL_O2_SCALE 100 // 0.01 %
+
+// STATUS_FLAG_*: bits of StatusPayload::flags
+#define STATUS_FLAG_READING_ERROR 0x01
+#define STATUS_FLAG_SOLENOID_OPEN 0x02
+#define STATUS_FLAG_CELL1_WARNING 0x04
+#define STATUS_FLAG_CELL2_WARNING 0x08
+#define STATUS_FLAG_CELL1_DISABLED 0x10
+#define STATUS_FLAG_CELL2_DISABLED 0x20
+
+struct __attribute__((packed)) FrameHeader {
+  uint16_t magic;
+  uint8_t version;
+  uint8_t type;       // FRAME_*
+  uint16_t sequence;
+  uint32_t sentAtUs;  // Sender's micros() when the frame was built
+  uint8_t length;     // Payload bytes
+};
+
+/// @brief What the blender shows, 16 bytes instead of the 60 of the old C structs.
+struct __attribute__((packed)) StatusPayload {
+  int16_t o2;               // PROTOCOL_O2_SCALE, negative without a valid reading
+  int16_t cellMv[2];        // PROTOCOL_MV_SCALE
+  int16_t cellO2[2];        // PROTOCOL_O2_SCALE
+  int16_t calibrationMv[2]; // PROTOCOL_MV_SCALE
+  uint8_t maxO2Percent;     // Set-point from the potentiometer
+  uint8_t flags;            // STATUS_FLAG_*
+};
+
+/// @brief Ask the blender for the raw cell samples. It streams until the lease runs out, so a
+/// client that goes away does not keep it sending. Renew well before, 0 stops right away.
+struct __attribute__((packed)) StreamRequestPayload {
+  uint16_t leaseMs;
+};
+
+/*
+ * A FRAME_SAMPLES payload is a SampleBatchHeader with the first sample, followed by
+ * one record per further sample: the milliseconds since the previous sample as a
+ * varint and the change of both cells as zigzag varints (Varint.h). Cell noise is a
+ * few counts, so a sample takes 3 bytes and a frame carries up to about 75.
+ */
+struct __attribute__((packed)) SampleBatchHeader {
+  uint32_t atMs;      // First sample, blender millis()
+  uint16_t index;     // Of the first sample since streaming started, wraps. A jump means lost frames.
+  uint8_t count;
+  int16_t cellMv[2];  // PROTOCOL_MV_SCALE
+};
+
+struct StreamSample {
+  uint32_t atMs;
+  int16_t cellMv[2];  // PROTOCOL_MV_SCALE
+};
+
+#define FRAME_OVERHEAD (sizeof(FrameHeader) + 2)
+#define PROTOCOL_MAX_PAYLOAD_SIZE (PROTOCOL_MAX_FRAME_SIZE - FRAME_OVERHEAD)
+// Samples after the first take at least 3 bytes.
+#define SAMPLE_BATCH_MAX_COUNT ((PROTOCOL_MAX_PAYLOAD_SIZE - sizeof(SampleBatchHeader)) / 3 + 1)
+
+enum FrameError {
+  FRAME_OK = 0,
+  FRAME_TOO_SHORT,
+  FRAME_FOREIGN,      // Not our magic, some other ESP-NOW sender.
+  FRAME_BAD_VERSION,
+  FRAME_BAD_LENGTH,
+  FRAME_BAD_CRC,
+};
+
+/// @return frame length, 0 if it does not fit into capacity.
+size_t encodeFrame(uint8_t type, uint16_t sequence, uint32_t sentAtUs, const void *payload, size_t length,
+  uint8_t *out, size_t capacity);
+
+/// @brief Check a received frame. On FRAME_OK header and payload point into data.
+FrameError decodeFrame(const uint8_t *data, size_t length, FrameHeader &header, const uint8_t *&payload);
+
+/// @brief Length of the frame at the start of data according to its header, to split frames sent
+/// back to back in a byte stream. 0 if the header is incomplete or foreign.
+size_t frameLength(const uint8_t *data, size_t length);
+
+/// @brief Delta-code as many of count samples as fit into capacity bytes.
+/// @return payload length, encoded is set to the number of samples in it.
+size_t encodeSampleBatch(uint16_t index, const StreamSample *samples, size_t count, uint8_t *out, size_t capacity,
+  size_t &encoded);
+
+/// @brief Expand a FRAME_SAMPLES payload into samples.
+/// @return number of samples, 0 if the payload is malformed or holds more than capacity.
+size_t decodeSampleBatch(const uint8_t *payload, size_t length, uint16_t &index, StreamSample *samples,
+  size_t capacity);
+
+/// @brief Sequence numbers wrap, a is newer than b within half the range.
+inline bool isNewerSequence(uint16_t a, uint16_t b) { return (int16_t)(a - b) > 0; }
+
+/*
+ * Deadbands for change-driven sending, about the one decimal the client shows the O2
+ * with. Smaller changes wait for the next heartbeat.
+ */
+#define STATUS_DEADBAND_O2 10 // 0.1 %
+#define STATUS_DEADBAND_MV 5  // 0.05 mV, about 0.1 % O2 on a 10 mV cell
+
+/// @return true if b differs from a by more than the deadbands, or in any flag or setting.
+bool statusChanged(const StatusPayload &a, const StatusPayload &b);
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+
+/*
+ * Single writer / many readers snapshot of a trivially copyable value.
+ *
+ * The writer never waits and readers never take a lock: the sequence counter is odd
+ * while a write is in progress and a reader retries if the counter was odd or changed
+ * while it copied the value. The payload is kept in relaxed atomic words, so a racing
+ * copy is well defined and only thrown away, never torn.
+ */
+template <typename T>
+class Seqlock {
+public:
+  Seqlock() : sequence(0) {
+    T value;
+    memset(&value, 0, sizeof(value));
+    write(value);
+  }
+
+  /// @brief Publish a new value, only call from one writer.
+  void write(const T &value) {
+    uint32_t buffer[WORDS] = {};
+    memcpy(buffer, &value, sizeof(T));
+
+    uint32_t s = sequence.load(std::memory_order_relaxed);
+    sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) {
+      words[i].store(buffer[i], std::memory_order_relaxed);
+    }
+    sequence.store(s + 2, std::memory_order_release);
+  }
+
+  /// @brief Single attempt at copying the value.
+  /// @return false if a write got in the way, value is then undefined.
+  bool tryRead(T &value) const {
+    uint32_t before = sequence.load(std::memory_order_acquire);
+    if (before & 1) {
+      return false;
+    }
+
+    uint32_t buffer[WORDS];
+    for (size_t i = 0; i < WORDS; i++) {
+      buffer[i] = words[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence.load(std::memory_order_relaxed) != before) {
+      return false;
+    }
+
+    memcpy(&value, buffer, sizeof(T));
+    return true;
+  }
+
+  /// @brief Copy the latest value, retries until no write got in the way.
+  T read() const {
+    T value;
+    while (!tryRead(value)) {
+    }
+    return value;
+  }
+
+  /// @brief Goes up by one with every write, readers can use it to spot a new value.
+  uint32_t version() const { return sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+  static const size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint32_t> words[WORDS];
+};
@@ -0,0 +1,163 @@
+#include "SlidingWindow.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+static uint32_t roundUpToPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+SlidingWindow::SlidingWindow(uint16_t size) : size(size) {
+  uint32_t capacity = roundUpToPowerOfTwo(size > 0 ? size : 1);
+  mask = capacity - 1;
+
+  values = (float *)malloc(capacity * sizeof(float));
+  minQueue.slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+  maxQueue.slots = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+  if (values == NULL || minQueue.slots == NULL || maxQueue.slots == NULL) {
+    // Like RunningAverage: out of memory leaves an empty window that ignores values.
+    this->size = 0;
+  }
+
+  clear();
+}
+
+SlidingWindow::SlidingWindow(SlidingWindow &&other)
+  : size(other.size), count(other.count), mask(other.mask), next(other.next), sinceResync(other.sinceResync),
+    values(other.values), minQueue(other.minQueue), maxQueue(other.maxQueue), mean(other.mean), m2(other.m2),
+    minSinceClear(other.minSinceClear), maxSinceClear(other.maxSinceClear) {
+  other.values = NULL;
+  other.minQueue.slots = NULL;
+  other.maxQueue.slots = NULL;
+  other.size = 0;
+  other.clear();
+}
+
+SlidingWindow::~SlidingWindow() {
+  free(values);
+  free(minQueue.slots);
+  free(maxQueue.slots);
+}
+
+void SlidingWindow::clear() {
+  count = 0;
+  next = 0;
+  sinceResync = 0;
+  minQueue.head = minQueue.tail = 0;
+  maxQueue.head = maxQueue.tail = 0;
+  mean = 0;
+  m2 = 0;
+  minSinceClear = NAN;
+  maxSinceClear = NAN;
+}
+
+void SlidingWindow::addValue(float value) {
+  if (size == 0) {
+    return;
+  }
+
+  if (count == size) {
+    uint32_t oldest = next - size;
+    float leaving = valueAt(oldest);
+
+    if (minQueue.slots[minQueue.head & mask] == oldest) {
+      minQueue.head++;
+    }
+    if (maxQueue.slots[maxQueue.head & mask] == oldest) {
+      maxQueue.head++;
+    }
+
+    // Welford, replacing leaving with value in a window of constant size.
+    double oldMean = mean;
+    mean += ((double)value - leaving) / size;
+    m2 += ((double)value - leaving) * ((double)value - mean + leaving - oldMean);
+  } else {
+    count++;
+    double delta = (double)value - mean;
+    mean += delta / count;
+    m2 += delta * ((double)value - mean);
+  }
+
+  values[next & mask] = value;
+
+  while (!minQueue.empty() && valueAt(minQueue.slots[(minQueue.tail - 1) & mask]) >= value) {
+    minQueue.tail--;
+  }
+  minQueue.slots[minQueue.tail++ & mask] = next;
+
+  while (!maxQueue.empty() && valueAt(maxQueue.slots[(maxQueue.tail - 1) & mask]) <= value) {
+    maxQueue.tail--;
+  }
+  maxQueue.slots[maxQueue.tail++ & mask] = next;
+
+  next++;
+
+  if (count == 1 || value < minSinceClear) {
+    minSinceClear = value;
+  }
+  if (count == 1 || value > maxSinceClear) {
+    maxSinceClear = value;
+  }
+
+  if (++sinceResync >= SLIDING_WINDOW_RESYNC) {
+    resync();
+  }
+}
+
+void SlidingWindow::resync() {
+  double sum = 0;
+  for (uint32_t sequence = next - count; sequence != next; sequence++) {
+    sum += valueAt(sequence);
+  }
+  mean = sum / count;
+
+  m2 = 0;
+  for (uint32_t sequence = next - count; sequence != next; sequence++) {
+    double delta = valueAt(sequence) - mean;
+    m2 += delta * delta;
+  }
+
+  sinceResync = 0;
+}
+
+float SlidingWindow::getAverage() const {
+  return count == 0 ? NAN : (float)mean;
+}
+
+float SlidingWindow::getMin() const {
+  return count == 0 ? NAN : minSinceClear;
+}
+
+float SlidingWindow::getMax() const {
+  return count == 0 ? NAN : maxSinceClear;
+}
+
+float SlidingWindow::getMinInBuffer() const {
+  return count == 0 ? NAN : valueAt(minQueue.slots[minQueue.head & mask]);
+}
+
+float SlidingWindow::getMaxInBuffer() const {
+  return count == 0 ? NAN : valueAt(maxQueue.slots[maxQueue.head & mask]);
+}
+
+float SlidingWindow::getVariance() const {
+  if (count < 2) {
+    return NAN;
+  }
+  // Rounding can leave a tiny negative m2 for a constant signal.
+  return m2 > 0 ? (float)(m2 / (count - 1)) : 0;
+}
+
+float SlidingWindow::getStandardDeviation() const {
+  float variance = getVariance();
+  return isnan(variance) ? NAN : sqrtf(variance);
+}
+
+float SlidingWindow::getStandardError() const {
+  float deviation = getStandardDeviation();
+  return isnan(deviation) ? NAN : deviation / sqrtf(count);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLIDING_WINDOW_RESYNC 65536UL // Additions between exact recomputations of mean and variance.
+
+/*
+ * Statistics over the last N values, drop-in for the parts of RunningAverage the
+ * firmware uses. Every query is O(1) and addValue() is amortised O(1):
+ *
+ * - min/max in the window come from monotonic queues (the front is the answer, values
+ *   that can never become the answer are dropped from the back),
+ * - average and variance are kept with Welford's update, extended to also remove the
+ *   value leaving the window. They are recomputed exactly every SLIDING_WINDOW_RESYNC
+ *   additions so rounding errors cannot pile up.
+ *
+ * Memory is 12 bytes per slot, rounded up to a power of two slots.
+ */
+class SlidingWindow {
+public:
+  explicit SlidingWindow(uint16_t size);
+  SlidingWindow(SlidingWindow &&other);
+  ~SlidingWindow();
+
+  SlidingWindow(const SlidingWindow &) = delete;
+  SlidingWindow &operator=(const SlidingWindow &) = delete;
+
+  void clear();
+  void addValue(float value);
+
+  /// @return average of the values in the window, NAN if empty.
+  float getAverage() const;
+  float getFastAverage() const { return getAverage(); }
+
+  /// @return smallest / largest value added since clear(), NAN if empty.
+  float getMin() const;
+  float getMax() const;
+
+  /// @return smallest / largest value in the window, NAN if empty.
+  float getMinInBuffer() const;
+  float getMaxInBuffer() const;
+
+  /// @return sample variance (n - 1) of the window, NAN with less than two values.
+  float getVariance() const;
+  float getStandardDeviation() const;
+  float getStandardError() const;
+
+  uint16_t getSize() const { return size; }
+  uint16_t getCount() const { return count; }
+  bool bufferIsFull() const { return count == size; }
+
+private:
+  /// @brief Indexes into values, in order of age, used for both monotonic queues.
+  struct IndexQueue {
+    uint32_t *slots;
+    uint32_t head;
+    uint32_t tail;
+
+    bool empty() const { return head == tail; }
+  };
+
+  float valueAt(uint32_t sequence) const { return values[sequence & mask]; }
+  void resync();
+
+  uint16_t size;
+  uint16_t count;
+  uint32_t mask;
+  uint32_t next;  // Sequence number of the next value, free running.
+  uint32_t sinceResync;
+
+  float *values;
+  IndexQueue minQueue;
+  IndexQueue maxQueue;
+
+  double mean;
+  double m2;  // Sum of squared differences from the mean.
+  float minSinceClear;
+  float maxSinceClear;
+};
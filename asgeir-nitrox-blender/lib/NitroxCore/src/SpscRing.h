@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+/*
+ * Lock-free single producer / single consumer ring buffer.
+ *
+ * push() may only be called from one context (task or ISR) and pop() from one other.
+ * Head and tail are free running counters, so all N slots are usable and the fill level
+ * is simply head - tail. N must be a power of two.
+ */
+template <typename T, size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  /// @return false if the ring is full, the value is dropped.
+  bool push(const T &value) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= N) {
+      return false;
+    }
+    slots[h & (N - 1)] = value;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @return false if the ring is empty.
+  bool pop(T &value) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = slots[t & (N - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  bool empty() const { return size() == 0; }
+  static size_t capacity() { return N; }
+
+private:
+  T slots[N];
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * LEB128 style varints, 7 bits per byte with the top bit set on all but the last.
+ * Signed deltas go through zigzag first, so small changes either way take one byte.
+ */
+
+#define VARINT_MAX_LENGTH 5
+
+/// @return number of bytes written to out, at most VARINT_MAX_LENGTH.
+inline size_t putVarint(uint8_t *out, uint32_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = value;
+  return length;
+}
+
+/// @return number of bytes read, 0 if the varint runs past length or is too long.
+inline size_t getVarint(const uint8_t *data, size_t length, uint32_t &value) {
+  value = 0;
+  for (size_t i = 0; i < length && i < VARINT_MAX_LENGTH; i++) {
+    value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+inline uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/// @brief value - previous as a zigzag varint.
+inline size_t putDelta(uint8_t *out, int16_t value, int16_t previous) {
+  return putVarint(out, zigzag((int32_t)value - previous));
+}
@@ -0,0 +1,95 @@
+#include "MainScreen.h"
+
+#define FONT_LARGE &Dialog_plain_100
+#define CELL_X(index) ((index) * (MAIN_CELL_WIDTH + MAIN_CELL_SPACING))
+#define CELL_VALUE_Y 112
+#define CELL_O2_X 50            // Within the cell, right of the voltage
+#define CELL_O2_HEIGHT 30
+#define CELL_UNIT_Y 127
+#define CELL_REFERENCE_Y 150
+#define SOLENOID_X 250
+#define SOLENOID_WIDTH 90
+#define MAX_O2_Y 115
+
+MainScreen::MainScreen(TFT_eSPI &tft)
+  : tft(tft),
+    oxygenSprite(&tft),
+    cellSprite(&tft),
+    oxygen(0, 0, MAIN_OXYGEN_WIDTH, MAIN_OXYGEN_HEIGHT, WIDGET_FONT_CURRENT),
+    cellHeaders {
+      StatusHeader(CELL_X(0), MAIN_HEADER_ROW_Y, MAIN_CELL_WIDTH, MAIN_HEADER_HEIGHT, "CELL 1", 2),
+      StatusHeader(CELL_X(1), MAIN_HEADER_ROW_Y, MAIN_CELL_WIDTH, MAIN_HEADER_HEIGHT, "CELL 2", 2) },
+    cellMv { Readout(CELL_X(0), CELL_VALUE_Y, CELL_O2_X, 16, 2), Readout(CELL_X(1), CELL_VALUE_Y, CELL_O2_X, 16, 2) },
+    cellMvUnit { Label(CELL_X(0) + 12, CELL_UNIT_Y, 30, 16, 2), Label(CELL_X(1) + 12, CELL_UNIT_Y, 30, 16, 2) },
+    cellReference {
+      Label(CELL_X(0), CELL_REFERENCE_Y, MAIN_CELL_WIDTH, 8, 1),
+      Label(CELL_X(1), CELL_REFERENCE_Y, MAIN_CELL_WIDTH, 8, 1) },
+    cellO2 {
+      Readout(CELL_X(0) + CELL_O2_X, CELL_VALUE_Y, MAIN_CELL_WIDTH - CELL_O2_X, CELL_O2_HEIGHT, WIDGET_FONT_CURRENT),
+      Readout(CELL_X(1) + CELL_O2_X, CELL_VALUE_Y, MAIN_CELL_WIDTH - CELL_O2_X, CELL_O2_HEIGHT, WIDGET_FONT_CURRENT) },
+    solenoidHeader(SOLENOID_X, MAIN_HEADER_ROW_Y, SOLENOID_WIDTH, MAIN_HEADER_HEIGHT, "SOLENOID", 2),
+    maxO2(SOLENOID_X, MAX_O2_Y, 70, 48, 7) {
+  for (int i = 0; i < 2; i++) {
+    cellO2[i].setSprite(&cellSprite);
+    cellMvUnit[i].print("mV", TFT_GREEN);
+    cells[i].add(cellHeaders[i]);
+    cells[i].add(cellMv[i]);
+    cells[i].add(cellMvUnit[i]);
+    cells[i].add(cellReference[i]);
+    cells[i].add(cellO2[i]);
+  }
+  oxygen.setSprite(&oxygenSprite);
+  solenoid.add(solenoidHeader);
+  solenoid.add(maxO2);
+}
+
+void MainScreen::begin() {
+  oxygenSprite.setColorDepth(8);
+  oxygenSprite.createSprite(MAIN_OXYGEN_WIDTH, MAIN_OXYGEN_HEIGHT);
+  oxygenSprite.setFreeFont(FONT_LARGE);
+
+  cellSprite.setColorDepth(8);
+  cellSprite.createSprite(MAIN_CELL_WIDTH - CELL_O2_X, CELL_O2_HEIGHT);
+  cellSprite.setFreeFont(&FreeSerif18pt7b);
+}
+
+void MainScreen::clear() {
+  tft.fillScreen(TFT_BLACK);
+  tft.setTextSize(1);
+  oxygen.invalidate();
+  cells[0].invalidate();
+  cells[1].invalidate();
+  solenoid.invalidate();
+}
+
+void MainScreen::setOxygen(float o2) {
+  if (o2 < 0) {
+    oxygen.print("ERR-1", TFT_RED);
+  } else if (o2 > MAIN_O2_RED_ABOVE) {
+    oxygen.setValue(o2, 1, TFT_RED, "%");
+  } else if (o2 > MAIN_O2_ORANGE_ABOVE) {
+    oxygen.setValue(o2, 1, TFT_ORANGE, "%");
+  } else {
+    oxygen.setValue(o2, 1, TFT_GREEN, "%");
+  }
+}
+
+void MainScreen::setOxygenText(const char *text, uint16_t color) {
+  oxygen.print(text, color);
+}
+
+void MainScreen::setCell(int index, const MainCell &cell) {
+  cellHeaders[index].setColor(cell.isDisabled ? TFT_RED : TFT_GREEN);
+  cellMv[index].setValue(cell.mv, 2, cell.mv < MAIN_CELL_LOW_MV ? TFT_RED : TFT_GREEN);
+  cellReference[index].printf(cell.isCalibrationValid ? TFT_GREEN : TFT_RED, "Ref: %.2f mV", cell.calibrationMv);
+  if (cell.isDisabled) {
+    cellO2[index].print("DISABLED", TFT_RED, 2);
+  } else {
+    cellO2[index].setValue(cell.o2Percent, 1, TFT_GREEN);
+  }
+}
+
+void MainScreen::setSolenoid(bool isOpen, int maxO2Percent) {
+  solenoidHeader.setColor(isOpen ? TFT_GREEN : TFT_RED);
+  maxO2.printf(maxO2Percent > MAIN_MAX_O2_ORANGE_ABOVE ? TFT_ORANGE : TFT_GREEN, "%02d", maxO2Percent);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Widgets.h"
+
+#define MAIN_CELL_WIDTH 120
+#define MAIN_CELL_SPACING 5
+#define MAIN_HEADER_ROW_Y 92
+#define MAIN_HEADER_HEIGHT 15
+#define MAIN_OXYGEN_WIDTH 340
+#define MAIN_OXYGEN_HEIGHT 90
+
+// Colors of the readings, the same on the blender and the client.
+#define MAIN_O2_ORANGE_ABOVE 32       // %
+#define MAIN_O2_RED_ABOVE 40          // %
+#define MAIN_MAX_O2_ORANGE_ABOVE 34   // % set-point
+#define MAIN_CELL_LOW_MV 7            // A cell below this is shown red
+
+/// @brief What the main page shows of one cell.
+struct MainCell {
+  float mv;
+  float o2Percent;
+  float calibrationMv;
+  bool isCalibrationValid;
+  bool isDisabled;   // By the menu or without a sane reading
+};
+
+/*
+ * The main page of the blender and the client: the O2 in large digits, both cells with
+ * their voltage, O2 and calibration, and the solenoid with its set-point. It is made of
+ * widgets, so the firmware sets the values on every redraw and only what changed is
+ * drawn. clear() after anything else was on the screen.
+ */
+class MainScreen {
+public:
+  explicit MainScreen(TFT_eSPI &tft);
+
+  /// @brief Create the sprites, after tft.begin().
+  void begin();
+  /// @brief Clear the panel, everything is drawn again on the next updates.
+  void clear();
+
+  /// @brief A negative o2 is a reading error.
+  void setOxygen(float o2);
+  /// @brief Text instead of the O2, e.g. while the reading is stale.
+  void setOxygenText(const char *text, uint16_t color);
+  void setCell(int index, const MainCell &cell);
+  void setSolenoid(bool isOpen, int maxO2Percent);
+
+  /// @brief The O2 area was drawn over, by the calibration.
+  void invalidateOxygen() { oxygen.invalidate(); }
+
+  uint32_t updateOxygen() { return oxygen.update(tft); }
+  uint32_t updateCell(int index) { return cells[index].update(tft); }
+  uint32_t updateSolenoid() { return solenoid.update(tft); }
+
+private:
+  TFT_eSPI &tft;
+  TFT_eSprite oxygenSprite;
+  TFT_eSprite cellSprite;   // Shared by the O2 of both cells
+
+  Readout oxygen;
+  StatusHeader cellHeaders[2];
+  Readout cellMv[2];
+  Label cellMvUnit[2];
+  Label cellReference[2];
+  Readout cellO2[2];
+  StatusHeader solenoidHeader;
+  Label maxO2;
+
+  WidgetGroup cells[2];
+  WidgetGroup solenoid;
+};
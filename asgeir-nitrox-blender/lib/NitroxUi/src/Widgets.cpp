@@ -0,0 +1,162 @@
+#include "Widgets.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+WidgetStats Widget::counters = {};
+
+uint32_t Widget::update(TFT_eSPI &tft) {
+  counters.updates++;
+  if (!isDirty) {
+    return 0;
+  }
+  isDirty = false;
+  uint32_t pixels = render(tft);
+  counters.draws++;
+  counters.pixels += pixels;
+  return pixels;
+}
+
+void Widget::resetStats() {
+  memset(&counters, 0, sizeof(counters));
+}
+
+void Widget::report(Print &out) {
+  out.printf("Widgets: %u updates, %u drawn (%.1f %%), %llu pixels (%.0f per update)\r\n", (unsigned)counters.updates,
+    (unsigned)counters.draws, counters.updates ? 100.0f * counters.draws / counters.updates : 0,
+    (unsigned long long)counters.pixels, counters.updates ? (double)counters.pixels / counters.updates : 0);
+}
+
+Label::Label(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t font, uint16_t background)
+  : Widget(x, y, width, height), background(background), defaultFont(font), font(font) {
+}
+
+void Label::print(const char *text, uint16_t color, uint8_t font) {
+  if (color == this->color && font == this->font && strncmp(text, this->text, sizeof(this->text) - 1) == 0) {
+    return;
+  }
+  snprintf(this->text, sizeof(this->text), "%s", text);
+  this->color = color;
+  this->font = font;
+  isDirty = true;
+}
+
+void Label::printf(uint16_t color, const char *format, ...) {
+  char formatted[WIDGET_TEXT_SIZE];
+  va_list arguments;
+  va_start(arguments, format);
+  vsnprintf(formatted, sizeof(formatted), format, arguments);
+  va_end(arguments);
+  print(formatted, color);
+}
+
+uint32_t Label::render(TFT_eSPI &tft) {
+  if (sprite != NULL) {
+    sprite->fillSprite(background);
+    sprite->setTextColor(color);
+    if (font == WIDGET_FONT_CURRENT) {
+      sprite->drawString(text, textX, textY);
+    } else {
+      sprite->drawString(text, textX, textY, font);
+    }
+    sprite->pushSprite(x, y);
+    return (uint32_t)width * height;
+  }
+
+  // The padding blanks what a longer text left behind, without clearing first and flickering.
+  tft.setTextColor(color, background);
+  tft.setTextPadding(width - textX);
+  if (font == WIDGET_FONT_CURRENT) {
+    tft.drawString(text, x + textX, y + textY);
+  } else {
+    tft.drawString(text, x + textX, y + textY, font);
+  }
+  tft.setTextPadding(0);
+  return (uint32_t)(width - textX) * (font == WIDGET_FONT_CURRENT ? tft.fontHeight() : tft.fontHeight(font));
+}
+
+void Readout::setValue(float value, uint8_t decimals, uint16_t color, const char *unit) {
+  char formatted[WIDGET_TEXT_SIZE];
+  snprintf(formatted, sizeof(formatted), "%.*f%s", decimals, value, unit);
+  print(formatted, color);
+}
+
+StatusHeader::StatusHeader(int16_t x, int16_t y, int16_t width, int16_t height, const char *title, uint8_t font,
+  int16_t textY, uint16_t textColor)
+  : Widget(x, y, width, height), font(font), textY(textY), textColor(textColor), title(title) {
+}
+
+void StatusHeader::set(const char *title, uint16_t background) {
+  if (title == this->title && background == this->background) {
+    return;
+  }
+  this->title = title;
+  this->background = background;
+  isDirty = true;
+}
+
+uint32_t StatusHeader::render(TFT_eSPI &tft) {
+  tft.fillRect(x, y, width, height, background);
+  tft.setTextColor(textColor);
+  tft.drawString(title, x + (width - tft.textWidth(title, font)) / 2, y + textY, font);
+  return (uint32_t)width * height;
+}
+
+Bar::Bar(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t background)
+  : Widget(x, y, width, height), background(background) {
+}
+
+void Bar::set(int32_t value, int32_t maximum, uint16_t color) {
+  if (value < 0) {
+    value = 0;
+  } else if (value > maximum) {
+    value = maximum;
+  }
+  int16_t filled = maximum > 0 ? (int16_t)(value * width / maximum) : 0;
+  if (filled == this->filled && color == this->color) {
+    return;
+  }
+  this->filled = filled;
+  this->color = color;
+  isDirty = true;
+}
+
+uint32_t Bar::render(TFT_eSPI &tft) {
+  if (drawnFilled < 0 || color != drawnColor) {
+    tft.fillRect(x, y, filled, height, color);
+    tft.fillRect(x + filled, y, width - filled, height, background);
+    drawnFilled = filled;
+    drawnColor = color;
+    return (uint32_t)width * height;
+  }
+
+  // Only the span between the old and the new end.
+  int16_t from = filled < drawnFilled ? filled : drawnFilled;
+  int16_t span = filled < drawnFilled ? drawnFilled - filled : filled - drawnFilled;
+  tft.fillRect(x + from, y, span, height, filled > drawnFilled ? color : background);
+  drawnFilled = filled;
+  return (uint32_t)span * height;
+}
+
+bool WidgetGroup::add(Widget &widget) {
+  if (count == WIDGET_GROUP_CAPACITY) {
+    return false;
+  }
+  widgets[count++] = &widget;
+  return true;
+}
+
+uint32_t WidgetGroup::update(TFT_eSPI &tft) {
+  uint32_t pixels = 0;
+  for (size_t i = 0; i < count; i++) {
+    pixels += widgets[i]->update(tft);
+  }
+  return pixels;
+}
+
+void WidgetGroup::invalidate() {
+  for (size_t i = 0; i < count; i++) {
+    widgets[i]->invalidate();
+  }
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "TFT_eSPI.h"
+
+#define WIDGET_TEXT_SIZE 40         // Longest text of a label, with the terminator
+#define WIDGET_GROUP_CAPACITY 8
+#define WIDGET_FONT_CURRENT 0       // Draw with the font set on the target, e.g. a free font of a sprite
+
+/*
+ * Retained-mode widgets for the 320 x 170 panel.
+ *
+ * A widget keeps what it last drew: the text, colors and font of a label, the fill of
+ * a bar. The firmware sets the values it wants shown as often as it likes, a setter
+ * only marks the widget dirty when the result differs, and update() draws the dirty
+ * ones and nothing else. A steady reading then costs a string compare per field and
+ * no bus traffic. Each draw covers the bounds of the widget, or the part of a bar that
+ * changed, so it never leaves old pixels behind and the panel only sees damage
+ * rectangles.
+ *
+ * Whatever clears the screen behind the widgets' back (a page switch, the menu) must
+ * invalidate() them, they are redrawn on the next update().
+ */
+
+struct WidgetStats {
+  uint32_t updates;     // Calls of Widget::update()
+  uint32_t draws;       // Of them, the ones that drew
+  uint64_t pixels;      // Area of the damage rectangles
+};
+
+class Widget {
+public:
+  Widget(int16_t x, int16_t y, int16_t width, int16_t height) : x(x), y(y), width(width), height(height) {}
+  virtual ~Widget() {}
+
+  /// @brief Draw the widget if it changed since the last draw.
+  /// @return pixels drawn, 0 if nothing changed.
+  uint32_t update(TFT_eSPI &tft);
+
+  virtual void invalidate() { isDirty = true; }
+  bool dirty() const { return isDirty; }
+
+  /// @brief Counters of all widgets, loop() only.
+  static const WidgetStats &stats() { return counters; }
+  static void resetStats();
+  static void report(Print &out);
+
+protected:
+  /// @return pixels drawn.
+  virtual uint32_t render(TFT_eSPI &tft) = 0;
+
+  int16_t x, y, width, height;
+  bool isDirty = true;
+
+private:
+  static WidgetStats counters;
+};
+
+/*
+ * Text in a box, left aligned at an offset in it. Drawn straight to the panel, with the
+ * text padded to the width of the box in the background color, or through a sprite of
+ * the size of the box, which draws without flicker and allows free fonts.
+ */
+class Label : public Widget {
+public:
+  Label(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t font, uint16_t background = TFT_BLACK);
+
+  /// @brief Draw through the sprite, it may be shared by labels of the same size.
+  void setSprite(TFT_eSprite *sprite) { this->sprite = sprite; isDirty = true; }
+  void setTextOffset(int16_t dx, int16_t dy) { textX = dx; textY = dy; isDirty = true; }
+
+  void print(const char *text, uint16_t color) { print(text, color, defaultFont); }
+  void print(const char *text, uint16_t color, uint8_t font);
+  void printf(uint16_t color, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+protected:
+  uint32_t render(TFT_eSPI &tft) override;
+
+  TFT_eSprite *sprite = NULL;
+  uint16_t background;
+  uint8_t defaultFont;
+  int16_t textX = 0;
+  int16_t textY = 0;
+
+  char text[WIDGET_TEXT_SIZE] = "";
+  uint16_t color = TFT_WHITE;
+  uint8_t font;
+};
+
+/// @brief A label for a number with a fixed number of decimals and a unit.
+class Readout : public Label {
+public:
+  Readout(int16_t x, int16_t y, int16_t width, int16_t height, uint8_t font, uint16_t background = TFT_BLACK)
+    : Label(x, y, width, height, font, background) {}
+
+  /// @brief Only a change in the shown digits redraws, 20.94 and 20.91 are both 20.9.
+  void setValue(float value, uint8_t decimals, uint16_t color, const char *unit = "");
+};
+
+/// @brief A filled box with its title centered, the color tells the state.
+class StatusHeader : public Widget {
+public:
+  StatusHeader(int16_t x, int16_t y, int16_t width, int16_t height, const char *title, uint8_t font,
+    int16_t textY = 0, uint16_t textColor = TFT_BLACK);
+
+  void setColor(uint16_t background) { set(title, background); }
+  void set(const char *title, uint16_t background);
+
+protected:
+  uint32_t render(TFT_eSPI &tft) override;
+
+  uint8_t font;
+  int16_t textY;
+  uint16_t textColor;
+  const char *title;
+  uint16_t background = TFT_BLACK;
+};
+
+/// @brief A horizontal bar filled from the left, only the part that changed is drawn.
+class Bar : public Widget {
+public:
+  Bar(int16_t x, int16_t y, int16_t width, int16_t height, uint16_t background = TFT_BLACK);
+
+  /// @brief value of maximum, clamped.
+  void set(int32_t value, int32_t maximum, uint16_t color);
+  void invalidate() override { isDirty = true; drawnFilled = -1; }
+
+protected:
+  uint32_t render(TFT_eSPI &tft) override;
+
+  uint16_t background;
+  uint16_t color = TFT_GREEN;
+  int16_t filled = 0;
+  int16_t drawnFilled = -1;   // -1: nothing on the panel, draw it all
+  uint16_t drawnColor = 0;
+};
+
+/// @brief Widgets that are shown and cleared together.
+class WidgetGroup {
+public:
+  bool add(Widget &widget);
+
+  /// @return pixels drawn.
+  uint32_t update(TFT_eSPI &tft);
+  void invalidate();
+
+private:
+  Widget *widgets[WIDGET_GROUP_CAPACITY];
+  size_t count = 0;
+};
@@ -0,0 +1,239 @@
+ // This is part of the TFT_eSPI class and is associated with the bus traffic profiler.
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Bus traffic profiler, compiled when TFT_BUS_PROFILE is defined
+////////////////////////////////////////////////////////////////////////////////////////
+// Counts what every public drawing call puts on the bus: the address windows it opens,
+// the pixels it pushes, how many windows carry a single pixel and the chip select
+// cycles. On the 8 bit parallel bus every byte is one write strobe, so a call that
+// opens a window per pixel costs about six times the bus time of one that pushes a run.
+//
+// The counters are kept per frame and in total. The sketch ends a frame with
+// busProfileFrame(), e.g. after a screen update, and prints the totals with
+// busProfileReport(). The state is shared by all TFT_eSPI instances.
+//
+// The pixels pushed by pushBlock() and pushPixels() are counted by the 8 bit parallel
+// backend of the ESP32-S3 and by the host backend, other processors only count the
+// windows, the chip selects and the pixels written by the core functions.
+
+// Public calls kept apart, the rest are booked together as "(other)"
+#ifndef TFT_BUS_PROFILE_CALLS
+  #define TFT_BUS_PROFILE_CALLS 32
+#endif
+
+// Bytes a window costs on controllers addressed by CASET, PASET and RAMWR
+#define TFT_BUS_PROFILE_WINDOW_BYTES 11
+
+typedef struct {
+  const char *name;
+  TFT_eSPI::busProfileCounters frame;
+  TFT_eSPI::busProfileCounters total;
+} busProfileEntry;
+
+static busProfileEntry busProfileEntries[TFT_BUS_PROFILE_CALLS + 2]; // + "(other)" and "(no call)"
+static uint8_t  busProfileCount = 0;    // Entries in use, not counting the last two
+static busProfileEntry *busProfileCall; // Entry of the outermost call, or "(no call)"
+static uint8_t  busProfileDepth = 0;    // Nested public calls
+static bool     busProfileTouched;      // The outermost call reached the bus
+static uint32_t busProfileRun = 0;      // Pixels pushed into the open window
+static uint32_t busProfileFrames = 0, busProfileBusyFrames = 0;
+
+/***************************************************************************************
+** Function name:           busProfileEntryFor (local)
+** Description:             Find or add the entry of a public call
+***************************************************************************************/
+static busProfileEntry *busProfileEntryFor(const char *name)
+{
+  for (uint8_t i = 0; i < busProfileCount; i++) {
+    if (busProfileEntries[i].name == name || strcmp(busProfileEntries[i].name, name) == 0) return &busProfileEntries[i];
+  }
+  if (busProfileCount == TFT_BUS_PROFILE_CALLS) return &busProfileEntries[TFT_BUS_PROFILE_CALLS];
+  busProfileEntries[busProfileCount].name = name;
+  return &busProfileEntries[busProfileCount++];
+}
+
+/***************************************************************************************
+** Function name:           busProfileCurrent (local)
+** Description:             Entry the bus traffic is booked to
+***************************************************************************************/
+static inline busProfileEntry *busProfileCurrent(void)
+{
+  busProfileTouched = true;
+  return busProfileDepth ? busProfileCall : &busProfileEntries[TFT_BUS_PROFILE_CALLS + 1];
+}
+
+/***************************************************************************************
+** Function name:           busProfileCloseRun (local)
+** Description:             Count the open window if it received a single pixel
+***************************************************************************************/
+static void busProfileCloseRun(busProfileEntry *entry)
+{
+  if (busProfileRun == 1) {
+    entry->frame.singles++;
+    entry->total.singles++;
+  }
+  busProfileRun = 0;
+}
+
+/***************************************************************************************
+** Function name:           busProfileBytes (local)
+** Description:             Estimated bytes on the bus, commands included
+***************************************************************************************/
+static uint64_t busProfileBytes(const TFT_eSPI::busProfileCounters &c)
+{
+  return (uint64_t)c.windows * TFT_BUS_PROFILE_WINDOW_BYTES + c.pixels * 2;
+}
+
+/***************************************************************************************
+** Function name:           busProfilePrint (local)
+** Description:             Print the entries, the most bus bytes first
+***************************************************************************************/
+static void busProfilePrint(Print &out, bool isFrame)
+{
+  busProfileEntry *order[TFT_BUS_PROFILE_CALLS + 2];
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < TFT_BUS_PROFILE_CALLS + 2; i++) {
+    busProfileEntry *entry = &busProfileEntries[i];
+    const TFT_eSPI::busProfileCounters &c = isFrame ? entry->frame : entry->total;
+    if (c.windows == 0 && c.pixels == 0 && c.csCycles == 0) continue;
+    // Insertion sort, there are only a few
+    uint8_t j = count++;
+    while (j > 0 && busProfileBytes(isFrame ? order[j - 1]->frame : order[j - 1]->total) < busProfileBytes(c)) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = entry;
+  }
+
+  for (uint8_t i = 0; i < count; i++) {
+    const TFT_eSPI::busProfileCounters &c = isFrame ? order[i]->frame : order[i]->total;
+    const char *name = order[i]->name;
+    if (order[i] == &busProfileEntries[TFT_BUS_PROFILE_CALLS]) name = "(other)";
+    else if (order[i] == &busProfileEntries[TFT_BUS_PROFILE_CALLS + 1]) name = "(no call)";
+    out.printf("  %-20s %6u calls %7u windows %7u single %9llu pixels %6u CS ~%llu bytes\r\n", name,
+      (unsigned)c.calls, (unsigned)c.windows, (unsigned)c.singles, (unsigned long long)c.pixels,
+      (unsigned)c.csCycles, (unsigned long long)busProfileBytes(c));
+  }
+}
+
+/***************************************************************************************
+** Function name:           BusProfileScope
+** Description:             Start booking to a public call, unless one is running
+***************************************************************************************/
+TFT_eSPI::BusProfileScope::BusProfileScope(const char *name)
+{
+  if (busProfileDepth++ == 0) {
+    busProfileCall = busProfileEntryFor(name);
+    busProfileTouched = false;
+  }
+}
+
+/***************************************************************************************
+** Function name:           ~BusProfileScope
+** Description:             Count the call if it reached the bus
+***************************************************************************************/
+TFT_eSPI::BusProfileScope::~BusProfileScope()
+{
+  if (--busProfileDepth == 0 && busProfileTouched) {
+    busProfileCloseRun(busProfileCall);
+    busProfileCall->frame.calls++;
+    busProfileCall->total.calls++;
+  }
+}
+
+/***************************************************************************************
+** Function name:           busProfileWindow
+** Description:             A window was opened, pixels follow
+***************************************************************************************/
+void TFT_eSPI::busProfileWindow(void)
+{
+  busProfileEntry *entry = busProfileCurrent();
+  busProfileCloseRun(entry);
+  entry->frame.windows++;
+  entry->total.windows++;
+}
+
+/***************************************************************************************
+** Function name:           busProfilePixels
+** Description:             Pixels were pushed into the open window
+***************************************************************************************/
+void TFT_eSPI::busProfilePixels(uint32_t count)
+{
+  busProfileEntry *entry = busProfileCurrent();
+  busProfileRun += count;
+  entry->frame.pixels += count;
+  entry->total.pixels += count;
+}
+
+/***************************************************************************************
+** Function name:           busProfileChipSelect
+** Description:             Chip select was taken low
+***************************************************************************************/
+void TFT_eSPI::busProfileChipSelect(void)
+{
+  busProfileEntry *entry = busProfileCurrent();
+  entry->frame.csCycles++;
+  entry->total.csCycles++;
+}
+
+/***************************************************************************************
+** Function name:           busProfileFrame
+** Description:             End a frame, print it if it had any bus traffic
+***************************************************************************************/
+void TFT_eSPI::busProfileFrame(Print *out)
+{
+  busProfileCounters sum = {};
+  for (uint8_t i = 0; i < TFT_BUS_PROFILE_CALLS + 2; i++) {
+    const busProfileCounters &c = busProfileEntries[i].frame;
+    sum.calls += c.calls;
+    sum.windows += c.windows;
+    sum.singles += c.singles;
+    sum.csCycles += c.csCycles;
+    sum.pixels += c.pixels;
+  }
+
+  busProfileFrames++;
+  if (sum.windows == 0 && sum.pixels == 0 && sum.csCycles == 0) return;
+  busProfileBusyFrames++;
+
+  if (out != nullptr) {
+    out->printf("Bus frame %u: %u calls, %u windows (%u single pixel), %llu pixels, %u CS, ~%llu bytes\r\n",
+      (unsigned)busProfileFrames, (unsigned)sum.calls, (unsigned)sum.windows, (unsigned)sum.singles,
+      (unsigned long long)sum.pixels, (unsigned)sum.csCycles, (unsigned long long)busProfileBytes(sum));
+    busProfilePrint(*out, true);
+  }
+
+  for (uint8_t i = 0; i < TFT_BUS_PROFILE_CALLS + 2; i++) {
+    memset(&busProfileEntries[i].frame, 0, sizeof(busProfileCounters));
+  }
+}
+
+/***************************************************************************************
+** Function name:           busProfileReport
+** Description:             Print the totals, the most bus bytes first
+***************************************************************************************/
+void TFT_eSPI::busProfileReport(Print &out)
+{
+  uint64_t bytes = 0;
+  for (uint8_t i = 0; i < TFT_BUS_PROFILE_CALLS + 2; i++) bytes += busProfileBytes(busProfileEntries[i].total);
+
+  out.printf("Bus profile: %u frames, %u with traffic, ~%llu bytes (~%llu per frame with traffic)\r\n",
+    (unsigned)busProfileFrames, (unsigned)busProfileBusyFrames, (unsigned long long)bytes,
+    (unsigned long long)(busProfileBusyFrames ? bytes / busProfileBusyFrames : 0));
+  busProfilePrint(out, false);
+}
+
+/***************************************************************************************
+** Function name:           busProfileReset
+** Description:             Clear all counters, the frame in progress included
+***************************************************************************************/
+void TFT_eSPI::busProfileReset(void)
+{
+  for (uint8_t i = 0; i < TFT_BUS_PROFILE_CALLS + 2; i++) {
+    memset(&busProfileEntries[i].frame, 0, sizeof(busProfileCounters));
+    memset(&busProfileEntries[i].total, 0, sizeof(busProfileCounters));
+  }
+  busProfileFrames = 0;
+  busProfileBusyFrames = 0;
+}
@@ -0,0 +1,41 @@
+ // This is part of the TFT_eSPI class and is associated with the bus traffic profiler.
+ // Only compiled when TFT_BUS_PROFILE is defined, see Bus_profile.cpp.
+
+ public:
+
+           // End a frame: print what the bus carried since the last call, one line per
+           // public call, when out is given and the frame had any traffic
+  static void busProfileFrame(Print *out = nullptr);
+           // Print the totals since start or busProfileReset()
+  static void busProfileReport(Print &out);
+  static void busProfileReset(void);
+
+           // Counters of one public call
+  typedef struct {
+    uint32_t calls;      // Calls that reached the bus
+    uint32_t windows;    // Address windows opened, CASET/PASET/RAMWR
+    uint32_t singles;    // Windows that received a single pixel
+    uint32_t csCycles;   // Chip select taken low
+    uint64_t pixels;     // Pixels pushed
+  } busProfileCounters;
+
+           // Marks the outermost public call, everything on the bus until it returns is
+           // booked to it. Nested calls, e.g. drawString() -> drawChar() -> drawPixel(),
+           // are not booked separately.
+  class BusProfileScope {
+   public:
+    explicit BusProfileScope(const char *name);
+    ~BusProfileScope();
+  };
+
+           // Called by the TFT_PROFILE_ macros below
+  static void busProfileWindow(void);
+  static void busProfilePixels(uint32_t count);
+  static void busProfileChipSelect(void);
+
+// Book the bus traffic to the public call, the pixel and window hooks sit where the
+// library writes to the panel, the chip select hook where a transaction starts
+#define TFT_PROFILE_CALL(name) BusProfileScope busProfileScope(name)
+#define TFT_PROFILE_WINDOW()   busProfileWindow()
+#define TFT_PROFILE_PIXELS(n)  busProfilePixels(n)
+#define TFT_PROFILE_CS()       busProfileChipSelect()
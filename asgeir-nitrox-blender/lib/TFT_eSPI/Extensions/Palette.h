@@ -0,0 +1,206 @@
+        ////////////////////////////////////////////////////
+        //   Palette expansion for the 8, 4 and 1 bpp     //
+        //   pushImage() functions                        //
+        ////////////////////////////////////////////////////
+
+// Plain functions, not part of the class: TFT_eSPI.cpp uses them to turn a run of
+// palette pixels into RGB565 for pushPixels(), src/bench-palette checks them against
+// the per pixel code they replace. The image is read with pgm_read_byte() so the same
+// functions serve images in RAM and in FLASH.
+
+#ifndef _TFT_eSPI_PALETTEH_
+#define _TFT_eSPI_PALETTEH_
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef pgm_read_byte
+  #define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+
+// Pixels converted into the line buffer before each pushPixels(), short rows are
+// packed together
+#ifndef TFT_PUSH_CHUNK
+  #define TFT_PUSH_CHUNK 512
+#endif
+
+// A 4 bpp image needs at least this many pixels to pay for a new two pixel table
+#define TFT_PAIR_MIN_PIXELS 512
+
+// RGB332 to RGB565, with the bytes in the order pushPixels() sends them when
+// setSwapBytes(false): high byte first in memory on a little endian processor.
+// Blue is expanded 0, 11, 21, 31, red and green repeat their top bits.
+static const uint16_t tftRgb332[256] = {
+  0x0000, 0x0B00, 0x1500, 0x1F00, 0x2001, 0x2B01, 0x3501, 0x3F01,
+  0x4002, 0x4B02, 0x5502, 0x5F02, 0x6003, 0x6B03, 0x7503, 0x7F03,
+  0x8004, 0x8B04, 0x9504, 0x9F04, 0xA005, 0xAB05, 0xB505, 0xBF05,
+  0xC006, 0xCB06, 0xD506, 0xDF06, 0xE007, 0xEB07, 0xF507, 0xFF07,
+  0x0020, 0x0B20, 0x1520, 0x1F20, 0x2021, 0x2B21, 0x3521, 0x3F21,
+  0x4022, 0x4B22, 0x5522, 0x5F22, 0x6023, 0x6B23, 0x7523, 0x7F23,
+  0x8024, 0x8B24, 0x9524, 0x9F24, 0xA025, 0xAB25, 0xB525, 0xBF25,
+  0xC026, 0xCB26, 0xD526, 0xDF26, 0xE027, 0xEB27, 0xF527, 0xFF27,
+  0x0048, 0x0B48, 0x1548, 0x1F48, 0x2049, 0x2B49, 0x3549, 0x3F49,
+  0x404A, 0x4B4A, 0x554A, 0x5F4A, 0x604B, 0x6B4B, 0x754B, 0x7F4B,
+  0x804C, 0x8B4C, 0x954C, 0x9F4C, 0xA04D, 0xAB4D, 0xB54D, 0xBF4D,
+  0xC04E, 0xCB4E, 0xD54E, 0xDF4E, 0xE04F, 0xEB4F, 0xF54F, 0xFF4F,
+  0x0068, 0x0B68, 0x1568, 0x1F68, 0x2069, 0x2B69, 0x3569, 0x3F69,
+  0x406A, 0x4B6A, 0x556A, 0x5F6A, 0x606B, 0x6B6B, 0x756B, 0x7F6B,
+  0x806C, 0x8B6C, 0x956C, 0x9F6C, 0xA06D, 0xAB6D, 0xB56D, 0xBF6D,
+  0xC06E, 0xCB6E, 0xD56E, 0xDF6E, 0xE06F, 0xEB6F, 0xF56F, 0xFF6F,
+  0x0090, 0x0B90, 0x1590, 0x1F90, 0x2091, 0x2B91, 0x3591, 0x3F91,
+  0x4092, 0x4B92, 0x5592, 0x5F92, 0x6093, 0x6B93, 0x7593, 0x7F93,
+  0x8094, 0x8B94, 0x9594, 0x9F94, 0xA095, 0xAB95, 0xB595, 0xBF95,
+  0xC096, 0xCB96, 0xD596, 0xDF96, 0xE097, 0xEB97, 0xF597, 0xFF97,
+  0x00B0, 0x0BB0, 0x15B0, 0x1FB0, 0x20B1, 0x2BB1, 0x35B1, 0x3FB1,
+  0x40B2, 0x4BB2, 0x55B2, 0x5FB2, 0x60B3, 0x6BB3, 0x75B3, 0x7FB3,
+  0x80B4, 0x8BB4, 0x95B4, 0x9FB4, 0xA0B5, 0xABB5, 0xB5B5, 0xBFB5,
+  0xC0B6, 0xCBB6, 0xD5B6, 0xDFB6, 0xE0B7, 0xEBB7, 0xF5B7, 0xFFB7,
+  0x00D8, 0x0BD8, 0x15D8, 0x1FD8, 0x20D9, 0x2BD9, 0x35D9, 0x3FD9,
+  0x40DA, 0x4BDA, 0x55DA, 0x5FDA, 0x60DB, 0x6BDB, 0x75DB, 0x7FDB,
+  0x80DC, 0x8BDC, 0x95DC, 0x9FDC, 0xA0DD, 0xABDD, 0xB5DD, 0xBFDD,
+  0xC0DE, 0xCBDE, 0xD5DE, 0xDFDE, 0xE0DF, 0xEBDF, 0xF5DF, 0xFFDF,
+  0x00F8, 0x0BF8, 0x15F8, 0x1FF8, 0x20F9, 0x2BF9, 0x35F9, 0x3FF9,
+  0x40FA, 0x4BFA, 0x55FA, 0x5FFA, 0x60FB, 0x6BFB, 0x75FB, 0x7FFB,
+  0x80FC, 0x8BFC, 0x95FC, 0x9FFC, 0xA0FD, 0xABFD, 0xB5FD, 0xBFFD,
+  0xC0FE, 0xCBFE, 0xD5FE, 0xDFFE, 0xE0FF, 0xEBFF, 0xF5FF, 0xFFFF
+};
+
+/***************************************************************************************
+** Function name:           tftExpand332
+** Description:             Convert n RGB332 pixels
+***************************************************************************************/
+static inline void tftExpand332(uint16_t *dst, const uint8_t *src, uint32_t n)
+{
+  for (; n >= 4; n -= 4) {
+    dst[0] = tftRgb332[pgm_read_byte(src)];
+    dst[1] = tftRgb332[pgm_read_byte(src + 1)];
+    dst[2] = tftRgb332[pgm_read_byte(src + 2)];
+    dst[3] = tftRgb332[pgm_read_byte(src + 3)];
+    dst += 4;
+    src += 4;
+  }
+  while (n--) *dst++ = tftRgb332[pgm_read_byte(src++)];
+}
+
+/***************************************************************************************
+** Function name:           tftPairsFor
+** Description:             Two pixel table of a 16 colour map, nullptr if not worth it
+***************************************************************************************/
+// Entry b holds the colours of both nibbles of byte b, the high nibble (first pixel)
+// in the low half so it lands first in memory. The table is kept until a different
+// colour map is used, building it only pays for images of TFT_PAIR_MIN_PIXELS or more.
+static inline const uint32_t *tftPairsFor(const uint16_t *cmap, uint32_t pixels)
+{
+  static uint16_t map[16];
+  static uint32_t pairs[256];
+  static bool     isValid = false;
+
+  if (isValid && memcmp(map, cmap, sizeof(map)) == 0) return pairs;
+  if (pixels < TFT_PAIR_MIN_PIXELS) return nullptr;
+
+  memcpy(map, cmap, sizeof(map));
+  for (uint32_t i = 0; i < 256; i++) pairs[i] = map[i >> 4] | (uint32_t)map[i & 0x0F] << 16;
+  isValid = true;
+  return pairs;
+}
+
+/***************************************************************************************
+** Function name:           tftExpand4
+** Description:             Convert n 4 bpp pixels through a colour map
+***************************************************************************************/
+// src holds the first pixel in its high nibble, or in its low nibble if odd is true.
+// pairs is the table from tftPairsFor(), or nullptr to look up one nibble at a time.
+static inline void tftExpand4(uint16_t *dst, const uint8_t *src, bool odd, uint32_t n,
+                              const uint32_t *pairs, const uint16_t *cmap)
+{
+  if (odd && n) {
+    *dst++ = cmap[pgm_read_byte(src++) & 0x0F];
+    n--;
+  }
+  if (pairs) {
+    for (; n >= 2; n -= 2) {
+      uint32_t pair = pairs[pgm_read_byte(src++)];
+      memcpy(dst, &pair, 4);
+      dst += 2;
+    }
+  }
+  else {
+    for (; n >= 2; n -= 2) {
+      uint8_t colors = pgm_read_byte(src++);
+      dst[0] = cmap[colors >> 4];
+      dst[1] = cmap[colors & 0x0F];
+      dst += 2;
+    }
+  }
+  if (n) *dst = cmap[pgm_read_byte(src) >> 4];
+}
+
+/***************************************************************************************
+** Function name:           tftNibble
+** Description:             Colour map index of pixel xp of a 4 bpp row
+***************************************************************************************/
+static inline uint8_t tftNibble(const uint8_t *row, uint32_t xp)
+{
+  uint8_t colors = pgm_read_byte(row + (xp >> 1));
+  return (xp & 1) ? colors & 0x0F : colors >> 4;
+}
+
+/***************************************************************************************
+** Function name:           tftBitRun
+** Description:             Pixels from pos on, up to end, with the same bit as pos
+***************************************************************************************/
+// Scans a byte at a time with __builtin_clz, isSet tells if the run is of 1 bits. A
+// marker bit after the last pixel of the byte stops the count there.
+static inline uint32_t tftBitRun(const uint8_t *row, uint32_t pos, uint32_t end, bool *isSet)
+{
+  uint32_t start = pos;
+  uint32_t bits  = (uint32_t)pgm_read_byte(row + (pos >> 3)) << (24 + (pos & 7));
+  uint32_t avail = 8 - (pos & 7); // Pixels of the byte from pos on
+  *isSet = bits >> 31;
+
+  for (;;) {
+    uint32_t other = (*isSet ? ~bits : bits) | (0x80000000 >> avail); // 1 where the run ends
+    uint32_t n = __builtin_clz(other);
+    pos += n;
+    if (n < avail || pos >= end) break;
+    bits  = (uint32_t)pgm_read_byte(row + (pos >> 3)) << 24;
+    avail = 8;
+  }
+  return (pos < end ? pos : end) - start;
+}
+
+/***************************************************************************************
+** Function name:           tftExpand1
+** Description:             Convert the 1 bpp pixels pos to end - 1 of a row
+***************************************************************************************/
+// fg and bg in the order the caller pushes them, they are copied as they are. Whole
+// bytes are expanded without branches, a mask of each bit selects fg or bg.
+static inline void tftExpand1(uint16_t *dst, const uint8_t *row, uint32_t pos, uint32_t end,
+                              uint16_t fg, uint16_t bg)
+{
+  uint16_t diff = fg ^ bg;
+
+  // Up to the first byte boundary
+  for (; pos < end && (pos & 7); pos++) {
+    uint32_t bit = pgm_read_byte(row + (pos >> 3)) >> (7 - (pos & 7)) & 1;
+    *dst++ = bg ^ (diff & -bit);
+  }
+  for (; pos + 8 <= end; pos += 8) {
+    uint32_t b = pgm_read_byte(row + (pos >> 3));
+    dst[0] = bg ^ (diff & -(b >> 7 & 1));
+    dst[1] = bg ^ (diff & -(b >> 6 & 1));
+    dst[2] = bg ^ (diff & -(b >> 5 & 1));
+    dst[3] = bg ^ (diff & -(b >> 4 & 1));
+    dst[4] = bg ^ (diff & -(b >> 3 & 1));
+    dst[5] = bg ^ (diff & -(b >> 2 & 1));
+    dst[6] = bg ^ (diff & -(b >> 1 & 1));
+    dst[7] = bg ^ (diff & -(b & 1));
+    dst += 8;
+  }
+  if (pos < end) {
+    uint32_t b = pgm_read_byte(row + (pos >> 3));
+    for (uint32_t k = 7; pos < end; pos++, k--) *dst++ = bg ^ (diff & -(b >> k & 1));
+  }
+}
+
+#endif
@@ -359,6 +359,7 @@ bool TFT_eSPI::getUnicodeIndex(uint16_t unicode, uint16_t *index)
 // Expects file to be open
 void TFT_eSPI::drawGlyph(uint16_t code)
 {
+  TFT_PROFILE_CALL("drawGlyph");
   uint16_t fg = textcolor;
   uint16_t bg = textbgcolor;
 
@@ -400,6 +400,7 @@ void TFT_eSprite::deleteSprite(void)
 #define FP_SCALE 10
 bool TFT_eSprite::pushRotated(int16_t angle, uint32_t transp)
 {
+  TFT_PROFILE_CALL("pushRotated");
   if ( !_created || _tft->_vpOoB) return false;
 
   // Bounding box parameters
@@ -663,6 +664,7 @@ void TFT_eSprite::getRotatedBounds(int16_t angle, int16_t w, int16_t h, int16_t
 ***************************************************************************************/
 void TFT_eSprite::pushSprite(int32_t x, int32_t y)
 {
+  TFT_PROFILE_CALL("pushSprite");
   if (!_created) return;
 
   if (_bpp == 16)
@@ -686,6 +688,7 @@ void TFT_eSprite::pushSprite(int32_t x, int32_t y)
 ***************************************************************************************/
 void TFT_eSprite::pushSprite(int32_t x, int32_t y, uint16_t transp)
 {
+  TFT_PROFILE_CALL("pushSprite");
   if (!_created) return;
 
   if (_bpp == 16)
@@ -805,6 +808,7 @@ bool TFT_eSprite::pushToSprite(TFT_eSprite *dspr, int32_t x, int32_t y, uint16_t
 ***************************************************************************************/
 bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh)
 {
+  TFT_PROFILE_CALL("pushSprite");
   if (!_created) return false;
 
   // Perform window boundary checks and crop if needed
@@ -2192,7 +2196,7 @@ int16_t TFT_eSprite::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t fo
 
   int32_t width  = 0;
   int32_t height = 0;
-  uint32_t flash_address = 0;
+  uintptr_t flash_address = 0; // Pointer sized, also on 64 bit hosts
   uniCode -= 32;
 
 #ifdef LOAD_FONT2
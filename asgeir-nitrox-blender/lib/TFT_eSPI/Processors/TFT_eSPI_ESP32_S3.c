@@ -52,6 +52,48 @@
   #endif
 #endif
 
+#ifdef ESP32_PARALLEL_DMA
+  // LCD_CAM in i80 mode, fed by a GDMA channel, see TFT_eSPI_ESP32_S3_DMA.h
+  #include "TFT_eSPI_ESP32_S3_DMA.h"
+  #include "esp_private/gdma.h"
+  #include "esp_intr_alloc.h"
+  #include "esp_heap_caps.h"
+  #include "esp_rom_gpio.h"
+  #include "hal/dma_types.h"
+  #include "soc/lcd_cam_struct.h"
+  #include "soc/lcd_periph.h"
+  #include "soc/gpio_sig_map.h"
+  #if __has_include("esp_memory_utils.h")
+    #include "esp_memory_utils.h"
+  #else
+    #include "soc/soc_memory_layout.h"
+  #endif
+  #if __has_include("esp_private/periph_ctrl.h")
+    #include "esp_private/periph_ctrl.h"
+  #else
+    #include "driver/periph_ctrl.h"
+  #endif
+
+  static_assert(sizeof(TFT_DmaDescriptor) == sizeof(dma_descriptor_t), "GDMA descriptor layout");
+
+  // Upper limit of the write strobe rate, the ST7789 needs a 66ns write cycle
+  #ifndef TFT_PARALLEL_DMA_FREQUENCY
+    #define TFT_PARALLEL_DMA_FREQUENCY 15000000
+  #endif
+
+  // Descriptors for a full screen image sent where it is
+  #define TFT_DMA_DIRECT_DESCS ((TFT_WIDTH * TFT_HEIGHT * 2 + TFT_DMA_DESC_MAX_BYTES - 1) / TFT_DMA_DESC_MAX_BYTES)
+
+  static gdma_channel_handle_t dmaChannel = NULL;
+  static intr_handle_t dmaInterrupt = NULL;
+  static portMUX_TYPE dmaLock = portMUX_INITIALIZER_UNLOCKED;
+  static TFT_DmaRing dmaRing;
+  static TFT_DmaDescriptor *dmaQueue[TFT_DMA_BUFFERS]; // Chain of every slot of the ring
+  static TFT_DmaDescriptor *dmaChains;                 // TFT_DMA_BAND_DESCS per conversion buffer
+  static TFT_DmaDescriptor *dmaDirect;                 // Chain over an image sent where it is
+  static uint16_t *dmaBuffers[TFT_DMA_BUFFERS];        // Conversion buffers
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////////////
 #if defined (TFT_SDA_READ) && !defined (TFT_PARALLEL_8_BIT)
 ////////////////////////////////////////////////////////////////////////////////////////
@@ -542,6 +584,7 @@ void TFT_eSPI::pushSwapBytePixels(const void* data_in, uint32_t len){
 ** Description:             Write a block of pixels of the same colour
 ***************************************************************************************/
 void TFT_eSPI::pushBlock(uint16_t color, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
   if ( (color >> 8) == (color & 0x00FF) )
   { if (!len) return;
     tft_Write_16(color);
@@ -563,6 +606,7 @@ void TFT_eSPI::pushBlock(uint16_t color, uint32_t len){
 ** Description:             Write a sequence of pixels with swapped bytes
 ***************************************************************************************/
 void TFT_eSPI::pushSwapBytePixels(const void* data_in, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
 
   uint16_t *data = (uint16_t*)data_in;
   while ( len-- ) {tft_Write_16(*data); data++;}
@@ -573,6 +617,7 @@ void TFT_eSPI::pushSwapBytePixels(const void* data_in, uint32_t len){
 ** Description:             Write a sequence of pixels
 ***************************************************************************************/
 void TFT_eSPI::pushPixels(const void* data_in, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
 
   uint16_t *data = (uint16_t*)data_in;
   if(_swapBytes) { while ( len-- ) {tft_Write_16(*data); data++; } }
@@ -849,3 +894,328 @@ void TFT_eSPI::deInitDMA(void)
 ////////////////////////////////////////////////////////////////////////////////////////
 #endif // End of DMA FUNCTIONS
 ////////////////////////////////////////////////////////////////////////////////////////
+
+
+////////////////////////////////////////////////////////////////////////////////////////
+#if defined (ESP32_PARALLEL_DMA) //                     8 BIT PARALLEL DMA FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////////////
+
+// LCD_CAM clocks the bytes out on the data pins with WR as its pixel clock. DC and CS
+// stay with the GPIO macros: the window is set up by setWindow() as usual, then the
+// pixel data goes out by DMA. The data and WR pins are routed to LCD_CAM only while a
+// transfer runs, so the GPIO macros work unchanged in between.
+//
+// An image in internal RAM that needs no copy is sent where it is, and is still being
+// read after the function returns: call dmaWait() before changing or freeing it. Anything
+// else, an image in flash or PSRAM, a clipped one, one with swapped bytes or one pushed
+// with a buffer, is copied in bands of TFT_DMA_BAND_PIXELS into two conversion buffers:
+// the CPU fills one while the other is on the bus and the completion interrupt starts
+// the next. That image may be overwritten once the function returns. The original image
+// is never changed.
+
+/***************************************************************************************
+** Function name:           dmaRoute (local)
+** Description:             Hand the data and WR pins to LCD_CAM, or back to the GPIO
+***************************************************************************************/
+static void dmaRoute(bool toLcd)
+{
+  static const int8_t pins[8] = { TFT_D0, TFT_D1, TFT_D2, TFT_D3, TFT_D4, TFT_D5, TFT_D6, TFT_D7 };
+
+  for (uint8_t i = 0; i < 8; i++) {
+    esp_rom_gpio_connect_out_signal(pins[i], toLcd ? lcd_periph_signals.buses[0].data_sigs[i] : SIG_GPIO_OUT_IDX, false, false);
+  }
+  esp_rom_gpio_connect_out_signal(TFT_WR, toLcd ? lcd_periph_signals.buses[0].wr_sig : SIG_GPIO_OUT_IDX, false, false);
+}
+
+/***************************************************************************************
+** Function name:           dmaStart (local)
+** Description:             Start sending a descriptor chain
+***************************************************************************************/
+static void dmaStart(TFT_DmaDescriptor *chain)
+{
+  gdma_reset(dmaChannel);
+  gdma_start(dmaChannel, (intptr_t)chain);
+  esp_rom_delay_us(1); // Time for the DMA to put the first bytes in the LCD FIFO
+  LCD_CAM.lcd_user.lcd_update = 1;
+  LCD_CAM.lcd_user.lcd_start = 1;
+}
+
+/***************************************************************************************
+** Function name:           dmaComplete (local)
+** Description:             LCD_CAM interrupt, the panel has received a transfer
+***************************************************************************************/
+// Not registered with ESP_INTR_FLAG_IRAM, it waits while the flash cache is off
+static void dmaComplete(void *arg)
+{
+  if (!LCD_CAM.lc_dma_int_st.lcd_trans_done_int_st) return;
+  LCD_CAM.lc_dma_int_clr.lcd_trans_done_int_clr = 1;
+
+  portENTER_CRITICAL_ISR(&dmaLock);
+  // Give the pins back before the ring reads idle, the CPU drives them from then on
+  if (dmaRing.filled - dmaRing.sent == 1) dmaRoute(false);
+  int32_t slot = tftDmaRingRetire(&dmaRing);
+  if (slot >= 0) dmaStart(dmaQueue[slot]);
+  portEXIT_CRITICAL_ISR(&dmaLock);
+}
+
+/***************************************************************************************
+** Function name:           dmaSubmit (local)
+** Description:             Queue the chain of an acquired slot, start it if the bus is idle
+***************************************************************************************/
+static void dmaSubmit(int32_t slot, TFT_DmaDescriptor *chain)
+{
+  portENTER_CRITICAL(&dmaLock);
+  dmaQueue[slot] = chain;
+  if (tftDmaRingSubmit(&dmaRing)) {
+    dmaRoute(true);
+    dmaStart(chain);
+  }
+  portEXIT_CRITICAL(&dmaLock);
+}
+
+/***************************************************************************************
+** Function name:           dmaSendDirect (local)
+** Description:             Send an image where it is, false if it is not DMA capable
+***************************************************************************************/
+// The bus reads the image until the chain is done, the caller has to dmaWait() before reusing it.
+static bool dmaSendDirect(const uint16_t *image, uint32_t len)
+{
+  if (!esp_ptr_dma_capable(image) || ((uintptr_t)image & 3)) return false;
+  if (tftDmaDescriptors(len << 1) > TFT_DMA_DIRECT_DESCS) return false;
+
+  while (!tftDmaRingIdle(&dmaRing)) {} // The direct chain may still be on the bus
+
+  tftDmaBuildChain(dmaDirect, TFT_DMA_DIRECT_DESCS, image, len << 1);
+  dmaSubmit(tftDmaRingAcquire(&dmaRing), dmaDirect);
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           dmaSendBands (local)
+** Description:             Copy an image into the conversion buffers band by band
+***************************************************************************************/
+// len pixels of a width pixels wide area, rows stride pixels apart in the image
+static void dmaSendBands(const uint16_t *image, uint32_t stride, uint32_t width, uint32_t len, bool swap)
+{
+  for (uint32_t first = 0; first < len; first += TFT_DMA_BAND_PIXELS) {
+    uint32_t count = len - first;
+    if (count > TFT_DMA_BAND_PIXELS) count = TFT_DMA_BAND_PIXELS;
+
+    int32_t slot;
+    while ((slot = tftDmaRingAcquire(&dmaRing)) < 0) {} // Both buffers queued
+
+    tftDmaCopy(dmaBuffers[slot], image, stride, width, first, count, swap);
+    TFT_DmaDescriptor *chain = dmaChains + slot * TFT_DMA_BAND_DESCS;
+    tftDmaBuildChain(chain, TFT_DMA_BAND_DESCS, dmaBuffers[slot], count << 1);
+    dmaSubmit(slot, chain);
+  }
+}
+
+/***************************************************************************************
+** Function name:           dmaBusy
+** Description:             Check if DMA is busy
+***************************************************************************************/
+bool TFT_eSPI::dmaBusy(void)
+{
+  if (!DMA_Enabled) return false;
+  return !tftDmaRingIdle(&dmaRing);
+}
+
+/***************************************************************************************
+** Function name:           dmaWait
+** Description:             Wait until DMA is over (blocking!)
+***************************************************************************************/
+void TFT_eSPI::dmaWait(void)
+{
+  while (dmaBusy()) {}
+}
+
+/***************************************************************************************
+** Function name:           pushPixelsDMA
+** Description:             Push pixels to TFT
+***************************************************************************************/
+// Swaps the bytes if setSwapBytes(true) was called, the image itself is not changed.
+// Chip select stays low until the next transaction ends, which waits for the transfer.
+void TFT_eSPI::pushPixelsDMA(uint16_t* image, uint32_t len)
+{
+  if ((len == 0) || (!DMA_Enabled)) return;
+  TFT_PROFILE_CALL("pushPixelsDMA");
+
+  begin_tft_write();
+  TFT_PROFILE_PIXELS(len);
+  if (_swapBytes || !dmaSendDirect(image, len)) dmaSendBands(image, len, len, len, _swapBytes);
+}
+
+/***************************************************************************************
+** Function name:           pushImageDMA
+** Description:             Push image to a window
+***************************************************************************************/
+// Fixed const data assumed, will NOT clip or swap bytes
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t const* image)
+{
+  if ((w == 0) || (h == 0) || (!DMA_Enabled)) return;
+  TFT_PROFILE_CALL("pushImageDMA");
+
+  uint32_t len = w*h;
+
+  setAddrWindow(x, y, w, h); // Waits for the last transfer
+
+  begin_tft_write();
+  TFT_PROFILE_PIXELS(len);
+  if (!dmaSendDirect(image, len)) dmaSendBands(image, w, w, len, false);
+}
+
+/***************************************************************************************
+** Function name:           pushImageDMA
+** Description:             Push image to a window
+***************************************************************************************/
+// This will clip and also swap bytes if setSwapBytes(true) was called by sketch. With a
+// buffer the image is always copied, buffer itself is not needed for that.
+void TFT_eSPI::pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* image, uint16_t* buffer)
+{
+  if ((x >= _vpW) || (y >= _vpH) || (!DMA_Enabled)) return;
+  TFT_PROFILE_CALL("pushImageDMA");
+
+  int32_t dx = 0;
+  int32_t dy = 0;
+  int32_t dw = w;
+  int32_t dh = h;
+
+  if (x < _vpX) { dx = _vpX - x; dw -= dx; x = _vpX; }
+  if (y < _vpY) { dy = _vpY - y; dh -= dy; y = _vpY; }
+
+  if ((x + dw) > _vpW ) dw = _vpW - x;
+  if ((y + dh) > _vpH ) dh = _vpH - y;
+
+  if (dw < 1 || dh < 1) return;
+
+  uint32_t len = dw*dh;
+  const uint16_t *first = image + dx + w * dy;
+
+  setAddrWindow(x, y, dw, dh); // Waits for the last transfer
+
+  begin_tft_write();
+  TFT_PROFILE_PIXELS(len);
+  // Rows clipped at the top or bottom only are still contiguous
+  if (buffer != nullptr || _swapBytes || dw != w || !dmaSendDirect(first, len)) {
+    dmaSendBands(first, w, dw, len, _swapBytes);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Processor specific DMA initialisation
+////////////////////////////////////////////////////////////////////////////////////////
+
+/***************************************************************************************
+** Function name:           initDMA
+** Description:             Initialise the DMA engine - returns true if init OK
+***************************************************************************************/
+// ctrl_cs is not supported, chip select stays with the GPIO macros
+bool TFT_eSPI::initDMA(bool ctrl_cs)
+{
+  if (DMA_Enabled) return false;
+
+  // Buffers and descriptors must be in internal RAM
+  dmaChains = (TFT_DmaDescriptor*)heap_caps_calloc(TFT_DMA_BUFFERS * TFT_DMA_BAND_DESCS, sizeof(TFT_DmaDescriptor), MALLOC_CAP_DMA);
+  dmaDirect = (TFT_DmaDescriptor*)heap_caps_calloc(TFT_DMA_DIRECT_DESCS, sizeof(TFT_DmaDescriptor), MALLOC_CAP_DMA);
+  bool ok = dmaChains && dmaDirect;
+  for (uint8_t i = 0; i < TFT_DMA_BUFFERS; i++) {
+    dmaBuffers[i] = (uint16_t*)heap_caps_malloc(TFT_DMA_BAND_PIXELS * 2, MALLOC_CAP_DMA);
+    ok = ok && dmaBuffers[i];
+  }
+
+  gdma_channel_alloc_config_t channel;
+  memset(&channel, 0, sizeof(channel));
+  channel.direction = GDMA_CHANNEL_DIRECTION_TX;
+  ok = ok && gdma_new_channel(&channel, &dmaChannel) == ESP_OK;
+  if (!ok) {
+    deInitDMA(); // Frees whatever was allocated
+    return false;
+  }
+
+  gdma_connect(dmaChannel, GDMA_MAKE_TRIGGER(GDMA_TRIG_PERIPH_LCD, 0));
+  gdma_strategy_config_t strategy;
+  memset(&strategy, 0, sizeof(strategy));
+  strategy.auto_update_desc = true;
+  strategy.owner_check = true;
+  gdma_apply_strategy(dmaChannel, &strategy);
+
+  periph_module_enable(lcd_periph_signals.buses[0].module);
+  periph_module_reset(lcd_periph_signals.buses[0].module);
+
+  // 160MHz PLL / 2 = 80MHz, divided down to the write strobe rate
+  uint32_t prescale = (80000000 + TFT_PARALLEL_DMA_FREQUENCY - 1) / TFT_PARALLEL_DMA_FREQUENCY;
+  if (prescale < 2) prescale = 2;
+  lcd_cam_lcd_clock_reg_t clock;
+  clock.val = 0;
+  clock.clk_en = 1;
+  clock.lcd_clk_sel = 3;        // 1 = XTAL, 2 = 240MHz, 3 = 160MHz
+  clock.lcd_clkm_div_num = 2;
+  clock.lcd_ck_idle_edge = 1;   // WR idles high
+  clock.lcd_ck_out_edge = 0;    // Data changes on the falling edge, the panel latches on the rising
+  clock.lcd_clkcnt_n = prescale - 1;
+  LCD_CAM.lcd_clock.val = clock.val;
+
+  LCD_CAM.lcd_ctrl.lcd_rgb_mode_en = 0;     // i80, not RGB
+  LCD_CAM.lcd_rgb_yuv.lcd_conv_bypass = 0;  // No colour conversion
+  LCD_CAM.lcd_data_dout_mode.val = 0;       // No output delays
+  LCD_CAM.lcd_misc.lcd_next_frame_en = 0;   // Stop at the end of the chain
+  LCD_CAM.lcd_misc.lcd_afifo_reset = 1;
+
+  lcd_cam_lcd_user_reg_t user;
+  user.val = 0;
+  user.lcd_always_out_en = 1;   // Until the DMA reaches the end of the chain
+  user.lcd_dout = 1;            // Data phase only, no command or dummy cycles
+  user.lcd_update = 1;
+  LCD_CAM.lcd_user.val = user.val;
+
+  LCD_CAM.lc_dma_int_clr.val = 0xFFFFFFFF;
+  LCD_CAM.lc_dma_int_ena.val = 0;
+  LCD_CAM.lc_dma_int_ena.lcd_trans_done_int_ena = 1;
+
+  if (esp_intr_alloc(lcd_periph_signals.buses[0].irq_id, 0, dmaComplete, nullptr, &dmaInterrupt) != ESP_OK) {
+    periph_module_disable(lcd_periph_signals.buses[0].module);
+    deInitDMA();
+    return false;
+  }
+
+  dmaRing.filled = 0;
+  dmaRing.sent = 0;
+  DMA_Enabled = true;
+  spiBusyCheck = 0;
+  return true;
+}
+
+/***************************************************************************************
+** Function name:           deInitDMA
+** Description:             Release the DMA engine and LCD_CAM, the bus stays with the GPIO
+***************************************************************************************/
+void TFT_eSPI::deInitDMA(void)
+{
+  dmaWait();
+  DMA_Enabled = false;
+
+  if (dmaInterrupt) {
+    LCD_CAM.lc_dma_int_ena.val = 0;
+    esp_intr_free(dmaInterrupt);
+    dmaInterrupt = NULL;
+    periph_module_disable(lcd_periph_signals.buses[0].module);
+  }
+  if (dmaChannel) {
+    gdma_disconnect(dmaChannel);
+    gdma_del_channel(dmaChannel);
+    dmaChannel = NULL;
+  }
+  for (uint8_t i = 0; i < TFT_DMA_BUFFERS; i++) {
+    heap_caps_free(dmaBuffers[i]);
+    dmaBuffers[i] = NULL;
+  }
+  heap_caps_free(dmaChains);
+  heap_caps_free(dmaDirect);
+  dmaChains = NULL;
+  dmaDirect = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+#endif // End of 8 BIT PARALLEL DMA FUNCTIONS
+////////////////////////////////////////////////////////////////////////////////////////
@@ -7,7 +7,7 @@
 #ifndef _TFT_eSPI_ESP32H_
 #define _TFT_eSPI_ESP32H_
 
-#if !defined(DISABLE_ALL_LIBRARY_WARNINGS)
+#if !defined(DISABLE_ALL_LIBRARY_WARNINGS) && !defined (TFT_PARALLEL_8_BIT)
  #warning >>>>------>> DMA is not supported on the ESP32 S3 (possible future update)
 #endif
 
@@ -135,11 +135,19 @@ SPI3_HOST = 2
   #define ESP32_DMA
   // Code to check if DMA is busy, used by SPI DMA + transaction + endWrite functions
   #define DMA_BUSY_CHECK  //dmaWait()
+#elif defined (TFT_PARALLEL_8_BIT) && !defined (SSD1963_DRIVER) && !defined (PSEUDO_16_BIT)
+  // 8 bit parallel DMA through the LCD_CAM peripheral, see TFT_eSPI_ESP32_S3_DMA.h
+  #define ESP32_PARALLEL_DMA
+  // The data and WR pins belong to LCD_CAM while a transfer runs, so every window,
+  // read and end of transaction waits for it
+  #define DMA_BUSY_CHECK  if (DMA_Enabled) dmaWait()
 #else
   #define DMA_BUSY_CHECK
 #endif
 
-#if defined(TFT_PARALLEL_8_BIT)
+#if defined (ESP32_PARALLEL_DMA)
+  #define SPI_BUSY_CHECK  DMA_BUSY_CHECK
+#elif defined(TFT_PARALLEL_8_BIT)
   #define SPI_BUSY_CHECK
 #else
   #define SPI_BUSY_CHECK while (*_spi_cmd&SPI_USR)
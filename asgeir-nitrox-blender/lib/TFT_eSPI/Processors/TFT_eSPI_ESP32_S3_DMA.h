@@ -0,0 +1,160 @@
+        ////////////////////////////////////////////////////
+        // DMA helpers for the ESP32 S3 8 bit parallel bus //
+        ////////////////////////////////////////////////////
+
+// The parts of the LCD_CAM DMA in TFT_eSPI_ESP32_S3.c that do not touch the hardware:
+// the GDMA descriptor chains, the ring of conversion buffers and the pixel copy into
+// them. No ESP-IDF headers are needed, src/dma-check runs them on the host.
+
+#ifndef _TFT_eSPI_ESP32_S3_DMAH_
+#define _TFT_eSPI_ESP32_S3_DMAH_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Bytes one descriptor can carry, the 12 bit length field holds 4095 but a multiple
+// of 4 keeps every buffer after the first word aligned and pixels in one piece
+#define TFT_DMA_DESC_MAX_BYTES 4092
+
+// Pixels the CPU converts per band, the two conversion buffers take 4 bytes per pixel
+#ifndef TFT_DMA_BAND_PIXELS
+  #define TFT_DMA_BAND_PIXELS 4092
+#endif
+
+// Conversion buffers, one is on the bus while the CPU fills the next. A power of 2.
+#ifndef TFT_DMA_BUFFERS
+  #define TFT_DMA_BUFFERS 2
+#endif
+
+// Descriptors needed by a band
+#define TFT_DMA_BAND_DESCS ((TFT_DMA_BAND_PIXELS * 2 + TFT_DMA_DESC_MAX_BYTES - 1) / TFT_DMA_DESC_MAX_BYTES)
+
+// GDMA link list item, the layout of dma_descriptor_t in the IDF
+typedef struct TFT_DmaDescriptor {
+  uint32_t size       : 12; // Bytes in the buffer
+  uint32_t length     : 12; // Bytes to send from the buffer
+  uint32_t reserved24 : 4;
+  uint32_t errEof     : 1;
+  uint32_t reserved29 : 1;
+  uint32_t sucEof     : 1;  // Last item of the transfer
+  uint32_t owner      : 1;  // 1 = owned by the DMA
+  const void *buffer;
+  struct TFT_DmaDescriptor *next;
+} TFT_DmaDescriptor;
+
+// Transfers queued on the bus. The CPU only writes filled, the completion interrupt
+// only writes sent, both are changed with the interrupt locked out.
+typedef struct {
+  volatile uint32_t filled; // Transfers submitted
+  volatile uint32_t sent;   // Transfers the panel has received
+} TFT_DmaRing;
+
+/***************************************************************************************
+** Function name:           tftDmaDescriptors
+** Description:             Descriptors needed to send a number of bytes
+***************************************************************************************/
+static inline uint32_t tftDmaDescriptors(uint32_t bytes)
+{
+  return (bytes + TFT_DMA_DESC_MAX_BYTES - 1) / TFT_DMA_DESC_MAX_BYTES;
+}
+
+/***************************************************************************************
+** Function name:           tftDmaBuildChain
+** Description:             Link descriptors over a block of bytes, returns the number used
+***************************************************************************************/
+// Returns 0, and touches nothing, if there are no bytes or count descriptors are too few
+static inline uint32_t tftDmaBuildChain(TFT_DmaDescriptor *desc, uint32_t count, const void *data, uint32_t bytes)
+{
+  uint32_t used = tftDmaDescriptors(bytes);
+  if (used == 0 || used > count) return 0;
+
+  const uint8_t *p = (const uint8_t *)data;
+  for (uint32_t i = 0; i < used; i++) {
+    uint32_t n = bytes > TFT_DMA_DESC_MAX_BYTES ? TFT_DMA_DESC_MAX_BYTES : bytes;
+    desc[i].size       = n;
+    desc[i].length     = n;
+    desc[i].reserved24 = 0;
+    desc[i].errEof     = 0;
+    desc[i].reserved29 = 0;
+    desc[i].sucEof     = (i == used - 1);
+    desc[i].owner      = 1;
+    desc[i].buffer     = p;
+    desc[i].next       = (i == used - 1) ? NULL : &desc[i + 1];
+    p += n;
+    bytes -= n;
+  }
+  return used;
+}
+
+/***************************************************************************************
+** Function name:           tftDmaRingIdle
+** Description:             True when every submitted transfer has been sent
+***************************************************************************************/
+static inline bool tftDmaRingIdle(const TFT_DmaRing *ring)
+{
+  return ring->filled == ring->sent;
+}
+
+/***************************************************************************************
+** Function name:           tftDmaRingAcquire
+** Description:             Slot the CPU may fill next, -1 while all are queued or on the bus
+***************************************************************************************/
+static inline int32_t tftDmaRingAcquire(const TFT_DmaRing *ring)
+{
+  uint32_t filled = ring->filled;
+  if (filled - ring->sent >= TFT_DMA_BUFFERS) return -1;
+  return filled & (TFT_DMA_BUFFERS - 1);
+}
+
+/***************************************************************************************
+** Function name:           tftDmaRingSubmit
+** Description:             Queue the acquired slot, true if the caller must start it
+***************************************************************************************/
+// The bus was idle, nothing will start the transfer from the completion interrupt
+static inline bool tftDmaRingSubmit(TFT_DmaRing *ring)
+{
+  bool start = tftDmaRingIdle(ring);
+  ring->filled = ring->filled + 1;
+  return start;
+}
+
+/***************************************************************************************
+** Function name:           tftDmaRingRetire
+** Description:             A transfer is complete, returns the slot to start next or -1
+***************************************************************************************/
+static inline int32_t tftDmaRingRetire(TFT_DmaRing *ring)
+{
+  ring->sent = ring->sent + 1;
+  if (tftDmaRingIdle(ring)) return -1;
+  return ring->sent & (TFT_DMA_BUFFERS - 1);
+}
+
+/***************************************************************************************
+** Function name:           tftDmaCopy
+** Description:             Copy pixels of a clipped image into a band, swapping if asked
+***************************************************************************************/
+// The band gets count pixels of a width pixels wide area, from its pixel first on. The
+// area starts at image[0] and its rows are stride pixels apart in the image.
+static inline void tftDmaCopy(uint16_t *band, const uint16_t *image, uint32_t stride, uint32_t width,
+                              uint32_t first, uint32_t count, bool swap)
+{
+  uint32_t row = first / width;
+  uint32_t col = first % width;
+
+  while (count) {
+    uint32_t n = width - col;
+    if (n > count) n = count;
+    const uint16_t *src = image + row * stride + col;
+    if (swap) {
+      for (uint32_t i = 0; i < n; i++) band[i] = src[i] << 8 | src[i] >> 8;
+    }
+    else memcpy(band, src, n << 1);
+    band += n;
+    count -= n;
+    col = 0;
+    row++;
+  }
+}
+
+#endif
@@ -0,0 +1,407 @@
+        ////////////////////////////////////////////////////
+        //   TFT_eSPI host framebuffer driver functions   //
+        ////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Global variables
+////////////////////////////////////////////////////////////////////////////////////////
+
+TFT_HostPanel tftHost;
+
+// ST7789 command set understood by the model, other commands are counted and ignored
+#define TFT_HOST_SWRESET 0x01
+#define TFT_HOST_CASET   0x2A
+#define TFT_HOST_PASET   0x2B
+#define TFT_HOST_RAMWR   0x2C
+#define TFT_HOST_RAMRD   0x2E
+#define TFT_HOST_MADCTL  0x36
+#define TFT_HOST_RAMWRC  0x3C
+
+// MADCTL bits
+#define TFT_HOST_MAD_MY  0x80
+#define TFT_HOST_MAD_MX  0x40
+#define TFT_HOST_MAD_MV  0x20
+#define TFT_HOST_MAD_BGR 0x08
+
+/***************************************************************************************
+** Function name:           tftHostReset
+** Description:             Controller state after power up or a software reset
+***************************************************************************************/
+static void tftHostReset(void)
+{
+  tftHost.madctl = 0;
+  tftHost.xs = 0;
+  tftHost.xe = TFT_HOST_GRAM_WIDTH - 1;
+  tftHost.ys = 0;
+  tftHost.ye = TFT_HOST_GRAM_HEIGHT - 1;
+  tftHost.col = 0;
+  tftHost.row = 0;
+  tftHost.command = 0;
+  tftHost.count = 0;
+}
+
+// The model starts out as after power up
+static struct TFT_HostPowerUp { TFT_HostPowerUp() { tftHostReset(); } } tftHostPowerUp;
+
+/***************************************************************************************
+** Function name:           tftHostAddress
+** Description:             Frame memory location of a column and row address
+***************************************************************************************/
+// The address counter runs in the orientation set by MADCTL, NULL outside the memory
+static uint16_t* tftHostAddress(uint16_t col, uint16_t row)
+{
+  uint16_t x = col, y = row;
+  if (tftHost.madctl & TFT_HOST_MAD_MV) { x = row; y = col; }
+  if (x >= TFT_HOST_GRAM_WIDTH || y >= TFT_HOST_GRAM_HEIGHT) return NULL;
+  if (tftHost.madctl & TFT_HOST_MAD_MX) x = TFT_HOST_GRAM_WIDTH  - 1 - x;
+  if (tftHost.madctl & TFT_HOST_MAD_MY) y = TFT_HOST_GRAM_HEIGHT - 1 - y;
+  return &tftHost.gram[y][x];
+}
+
+/***************************************************************************************
+** Function name:           tftHostAdvance
+** Description:             Move the address counter to the next pixel of the window
+***************************************************************************************/
+static void tftHostAdvance(void)
+{
+  if (tftHost.col < tftHost.xe) { tftHost.col++; return; }
+  tftHost.col = tftHost.xs;
+  tftHost.row = (tftHost.row < tftHost.ye) ? tftHost.row + 1 : tftHost.ys;
+}
+
+/***************************************************************************************
+** Function name:           tftHostSelect
+** Description:             Drive CS, a transaction ends when CS goes high
+***************************************************************************************/
+void tftHostSelect(bool select)
+{
+  if (tftHost.isSelected && !select) tftHost.stats.transactions++;
+  tftHost.isSelected = select;
+}
+
+/***************************************************************************************
+** Function name:           tftHostCommand
+** Description:             A byte written with DC low
+***************************************************************************************/
+static void tftHostCommand(uint8_t c)
+{
+  tftHost.stats.commands++;
+  tftHost.command = c;
+  tftHost.count = 0;
+
+  switch (c) {
+    case TFT_HOST_SWRESET:
+      tftHostReset();
+      break;
+    case TFT_HOST_CASET:
+    case TFT_HOST_PASET:
+      tftHost.stats.addressSets++;
+      break;
+    case TFT_HOST_RAMWR:
+      tftHost.stats.windows++;
+      // fall through
+    case TFT_HOST_RAMRD:
+      tftHost.col = tftHost.xs;
+      tftHost.row = tftHost.ys;
+      break;
+  }
+}
+
+/***************************************************************************************
+** Function name:           tftHostData
+** Description:             A byte written with DC high, parameters or pixels
+***************************************************************************************/
+static void tftHostData(uint8_t d)
+{
+  switch (tftHost.command) {
+    case TFT_HOST_CASET:
+    case TFT_HOST_PASET:
+      if (tftHost.count < 4) tftHost.data[tftHost.count++] = d;
+      if (tftHost.count == 4) {
+        uint16_t s = tftHost.data[0] << 8 | tftHost.data[1];
+        uint16_t e = tftHost.data[2] << 8 | tftHost.data[3];
+        if (tftHost.command == TFT_HOST_CASET) { tftHost.xs = s; tftHost.xe = e; }
+        else                                   { tftHost.ys = s; tftHost.ye = e; }
+        tftHost.count++; // Further parameters are ignored
+      }
+      break;
+    case TFT_HOST_MADCTL:
+      if (tftHost.count++ == 0) tftHost.madctl = d;
+      break;
+    case TFT_HOST_RAMWR:
+    case TFT_HOST_RAMWRC:
+      // Two bytes per RGB565 pixel, MS byte first
+      if (tftHost.count == 0) { tftHost.data[0] = d; tftHost.count = 1; break; }
+      tftHost.count = 0;
+      {
+        uint16_t* p = tftHostAddress(tftHost.col, tftHost.row);
+        if (p) *p = tftHost.data[0] << 8 | d;
+      }
+      tftHost.stats.pixels++;
+      tftHostAdvance();
+      break;
+    default:
+      break;
+  }
+}
+
+/***************************************************************************************
+** Function name:           tftHostWrite
+** Description:             One byte on the bus, one WR strobe
+***************************************************************************************/
+void tftHostWrite(uint8_t b)
+{
+  tftHost.stats.bytes++;
+  if (!tftHost.isSelected) return;
+  if (tftHost.isData) tftHostData(b);
+  else tftHostCommand(b);
+}
+
+/***************************************************************************************
+** Function name:           tftHostRead
+** Description:             One byte read from the bus, one RD strobe
+***************************************************************************************/
+// After RAMRD: a dummy byte, then two bytes per pixel. With the BGR bit set the
+// pixel is read back with red and blue exchanged, as stored by the controller.
+uint8_t tftHostRead(void)
+{
+  tftHost.stats.reads++;
+  if (!tftHost.isSelected || tftHost.command != TFT_HOST_RAMRD) return 0;
+
+  if (tftHost.count == 0) { tftHost.count = 1; return 0; } // Dummy read
+  if (tftHost.count == 1) {
+    uint16_t* p = tftHostAddress(tftHost.col, tftHost.row);
+    uint16_t c = p ? *p : 0;
+    if (tftHost.madctl & TFT_HOST_MAD_BGR) c = (c >> 11) | (c << 11) | (c & 0x07E0);
+    tftHost.readPixel = c;
+    tftHost.count = 2;
+    return c >> 8;
+  }
+  tftHost.count = 1;
+  tftHostAdvance();
+  return (uint8_t)tftHost.readPixel;
+}
+
+/***************************************************************************************
+** Function name:           tftHostResetStats
+** Description:             Clear the bus counters
+***************************************************************************************/
+void tftHostResetStats(void)
+{
+  memset(&tftHost.stats, 0, sizeof(tftHost.stats));
+}
+
+/***************************************************************************************
+** Function name:           tftHostReport
+** Description:             Print the bus counters
+***************************************************************************************/
+void tftHostReport(Print &out)
+{
+  const TFT_HostStats& s = tftHost.stats;
+  out.printf("Panel: %u transactions, %u commands (%u address sets, %u windows), %llu bytes written (%llu pixels), %llu read\r\n",
+    (unsigned)s.transactions, (unsigned)s.commands, (unsigned)s.addressSets, (unsigned)s.windows,
+    (unsigned long long)s.bytes, (unsigned long long)s.pixels, (unsigned long long)s.reads);
+}
+
+/***************************************************************************************
+** Function name:           tftHostSize
+** Description:             Size of the visible area in the orientation set by MADCTL
+***************************************************************************************/
+void tftHostSize(int32_t *w, int32_t *h)
+{
+  bool swap = tftHost.madctl & TFT_HOST_MAD_MV;
+  *w = swap ? TFT_HEIGHT : TFT_WIDTH;
+  *h = swap ? TFT_WIDTH  : TFT_HEIGHT;
+}
+
+/***************************************************************************************
+** Function name:           tftHostSnapshot
+** Description:             Copy the visible area in the orientation set by MADCTL
+***************************************************************************************/
+// The same mapping as the writes use, so the image shows the panel as the user holds it
+void tftHostSnapshot(uint16_t *image)
+{
+  int32_t w, h;
+  tftHostSize(&w, &h);
+
+  // Address of the top left visible pixel, the smallest column and row of the corners
+  int32_t col0 = 0x7FFF, row0 = 0x7FFF;
+  for (int i = 0; i < 4; i++) {
+    int32_t x = TFT_HOST_GLASS_X + ((i & 1) ? TFT_WIDTH  - 1 : 0);
+    int32_t y = TFT_HOST_GLASS_Y + ((i & 2) ? TFT_HEIGHT - 1 : 0);
+    if (tftHost.madctl & TFT_HOST_MAD_MX) x = TFT_HOST_GRAM_WIDTH  - 1 - x;
+    if (tftHost.madctl & TFT_HOST_MAD_MY) y = TFT_HOST_GRAM_HEIGHT - 1 - y;
+    if (tftHost.madctl & TFT_HOST_MAD_MV) { int32_t t = x; x = y; y = t; }
+    if (x < col0) col0 = x;
+    if (y < row0) row0 = y;
+  }
+
+  for (int32_t row = 0; row < h; row++) {
+    for (int32_t col = 0; col < w; col++) {
+      uint16_t* p = tftHostAddress(col0 + col, row0 + row);
+      *image++ = p ? *p : 0;
+    }
+  }
+}
+
+/***************************************************************************************
+** Function name:           tftHostCrc
+** Description:             CRC-32 of PNG chunks, continued from crc
+***************************************************************************************/
+static uint32_t tftHostCrc(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+  static uint32_t table[256];
+  if (table[1] == 0) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+  }
+  crc = ~crc;
+  while (len--) crc = table[(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void tftHostPut32(uint8_t *p, uint32_t v)
+{
+  p[0] = v >> 24; p[1] = v >> 16; p[2] = v >> 8; p[3] = v;
+}
+
+static bool tftHostChunk(FILE *f, const char *type, const uint8_t *data, uint32_t len)
+{
+  uint8_t head[8], tail[4];
+  tftHostPut32(head, len);
+  memcpy(head + 4, type, 4);
+  tftHostPut32(tail, tftHostCrc(tftHostCrc(0, head + 4, 4), data, len));
+  return fwrite(head, 1, 8, f) == 8 && fwrite(data, 1, len, f) == len && fwrite(tail, 1, 4, f) == 4;
+}
+
+/***************************************************************************************
+** Function name:           tftHostWritePng
+** Description:             Write the visible area to a PNG file, RGB 8 bits per channel
+***************************************************************************************/
+// The image data is not compressed (stored deflate blocks), it needs no zlib
+bool tftHostWritePng(const char *path)
+{
+  int32_t w, h;
+  tftHostSize(&w, &h);
+
+  uint16_t* image = (uint16_t*)malloc(w * h * 2);
+  uint32_t  rawLen = h * (1 + w * 3);          // Filter byte and RGB per line
+  uint32_t  blocks = (rawLen + 65534) / 65535;
+  uint32_t  zLen = 2 + rawLen + blocks * 5 + 4;
+  uint8_t*  raw = (uint8_t*)malloc(rawLen);
+  uint8_t*  z = (uint8_t*)malloc(zLen);
+  if (!image || !raw || !z) { free(image); free(raw); free(z); return false; }
+
+  tftHostSnapshot(image);
+  uint8_t* r = raw;
+  for (int32_t y = 0; y < h; y++) {
+    *r++ = 0; // No filter
+    for (int32_t x = 0; x < w; x++) {
+      uint16_t c = image[y * w + x];
+      *r++ = ((c >> 8) & 0xF8) | (c >> 13);
+      *r++ = ((c >> 3) & 0xFC) | ((c >> 9) & 0x03);
+      *r++ = ((c << 3) & 0xF8) | ((c >> 2) & 0x07);
+    }
+  }
+
+  // zlib stream of stored blocks with its Adler-32
+  uint8_t* p = z;
+  *p++ = 0x78; *p++ = 0x01;
+  uint32_t a = 1, b = 0;
+  for (uint32_t done = 0; done < rawLen; ) {
+    uint32_t n = rawLen - done > 65535 ? 65535 : rawLen - done;
+    *p++ = (done + n == rawLen) ? 1 : 0;
+    *p++ = n; *p++ = n >> 8; *p++ = ~n; *p++ = ~n >> 8;
+    memcpy(p, raw + done, n);
+    for (uint32_t i = 0; i < n; i++) { a = (a + p[i]) % 65521; b = (b + a) % 65521; }
+    p += n;
+    done += n;
+  }
+  tftHostPut32(p, b << 16 | a);
+
+  uint8_t ihdr[13];
+  tftHostPut32(ihdr, w);
+  tftHostPut32(ihdr + 4, h);
+  ihdr[8] = 8;  // Bits per channel
+  ihdr[9] = 2;  // RGB
+  ihdr[10] = ihdr[11] = ihdr[12] = 0;
+
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+  FILE* f = fopen(path, "wb");
+  bool ok = f && fwrite(signature, 1, 8, f) == 8 && tftHostChunk(f, "IHDR", ihdr, 13)
+    && tftHostChunk(f, "IDAT", z, zLen) && tftHostChunk(f, "IEND", NULL, 0);
+  if (f && fclose(f) != 0) ok = false;
+
+  free(image);
+  free(raw);
+  free(z);
+  return ok;
+}
+
+
+/***************************************************************************************
+** Function name:           read byte  - supports class functions
+** Description:             Read a byte from the model bus
+***************************************************************************************/
+uint8_t TFT_eSPI::readByte(void)
+{
+  return tftHostRead();
+}
+
+/***************************************************************************************
+** Function name:           GPIO direction control  - supports class functions
+** Description:             Set parallel bus to INPUT or OUTPUT
+***************************************************************************************/
+void TFT_eSPI::busDir(uint32_t mask, uint8_t mode)
+{
+  // The model bus needs no direction
+}
+
+/***************************************************************************************
+** Function name:           GPIO direction control  - supports class functions
+** Description:             Faster GPIO pin input/output switch
+***************************************************************************************/
+void TFT_eSPI::gpioMode(uint8_t gpio, uint8_t mode)
+{
+  // Not used by the model
+}
+
+/***************************************************************************************
+** Function name:           pushBlock - for host framebuffer
+** Description:             Write a block of pixels of the same colour
+***************************************************************************************/
+void TFT_eSPI::pushBlock(uint16_t color, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
+
+  while (len--) {tft_Write_16(color);}
+}
+
+/***************************************************************************************
+** Function name:           pushSwapBytePixels - for host framebuffer
+** Description:             Write a sequence of pixels with swapped bytes
+***************************************************************************************/
+void TFT_eSPI::pushSwapBytePixels(const void* data_in, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
+
+  uint16_t *data = (uint16_t*)data_in;
+  while ( len-- ) {tft_Write_16(*data); data++;}
+}
+
+/***************************************************************************************
+** Function name:           pushPixels - for host framebuffer
+** Description:             Write a sequence of pixels
+***************************************************************************************/
+void TFT_eSPI::pushPixels(const void* data_in, uint32_t len){
+  TFT_PROFILE_PIXELS(len);
+
+  uint16_t *data = (uint16_t*)data_in;
+  if(_swapBytes) { while ( len-- ) {tft_Write_16(*data); data++; } }
+  else { while ( len-- ) {tft_Write_16S(*data); data++;} }
+}
@@ -0,0 +1,155 @@
+        ////////////////////////////////////////////////////
+        //   TFT_eSPI host framebuffer driver functions   //
+        ////////////////////////////////////////////////////
+
+// Runs the library on a Linux (or other) host against a display held in memory, see
+// User_Setups/Setup207_Host_Framebuffer.h. Nothing is drawn on a real screen; the
+// panel can be inspected, read back and written to a PNG file.
+//
+// The write macros drive a model of the display controller on an 8 bit parallel
+// (8080) bus: DC low bytes are commands, the ST7789 address commands CASET, PASET,
+// RAMWR, RAMRD and MADCTL are executed, pixel data lands in the controller frame
+// memory with the same rotation, mirroring and CGRAM offsets as on the real chip.
+// Every byte on the bus is counted, so the counters are exactly what the panel of
+// the board gets sent for the same drawing calls.
+
+#ifndef _TFT_eSPI_HOSTH_
+#define _TFT_eSPI_HOSTH_
+
+#include <stdint.h>
+
+// Processor ID reported by getSetup()
+#define PROCESSOR_ID 0x4F57
+
+// The bus model only knows the 8 bit parallel interface
+#if !defined (TFT_PARALLEL_8_BIT)
+  #define TFT_PARALLEL_8_BIT
+#endif
+
+// Controller frame memory, the ST7789 has 240 x 320 pixels
+#ifndef TFT_HOST_GRAM_WIDTH
+  #define TFT_HOST_GRAM_WIDTH  240
+#endif
+#ifndef TFT_HOST_GRAM_HEIGHT
+  #define TFT_HOST_GRAM_HEIGHT 320
+#endif
+
+// The visible TFT_WIDTH x TFT_HEIGHT part of it, centered unless set by the setup
+#ifndef TFT_HOST_GLASS_X
+  #define TFT_HOST_GLASS_X ((TFT_HOST_GRAM_WIDTH - TFT_WIDTH) / 2)
+#endif
+#ifndef TFT_HOST_GLASS_Y
+  #define TFT_HOST_GLASS_Y ((TFT_HOST_GRAM_HEIGHT - TFT_HEIGHT) / 2)
+#endif
+
+// Processor specific code used by SPI bus transaction startWrite and endWrite functions
+#define SET_BUS_WRITE_MODE // Not used
+#define SET_BUS_READ_MODE  // Not used
+
+// Code to check if DMA or the bus is busy, nothing to wait for
+#define DMA_BUSY_CHECK
+#define SPI_BUSY_CHECK
+
+// To be safe, SUPPORT_TRANSACTIONS is assumed mandatory
+#if !defined (SUPPORT_TRANSACTIONS)
+  #define SUPPORT_TRANSACTIONS
+#endif
+
+// Initialise processor specific bus functions, used by init()
+#define INIT_TFT_DATA_BUS
+#define PARALLEL_INIT_TFT_DATA_BUS
+
+// Not used, busDir() sets the direction of the model bus
+#define GPIO_DIR_MASK 0
+
+// Bus counters, every byte the panel would see
+typedef struct {
+  uint32_t transactions; // CS low to CS high
+  uint32_t commands;     // Bytes written with DC low
+  uint32_t addressSets;  // CASET and PASET commands
+  uint32_t windows;      // RAMWR commands, each starts a stream of pixels
+  uint64_t bytes;        // Bytes written, commands and parameters included
+  uint64_t pixels;       // Pixels written to the frame memory
+  uint64_t reads;        // Bytes read
+} TFT_HostStats;
+
+// State of the controller model
+typedef struct {
+  uint16_t gram[TFT_HOST_GRAM_HEIGHT][TFT_HOST_GRAM_WIDTH]; // RGB565 as written
+  uint8_t  madctl;          // Memory access control, rotation and colour order
+  uint16_t xs, xe, ys, ye;  // Column and row address window
+  uint16_t col, row;        // Address counter
+  uint8_t  command;         // Last command, its parameters or pixels follow
+  uint8_t  count;           // Bytes received or sent since the command
+  uint8_t  data[4];         // Parameters, or the first byte of a pixel
+  uint16_t readPixel;       // Pixel being read
+  bool     isSelected;      // CS low
+  bool     isData;          // DC high
+  TFT_HostStats stats;
+} TFT_HostPanel;
+
+extern TFT_HostPanel tftHost;
+
+// Bus access, used by the macros below
+void tftHostSelect(bool select);
+void tftHostWrite(uint8_t b);
+uint8_t tftHostRead(void);
+inline void tftHostWrite16(uint16_t c) { tftHostWrite((uint8_t)(c >> 8)); tftHostWrite((uint8_t)c); }
+inline void tftHostWrite32(uint32_t c) { tftHostWrite16((uint16_t)(c >> 16)); tftHostWrite16((uint16_t)c); }
+
+// Counters since start or the last reset
+inline const TFT_HostStats& tftHostStats(void) { return tftHost.stats; }
+void tftHostResetStats(void);
+// Print the counters, on one line
+void tftHostReport(Print &out);
+
+// Width and height of the visible area as the last MADCTL orients it, e.g. 320 x 170
+// after setRotation(1) on the T-Display S3
+void tftHostSize(int32_t *w, int32_t *h);
+// Copy the visible area in that orientation, tftHostSize() pixels of RGB565
+void tftHostSnapshot(uint16_t *image);
+// Write the visible area in that orientation to a PNG file, returns false on a file error
+bool tftHostWritePng(const char *path);
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Define the DC (TFT Data/Command or Register Select (RS))pin drive code
+////////////////////////////////////////////////////////////////////////////////////////
+#define DC_C tftHost.isData = false
+#define DC_D tftHost.isData = true
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Define the CS (TFT chip select) pin drive code
+////////////////////////////////////////////////////////////////////////////////////////
+#define CS_L tftHostSelect(true)
+#define CS_H tftHostSelect(false)
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Define the WR (TFT Write) and RD (TFT Read) pin drive code, strobes are implied
+////////////////////////////////////////////////////////////////////////////////////////
+#define WR_L
+#define WR_H
+#define RD_L
+#define RD_H
+
+#ifndef TFT_RD
+  #define TFT_RD -1
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Define the touch screen chip select pin drive code
+////////////////////////////////////////////////////////////////////////////////////////
+#define T_CS_L // No macro allocated so it generates no code
+#define T_CS_H // No macro allocated so it generates no code
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Macros to write commands/pixel colour data to the model, MS byte first
+////////////////////////////////////////////////////////////////////////////////////////
+#define tft_Write_8(C)     tftHostWrite((uint8_t)(C))
+#define tft_Write_16(C)    tftHostWrite16((uint16_t)(C))
+#define tft_Write_16N(C)   tftHostWrite16((uint16_t)(C))
+#define tft_Write_16S(C)   tftHostWrite16((uint16_t)((C) << 8 | (uint16_t)(C) >> 8))
+#define tft_Write_32(C)    tftHostWrite32((uint32_t)(C))
+#define tft_Write_32C(C,D) tftHostWrite32((uint32_t)(C) << 16 | (uint16_t)(D))
+#define tft_Write_32D(C)   tftHostWrite32((uint32_t)(C) << 16 | (uint16_t)(C))
+
+#endif // Header end
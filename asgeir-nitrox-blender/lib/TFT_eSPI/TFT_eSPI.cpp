@@ -15,7 +15,9 @@
 
 #include "TFT_eSPI.h"
 
-#if defined (ESP32)
+#if defined (TFT_HOST_FRAMEBUFFER)
+  #include "Processors/TFT_eSPI_Host.c" // Panel in memory, for host builds
+#elif defined (ESP32)
   #if defined(CONFIG_IDF_TARGET_ESP32S3)
     #include "Processors/TFT_eSPI_ESP32_S3.c" // Tested with SPI and 8 bit parallel
   #elif defined(CONFIG_IDF_TARGET_ESP32C3)
@@ -37,6 +39,9 @@
   #define SPI_BUSY_CHECK
 #endif
 
+// Table driven conversion for the 8, 4 and 1 bpp pushImage() functions
+#include "Extensions/Palette.h"
+
 // Clipping macro for pushImage
 #define PI_CLIP                                        \
   if (_vpOoB) return;                                  \
@@ -78,6 +83,7 @@ inline void TFT_eSPI::begin_tft_write(void){
     spi.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
 #endif
     CS_L;
+    TFT_PROFILE_CS();
     SET_BUS_WRITE_MODE;  // Some processors (e.g. ESP32) allow recycling the tx buffer when rx is not used
   }
 }
@@ -90,6 +96,7 @@ void TFT_eSPI::begin_nin_write(void){
     spi.beginTransaction(SPISettings(SPI_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
 #endif
     CS_L;
+    TFT_PROFILE_CS();
     SET_BUS_WRITE_MODE;  // Some processors (e.g. ESP32) allow recycling the tx buffer when rx is not used
   }
 }
@@ -139,12 +146,14 @@ inline void TFT_eSPI::begin_tft_read(void){
     locked = false;
     spi.beginTransaction(SPISettings(SPI_READ_FREQUENCY, MSBFIRST, TFT_SPI_MODE));
     CS_L;
+    TFT_PROFILE_CS();
   }
 #else
   #if !defined(TFT_PARALLEL_8_BIT) && !defined(RP2040_PIO_INTERFACE)
     spi.setFrequency(SPI_READ_FREQUENCY);
   #endif
    CS_L;
+   TFT_PROFILE_CS();
 #endif
   SET_BUS_READ_MODE;
 }
@@ -333,6 +342,7 @@ bool  TFT_eSPI::getViewportDatum(void)
 ***************************************************************************************/
 void TFT_eSPI::frameViewport(uint16_t color, int32_t w)
 {
+  TFT_PROFILE_CALL("frameViewport");
   // Save datum position
   bool _dT = _vpDatum;
 
@@ -1100,6 +1110,7 @@ uint32_t TFT_eSPI::readcommand32(uint8_t cmd_function, uint8_t index)
 ***************************************************************************************/
 uint16_t TFT_eSPI::readPixel(int32_t x0, int32_t y0)
 {
+  TFT_PROFILE_CALL("readPixel");
   if (_vpOoB) return 0;
 
   x0+= _xDatum;
@@ -1110,7 +1121,7 @@ uint16_t TFT_eSPI::readPixel(int32_t x0, int32_t y0)
 
 #if defined(TFT_PARALLEL_8_BIT) || defined(RP2040_PIO_INTERFACE)
 
-  if (!inTransaction) { CS_L; } // CS_L can be multi-statement
+  if (!inTransaction) { CS_L; TFT_PROFILE_CS(); } // CS_L can be multi-statement
 
   readAddrWindow(x0, y0, 1, 1);
 
@@ -1230,11 +1241,13 @@ void TFT_eSPI::setCallback(getColorCallback getCol)
 ***************************************************************************************/
 void TFT_eSPI::readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
 {
+  TFT_PROFILE_CALL("readRect");
   PI_CLIP ;
 
 #if defined(TFT_PARALLEL_8_BIT) || defined(RP2040_PIO_INTERFACE)
 
   CS_L;
+  TFT_PROFILE_CS();
 
   readAddrWindow(x, y, dw, dh);
 
@@ -1386,6 +1399,7 @@ void TFT_eSPI::readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *da
 ***************************************************************************************/
 void TFT_eSPI::pushRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
 {
+  TFT_PROFILE_CALL("pushRect");
   bool swap = _swapBytes; _swapBytes = false;
   pushImage(x, y, w, h, data);
   _swapBytes = swap;
@@ -1398,6 +1412,7 @@ void TFT_eSPI::pushRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *da
 ***************************************************************************************/
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data)
 {
+  TFT_PROFILE_CALL("pushImage");
   PI_CLIP;
 
   begin_tft_write();
@@ -1428,6 +1443,7 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *d
 ***************************************************************************************/
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data, uint16_t transp)
 {
+  TFT_PROFILE_CALL("pushImage");
   PI_CLIP;
 
   begin_tft_write();
@@ -1487,6 +1503,7 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *d
 ***************************************************************************************/
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
 {
+  TFT_PROFILE_CALL("pushImage");
   // Requires 32 bit aligned access, so use PROGMEM 16 bit word functions
   PI_CLIP;
 
@@ -1517,6 +1534,7 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint1
 ***************************************************************************************/
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data, uint16_t transp)
 {
+  TFT_PROFILE_CALL("pushImage");
   // Requires 32 bit aligned access, so use PROGMEM 16 bit word functions
   PI_CLIP;
 
@@ -1571,8 +1589,11 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint1
 ** Function name:           pushImage
 ** Description:             plot 8 bit or 4 bit or 1 bit image or sprite using a line buffer
 ***************************************************************************************/
+// The pixels are converted by the table driven functions of Extensions/Palette.h and
+// pushed TFT_PUSH_CHUNK at a time, several short rows go out in one pushPixels() call
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint8_t *data, bool bpp8,  uint16_t *cmap)
 {
+  TFT_PROFILE_CALL("pushImage");
   PI_CLIP;
 
   begin_tft_write();
@@ -1582,117 +1603,47 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint8
   setWindow(x, y, x + dw - 1, y + dh - 1); // Sets CS low and sent RAMWR
 
   // Line buffer makes plotting faster
-  uint16_t  lineBuf[dw];
-
-  if (bpp8)
-  {
-    _swapBytes = false;
-
-    uint8_t  blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
+  uint16_t  lineBuf[TFT_PUSH_CHUNK];
+  uint32_t  np = 0; // Pixels waiting in lineBuf
 
-    _lastColor = -1; // Set to illegal value
+  const uint32_t *pairs = nullptr;
+  uint32_t ww; // Width of source image line in bytes
 
-    // Used to store last shifted colour
-    uint8_t msbColor = 0;
-    uint8_t lsbColor = 0;
-
-    data += dx + dy * w;
-    while (dh--) {
-      uint32_t len = dw;
-      uint8_t* ptr = (uint8_t*)data;
-      uint8_t* linePtr = (uint8_t*)lineBuf;
-
-      while(len--) {
-        uint32_t color = pgm_read_byte(ptr++);
-
-        // Shifts are slow so check if colour has changed first
-        if (color != _lastColor) {
-          //          =====Green=====     ===============Red==============
-          msbColor = (color & 0x1C)>>2 | (color & 0xC0)>>3 | (color & 0xE0);
-          //          =====Green=====    =======Blue======
-          lsbColor = (color & 0x1C)<<3 | blue[color & 0x03];
-          _lastColor = color;
-        }
-
-       *linePtr++ = msbColor;
-       *linePtr++ = lsbColor;
-      }
+  // 1bpp colours with the bytes in the order they are sent
+  uint16_t fg = (uint16_t)(bitmap_fg << 8 | (uint8_t)(bitmap_fg >> 8));
+  uint16_t bg = (uint16_t)(bitmap_bg << 8 | (uint8_t)(bitmap_bg >> 8));
 
-      pushPixels(lineBuf, dw);
-
-      data += w;
-    }
-    _swapBytes = swap; // Restore old value
+  if (bpp8) {
+    _swapBytes = false; // tftRgb332 has the bytes in the order they are sent
+    ww = w;
   }
-  else if (cmap != nullptr) // Must be 4bpp
-  {
+  else if (cmap != nullptr) { // Must be 4bpp
     _swapBytes = true;
+    ww = (w + 1) >> 1;  // if this is a sprite, w will already be even
+    pairs = tftPairsFor(cmap, dw * dh);
+  }
+  else { // Must be 1bpp
+    _swapBytes = false;
+    ww = (w + 7) >> 3;
+  }
 
-    w = (w+1) & 0xFFFE;   // if this is a sprite, w will already be even; this does no harm.
-    bool splitFirst = (dx & 0x01) != 0; // split first means we have to push a single px from the left of the sprite / image
-
-    if (splitFirst) {
-      data += ((dx - 1 + dy * w) >> 1);
-    }
-    else {
-      data += ((dx + dy * w) >> 1);
-    }
-
-    while (dh--) {
-      uint32_t len = dw;
-      uint8_t * ptr = (uint8_t*)data;
-      uint16_t *linePtr = lineBuf;
-      uint8_t colors; // two colors in one byte
-      uint16_t index;
-
-      if (splitFirst) {
-        colors = pgm_read_byte(ptr);
-        index = (colors & 0x0F);
-        *linePtr++ = cmap[index];
-        len--;
-        ptr++;
-      }
-
-      while (len--)
-      {
-        colors = pgm_read_byte(ptr);
-        index = ((colors & 0xF0) >> 4) & 0x0F;
-        *linePtr++ = cmap[index];
-
-        if (len--)
-        {
-          index = colors & 0x0F;
-          *linePtr++ = cmap[index];
-        } else {
-          break;  // nothing to do here
-        }
+  data += dy * ww;
+  while (dh--) {
+    for (int32_t xp = dx; xp < dx + dw; ) {
+      uint32_t n = dx + dw - xp;
+      if (n > TFT_PUSH_CHUNK - np) n = TFT_PUSH_CHUNK - np;
 
-        ptr++;
-      }
+      if (bpp8) tftExpand332(lineBuf + np, data + xp, n);
+      else if (cmap != nullptr) tftExpand4(lineBuf + np, data + (xp >> 1), xp & 1, n, pairs, cmap);
+      else tftExpand1(lineBuf + np, data, xp, xp + n, fg, bg);
 
-      pushPixels(lineBuf, dw);
-      data += (w >> 1);
-    }
-    _swapBytes = swap; // Restore old value
-  }
-  else // Must be 1bpp
-  {
-    _swapBytes = false;
-    uint8_t * ptr = (uint8_t*)data;
-    uint32_t ww =  (w+7)>>3; // Width of source image line in bytes
-    for (int32_t yp = dy;  yp < dy + dh; yp++)
-    {
-      uint8_t* linePtr = (uint8_t*)lineBuf;
-      for (int32_t xp = dx; xp < dx + dw; xp++)
-      {
-        uint16_t col = (pgm_read_byte(ptr + (xp>>3)) & (0x80 >> (xp & 0x7)) );
-        if (col) {*linePtr++ = bitmap_fg>>8; *linePtr++ = (uint8_t) bitmap_fg;}
-        else     {*linePtr++ = bitmap_bg>>8; *linePtr++ = (uint8_t) bitmap_bg;}
-      }
-      ptr += ww;
-      pushPixels(lineBuf, dw);
+      np += n;
+      xp += n;
+      if (np == TFT_PUSH_CHUNK) { pushPixels(lineBuf, np); np = 0; }
     }
+    data += ww;
   }
+  if (np) pushPixels(lineBuf, np);
 
   _swapBytes = swap; // Restore old value
   inTransaction = lockTransaction;
@@ -1706,130 +1657,7 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint8
 ***************************************************************************************/
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *data, bool bpp8,  uint16_t *cmap)
 {
-  PI_CLIP;
-
-  begin_tft_write();
-  inTransaction = true;
-  bool swap = _swapBytes;
-
-  setWindow(x, y, x + dw - 1, y + dh - 1); // Sets CS low and sent RAMWR
-
-  // Line buffer makes plotting faster
-  uint16_t  lineBuf[dw];
-
-  if (bpp8)
-  {
-    _swapBytes = false;
-
-    uint8_t  blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
-
-    _lastColor = -1; // Set to illegal value
-
-    // Used to store last shifted colour
-    uint8_t msbColor = 0;
-    uint8_t lsbColor = 0;
-
-    data += dx + dy * w;
-    while (dh--) {
-      uint32_t len = dw;
-      uint8_t* ptr = data;
-      uint8_t* linePtr = (uint8_t*)lineBuf;
-
-      while(len--) {
-        uint32_t color = *ptr++;
-
-        // Shifts are slow so check if colour has changed first
-        if (color != _lastColor) {
-          //          =====Green=====     ===============Red==============
-          msbColor = (color & 0x1C)>>2 | (color & 0xC0)>>3 | (color & 0xE0);
-          //          =====Green=====    =======Blue======
-          lsbColor = (color & 0x1C)<<3 | blue[color & 0x03];
-          _lastColor = color;
-        }
-
-       *linePtr++ = msbColor;
-       *linePtr++ = lsbColor;
-      }
-
-      pushPixels(lineBuf, dw);
-
-      data += w;
-    }
-    _swapBytes = swap; // Restore old value
-  }
-  else if (cmap != nullptr) // Must be 4bpp
-  {
-    _swapBytes = true;
-
-    w = (w+1) & 0xFFFE;   // if this is a sprite, w will already be even; this does no harm.
-    bool splitFirst = (dx & 0x01) != 0; // split first means we have to push a single px from the left of the sprite / image
-
-    if (splitFirst) {
-      data += ((dx - 1 + dy * w) >> 1);
-    }
-    else {
-      data += ((dx + dy * w) >> 1);
-    }
-
-    while (dh--) {
-      uint32_t len = dw;
-      uint8_t * ptr = data;
-      uint16_t *linePtr = lineBuf;
-      uint8_t colors; // two colors in one byte
-      uint16_t index;
-
-      if (splitFirst) {
-        colors = *ptr;
-        index = (colors & 0x0F);
-        *linePtr++ = cmap[index];
-        len--;
-        ptr++;
-      }
-
-      while (len--)
-      {
-        colors = *ptr;
-        index = ((colors & 0xF0) >> 4) & 0x0F;
-        *linePtr++ = cmap[index];
-
-        if (len--)
-        {
-          index = colors & 0x0F;
-          *linePtr++ = cmap[index];
-        } else {
-          break;  // nothing to do here
-        }
-
-        ptr++;
-      }
-
-      pushPixels(lineBuf, dw);
-      data += (w >> 1);
-    }
-    _swapBytes = swap; // Restore old value
-  }
-  else // Must be 1bpp
-  {
-    _swapBytes = false;
-
-    uint32_t ww =  (w+7)>>3; // Width of source image line in bytes
-    for (int32_t yp = dy;  yp < dy + dh; yp++)
-    {
-      uint8_t* linePtr = (uint8_t*)lineBuf;
-      for (int32_t xp = dx; xp < dx + dw; xp++)
-      {
-        uint16_t col = (data[(xp>>3)] & (0x80 >> (xp & 0x7)) );
-        if (col) {*linePtr++ = bitmap_fg>>8; *linePtr++ = (uint8_t) bitmap_fg;}
-        else     {*linePtr++ = bitmap_bg>>8; *linePtr++ = (uint8_t) bitmap_bg;}
-      }
-      data += ww;
-      pushPixels(lineBuf, dw);
-    }
-  }
-
-  _swapBytes = swap; // Restore old value
-  inTransaction = lockTransaction;
-  end_tft_write();
+  pushImage(x, y, w, h, (const uint8_t*)data, bpp8, cmap);
 }
 
 
@@ -1837,8 +1665,10 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *da
 ** Function name:           pushImage
 ** Description:             plot 8 or 4 or 1 bit image or sprite with a transparent colour
 ***************************************************************************************/
+// Every run of opaque pixels gets a window, the 1bpp runs are found a byte at a time
 void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *data, uint8_t transp, bool bpp8, uint16_t *cmap)
 {
+  TFT_PROFILE_CALL("pushImage");
   PI_CLIP;
 
   begin_tft_write();
@@ -1847,192 +1677,68 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *da
 
 
   // Line buffer makes plotting faster
-  uint16_t  lineBuf[dw];
+  uint16_t  lineBuf[TFT_PUSH_CHUNK];
+
+  const uint32_t *pairs = nullptr;
+  uint32_t ww; // Width of source image line in bytes
 
   if (bpp8) { // 8 bits per pixel
     _swapBytes = false;
-
-    data += dx + dy * w;
-
-    uint8_t  blue[] = {0, 11, 21, 31}; // blue 2 to 5 bit colour lookup table
-
-    _lastColor = -1; // Set to illegal value
-
-    // Used to store last shifted colour
-    uint8_t msbColor = 0;
-    uint8_t lsbColor = 0;
-
-    while (dh--) {
-      int32_t len = dw;
-      uint8_t* ptr = data;
-      uint8_t* linePtr = (uint8_t*)lineBuf;
-
-      int32_t px = x, sx = x;
-      bool move = true;
-      uint16_t np = 0;
-
-      while (len--) {
-        if (transp != *ptr) {
-          if (move) { move = false; sx = px; }
-          uint8_t color = *ptr;
-
-          // Shifts are slow so check if colour has changed first
-          if (color != _lastColor) {
-            //          =====Green=====     ===============Red==============
-            msbColor = (color & 0x1C)>>2 | (color & 0xC0)>>3 | (color & 0xE0);
-            //          =====Green=====    =======Blue======
-            lsbColor = (color & 0x1C)<<3 | blue[color & 0x03];
-            _lastColor = color;
-          }
-          *linePtr++ = msbColor;
-          *linePtr++ = lsbColor;
-          np++;
-        }
-        else {
-          move = true;
-          if (np) {
-            setWindow(sx, y, sx + np - 1, y);
-            pushPixels(lineBuf, np);
-            linePtr = (uint8_t*)lineBuf;
-            np = 0;
-          }
-        }
-        px++;
-        ptr++;
-      }
-
-      if (np) { setWindow(sx, y, sx + np - 1, y); pushPixels(lineBuf, np); }
-      y++;
-      data += w;
-    }
+    ww = w;
   }
-  else if (cmap != nullptr) // 4bpp with color map
-  {
+  else if (cmap != nullptr) { // 4bpp with color map
     _swapBytes = true;
+    ww = (w + 1) >> 1;
+    pairs = tftPairsFor(cmap, dw * dh);
+  }
+  else { // 1 bit per pixel, the 0 bits are transparent
+    _swapBytes = false;
+    ww = (w + 7) >> 3;
+  }
 
-    w = (w+1) & 0xFFFE; // here we try to recreate iwidth from dwidth.
-    bool splitFirst = ((dx & 0x01) != 0);
-    if (splitFirst) {
-      data += ((dx - 1 + dy * w) >> 1);
-    }
-    else {
-      data += ((dx + dy * w) >> 1);
-    }
-
-    while (dh--) {
-      uint32_t len = dw;
-      uint8_t * ptr = data;
-
-      int32_t px = x, sx = x;
-      bool move = true;
-      uint16_t np = 0;
-
-      uint8_t index;  // index into cmap.
-
-      if (splitFirst) {
-        index = (*ptr & 0x0F);  // odd = bits 3 .. 0
-        if (index != transp) {
-          move = false; sx = px;
-          lineBuf[np] = cmap[index];
-          np++;
+  data += dy * ww;
+  while (dh--) {
+    int32_t xp = dx;
+    while (xp < dx + dw) {
+      int32_t sx = xp; // First pixel of the run
+
+      if (!bpp8 && cmap == nullptr) {
+        bool isSet;
+        xp += tftBitRun(data, xp, dx + dw, &isSet);
+        if (isSet) {
+          setWindow(x + sx - dx, y, x + xp - dx - 1, y);
+          pushBlock(bitmap_fg, xp - sx);
         }
-        px++; ptr++;
-        len--;
+        continue;
       }
 
-      while (len--)
-      {
-        uint8_t color = *ptr;
-
-        // find the actual color you care about.  There will be two pixels here!
-        // but we may only want one at the end of the row
-        uint16_t index = ((color & 0xF0) >> 4) & 0x0F;  // high bits are the even numbers
-        if (index != transp) {
-          if (move) {
-            move = false; sx = px;
-          }
-          lineBuf[np] = cmap[index];
-          np++; // added a pixel
-        }
-        else {
-          move = true;
-          if (np) {
-            setWindow(sx, y, sx + np - 1, y);
-            pushPixels(lineBuf, np);
-            np = 0;
-          }
-        }
-        px++;
-
-        if (len--)
-        {
-          index = color & 0x0F; // the odd number is 3 .. 0
-          if (index != transp) {
-            if (move) {
-              move = false; sx = px;
-             }
-            lineBuf[np] = cmap[index];
-            np++;
-          }
-          else {
-            move = true;
-            if (np) {
-              setWindow(sx, y, sx + np - 1, y);
-              pushPixels(lineBuf, np);
-              np = 0;
-            }
-          }
-          px++;
-        }
-        else {
-          break;  // we are done with this row.
-        }
-        ptr++;  // we only increment ptr once in the loop (deliberate)
+      // Skip the transparent pixels, then find the end of the opaque ones
+      if (bpp8) {
+        while (xp < dx + dw && data[xp] == transp) xp++;
+        sx = xp;
+        while (xp < dx + dw && data[xp] != transp) xp++;
       }
-
-      if (np) {
-        setWindow(sx, y, sx + np - 1, y);
-        pushPixels(lineBuf, np);
-        np = 0;
+      else {
+        while (xp < dx + dw && tftNibble(data, xp) == transp) xp++;
+        sx = xp;
+        while (xp < dx + dw && tftNibble(data, xp) != transp) xp++;
       }
-      data += (w>>1);
-      y++;
-    }
-  }
-  else { // 1 bit per pixel
-    _swapBytes = false;
-
-    uint32_t ww =  (w+7)>>3; // Width of source image line in bytes
-    uint16_t np = 0;
-
-    for (int32_t yp = dy;  yp < dy + dh; yp++)
-    {
-      int32_t px = x, sx = x;
-      bool move = true;
-      for (int32_t xp = dx; xp < dx + dw; xp++)
-      {
-        if (data[(xp>>3)] & (0x80 >> (xp & 0x7))) {
-          if (move) {
-            move = false;
-            sx = px;
-          }
-          np++;
-        }
-        else {
-          move = true;
-          if (np) {
-            setWindow(sx, y, sx + np - 1, y);
-            pushBlock(bitmap_fg, np);
-            np = 0;
-          }
-        }
-        px++;
+      if (xp == sx) break;
+
+      setWindow(x + sx - dx, y, x + xp - dx - 1, y);
+      for (int32_t px = sx; px < xp; ) {
+        uint32_t n = xp - px;
+        if (n > TFT_PUSH_CHUNK) n = TFT_PUSH_CHUNK;
+        if (bpp8) tftExpand332(lineBuf, data + px, n);
+        else tftExpand4(lineBuf, data + (px >> 1), px & 1, n, pairs, cmap);
+        pushPixels(lineBuf, n);
+        px += n;
       }
-      if (np) { setWindow(sx, y, sx + np - 1, y); pushBlock(bitmap_fg, np); np = 0; }
-      y++;
-      data += ww;
     }
+    y++;
+    data += ww;
   }
+
   _swapBytes = swap; // Restore old value
   inTransaction = lockTransaction;
   end_tft_write();
@@ -2045,6 +1751,7 @@ void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *da
 // Can be used with a 16bpp sprite and a 1bpp sprite for the mask
 void TFT_eSPI::pushMaskedImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *img, uint8_t *mask)
 {
+  TFT_PROFILE_CALL("pushMaskedImage");
   if (_vpOoB || w < 1 || h < 1) return;
 
   // To simplify mask handling the window clipping is done by the pushImage function
@@ -2151,6 +1858,7 @@ bool TFT_eSPI::getSwapBytes(void)
 // If w and h are 1, then 1 pixel is read, *data array size must be 3 bytes per pixel
 void  TFT_eSPI::readRectRGB(int32_t x0, int32_t y0, int32_t w, int32_t h, uint8_t *data)
 {
+  TFT_PROFILE_CALL("readRectRGB");
 #if defined(TFT_PARALLEL_8_BIT) || defined(RP2040_PIO_INTERFACE)
 
   uint32_t len = w * h;
@@ -2225,6 +1933,7 @@ void  TFT_eSPI::readRectRGB(int32_t x0, int32_t y0, int32_t w, int32_t h, uint8_
 // Optimised midpoint circle algorithm
 void TFT_eSPI::drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawCircle");
   if ( r <= 0 ) return;
 
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
@@ -2363,6 +2072,7 @@ void TFT_eSPI::drawCircleHelper( int32_t x0, int32_t y0, int32_t rr, uint8_t cor
 // Improved algorithm avoids repetition of lines
 void TFT_eSPI::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color)
 {
+  TFT_PROFILE_CALL("fillCircle");
   int32_t  x  = 0;
   int32_t  dx = 1;
   int32_t  dy = r+r;
@@ -2435,6 +2145,7 @@ void TFT_eSPI::fillCircleHelper(int32_t x0, int32_t y0, int32_t r, uint8_t corne
 ***************************************************************************************/
 void TFT_eSPI::drawEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color)
 {
+  TFT_PROFILE_CALL("drawEllipse");
   if (rx<2) return;
   if (ry<2) return;
   int32_t x, y;
@@ -2487,6 +2198,7 @@ void TFT_eSPI::drawEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint1
 ***************************************************************************************/
 void TFT_eSPI::fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint16_t color)
 {
+  TFT_PROFILE_CALL("fillEllipse");
   if (rx<2) return;
   if (ry<2) return;
   int32_t x, y;
@@ -2532,6 +2244,7 @@ void TFT_eSPI::fillEllipse(int16_t x0, int16_t y0, int32_t rx, int32_t ry, uint1
 ***************************************************************************************/
 void TFT_eSPI::fillScreen(uint32_t color)
 {
+  TFT_PROFILE_CALL("fillScreen");
   fillRect(0, 0, _width, _height, color);
 }
 
@@ -2543,6 +2256,7 @@ void TFT_eSPI::fillScreen(uint32_t color)
 // Draw a rectangle
 void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawRect");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2564,6 +2278,7 @@ void TFT_eSPI::drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t col
 // Draw a rounded rectangle
 void TFT_eSPI::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawRoundRect");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2590,6 +2305,7 @@ void TFT_eSPI::drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t
 // Fill a rounded rectangle, changed to horizontal lines (faster in sprites)
 void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color)
 {
+  TFT_PROFILE_CALL("fillRoundRect");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2612,6 +2328,7 @@ void TFT_eSPI::fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t
 // Draw a triangle
 void TFT_eSPI::drawTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawTriangle");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2631,6 +2348,7 @@ void TFT_eSPI::drawTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int3
 // Fill a triangle - original Adafruit function works well and code footprint is small
 void TFT_eSPI::fillTriangle ( int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color)
 {
+  TFT_PROFILE_CALL("fillTriangle");
   int32_t a, b, y, last;
 
   // Sort coordinates by Y order (y2 >= y1 >= y0)
@@ -2711,6 +2429,7 @@ void TFT_eSPI::fillTriangle ( int32_t x0, int32_t y0, int32_t x1, int32_t y1, in
 ***************************************************************************************/
 void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color)
 {
+  TFT_PROFILE_CALL("drawBitmap");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2735,6 +2454,7 @@ void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w
 ***************************************************************************************/
 void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t fgcolor, uint16_t bgcolor)
 {
+  TFT_PROFILE_CALL("drawBitmap");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2758,6 +2478,7 @@ void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w
 ***************************************************************************************/
 void TFT_eSPI::drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color)
 {
+  TFT_PROFILE_CALL("drawXBitmap");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -2782,6 +2503,7 @@ void TFT_eSPI::drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t
 ***************************************************************************************/
 void TFT_eSPI::drawXBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color, uint16_t bgcolor)
 {
+  TFT_PROFILE_CALL("drawXBitmap");
   //begin_tft_write();          // Sprite class can use this function, avoiding begin_tft_write()
   inTransaction = true;
 
@@ -3130,6 +2852,7 @@ int16_t TFT_eSPI::fontHeight(void)
 ***************************************************************************************/
 void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size)
 {
+  TFT_PROFILE_CALL("drawChar");
   if (_vpOoB) return;
 
   if (c < 32) return;
@@ -3158,6 +2881,7 @@ void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32
     begin_tft_write();
 
     setWindow(xd, yd, xd+5, yd+7);
+    TFT_PROFILE_PIXELS(48);
 
     for (int8_t i = 0; i < 5; i++ ) column[i] = pgm_read_byte(font + (c * 5) + i);
     column[5] = 0;
@@ -3290,6 +3014,7 @@ void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32
 // Chip select is high at the end of this function
 void TFT_eSPI::setAddrWindow(int32_t x0, int32_t y0, int32_t w, int32_t h)
 {
+  TFT_PROFILE_CALL("setAddrWindow");
   begin_tft_write();
 
   setWindow(x0, y0, x0 + w - 1, y0 + h - 1);
@@ -3308,6 +3033,7 @@ void TFT_eSPI::setWindow(int32_t x0, int32_t y0, int32_t x1, int32_t y1)
   //begin_tft_write(); // Must be called before setWindow
   addr_row = 0xFFFF;
   addr_col = 0xFFFF;
+  TFT_PROFILE_WINDOW();
 
 #if defined (ILI9225_DRIVER)
   if (rotation & 0x01) { transpose(x0, y0); transpose(x1, y1); }
@@ -3515,6 +3241,7 @@ void TFT_eSPI::readAddrWindow(int32_t xs, int32_t ys, int32_t w, int32_t h)
 ***************************************************************************************/
 void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawPixel");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -3534,6 +3261,8 @@ void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color)
 #endif
 
   begin_tft_write();
+  TFT_PROFILE_WINDOW();  // A RAMWR with a single pixel, the address set when it moved
+  TFT_PROFILE_PIXELS(1);
 
 #if defined (ILI9225_DRIVER)
   if (rotation & 0x01) { transpose(x, y); }
@@ -3705,10 +3434,12 @@ void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color)
 ***************************************************************************************/
 void TFT_eSPI::pushColor(uint16_t color)
 {
+  TFT_PROFILE_CALL("pushColor");
   begin_tft_write();
 
   SPI_BUSY_CHECK;
   tft_Write_16N(color);
+  TFT_PROFILE_PIXELS(1);
 
   end_tft_write();
 }
@@ -3720,6 +3451,7 @@ void TFT_eSPI::pushColor(uint16_t color)
 ***************************************************************************************/
 void TFT_eSPI::pushColor(uint16_t color, uint32_t len)
 {
+  TFT_PROFILE_CALL("pushColor");
   begin_tft_write();
 
   pushBlock(color, len);
@@ -3756,6 +3488,7 @@ void TFT_eSPI::endWrite(void)
 ***************************************************************************************/
 void TFT_eSPI::writeColor(uint16_t color, uint32_t len)
 {
+  TFT_PROFILE_CALL("writeColor");
   pushBlock(color, len);
 }
 
@@ -3767,6 +3500,7 @@ void TFT_eSPI::writeColor(uint16_t color, uint32_t len)
 // len is number of bytes, not pixels
 void TFT_eSPI::pushColors(uint8_t *data, uint32_t len)
 {
+  TFT_PROFILE_CALL("pushColors");
   begin_tft_write();
 
   pushPixels(data, len>>1);
@@ -3781,6 +3515,7 @@ void TFT_eSPI::pushColors(uint8_t *data, uint32_t len)
 ***************************************************************************************/
 void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
 {
+  TFT_PROFILE_CALL("pushColors");
   begin_tft_write();
   if (swap) {swap = _swapBytes; _swapBytes = true; }
 
@@ -3799,6 +3534,7 @@ void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
 // an efficient FastH/V Line draw routine for line segments of 2 pixels or more
 void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawLine");
   if (_vpOoB) return;
 
   //begin_tft_write();       // Sprite class can use this function, avoiding begin_tft_write()
@@ -3874,6 +3610,7 @@ constexpr float deg2rad      = 3.14159265359/180.0;
 ***************************************************************************************/
 uint16_t TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color, uint8_t alpha, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("drawPixel(alpha)");
   if (bg_color == 0x00FFFFFF) bg_color = readPixel(x, y);
   color = alphaBlend(alpha, color, bg_color);
   drawPixel(x, y, color);
@@ -3893,6 +3630,7 @@ void TFT_eSPI::drawSmoothArc(int32_t x, int32_t y, int32_t r, int32_t ir, int32_
 // anti-aliased roundEnd is optional, default is anti-aliased straight end
 // Note: rounded ends extend the arc angle so can overlap, user sketch to manage this.
 {
+  TFT_PROFILE_CALL("drawSmoothArc");
   inTransaction = true;
 
   if (endAngle != startAngle)
@@ -3992,6 +3730,7 @@ void TFT_eSPI::drawArc(int32_t x, int32_t y, int32_t r, int32_t ir,
                        uint32_t fg_color, uint32_t bg_color,
                        bool smooth)
 {
+  TFT_PROFILE_CALL("drawArc");
   if (_vpOoB) return;
   if (r < ir) transpose(r, ir);  // Required that r > ir
   if (r <= 0 || ir < 0) return;  // Invalid r, ir can be zero (circle sector)
@@ -4161,6 +3900,7 @@ void TFT_eSPI::drawArc(int32_t x, int32_t y, int32_t r, int32_t ir,
 // To have effective anti-aliasing the circle will be 3 pixels thick
 void TFT_eSPI::drawSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t fg_color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("drawSmoothCircle");
   drawSmoothRoundRect(x-r, y-r, r, r-1, 0, 0, fg_color, bg_color);
 }
 
@@ -4170,6 +3910,7 @@ void TFT_eSPI::drawSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t fg_col
 ***************************************************************************************/
 void TFT_eSPI::fillSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("fillSmoothCircle");
   if (r <= 0) return;
 
   inTransaction = true;
@@ -4240,6 +3981,7 @@ void TFT_eSPI::fillSmoothCircle(int32_t x, int32_t y, int32_t r, uint32_t color,
 //   0x8 | 0x4
 void TFT_eSPI::drawSmoothRoundRect(int32_t x, int32_t y, int32_t r, int32_t ir, int32_t w, int32_t h, uint32_t fg_color, uint32_t bg_color, uint8_t quadrants)
 {
+  TFT_PROFILE_CALL("drawSmoothRoundRect");
   if (_vpOoB) return;
   if (r < ir) transpose(r, ir); // Required that r > ir
   if (r <= 0 || ir < 0) return;  // Invalid
@@ -4343,6 +4085,7 @@ void TFT_eSPI::drawSmoothRoundRect(int32_t x, int32_t y, int32_t r, int32_t ir,
 ***************************************************************************************/
 void TFT_eSPI::fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("fillSmoothRoundRect");
   inTransaction = true;
 
   int32_t xs = 0;
@@ -4404,6 +4147,7 @@ void TFT_eSPI::fillSmoothRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, i
 // Coordinates are floating point to achieve sub-pixel positioning
 void TFT_eSPI::drawSpot(float ax, float ay, float r, uint32_t fg_color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("drawSpot");
   // Filled circle can be created by the wide line function with zero line length
   drawWedgeLine( ax, ay, ax, ay, r, r, fg_color, bg_color);
 }
@@ -4414,6 +4158,7 @@ void TFT_eSPI::drawSpot(float ax, float ay, float r, uint32_t fg_color, uint32_t
 ***************************************************************************************/
 void TFT_eSPI::drawWideLine(float ax, float ay, float bx, float by, float wd, uint32_t fg_color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("drawWideLine");
   drawWedgeLine( ax, ay, bx, by, wd/2.0, wd/2.0, fg_color, bg_color);
 }
 
@@ -4423,6 +4168,7 @@ void TFT_eSPI::drawWideLine(float ax, float ay, float bx, float by, float wd, ui
 ***************************************************************************************/
 void TFT_eSPI::drawWedgeLine(float ax, float ay, float bx, float by, float ar, float br, uint32_t fg_color, uint32_t bg_color)
 {
+  TFT_PROFILE_CALL("drawWedgeLine");
   if ( (ar < 0.0) || (br < 0.0) )return;
   if ( (fabsf(ax - bx) < 0.01f) && (fabsf(ay - by) < 0.01f) ) bx += 0.01f;  // Avoid divide by zero
 
@@ -4526,6 +4272,7 @@ inline float TFT_eSPI::wedgeLineDistance(float xpax, float ypay, float bax, floa
 ***************************************************************************************/
 void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawFastVLine");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -4556,6 +4303,7 @@ void TFT_eSPI::drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color)
 ***************************************************************************************/
 void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
 {
+  TFT_PROFILE_CALL("drawFastHLine");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -4586,6 +4334,7 @@ void TFT_eSPI::drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color)
 ***************************************************************************************/
 void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
 {
+  TFT_PROFILE_CALL("fillRect");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -4627,6 +4376,7 @@ void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t col
 ***************************************************************************************/
 void TFT_eSPI::fillRectVGradient(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t color1, uint32_t color2)
 {
+  TFT_PROFILE_CALL("fillRectVGradient");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -4665,6 +4415,7 @@ void TFT_eSPI::fillRectVGradient(int16_t x, int16_t y, int16_t w, int16_t h, uin
 ***************************************************************************************/
 void TFT_eSPI::fillRectHGradient(int16_t x, int16_t y, int16_t w, int16_t h, uint32_t color1, uint32_t color2)
 {
+  TFT_PROFILE_CALL("fillRectHGradient");
   if (_vpOoB) return;
 
   x+= _xDatum;
@@ -4979,6 +4730,7 @@ size_t TFT_eSPI::write(const uint8_t *buf, size_t len)
 ***************************************************************************************/
 size_t TFT_eSPI::write(uint8_t utf8)
 {
+  TFT_PROFILE_CALL("write");
   if (_vpOoB) return 1;
 
   uint16_t uniCode = decodeUTF8(utf8);
@@ -5114,6 +4866,7 @@ int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y)
   // Any UTF-8 decoding must be done before calling drawChar()
 int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font)
 {
+  TFT_PROFILE_CALL("drawChar");
   if (_vpOoB || !uniCode) return 0;
 
   if (font==1) {
@@ -5154,7 +4907,7 @@ int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font)
 
   int32_t width  = 0;
   int32_t height = 0;
-  uint32_t flash_address = 0;
+  uintptr_t flash_address = 0; // Pointer sized, also on 64 bit hosts
   uniCode -= 32;
 
 #ifdef LOAD_FONT2
@@ -5239,6 +4992,7 @@ int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font)
       begin_tft_write();
 
       setWindow(xd, yd, xd + width - 1, yd + height - 1);
+      TFT_PROFILE_PIXELS(width * height);
 
       uint8_t mask;
       for (int32_t i = 0; i < height; i++) {
@@ -5299,6 +5053,7 @@ int16_t TFT_eSPI::drawChar(uint16_t uniCode, int32_t x, int32_t y, uint8_t font)
           while (line--) { // In this case the while(line--) is faster
             pc++; // This is faster than putting pc+=line before while()?
             setWindow(px, py, px + ts, py + ts);
+            TFT_PROFILE_PIXELS(np);
 
             if (ts) {
               tnp = np;
@@ -5426,6 +5181,7 @@ int16_t TFT_eSPI::drawString(const char *string, int32_t poX, int32_t poY)
 // With font number. Note: font number is over-ridden if a smooth font is loaded
 int16_t TFT_eSPI::drawString(const char *string, int32_t poX, int32_t poY, uint8_t font)
 {
+  TFT_PROFILE_CALL("drawString");
   int16_t sumX = 0;
   uint8_t padding = 1, baseline = 0;
   uint16_t cwidth = textWidth(string, font); // Find the pixel width of the string in the font
@@ -6071,5 +5827,9 @@ void TFT_eSPI::getSetup(setup_t &tft_settings)
 #ifdef AA_GRAPHICS
   #include "Extensions/AA_graphics.cpp"  // Loaded if SMOOTH_FONT is defined by user
 #endif
+
+#ifdef TFT_BUS_PROFILE
+  #include "Extensions/Bus_profile.cpp"
+#endif
 ////////////////////////////////////////////////////////////////////////////////////////
 
@@ -29,7 +29,9 @@
 //Standard support
 #include <Arduino.h>
 #include <Print.h>
-#include <SPI.h>
+#if !defined (TFT_HOST_FRAMEBUFFER)
+  #include <SPI.h>
+#endif
 
 /***************************************************************************************
 **                         Section 2: Load library and processor specific header files
@@ -81,6 +83,15 @@
     typeof(addr) _addr = (addr); \
     *(const unsigned long *)(_addr); \
   })
+#elif defined (TFT_HOST_FRAMEBUFFER)
+  #define PROGMEM
+  #define pgm_read_byte(addr)  (*(const uint8_t *)(addr))
+  #define pgm_read_word(addr) ({ \
+    uint16_t _word; memcpy(&_word, (const void *)(addr), sizeof(_word)); _word; \
+  })
+  #define pgm_read_dword(addr) ({ /* Also reads the pointers of the font tables */ \
+    uintptr_t _dword; memcpy(&_dword, (const void *)(addr), sizeof(_dword)); _dword; \
+  })
 #elif defined(__AVR__)
   #include <avr/pgmspace.h>
 #elif defined(ARDUINO_ARCH_ESP8266) || defined(ESP32)
@@ -90,7 +101,9 @@
 #endif
 
 // Include the processor specific drivers
-#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#if defined (TFT_HOST_FRAMEBUFFER)
+  #include "Processors/TFT_eSPI_Host.h"
+#elif defined(CONFIG_IDF_TARGET_ESP32S3)
   #include "Processors/TFT_eSPI_ESP32_S3.h"
 #elif defined(CONFIG_IDF_TARGET_ESP32C3)
   #include "Processors/TFT_eSPI_ESP32_C3.h"
@@ -761,6 +774,10 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
            // Note 2: If part of the image will be off screen or outside of a set viewport, then the the original
            // image buffer content will be altered to a correctly clipped image before DMA is initiated.
            //
+           // On the ESP32 S3 8 bit parallel bus the image is copied instead of altered, see the notes in
+           // Processors/TFT_eSPI_ESP32_S3.c. An image in internal RAM that needs no clipping or swapping
+           // is sent in place without a buffer, call dmaWait() before changing it.
+           //
            // The function will wait for the last DMA to complete if it is called while a previous DMA is still
            // in progress, this simplifies the sketch and helps avoid "gotchas".
   void     pushImageDMA(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t* data, uint16_t* buffer = nullptr);
@@ -801,7 +818,9 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
   bool     verifySetupID(uint32_t id);
 
   // Global variables
+#if !defined (TFT_HOST_FRAMEBUFFER)
   static   SPIClass& getSPIinstance(void); // Get SPI class handle
+#endif
 
   uint32_t textcolor, textbgcolor;         // Text foreground and background colours
 
@@ -959,6 +978,16 @@ class TFT_eSPI : public Print { friend class TFT_eSprite; // Sprite class has ac
   #include "Extensions/Smooth_font.h"  // Loaded if SMOOTH_FONT is defined by user
 #endif
 
+// Load the bus traffic profiler, the hooks generate no code unless it is enabled
+#ifdef TFT_BUS_PROFILE
+  #include "Extensions/Bus_profile.h"  // Loaded if TFT_BUS_PROFILE is defined by user
+#else
+  #define TFT_PROFILE_CALL(name)
+  #define TFT_PROFILE_WINDOW()
+  #define TFT_PROFILE_PIXELS(n)
+  #define TFT_PROFILE_CS()
+#endif
+
 }; // End of class TFT_eSPI
 
 // Swap any type
@@ -0,0 +1,50 @@
+// The T-Display S3 panel emulated in memory, for host builds with -DTFT_HOST_FRAMEBUFFER
+// See Processors/TFT_eSPI_Host.h
+
+#define USER_SETUP_ID 207
+
+#define ST7789_DRIVER
+
+#define CGRAM_OFFSET
+#define TFT_RGB_ORDER TFT_BGR // Colour order Blue-Green-Red
+
+#define TFT_INVERSION_ON
+
+#define TFT_PARALLEL_8_BIT
+
+#define TFT_WIDTH 170
+#define TFT_HEIGHT 320
+
+// ST7789 frame memory, the 170 x 320 panel shows columns 35 to 204 of it
+#define TFT_HOST_GRAM_WIDTH  240
+#define TFT_HOST_GRAM_HEIGHT 320
+
+// Same pins as Setup206, the host HAL records their state
+#define TFT_DC 7
+#define TFT_RST 5
+#define TFT_CS  6
+
+#define TFT_WR 8
+#define TFT_RD 9
+
+#define TFT_D0 39
+#define TFT_D1 40
+#define TFT_D2 41
+#define TFT_D3 42
+#define TFT_D4 45
+#define TFT_D5 46
+#define TFT_D6 47
+#define TFT_D7 48
+
+#define TFT_BL 38
+#define TFT_BACKLIGHT_ON HIGH
+
+#define LOAD_GLCD
+#define LOAD_FONT2
+#define LOAD_FONT4
+#define LOAD_FONT6
+#define LOAD_FONT7
+#define LOAD_FONT8
+#define LOAD_GFXFF
+
+#define SMOOTH_FONT
@@ -0,0 +1,502 @@
+/*
+ * Benchmark and check of the 8, 4 and 1 bpp pushImage() functions of TFT_eSPI against
+ * the per pixel code they replaced, which is kept below as the reference.
+ *
+ * First random images, clipped, with transparent colours and changing colour maps, are
+ * drawn both ways and the panel read back: every pixel must match, and on the host the
+ * panel must also have received the same windows and bytes. Then both convert a full
+ * screen image, once into a line buffer only and once all the way to the panel.
+ *
+ * Runs on the board (env bench-palette, results on the serial monitor) and on the
+ * host framebuffer (env native-bench-palette). Cycles come from ESP.getCycleCount(),
+ * on the host that is host time scaled to 240 MHz, and the pushImage rows mostly time
+ * the panel model there.
+ */
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <Extensions/Palette.h>
+
+#define CHECK_TRIALS 400
+#define BENCH_ROUNDS 20
+
+TFT_eSPI tft = TFT_eSPI();
+
+uint32_t randomState = 1;
+
+uint32_t nextRandom() {
+  randomState = randomState * 1664525UL + 1013904223UL;
+  return randomState >> 8;
+}
+
+uint32_t randomBelow(uint32_t n) {
+  return nextRandom() % n;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// The conversion as it was, the row loops are timed on their own further down
+////////////////////////////////////////////////////////////////////////////////////////
+
+// The colour cache was kept across rows
+uint32_t refLastColor;
+uint8_t refMsbColor, refLsbColor;
+
+void refRow8(uint16_t *lineBuf, const uint8_t *ptr, uint32_t len) {
+  uint8_t blue[] = {0, 11, 21, 31};
+  uint8_t *linePtr = (uint8_t *)lineBuf;
+
+  while (len--) {
+    uint32_t color = pgm_read_byte(ptr++);
+    if (color != refLastColor) {
+      refMsbColor = (color & 0x1C) >> 2 | (color & 0xC0) >> 3 | (color & 0xE0);
+      refLsbColor = (color & 0x1C) << 3 | blue[color & 0x03];
+      refLastColor = color;
+    }
+    *linePtr++ = refMsbColor;
+    *linePtr++ = refLsbColor;
+  }
+}
+
+void refRow4(uint16_t *lineBuf, const uint8_t *ptr, bool splitFirst, uint32_t len, const uint16_t *cmap) {
+  uint16_t *linePtr = lineBuf;
+  uint8_t colors;
+
+  if (splitFirst) {
+    colors = pgm_read_byte(ptr);
+    *linePtr++ = cmap[colors & 0x0F];
+    len--;
+    ptr++;
+  }
+  while (len--) {
+    colors = pgm_read_byte(ptr);
+    *linePtr++ = cmap[((colors & 0xF0) >> 4) & 0x0F];
+    if (len--) {
+      *linePtr++ = cmap[colors & 0x0F];
+    } else {
+      break;
+    }
+    ptr++;
+  }
+}
+
+void refRow1(uint16_t *lineBuf, const uint8_t *ptr, int32_t dx, int32_t dw, uint32_t fg, uint32_t bg) {
+  uint8_t *linePtr = (uint8_t *)lineBuf;
+  for (int32_t xp = dx; xp < dx + dw; xp++) {
+    uint16_t col = (pgm_read_byte(ptr + (xp >> 3)) & (0x80 >> (xp & 0x7)));
+    if (col) { *linePtr++ = fg >> 8; *linePtr++ = (uint8_t)fg; }
+    else     { *linePtr++ = bg >> 8; *linePtr++ = (uint8_t)bg; }
+  }
+}
+
+// Runs of 1 bits in a row, the way the transparent 1 bpp image was scanned
+uint32_t refRuns1(const uint8_t *data, int32_t dx, int32_t dw) {
+  uint32_t runs = 0;
+  uint16_t np = 0;
+  for (int32_t xp = dx; xp < dx + dw; xp++) {
+    if (data[(xp >> 3)] & (0x80 >> (xp & 0x7))) np++;
+    else if (np) { runs++; np = 0; }
+  }
+  if (np) runs++;
+  return runs;
+}
+
+// PI_CLIP without a viewport or datum
+#define REF_CLIP                                        \
+  if ((x >= tft.width()) || (y >= tft.height())) return; \
+  int32_t dx = 0;                                       \
+  int32_t dy = 0;                                       \
+  int32_t dw = w;                                       \
+  int32_t dh = h;                                       \
+  if (x < 0) { dx = -x; dw -= dx; x = 0; }              \
+  if (y < 0) { dy = -y; dh -= dy; y = 0; }              \
+  if ((x + dw) > tft.width()) dw = tft.width() - x;     \
+  if ((y + dh) > tft.height()) dh = tft.height() - y;   \
+  if (dw < 1 || dh < 1) return;
+
+void refPushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint8_t *data, bool bpp8, uint16_t *cmap) {
+  REF_CLIP;
+
+  tft.startWrite();
+  bool swap = tft.getSwapBytes();
+  tft.setWindow(x, y, x + dw - 1, y + dh - 1);
+
+  uint16_t lineBuf[dw];
+
+  if (bpp8) {
+    tft.setSwapBytes(false);
+    refLastColor = -1;
+    data += dx + dy * w;
+    while (dh--) {
+      refRow8(lineBuf, data, dw);
+      tft.pushPixels(lineBuf, dw);
+      data += w;
+    }
+  }
+  else if (cmap != nullptr) {
+    tft.setSwapBytes(true);
+    w = (w + 1) & 0xFFFE;
+    bool splitFirst = (dx & 0x01) != 0;
+    if (splitFirst) data += ((dx - 1 + dy * w) >> 1);
+    else data += ((dx + dy * w) >> 1);
+    while (dh--) {
+      refRow4(lineBuf, data, splitFirst, dw, cmap);
+      tft.pushPixels(lineBuf, dw);
+      data += (w >> 1);
+    }
+  }
+  else {
+    tft.setSwapBytes(false);
+    uint32_t ww = (w + 7) >> 3;
+    data += dy * ww;
+    while (dh--) {
+      refRow1(lineBuf, data, dx, dw, tft.bitmap_fg, tft.bitmap_bg);
+      tft.pushPixels(lineBuf, dw);
+      data += ww;
+    }
+  }
+
+  tft.setSwapBytes(swap);
+  tft.endWrite();
+}
+
+void refPushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint8_t *data, uint8_t transp, bool bpp8, uint16_t *cmap) {
+  REF_CLIP;
+
+  tft.startWrite();
+  bool swap = tft.getSwapBytes();
+  uint16_t lineBuf[dw];
+
+  if (bpp8) {
+    tft.setSwapBytes(false);
+    refLastColor = -1;
+    data += dx + dy * w;
+    while (dh--) {
+      uint8_t *ptr = data;
+      int32_t px = x, sx = x;
+      bool move = true;
+      uint16_t np = 0;
+      for (int32_t len = dw; len--; px++, ptr++) {
+        if (transp != *ptr) {
+          if (move) { move = false; sx = px; }
+          refRow8(lineBuf + np, ptr, 1);
+          np++;
+        }
+        else {
+          move = true;
+          if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushPixels(lineBuf, np); np = 0; }
+        }
+      }
+      if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushPixels(lineBuf, np); }
+      y++;
+      data += w;
+    }
+  }
+  else if (cmap != nullptr) {
+    tft.setSwapBytes(true);
+    w = (w + 1) & 0xFFFE;
+    data += (dy * w) >> 1;
+    while (dh--) {
+      int32_t px = x, sx = x;
+      bool move = true;
+      uint16_t np = 0;
+      for (int32_t xp = dx; xp < dx + dw; xp++, px++) {
+        uint8_t colors = data[xp >> 1];
+        uint8_t index = (xp & 1) ? colors & 0x0F : colors >> 4;
+        if (index != transp) {
+          if (move) { move = false; sx = px; }
+          lineBuf[np++] = cmap[index];
+        }
+        else {
+          move = true;
+          if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushPixels(lineBuf, np); np = 0; }
+        }
+      }
+      if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushPixels(lineBuf, np); }
+      data += (w >> 1);
+      y++;
+    }
+  }
+  else {
+    tft.setSwapBytes(false);
+    uint32_t ww = (w + 7) >> 3;
+    uint16_t np = 0;
+    // Not in the old code: it drew the top rows of an image clipped at the top
+    data += dy * ww;
+    for (int32_t yp = dy; yp < dy + dh; yp++) {
+      int32_t px = x, sx = x;
+      bool move = true;
+      for (int32_t xp = dx; xp < dx + dw; xp++) {
+        if (data[(xp >> 3)] & (0x80 >> (xp & 0x7))) {
+          if (move) { move = false; sx = px; }
+          np++;
+        }
+        else {
+          move = true;
+          if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushBlock(tft.bitmap_fg, np); np = 0; }
+        }
+        px++;
+      }
+      if (np) { tft.setWindow(sx, y, sx + np - 1, y); tft.pushBlock(tft.bitmap_fg, np); np = 0; }
+      y++;
+      data += ww;
+    }
+  }
+
+  tft.setSwapBytes(swap);
+  tft.endWrite();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Pixel exact check
+////////////////////////////////////////////////////////////////////////////////////////
+
+struct Trial {
+  int32_t x, y, w, h;
+  uint8_t bpp;         // 8, 4 or 1
+  bool isTransparent;
+  bool isConst;        // The const overload, for images in FLASH
+  uint8_t transp;
+};
+
+uint16_t *screenA;
+uint16_t *screenB;
+uint8_t *image;
+uint16_t cmap[16];
+
+uint32_t imageBytes(const Trial &t) {
+  if (t.bpp == 8) return t.w * t.h;
+  if (t.bpp == 4) return ((t.w + 1) >> 1) * t.h;
+  return ((t.w + 7) >> 3) * t.h;
+}
+
+Trial randomTrial() {
+  Trial t;
+  static const uint8_t formats[] = { 8, 4, 1 };
+  t.bpp = formats[randomBelow(3)];
+  t.isTransparent = randomBelow(2);
+  t.isConst = !t.isTransparent && randomBelow(2);
+  t.w = randomBelow(4) ? 1 + randomBelow(400) : 1 + randomBelow(9);
+  t.h = randomBelow(4) ? 1 + randomBelow(200) : 1 + randomBelow(5);
+  t.x = (int32_t)randomBelow(tft.width() + t.w) - t.w / 2 - 8;
+  t.y = (int32_t)randomBelow(tft.height() + t.h) - t.h / 2 - 8;
+
+  // Runs of a few colours, so the transparent one comes in runs too
+  uint8_t colours[4];
+  for (int i = 0; i < 4; i++) colours[i] = nextRandom();
+  t.transp = t.bpp == 4 ? (randomBelow(8) ? colours[0] & 0x0F : 16) : colours[0];
+  uint32_t bytes = imageBytes(t);
+  for (uint32_t i = 0; i < bytes; ) {
+    uint32_t run = 1 + randomBelow(randomBelow(2) ? 3 : 40);
+    uint8_t value = colours[randomBelow(4)];
+    if (t.bpp == 4) value = (value & 0x0F) * 0x11;
+    if (t.bpp == 4 && randomBelow(3) == 0) value = colours[randomBelow(4)];
+    if (t.bpp == 1 && randomBelow(2)) value = randomBelow(2) ? 0xFF : 0x00;
+    while (run-- && i < bytes) image[i++] = value;
+  }
+
+  // A new colour map now and then, the two pixel table must follow it
+  if (randomBelow(4) == 0) {
+    for (int i = 0; i < 16; i++) cmap[i] = nextRandom();
+  }
+  else if (randomBelow(4) == 0) {
+    cmap[randomBelow(16)] = nextRandom();
+  }
+  tft.setBitmapColor(nextRandom(), nextRandom());
+  tft.setSwapBytes(randomBelow(2));
+  return t;
+}
+
+void drawTrial(const Trial &t, bool isReference) {
+  bool bpp8 = t.bpp == 8;
+  uint16_t *map = t.bpp == 4 ? cmap : nullptr;
+  if (isReference) {
+    if (t.isTransparent) refPushImage(t.x, t.y, t.w, t.h, image, t.transp, bpp8, map);
+    else refPushImage(t.x, t.y, t.w, t.h, (const uint8_t *)image, bpp8, map);
+  }
+  else if (t.isTransparent) tft.pushImage(t.x, t.y, t.w, t.h, image, t.transp, bpp8, map);
+  else if (t.isConst) tft.pushImage(t.x, t.y, t.w, t.h, (const uint8_t *)image, bpp8, map);
+  else tft.pushImage(t.x, t.y, t.w, t.h, image, bpp8, map);
+}
+
+bool runCheck() {
+  uint32_t pixels = tft.width() * tft.height();
+  uint32_t failures = 0;
+
+  for (int trial = 0; trial < CHECK_TRIALS; trial++) {
+    Trial t = randomTrial();
+    bool swap = tft.getSwapBytes();
+    uint16_t background = nextRandom();
+
+    tft.fillScreen(background);
+#ifdef TFT_HOST_FRAMEBUFFER
+    tftHostResetStats();
+#endif
+    drawTrial(t, false);
+#ifdef TFT_HOST_FRAMEBUFFER
+    TFT_HostStats stats = tftHostStats();
+#endif
+    bool swapKept = tft.getSwapBytes() == swap;
+    tft.readRect(0, 0, tft.width(), tft.height(), screenA);
+
+    tft.fillScreen(background);
+#ifdef TFT_HOST_FRAMEBUFFER
+    tftHostResetStats();
+#endif
+    drawTrial(t, true);
+#ifdef TFT_HOST_FRAMEBUFFER
+    TFT_HostStats reference = tftHostStats();
+#endif
+    tft.readRect(0, 0, tft.width(), tft.height(), screenB);
+
+    uint32_t differ = 0;
+    for (uint32_t i = 0; i < pixels; i++) {
+      if (screenA[i] != screenB[i]) differ++;
+    }
+    bool ok = differ == 0 && swapKept;
+#ifdef TFT_HOST_FRAMEBUFFER
+    ok = ok && stats.windows == reference.windows && stats.pixels == reference.pixels
+      && stats.bytes == reference.bytes && stats.transactions == reference.transactions;
+#endif
+    if (!ok && failures++ < 10) {
+      Serial.printf("trial %d: %u bpp%s %dx%d at %d,%d: %u pixels differ%s\r\n", trial, t.bpp,
+        t.isTransparent ? " transparent" : "", (int)t.w, (int)t.h, (int)t.x, (int)t.y, (unsigned)differ,
+        swapKept ? "" : ", swap bytes not restored");
+    }
+  }
+
+  Serial.printf("Check: %d images, %u differ from the reference\r\n", CHECK_TRIALS, (unsigned)failures);
+  return failures == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+// Timing
+////////////////////////////////////////////////////////////////////////////////////////
+
+// Keeps the compiler from dropping the conversions
+volatile uint32_t sink;
+
+// A full screen image of the given depth, rows of random length runs. The 1 bpp one
+// is mostly solid like an icon or a glyph, unless isNoise is set.
+void fillBenchImage(int32_t w, int32_t h, uint8_t bpp, bool isNoise = false) {
+  Trial t = {0, 0, w, h, bpp, false, false, 0};
+  uint32_t bytes = imageBytes(t);
+  for (uint32_t i = 0; i < bytes; ) {
+    uint32_t run = 1 + randomBelow(24);
+    uint8_t value = nextRandom();
+    if (bpp == 1 && !isNoise && randomBelow(4)) value = randomBelow(2) ? 0xFF : 0x00;
+    while (run-- && i < bytes) image[i++] = value;
+  }
+}
+
+// Cycles per pixel to convert the image into a line buffer, row by row
+float convertCycles(int32_t w, int32_t h, uint8_t bpp, bool isReference) {
+  uint16_t lineBuf[TFT_PUSH_CHUNK > 320 ? TFT_PUSH_CHUNK : 320];
+  uint32_t ww = bpp == 8 ? w : bpp == 4 ? (w + 1) >> 1 : (w + 7) >> 3;
+  const uint32_t *pairs = bpp == 4 ? tftPairsFor(cmap, w * h) : nullptr;
+  uint32_t start = ESP.getCycleCount();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    const uint8_t *row = image;
+    refLastColor = -1;
+    for (int32_t y = 0; y < h; y++, row += ww) {
+      if (isReference) {
+        if (bpp == 8) refRow8(lineBuf, row, w);
+        else if (bpp == 4) refRow4(lineBuf, row, false, w, cmap);
+        else refRow1(lineBuf, row, 0, w, tft.bitmap_fg, tft.bitmap_bg);
+      }
+      else {
+        if (bpp == 8) tftExpand332(lineBuf, row, w);
+        else if (bpp == 4) tftExpand4(lineBuf, row, false, w, pairs, cmap);
+        else tftExpand1(lineBuf, row, 0, w, 0xFFFF, 0x0000);
+      }
+      sink += lineBuf[y % w];
+    }
+  }
+  return (float)(ESP.getCycleCount() - start) / BENCH_ROUNDS / (w * h);
+}
+
+// Cycles per pixel to find the runs of 1 bits, as the transparent 1 bpp image does
+float runCycles(int32_t w, int32_t h, bool isReference) {
+  uint32_t ww = (w + 7) >> 3;
+  uint32_t start = ESP.getCycleCount();
+  for (int round = 0; round < BENCH_ROUNDS; round++) {
+    const uint8_t *row = image;
+    for (int32_t y = 0; y < h; y++, row += ww) {
+      if (isReference) sink += refRuns1(row, 0, w);
+      else {
+        uint32_t runs = 0;
+        for (int32_t xp = 0; xp < w; ) {
+          bool isSet;
+          xp += tftBitRun(row, xp, w, &isSet);
+          runs += isSet;
+        }
+        sink += runs;
+      }
+    }
+  }
+  return (float)(ESP.getCycleCount() - start) / BENCH_ROUNDS / (w * h);
+}
+
+// Cycles per pixel to draw the image, bus included
+float drawCycles(int32_t w, int32_t h, uint8_t bpp, bool isTransparent, bool isReference) {
+  Trial t = {0, 0, w, h, bpp, isTransparent, false, (uint8_t)(bpp == 4 ? image[0] >> 4 : image[0])};
+  uint32_t start = ESP.getCycleCount();
+  for (int round = 0; round < BENCH_ROUNDS; round++) drawTrial(t, isReference);
+  return (float)(ESP.getCycleCount() - start) / BENCH_ROUNDS / (w * h);
+}
+
+void printRow(const char *name, float reference, float table) {
+  Serial.printf("%-22s %10.2f %10.2f %9.1fx\r\n", name, reference, table, reference / table);
+}
+
+void runBenchmark() {
+  int32_t w = tft.width();
+  int32_t h = tft.height();
+  tft.setSwapBytes(false);
+  tft.setBitmapColor(TFT_WHITE, TFT_BLACK);
+  for (int i = 0; i < 16; i++) cmap[i] = nextRandom();
+
+  Serial.printf("%dx%d image, %d rounds, cycles per pixel\r\n", (int)w, (int)h, BENCH_ROUNDS);
+  Serial.printf("%-22s %10s %10s %10s\r\n", "", "per pixel", "tables", "speedup");
+
+  static const uint8_t formats[] = { 8, 4, 1 };
+  char name[32];
+  for (uint8_t bpp : formats) {
+    fillBenchImage(w, h, bpp);
+    snprintf(name, sizeof(name), "%u bpp convert", bpp);
+    printRow(name, convertCycles(w, h, bpp, true), convertCycles(w, h, bpp, false));
+    if (bpp == 1) printRow("1 bpp find runs", runCycles(w, h, true), runCycles(w, h, false));
+    snprintf(name, sizeof(name), "%u bpp pushImage", bpp);
+    printRow(name, drawCycles(w, h, bpp, false, true), drawCycles(w, h, bpp, false, false));
+    snprintf(name, sizeof(name), "%u bpp transparent", bpp);
+    printRow(name, drawCycles(w, h, bpp, true, true), drawCycles(w, h, bpp, true, false));
+  }
+
+  // Random bits, the runs are short and the per pixel scan does better
+  fillBenchImage(w, h, 1, true);
+  printRow("1 bpp runs, noise", runCycles(w, h, true), runCycles(w, h, false));
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000); // Give the serial monitor time to attach.
+
+  tft.init();
+  tft.setRotation(1);
+
+  uint32_t pixels = tft.width() * tft.height();
+  screenA = (uint16_t *)malloc(pixels * 2);
+  screenB = (uint16_t *)malloc(pixels * 2);
+  image = (uint8_t *)malloc(400 * 200);
+  for (int i = 0; i < 16; i++) cmap[i] = nextRandom();
+
+  bool ok = runCheck();
+  runBenchmark();
+  Serial.printf("%s\r\n", ok ? "OK" : "FAILED");
+
+#ifdef NATIVE_HAL
+  exit(ok ? 0 : 1);
+#endif
+}
+
+void loop() {
+  delay(1000);
+}
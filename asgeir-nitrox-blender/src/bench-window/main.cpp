@@ -0,0 +1,124 @@
+/*
+ * Microbenchmark: SlidingWindow (lib/NitroxCore) against RunningAverage, doing what
+ * handleSensor() does every tick - add a value, then ask for min/max (since clear and
+ * in buffer), the average and the standard deviation.
+ *
+ * Runs on the board (env bench-window, results on the serial monitor) and on the host
+ * (env native-bench-window). Cycles come from ESP.getCycleCount(), on the host that is
+ * host time scaled to 240 MHz.
+ *
+ * Every answer of SlidingWindow is checked against a RunningAverage fed the same samples,
+ * the run fails (exit code 1 on the host) if one is off by more than BENCH_TOLERANCE.
+ */
+#include <Arduino.h>
+#include <RunningAverage.h>
+#include <SlidingWindow.h>
+
+#define BENCH_TICKS 2000
+#define BENCH_TOLERANCE 0.0001f // mV, float rounding of a 10 mV signal is far below this
+
+const uint16_t windowSizes[] = { 40, 128, 512, 1024, 4096 };
+
+uint32_t noiseState = 1;
+
+/// @brief Cell voltage around 10 mV with +-0.5 mV of noise, same sequence every run.
+float nextSample() {
+  noiseState = noiseState * 1664525UL + 1013904223UL;
+  return 10.0f + ((noiseState >> 8) & 0xFFFF) / 65535.0f - 0.5f;
+}
+
+// Keeps the compiler from dropping the queries.
+volatile float sink;
+
+template <typename Window>
+uint64_t runTicks(Window &window, float &maxDeviation, RunningAverage *reference) {
+  uint64_t cycles = 0;
+
+  for (int tick = 0; tick < BENCH_TICKS; tick++) {
+    float sample = nextSample();
+    if (reference) {
+      reference->addValue(sample);
+    }
+
+    uint32_t start = ESP.getCycleCount();
+    window.addValue(sample);
+    float average = window.getAverage();
+    float minValue = window.getMinInBuffer();
+    float maxValue = window.getMaxInBuffer();
+    float deviation = window.getStandardDeviation();
+    sink = window.getMin() + window.getMax() + average + minValue + maxValue + deviation;
+    cycles += ESP.getCycleCount() - start;
+
+    if (reference) {
+      float errors[] = {
+        average - reference->getAverage(),
+        minValue - reference->getMinInBuffer(),
+        maxValue - reference->getMaxInBuffer(),
+        deviation - reference->getStandardDeviation()
+      };
+      for (float error : errors) {
+        if (fabsf(error) > maxDeviation) {
+          maxDeviation = fabsf(error);
+        }
+      }
+    }
+  }
+
+  return cycles;
+}
+
+/// @return false if SlidingWindow differs from RunningAverage by more than BENCH_TOLERANCE.
+bool runBenchmark() {
+  bool ok = true;
+
+  Serial.printf("%d ticks per window size, cycles per tick (add + 6 queries)\r\n", BENCH_TICKS);
+  Serial.printf("%8s %16s %16s %10s %14s\r\n", "size", "RunningAverage", "SlidingWindow", "speedup", "max abs diff");
+
+  for (uint16_t size : windowSizes) {
+    RunningAverage runningAverage(size);
+    SlidingWindow slidingWindow(size);
+    RunningAverage reference(size);
+
+    // Start from full windows, like the firmware after the first couple of seconds.
+    for (int i = 0; i < size; i++) {
+      float sample = nextSample();
+      runningAverage.addValue(sample);
+      slidingWindow.addValue(sample);
+      reference.addValue(sample);
+    }
+
+    uint32_t state = noiseState;
+    float unused = 0;
+    uint64_t runningAverageCycles = runTicks(runningAverage, unused, NULL);
+
+    noiseState = state;
+    float maxDeviation = 0;
+    uint64_t slidingWindowCycles = runTicks(slidingWindow, maxDeviation, &reference);
+
+    float runningAveragePerTick = (float)runningAverageCycles / BENCH_TICKS;
+    float slidingWindowPerTick = (float)slidingWindowCycles / BENCH_TICKS;
+    Serial.printf("%8u %16.0f %16.0f %9.1fx %14.6f\r\n", (unsigned)size, runningAveragePerTick, slidingWindowPerTick,
+      runningAveragePerTick / slidingWindowPerTick, maxDeviation);
+    if (!(maxDeviation <= BENCH_TOLERANCE)) {
+      Serial.printf("%8u differs from RunningAverage by more than %g\r\n", (unsigned)size, BENCH_TOLERANCE);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(2000); // Give the serial monitor time to attach.
+
+  bool ok = runBenchmark();
+  Serial.printf("%s\r\n", ok ? "OK" : "FAILED");
+
+#ifdef NATIVE_HAL
+  exit(ok ? 0 : 1);
+#endif
+}
+
+void loop() {
+  delay(1000);
+}
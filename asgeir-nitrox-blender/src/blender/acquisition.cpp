@@ -0,0 +1,82 @@
+#include "acquisition.h"
+
+// The ISR has no argument, there is only one ADS1115 on the board.
+static OxygenAcquisition *instance = NULL;
+
+bool OxygenAcquisition::begin(Adafruit_ADS1115 &ads, uint8_t alertPin) {
+  this->ads = &ads;
+  instance = this;
+
+  // ALERT/RDY is open drain.
+  pinMode(alertPin, INPUT_PULLUP);
+
+  BaseType_t created = xTaskCreatePinnedToCore(taskLoop, "acquisition", 3072, this, ACQUISITION_TASK_PRIORITY, &task,
+    ACQUISITION_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Failed to start acquisition task");
+    return false;
+  }
+
+  attachInterrupt(digitalPinToInterrupt(alertPin), onReady, FALLING);
+  return true;
+}
+
+AcquisitionStats OxygenAcquisition::stats() const {
+  AcquisitionStats result;
+  result.samples = sampleCount.load(std::memory_order_relaxed);
+  result.dropped = droppedCount.load(std::memory_order_relaxed);
+  result.timeouts = timeoutCount.load(std::memory_order_relaxed);
+  return result;
+}
+
+void IRAM_ATTR OxygenAcquisition::onReady() {
+  if (instance == NULL || instance->task == NULL) {
+    return;
+  }
+
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(instance->task, &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+void OxygenAcquisition::taskLoop(void *parameter) {
+  OxygenAcquisition *self = (OxygenAcquisition *)parameter;
+
+  self->startConversion();
+
+  for (;;) {
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ACQUISITION_TIMEOUT_MS)) == 0) {
+      // Missed edge or a glitch on the bus, start over with the same cell.
+      self->timeoutCount.fetch_add(1, std::memory_order_relaxed);
+      self->startConversion();
+      continue;
+    }
+
+    self->onConversionReady();
+  }
+}
+
+void OxygenAcquisition::startConversion() {
+  uint16_t mux = cell == 0 ? ADS1X15_REG_CONFIG_MUX_DIFF_0_1 : ADS1X15_REG_CONFIG_MUX_DIFF_2_3;
+  ads->startADCReading(mux, false);
+}
+
+void OxygenAcquisition::onConversionReady() {
+  pending[cell] = ads->getLastConversionResults();
+
+  if (cell == 1) {
+    CellSample sample;
+    sample.atMs = millis();
+    sample.raw[0] = pending[0];
+    sample.raw[1] = pending[1];
+
+    if (samples.push(sample)) {
+      sampleCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  cell ^= 1;
+  startConversion();
+}
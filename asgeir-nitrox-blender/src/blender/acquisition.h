@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include <SpscRing.h>
+
+#include <atomic>
+
+#define ACQUISITION_RING_SIZE 64
+#define ACQUISITION_TIMEOUT_MS 100 // Restart the conversion if RDY does not show up within this time.
+#define ACQUISITION_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define ACQUISITION_TASK_CORE 0
+
+/// @brief One reading of both O2 cells in raw ADS1115 counts.
+struct CellSample {
+  uint32_t atMs;
+  int16_t raw[2];
+};
+
+struct AcquisitionStats {
+  uint32_t samples;
+  uint32_t dropped;  // Ring was full, loop() did not drain it in time.
+  uint32_t timeouts; // RDY did not arrive and the conversion was restarted.
+};
+
+/*
+ * Reads both O2 cells without ever blocking loop() on I2C.
+ *
+ * The ADS1115 runs single-shot conversions with ALERT/RDY configured as conversion
+ * ready output. The falling edge wakes a high priority task, which fetches the result,
+ * flips the MUX to the other differential pair and starts the next conversion. Once
+ * both pairs are read the sample goes into a lock-free ring that handleSensor() drains.
+ */
+class OxygenAcquisition {
+public:
+  bool begin(Adafruit_ADS1115 &ads, uint8_t alertPin);
+
+  /// @brief Take the oldest sample, only call from one consumer.
+  bool read(CellSample &sample) { return samples.pop(sample); }
+
+  AcquisitionStats stats() const;
+
+private:
+  static void IRAM_ATTR onReady();
+  static void taskLoop(void *parameter);
+
+  void startConversion();
+  void onConversionReady();
+
+  Adafruit_ADS1115 *ads = NULL;
+  TaskHandle_t task = NULL;
+
+  int cell = 0;
+  int16_t pending[2];
+
+  SpscRing<CellSample, ACQUISITION_RING_SIZE> samples;
+  std::atomic<uint32_t> sampleCount { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+  std::atomic<uint32_t> timeoutCount { 0 };
+};
@@ -0,0 +1,145 @@
+#include "ble.h"
+
+#include <Protocol.h>
+
+bool BleTransport::begin(TransportReceiveHook receiveHook) {
+  this->receiveHook = receiveHook;
+
+  BLEDevice::init(BLE_DEVICE_NAME);
+  BLEDevice::setMTU(BLE_LOCAL_MTU);
+  BLEServer *server = BLEDevice::createServer();
+  server->setCallbacks(this);
+
+  BLEService *service = server->createService(BLE_SERVICE_UUID);
+  telemetry = service->createCharacteristic(BLE_TELEMETRY_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+  subscription = new BLE2902();
+  telemetry->addDescriptor(subscription);
+  BLECharacteristic *command = service->createCharacteristic(BLE_COMMAND_UUID,
+    BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+  command->setCallbacks(this);
+  service->start();
+
+  BLEAdvertising *advertising = BLEDevice::getAdvertising();
+  advertising->addServiceUUID(BLE_SERVICE_UUID);
+  BLEDevice::startAdvertising();
+
+  BaseType_t created = xTaskCreatePinnedToCore(taskLoop, "ble", 4096, this, BLE_TASK_PRIORITY, &task,
+    BLE_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Failed to start BLE task");
+    return false;
+  }
+  return true;
+}
+
+bool BleTransport::isSubscribed() const {
+  return connected.load(std::memory_order_acquire) && subscription->getNotifications();
+}
+
+bool BleTransport::sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) {
+  if (task == NULL || !isSubscribed()) {
+    return false;
+  }
+
+  size_t capacity = min(mtu(), (size_t)BLE_MAX_NOTIFY);
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += frames[i].length;
+  }
+  // All or nothing, a batch cut short would leave half a frame in the stream.
+  size_t needed = (total + capacity - 1) / capacity;
+  if (notifications.capacity() - notifications.size() < needed) {
+    droppedCount.fetch_add(count, std::memory_order_relaxed);
+    return false;
+  }
+
+  Notification notification;
+  notification.length = 0;
+  for (size_t i = 0; i < count; i++) {
+    const uint8_t *data = frames[i].data;
+    size_t left = frames[i].length;
+    while (left > 0) {
+      size_t chunk = min(left, capacity - notification.length);
+      memcpy(notification.data + notification.length, data, chunk);
+      notification.length += chunk;
+      data += chunk;
+      left -= chunk;
+      if (notification.length == capacity) {
+        notifications.push(notification);
+        notification.length = 0;
+      }
+    }
+  }
+  if (notification.length > 0) {
+    notifications.push(notification);
+  }
+
+  frameCount.fetch_add(count, std::memory_order_relaxed);
+  xTaskNotifyGive(task);
+  return true;
+}
+
+void BleTransport::report(Print &out) const {
+  uint32_t notified = notifyCount.load(std::memory_order_relaxed);
+  uint32_t bytes = notifyBytes.load(std::memory_order_relaxed);
+  out.printf("BLE: %s, MTU %u, %u connections\r\n", isSubscribed() ? "subscribed" :
+    connected.load(std::memory_order_relaxed) ? "connected" : "advertising",
+    (unsigned)negotiatedMtu.load(std::memory_order_relaxed), (unsigned)connectionCount.load(std::memory_order_relaxed));
+  out.printf("BLE: %u frames in %u notifications (%u bytes each), %u dropped, %u received\r\n",
+    (unsigned)frameCount.load(std::memory_order_relaxed), (unsigned)notified, (unsigned)(notified ? bytes / notified : 0),
+    (unsigned)droppedCount.load(std::memory_order_relaxed), (unsigned)receivedCount.load(std::memory_order_relaxed));
+}
+
+void BleTransport::onConnect(BLEServer *server, esp_ble_gatts_cb_param_t *param) {
+  negotiatedMtu.store(BLE_DEFAULT_MTU, std::memory_order_relaxed);
+  connected.store(true, std::memory_order_release);
+  connectionCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void BleTransport::onDisconnect(BLEServer *server) {
+  connected.store(false, std::memory_order_release);
+  // Advertising stops with a connection, one central at a time.
+  BLEDevice::startAdvertising();
+}
+
+void BleTransport::onMtuChanged(BLEServer *server, esp_ble_gatts_cb_param_t *param) {
+  negotiatedMtu.store(min(param->mtu.mtu, (uint16_t)BLE_LOCAL_MTU), std::memory_order_relaxed);
+}
+
+void BleTransport::onWrite(BLECharacteristic *characteristic) {
+  std::string value = characteristic->getValue();
+  const uint8_t *data = (const uint8_t *)value.data();
+  size_t left = value.size();
+
+  // A central may write several frames at once.
+  size_t length;
+  while ((length = frameLength(data, left)) > 0 && length <= left) {
+    receivedCount.fetch_add(1, std::memory_order_relaxed);
+    if (receiveHook != NULL) {
+      receiveHook(data, length);
+    }
+    data += length;
+    left -= length;
+  }
+}
+
+void BleTransport::taskLoop(void *parameter) {
+  BleTransport *self = (BleTransport *)parameter;
+  Notification notification;
+
+  for (;;) {
+    if (!self->notifications.pop(notification)) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    if (!self->connected.load(std::memory_order_acquire)) {
+      // Left over from a central that went away.
+      continue;
+    }
+
+    self->telemetry->setValue(notification.data, notification.length);
+    self->telemetry->notify();
+    self->notifyCount.fetch_add(1, std::memory_order_relaxed);
+    self->notifyBytes.fetch_add(notification.length, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLE2902.h>
+#include <SpscRing.h>
+
+#include <atomic>
+
+#include "transport.h"
+
+#define BLE_DEVICE_NAME "Nitrox blender"
+#define BLE_SERVICE_UUID "6e580001-5d1a-4b3c-9a4f-2e0c6a3b7d10"
+#define BLE_TELEMETRY_UUID "6e580002-5d1a-4b3c-9a4f-2e0c6a3b7d10"  // Notify, the frames
+#define BLE_COMMAND_UUID "6e580003-5d1a-4b3c-9a4f-2e0c6a3b7d10"    // Write, frames to the blender
+#define BLE_LOCAL_MTU 247             // 244 bytes of notification fill one LE data length extension packet
+#define BLE_DEFAULT_MTU 23            // Until the central negotiates a larger one
+#define BLE_ATT_HEADER 3              // Opcode and handle in front of every notification
+#define BLE_MAX_NOTIFY (BLE_LOCAL_MTU - BLE_ATT_HEADER)
+#define BLE_RING_SIZE 16              // Notifications waiting for the stack
+#define BLE_TASK_PRIORITY 2           // Like the radio task, it mostly waits on the stack
+#define BLE_TASK_CORE 1
+
+/*
+ * GATT notifications to one central, a phone or a PC.
+ *
+ * The notifications of the telemetry characteristic form a byte stream of protocol
+ * frames: a batch is packed back to back up to the negotiated MTU, and a frame that
+ * does not fit continues in the next notification. BLE retransmits on the link layer,
+ * so nothing gets lost while connected, and a central that subscribes mid-stream finds
+ * the next frame by its magic and CRC. Frames written to the command characteristic
+ * (a stream request) go to the receive hook.
+ *
+ * notify() waits for the stack, so a task on the UI core sends the notifications that
+ * sendBatch() queued. Nothing is sent while no central is subscribed.
+ */
+class BleTransport : public Transport, BLEServerCallbacks, BLECharacteristicCallbacks {
+public:
+  const char *name() const override { return "BLE"; }
+  bool begin(TransportReceiveHook receiveHook) override;
+  size_t mtu() const override { return negotiatedMtu.load(std::memory_order_relaxed) - BLE_ATT_HEADER; }
+  bool sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) override;
+  void report(Print &out) const override;
+
+  bool isSubscribed() const;
+
+private:
+  struct Notification {
+    uint16_t length;
+    uint8_t data[BLE_MAX_NOTIFY];
+  };
+
+  // BLE task
+  void onConnect(BLEServer *server, esp_ble_gatts_cb_param_t *param) override;
+  void onDisconnect(BLEServer *server) override;
+  void onMtuChanged(BLEServer *server, esp_ble_gatts_cb_param_t *param) override;
+  void onWrite(BLECharacteristic *characteristic) override;
+
+  static void taskLoop(void *parameter);
+
+  TransportReceiveHook receiveHook = NULL;
+  TaskHandle_t task = NULL;
+  BLECharacteristic *telemetry = NULL;
+  BLE2902 *subscription = NULL;
+
+  SpscRing<Notification, BLE_RING_SIZE> notifications;
+  std::atomic<bool> connected { false };
+  std::atomic<uint16_t> negotiatedMtu { BLE_DEFAULT_MTU };
+
+  std::atomic<uint32_t> connectionCount { 0 };
+  std::atomic<uint32_t> frameCount { 0 };
+  std::atomic<uint32_t> notifyCount { 0 };
+  std::atomic<uint32_t> notifyBytes { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+  std::atomic<uint32_t> receivedCount { 0 };
+};
@@ -0,0 +1,50 @@
+#include "calibration.h"
+
+void Calibration::start(unsigned long nowMs) {
+  status.state = CALIBRATION_SETTLING;
+  status.progressPercent = 0;
+  startedAtMs = nowMs;
+  sampleCount = 0;
+  sumMv[0] = 0;
+  sumMv[1] = 0;
+}
+
+void Calibration::addSample(float cell1Mv, float cell2Mv) {
+  if (status.state != CALIBRATION_COLLECTING || sampleCount >= CALIBRATION_SAMPLES) {
+    return;
+  }
+
+  sumMv[0] += cell1Mv;
+  sumMv[1] += cell2Mv;
+  sampleCount++;
+  status.progressPercent = sampleCount * 100 / CALIBRATION_SAMPLES;
+}
+
+bool Calibration::update(unsigned long nowMs, CellCalibration result[2]) {
+  switch (status.state) {
+    case CALIBRATION_SETTLING:
+      if (nowMs - startedAtMs >= CALIBRATION_SETTLE_MS) {
+        status.state = CALIBRATION_COLLECTING;
+      }
+      return false;
+
+    case CALIBRATION_COLLECTING:
+      if (sampleCount >= CALIBRATION_SAMPLES) {
+        for (int i = 0; i < 2; i++) {
+          result[i].value = abs(sumMv[i] / sampleCount);
+          result[i].calibratedAtMs = nowMs;
+        }
+        status.state = CALIBRATION_DONE;
+        status.completedCount++;
+        return true;
+      }
+
+      if (nowMs - startedAtMs >= CALIBRATION_TIMEOUT_MS) {
+        status.state = CALIBRATION_FAILED;
+      }
+      return false;
+
+    default:
+      return false;
+  }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "status.h"
+
+#define CALIBRATION_SETTLE_MS 3000   // Let air flush the sensor line before sampling.
+#define CALIBRATION_SAMPLES 128      // About 4 s of samples from the acquisition task.
+#define CALIBRATION_TIMEOUT_MS 10000 // Give up if the samples stop coming.
+
+enum CalibrationState {
+  CALIBRATION_IDLE,
+  CALIBRATION_SETTLING,
+  CALIBRATION_COLLECTING,
+  CALIBRATION_DONE,
+  CALIBRATION_FAILED
+};
+
+struct CalibrationStatus {
+  CalibrationState state;
+  uint8_t progressPercent;
+  uint32_t completedCount; // Goes up every time a new calibration is committed.
+};
+
+/*
+ * Calibration in normal air as a state machine, advanced by the control task on every
+ * cycle instead of blocking for seconds. It waits CALIBRATION_SETTLE_MS, averages the
+ * next CALIBRATION_SAMPLES samples from the acquisition stream and then hands out both
+ * cell calibrations at once, so a half done calibration is never used.
+ */
+class Calibration {
+public:
+  void start(unsigned long nowMs);
+
+  /// @brief Feed one sample of both cells, ignored unless collecting.
+  void addSample(float cell1Mv, float cell2Mv);
+
+  /// @brief Advance the state machine.
+  /// @return true if a new calibration was written to result.
+  bool update(unsigned long nowMs, CellCalibration result[2]);
+
+  /// @brief Calibrating, the solenoid has to stay closed.
+  bool isActive() const { return status.state == CALIBRATION_SETTLING || status.state == CALIBRATION_COLLECTING; }
+
+  CalibrationStatus getStatus() const { return status; }
+
+private:
+  CalibrationStatus status = { CALIBRATION_IDLE, 0, 0 };
+  unsigned long startedAtMs = 0;
+  uint32_t sampleCount = 0;
+  double sumMv[2] = { 0, 0 };
+};
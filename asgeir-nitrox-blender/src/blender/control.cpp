@@ -0,0 +1,310 @@
+#include "control.h"
+
+#include <SlidingWindow.h>
+
+#include "pin_config.h"
+
+Seqlock<ControlSnapshot> controlSnapshot;
+Seqlock<ControlSettings> controlSettings;
+OxygenAcquisition acquisition;
+TraceRecorder traceRecorder;
+DataLog dataLog;
+SampleStream sampleStream;
+
+// Only touched by the control task.
+static LoopProfiler controlProfiler;
+static Scheduler controlScheduler;
+static SystemStatus systemState;
+static SensorReading sensorValue[2];
+static CellCalibration cellCalibration[2];
+static SolenoidStatus solenoid;
+static Calibration calibration;
+static uint32_t lastCalibrationRequest = 0;
+static ModelIdentifier identifier;
+static uint32_t lastIdentificationRequest = 0;
+static uint32_t lastIdentifiedCount = 0;
+static BangBangController bangBangController;
+static SmithPiController smithPiController;
+static SolenoidController *controllers[CONTROLLER_COUNT] = { &bangBangController, &smithPiController };
+static uint8_t controllerMode = CONTROLLER_DEFAULT;
+static SlidingWindow cellReadings[2] = { SlidingWindow(RA_SIZE), SlidingWindow(RA_SIZE) };
+static float gain = 0.0625F;
+static uint16_t potentiometerRaw = 0;
+
+static std::atomic<bool> profilerResetRequested(false);
+
+// Static, a copy on the 4 KB control task stack would not fit. Written by the control task
+// when statsRequest moves ahead of statsCopied, read by the UI task once they match again.
+static ControlStats statsCopy;
+static std::atomic<uint32_t> statsRequest(0);
+static std::atomic<uint32_t> statsCopied(0);
+
+static void controlTask(void *parameter);
+static void sensorJob();
+static void controlJob();
+static void applySettings();
+static void handleSensor();
+static void handlePotentiometer();
+static void handleSolenoid();
+static void handleCalibration();
+static void publishSnapshot();
+static int readOxygenCellVoltage();
+
+bool startControlTask(Adafruit_ADS1115 &ads, uint8_t alertPin, const CellCalibration restoredCalibration[2]) {
+  for (int i = 0; i < 2; i++) {
+    cellCalibration[i] = restoredCalibration[i];
+  }
+  lastCalibrationRequest = controlSettings.read().calibrationRequest;
+  lastIdentificationRequest = controlSettings.read().identificationRequest;
+  smithPiController.configure(loadSmithPiConfig());
+  publishSnapshot();
+
+  if (!acquisition.begin(ads, alertPin)) {
+    return false;
+  }
+
+  controlProfiler.reset();
+
+  BaseType_t created = xTaskCreatePinnedToCore(controlTask, "control", 4096, NULL, CONTROL_TASK_PRIORITY, NULL,
+    CONTROL_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Failed to start control task");
+    return false;
+  }
+  return true;
+}
+
+void requestControlProfilerReset() {
+  profilerResetRequested.store(true);
+}
+
+const ControlStats *copyControlStats() {
+  uint32_t request = statsRequest.load() + 1;
+  statsRequest.store(request);
+
+  unsigned long startedMs = millis();
+  while (statsCopied.load(std::memory_order_acquire) != request) {
+    if (millis() - startedMs > CONTROL_STATS_TIMEOUT_MS) {
+      return NULL;
+    }
+    delay(1);
+  }
+  return &statsCopy;
+}
+
+static void controlTask(void *parameter) {
+  // Read the sensor first when both are due, so the solenoid acts on the fresh reading.
+  controlScheduler.addJob("sensor", sensorJob, SENSOR_PERIOD_MS * 1000UL, 3);
+  controlScheduler.addJob("control", controlJob, CONTROL_PERIOD_MS * 1000UL, 2);
+
+  for (;;) {
+    if (profilerResetRequested.exchange(false)) {
+      controlProfiler.reset();
+      controlScheduler.resetStats();
+    }
+    uint32_t request = statsRequest.load();
+    if (statsCopied.load() != request) {
+      statsCopy.profiler = controlProfiler;
+      statsCopy.scheduler = controlScheduler;
+      statsCopied.store(request, std::memory_order_release);
+    }
+
+    controlScheduler.runPending();
+    controlScheduler.sleepUntilNextRelease();
+  }
+}
+
+static void sensorJob() {
+  PROFILE(controlProfiler, PHASE_SENSOR, handleSensor());
+  handleCalibration();
+  dataLog.recordSample(millis(), sensorValue[0].avgMv, sensorValue[1].avgMv, systemState.o2);
+}
+
+static void controlJob() {
+  applySettings();
+
+  PROFILE(controlProfiler, PHASE_POTENTIOMETER, handlePotentiometer());
+
+  controlProfiler.recordInterval(PHASE_SOLENOID_INTERVAL);
+  PROFILE(controlProfiler, PHASE_SOLENOID, handleSolenoid());
+
+  publishSnapshot();
+}
+
+static void applySettings() {
+  ControlSettings settings = controlSettings.read();
+
+  for (int i = 0; i < 2; i++) {
+    sensorValue[i].isDisabledByMenu = settings.isCellDisabled[i];
+  }
+
+  if (settings.controllerMode != controllerMode && settings.controllerMode < CONTROLLER_COUNT) {
+    controllerMode = settings.controllerMode;
+    controllers[controllerMode]->reset(millis());
+  }
+
+  if (settings.isTracing && !traceRecorder.isRecording()) {
+    TraceHeader header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.millivoltsPerCount = gain;
+    header.calibrationMv[0] = cellCalibration[0].value;
+    header.calibrationMv[1] = cellCalibration[1].value;
+    header.controllerMode = controllerMode;
+    traceRecorder.start(header);
+  } else if (!settings.isTracing && traceRecorder.isRecording()) {
+    traceRecorder.stop();
+  }
+
+  if (settings.calibrationRequest != lastCalibrationRequest) {
+    lastCalibrationRequest = settings.calibrationRequest;
+    calibration.start(millis());
+  }
+
+  if (settings.identificationRequest != lastIdentificationRequest) {
+    lastIdentificationRequest = settings.identificationRequest;
+    identifier.start(millis());
+  }
+}
+
+static void publishSnapshot() {
+  ControlSnapshot snapshot;
+  snapshot.systemState = systemState;
+  for (int i = 0; i < 2; i++) {
+    snapshot.sensorValue[i] = sensorValue[i];
+    snapshot.cellCalibration[i] = cellCalibration[i];
+  }
+  snapshot.solenoid = solenoid;
+  snapshot.calibration = calibration.getStatus();
+  snapshot.identification = identifier.getStatus();
+
+  controlSnapshot.write(snapshot);
+}
+
+/*
+ * Update the readings from the latest samples, runs every SENSOR_PERIOD_MS
+*/
+static void handleSensor() {
+  readOxygenCellVoltage();
+
+  float o2Percent = 0;
+  int validReadingsCount = 0;
+
+  for (int cellIndex = 0; cellIndex < 2; cellIndex++) {
+    bool isCalibrated = cellCalibration[cellIndex].isValid();
+
+    sensorValue[cellIndex].avgMv = abs(cellReadings[cellIndex].getAverage());
+    sensorValue[cellIndex].o2Percent = (sensorValue[cellIndex].avgMv / cellCalibration[cellIndex].value) * 20.9;
+    if (sensorValue[cellIndex].o2Percent > 99.9) {
+      sensorValue[cellIndex].o2Percent = 99.9;
+    }
+
+    bool isReadingError = !isCalibrated || !sensorValue[cellIndex].isValid();
+
+    sensorValue[cellIndex].sensorWarning = isReadingError;
+
+    if (!isReadingError && !sensorValue[cellIndex].isDisabledByMenu) {
+      o2Percent += sensorValue[cellIndex].o2Percent;
+      validReadingsCount++;
+    }
+
+  }
+
+  // Calculate combined percentage
+  systemState.isReadingError = validReadingsCount == 0;
+  if (validReadingsCount > 0) {
+    systemState.o2 = o2Percent / validReadingsCount;
+  } else {
+    systemState.o2 = -1;
+  }
+}
+
+static void handlePotentiometer() {
+  int data = analogRead(PIN_POTENTIOMETER);
+  potentiometerRaw = data;
+  
+  solenoid.maxO2Percent = map(data, 0, 4095, 0, 40);  
+}
+
+/*
+ * Advance a running calibration. Both cells switch to the new calibration in the same
+ * cycle, so the snapshot never shows one old and one new value.
+*/
+static void handleCalibration() {
+  CellCalibration result[2];
+
+  if (calibration.update(millis(), result)) {
+    for (int i = 0; i < 2; i++) {
+      cellCalibration[i] = result[i];
+    }
+  }
+}
+
+static void handleSolenoid() {
+  SolenoidController *controller = controllers[controllerMode];
+  bool shouldOpen = false;
+
+  if (calibration.isActive()) {
+    // The cells have to see normal air while calibrating.
+    identifier.cancel();
+    controller->reset(millis());
+  } else if (identifier.isActive()) {
+    shouldOpen = identifier.update(systemState.o2, solenoid.maxO2Percent, systemState.isReadingError, millis());
+    controller->reset(millis());
+
+    IdentificationStatus identification = identifier.getStatus();
+    if (identification.completedCount != lastIdentifiedCount) {
+      lastIdentifiedCount = identification.completedCount;
+      smithPiController.configure(identification.result);
+    }
+  } else {
+    ControllerInput input;
+    input.o2Percent = systemState.o2;
+    input.targetPercent = solenoid.maxO2Percent;
+    input.isReadingError = systemState.isReadingError;
+    input.nowMs = millis();
+
+    shouldOpen = controller->update(input, solenoid.isOpen);
+  }
+
+  if (shouldOpen) {
+    solenoid.solenoidClosedAt = millis();
+  }
+
+  if (shouldOpen != solenoid.isOpen) {
+    digitalWrite(PIN_SOLENOID_SIGNAL, shouldOpen ? HIGH : LOW);
+    solenoid.isOpen = shouldOpen;
+    dataLog.recordValve(millis(), shouldOpen);
+  }
+}
+
+/*
+ * Move the samples collected by the acquisition task into the running averages, a
+ * running calibration and the trace and sample stream when they are on.
+*/
+static int readOxygenCellVoltage() {
+  CellSample sample;
+  int count = 0;
+
+  while (acquisition.read(sample)) {
+    float cell1Mv = sample.raw[0] * gain;
+    float cell2Mv = sample.raw[1] * gain;
+
+    cellReadings[0].addValue(cell1Mv);
+    cellReadings[1].addValue(cell2Mv);
+    calibration.addSample(cell1Mv, cell2Mv);
+    sampleStream.record(sample.atMs, cell1Mv, cell2Mv);
+
+    TraceRecord record;
+    record.atMs = sample.atMs;
+    record.raw[0] = sample.raw[0];
+    record.raw[1] = sample.raw[1];
+    record.potentiometer = potentiometerRaw;
+    traceRecorder.record(record);
+
+    count++;
+  }
+
+  return count;
+}
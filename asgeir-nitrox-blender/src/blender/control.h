@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include <Seqlock.h>
+
+#include "status.h"
+#include "profiler.h"
+#include "acquisition.h"
+#include "calibration.h"
+#include "scheduler.h"
+#include "controller.h"
+#include "trace.h"
+#include "datalog.h"
+#include "stream.h"
+
+// The O2 is averaged over RA_WINDOW_MS, the time 40 samples took when loop() still read
+// the ADS1115 itself (~12 pairs a second). The acquisition task reads a pair of cells
+// every two conversions at 64 SPS.
+#define RA_WINDOW_MS 3300
+#define ACQUISITION_PAIRS_PER_SECOND 32
+#define RA_SIZE (RA_WINDOW_MS * ACQUISITION_PAIRS_PER_SECOND / 1000)
+
+#define CONTROL_PERIOD_MS 10 // Solenoid decisions
+#define SENSOR_PERIOD_MS 50  // Averaging the cells and O2 computation
+#define CONTROL_TASK_PRIORITY (configMAX_PRIORITIES - 3) // Just below the acquisition task.
+#define CONTROL_TASK_CORE 0
+#define CONTROL_STATS_TIMEOUT_MS 100 // Longest wait for the control task to copy its stats.
+
+/// @brief Everything the control task publishes for the UI and the radio.
+struct ControlSnapshot {
+  SystemStatus systemState;
+  SensorReading sensorValue[2];
+  CellCalibration cellCalibration[2];
+  SolenoidStatus solenoid;
+  CalibrationStatus calibration;
+  IdentificationStatus identification;
+};
+
+/// @brief Set by the UI (menu, calibrate button) and picked up by the control task on its next cycle.
+struct ControlSettings {
+  bool isCellDisabled[2];
+  uint32_t calibrationRequest; // Bump to start a calibration.
+  uint32_t identificationRequest; // Bump to identify the stick model, see ModelIdentifier.
+  uint8_t controllerMode;      // CONTROLLER_BANG_BANG or CONTROLLER_SMITH_PI
+  bool isTracing;              // Record the raw sensor input, see trace.h
+};
+
+/// @brief Profiler and scheduler of the control task as it copied them, see copyControlStats().
+struct ControlStats {
+  LoopProfiler profiler;
+  Scheduler scheduler;
+};
+
+/*
+ * Sensor reading, O2 computation, calibration and the solenoid run in their own task on
+ * core 0, so drawing and ESP-NOW on core 1 can never hold the solenoid open.
+ * State crosses between the cores through the two seqlocks only.
+ */
+extern Seqlock<ControlSnapshot> controlSnapshot;
+extern Seqlock<ControlSettings> controlSettings;
+extern OxygenAcquisition acquisition;
+extern TraceRecorder traceRecorder;
+extern DataLog dataLog;
+extern SampleStream sampleStream;
+
+/// @param calibration restored from NVS, the control task owns the calibration from here on.
+bool startControlTask(Adafruit_ADS1115 &ads, uint8_t alertPin, const CellCalibration calibration[2]);
+
+/// @brief Ask the control task to reset its profiler and scheduler stats, it owns them.
+void requestControlProfilerReset();
+
+/// @brief Have the control task copy its profiler and scheduler stats between two jobs and wait for it.
+/// The 64-bit totals would tear when read from the other core while the control task updates them.
+/// @return the copy, valid until the next call, NULL if the control task did not answer in time.
+const ControlStats *copyControlStats();
@@ -0,0 +1,306 @@
+#include "controller.h"
+
+#include <Preferences.h>
+
+bool BangBangController::update(const ControllerInput &input, bool isOpen) {
+  if (!input.isReadingError && input.o2Percent < input.targetPercent) {
+    lastBelowTargetMs = input.nowMs;
+    return true;
+  }
+
+  // Keep the valve open a little longer, so it does not chatter around the set-point.
+  return isOpen && (input.nowMs - lastBelowTargetMs) <= SOLENOID_CLOSE_DELAY;
+}
+
+SmithPiConfig smithPiConfigFor(float gainPercent, float tauMs, float delayMs) {
+  SmithPiConfig config;
+  config.kp = tauMs / (gainPercent * PI_LAMBDA_MS);
+  config.ki = config.kp * 1000.0f / (tauMs + delayMs);
+  config.modelGainPercent = gainPercent;
+  config.modelTauMs = tauMs;
+  config.modelDelayMs = delayMs;
+  return config;
+}
+
+SmithPiController::SmithPiController() {
+  SmithPiConfig defaults = { PI_KP, PI_KI, MODEL_GAIN_PERCENT, MODEL_TAU_MS, MODEL_DELAY_MS };
+  configure(defaults);
+}
+
+void SmithPiController::configure(const SmithPiConfig &config) {
+  this->config = config;
+
+  delaySteps = (int)(config.modelDelayMs / MODEL_STEP_MS + 0.5f);
+  if (delaySteps < 1) {
+    delaySteps = 1;
+  } else if (delaySteps > MODEL_DELAY_STEPS) {
+    delaySteps = MODEL_DELAY_STEPS;
+  }
+  reset(millis());
+}
+
+void SmithPiController::reset(unsigned long nowMs) {
+  integral = 0;
+  duty = 0;
+  model = 0;
+  for (int i = 0; i < MODEL_DELAY_STEPS; i++) {
+    modelHistory[i] = 0;
+  }
+  historyIndex = 0;
+  lastModelStepMs = nowMs;
+  lastUpdateMs = nowMs;
+  windowStartedMs = nowMs;
+  onTimeMs = 0;
+}
+
+/*
+ * Advance the first-order model of the stick in MODEL_STEP_MS steps and remember its
+ * output, the oldest entry is the model output one transport delay ago.
+*/
+void SmithPiController::stepModel(unsigned long nowMs, bool isOpen) {
+  float alpha = 1 - expf(-(float)MODEL_STEP_MS / config.modelTauMs);
+  float input = isOpen ? config.modelGainPercent : 0;
+
+  while (nowMs - lastModelStepMs >= MODEL_STEP_MS) {
+    lastModelStepMs += MODEL_STEP_MS;
+    model += (input - model) * alpha;
+
+    modelHistory[historyIndex] = model;
+    historyIndex = (historyIndex + 1) % delaySteps;
+  }
+}
+
+bool SmithPiController::update(const ControllerInput &input, bool isOpen) {
+  stepModel(input.nowMs, isOpen);
+
+  if (input.isReadingError) {
+    reset(input.nowMs);
+    return false;
+  }
+
+  float delayedModel = modelHistory[historyIndex];
+  predictedPercent = input.o2Percent + model - delayedModel;
+
+  // The prediction may still ask for oxygen when the cells already see enough, a wrong
+  // model must not be able to keep the valve open past the target or the absolute limit.
+  bool isOverTarget = input.o2Percent >= input.targetPercent || input.o2Percent > O2_LIMIT_PERCENT;
+
+  // Aim a little below the target so the ripple of the pulses does not reach the hard close.
+  float error = input.targetPercent - PI_TARGET_MARGIN_PERCENT - predictedPercent;
+  float dt = (input.nowMs - lastUpdateMs) / 1000.0f;
+  lastUpdateMs = input.nowMs;
+
+  float candidate = integral + config.ki * error * dt;
+  float output = config.kp * error + candidate;
+
+  // Anti-windup: only integrate while the output is not pushed further into saturation,
+  // or held closed by the measurement.
+  if ((output < 1 || error < 0) && (output > 0 || error > 0) && !(isOverTarget && error > 0)) {
+    integral = candidate;
+  }
+  // While held closed the integral is tracked back towards what the valve does, otherwise it
+  // keeps the output it had and the valve opens again as soon as the reading drops.
+  if (isOverTarget) {
+    float overridden = config.kp * error + integral;
+    if (overridden > 0) {
+      integral -= overridden * dt * 1000.0f / config.modelTauMs;
+    }
+  }
+  duty = constrain(config.kp * error + integral, 0.0f, 1.0f);
+
+  // Time-proportioning, the duty of the next window is fixed when it starts.
+  if (input.nowMs - windowStartedMs >= DUTY_WINDOW_MS) {
+    windowStartedMs = input.nowMs;
+    onTimeMs = (unsigned long)(duty * DUTY_WINDOW_MS);
+    if (onTimeMs < DUTY_MIN_PULSE_MS) {
+      onTimeMs = 0;
+    } else if (DUTY_WINDOW_MS - onTimeMs < DUTY_MIN_PULSE_MS) {
+      onTimeMs = DUTY_WINDOW_MS;
+    }
+  }
+
+  // The hard close overrides the window that is running.
+  if (isOverTarget) {
+    onTimeMs = 0;
+    return false;
+  }
+  return input.nowMs - windowStartedMs < onTimeMs;
+}
+
+SmithPiConfig loadSmithPiConfig() {
+  Preferences preferences;
+  preferences.begin("controller", true);
+
+  SmithPiConfig config;
+  config.kp = preferences.getFloat("kp", PI_KP);
+  config.ki = preferences.getFloat("ki", PI_KI);
+  config.modelGainPercent = preferences.getFloat("gain", MODEL_GAIN_PERCENT);
+  config.modelTauMs = preferences.getFloat("tau", MODEL_TAU_MS);
+  config.modelDelayMs = preferences.getFloat("delay", MODEL_DELAY_MS);
+
+  preferences.end();
+  return config;
+}
+
+bool hasSmithPiModel() {
+  Preferences preferences;
+  preferences.begin("controller", true);
+  bool hasModel = preferences.isKey("gain");
+  preferences.end();
+  return hasModel;
+}
+
+void persistSmithPiConfig(const SmithPiConfig &config) {
+  Preferences preferences;
+  preferences.begin("controller", false);
+  preferences.putFloat("kp", config.kp);
+  preferences.putFloat("ki", config.ki);
+  preferences.putFloat("gain", config.modelGainPercent);
+  preferences.putFloat("tau", config.modelTauMs);
+  preferences.putFloat("delay", config.modelDelayMs);
+  preferences.end();
+}
+
+void ModelIdentifier::start(unsigned long nowMs) {
+  status.state = IDENTIFICATION_BASELINE;
+  startedAtMs = nowMs;
+  phaseStartedMs = nowMs;
+  lastUpdateMs = nowMs;
+  baselineCount = 0;
+}
+
+void ModelIdentifier::fail() {
+  status.state = IDENTIFICATION_FAILED;
+}
+
+void ModelIdentifier::cancel() {
+  if (isActive()) {
+    fail();
+  }
+}
+
+/*
+ * Turn the moments of the response into the model, see the class comment.
+*/
+void ModelIdentifier::finish() {
+  if (peak < IDENT_MIN_PEAK_PERCENT || delayMs < 0 || area <= 0 || openMs == 0) {
+    fail();
+    return;
+  }
+
+  float gainPercent = area / openMs;
+  float centroidMs = moment / area - openMs / 2.0f;
+  float tauMs = centroidMs - delayMs;
+  if (tauMs < MODEL_STEP_MS) {
+    tauMs = MODEL_STEP_MS;
+  }
+
+  status.result = smithPiConfigFor(gainPercent, tauMs, delayMs);
+  status.state = IDENTIFICATION_DONE;
+  status.completedCount++;
+}
+
+bool ModelIdentifier::update(float o2Percent, float targetPercent, bool isReadingError, unsigned long nowMs) {
+  if (!isActive()) {
+    return false;
+  }
+  if (isReadingError || nowMs - startedAtMs >= IDENT_TIMEOUT_MS) {
+    fail();
+    return false;
+  }
+
+  unsigned long dt = nowMs - lastUpdateMs;
+  lastUpdateMs = nowMs;
+
+  switch (status.state) {
+    case IDENTIFICATION_BASELINE:
+      // A response too small to identify the model from is all the set-point would allow.
+      if (o2Percent + IDENT_MIN_PEAK_PERCENT + IDENT_TARGET_MARGIN_PERCENT > targetPercent) {
+        fail();
+        return false;
+      }
+
+      // Start over whenever the O2 moves, the pulse has to start from a still mix.
+      if (baselineCount == 0 || o2Percent < baselineMin) {
+        baselineMin = o2Percent;
+      }
+      if (baselineCount == 0 || o2Percent > baselineMax) {
+        baselineMax = o2Percent;
+      }
+      if (baselineMax - baselineMin > IDENT_STILL_PERCENT) {
+        baselineMin = o2Percent;
+        baselineMax = o2Percent;
+        baselineSum = 0;
+        baselineCount = 0;
+        phaseStartedMs = nowMs;
+      }
+      baselineSum += o2Percent;
+      baselineCount++;
+
+      if (nowMs - phaseStartedMs >= IDENT_BASELINE_MS) {
+        baseline = baselineSum / baselineCount;
+        peak = 0;
+        delayMs = -1;
+        area = 0;
+        moment = 0;
+        openMs = IDENT_PULSE_MS;
+        phaseStartedMs = nowMs;
+        status.state = IDENTIFICATION_PULSE;
+        return true;
+      }
+      return false;
+
+    case IDENTIFICATION_PULSE:
+    case IDENTIFICATION_RESPONSE: {
+      float rise = o2Percent - baseline;
+      unsigned long t = nowMs - phaseStartedMs;
+      area += rise * dt;
+      moment += rise * dt * (t - dt / 2.0);
+      if (rise > peak) {
+        peak = rise;
+      }
+      if (delayMs < 0 && rise >= IDENT_RISE_PERCENT) {
+        delayMs = t;
+      }
+
+      if (status.state == IDENTIFICATION_PULSE) {
+        if (o2Percent > O2_LIMIT_PERCENT || o2Percent >= targetPercent) {
+          openMs = t;
+        }
+        if (t < openMs) {
+          return true;
+        }
+        status.state = IDENTIFICATION_RESPONSE;
+        return false;
+      }
+
+      if (peak >= IDENT_MIN_PEAK_PERCENT && rise < peak * IDENT_END_FRACTION) {
+        finish();
+      }
+      return false;
+    }
+
+    default:
+      return false;
+  }
+}
+
+const char *controllerName(uint8_t mode) {
+  return mode == CONTROLLER_BANG_BANG ? "bang-bang" : "smith-pi";
+}
+
+uint8_t loadControllerMode() {
+  Preferences preferences;
+  preferences.begin("controller", true);
+  int32_t mode = preferences.getInt("mode", CONTROLLER_DEFAULT);
+  preferences.end();
+
+  return mode >= 0 && mode < CONTROLLER_COUNT ? mode : CONTROLLER_DEFAULT;
+}
+
+void persistControllerMode(uint8_t mode) {
+  Preferences preferences;
+  preferences.begin("controller", false);
+  preferences.putInt("mode", mode);
+  preferences.end();
+}
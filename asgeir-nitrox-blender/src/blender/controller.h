@@ -0,0 +1,206 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define CONTROLLER_BANG_BANG 0
+#define CONTROLLER_SMITH_PI 1
+#define CONTROLLER_COUNT 2
+#define CONTROLLER_DEFAULT CONTROLLER_BANG_BANG
+
+#define SOLENOID_CLOSE_DELAY 300 // milliseconds
+#define O2_LIMIT_PERCENT 40.0f   // The valve never opens above this, whatever the set-point.
+
+// Defaults for the Smith predictor PI, can be overridden in the "controller" NVS namespace
+// and are replaced by an identification, see ModelIdentifier. The gains follow from the
+// model by smithPiConfigFor().
+#define PI_KP 0.03f                // Duty per % O2 of error.
+#define PI_KI 0.004f               // Duty per % O2 and second.
+#define MODEL_GAIN_PERCENT 30.0f   // O2 % the valve adds when open all the time.
+#define MODEL_TAU_MS 4500          // Mixing plus cell response, lumped.
+#define MODEL_DELAY_MS 3000        // Transport delay from the valve to the cells.
+#define PI_LAMBDA_MS 5000          // Closed loop time constant the gains are chosen for.
+#define PI_TARGET_MARGIN_PERCENT 0.3f // The PI aims this far below the set-point.
+
+#define MODEL_STEP_MS 100
+#define MODEL_DELAY_STEPS 128      // Longest supported delay is MODEL_DELAY_STEPS * MODEL_STEP_MS.
+#define DUTY_WINDOW_MS 2000
+#define DUTY_MIN_PULSE_MS 200      // Shorter pulses are skipped, saves the valve and the relay.
+
+struct ControllerInput {
+  float o2Percent;
+  float targetPercent;
+  bool isReadingError;
+  unsigned long nowMs;
+};
+
+/*
+ * Decides whether the solenoid should be open, called every control cycle.
+ */
+class SolenoidController {
+public:
+  virtual ~SolenoidController() {}
+
+  virtual void reset(unsigned long nowMs) = 0;
+
+  /// @param isOpen the current valve state.
+  /// @return true to open the valve.
+  virtual bool update(const ControllerInput &input, bool isOpen) = 0;
+};
+
+/// @brief The original comparator: open below the set-point, close SOLENOID_CLOSE_DELAY after it is reached.
+class BangBangController : public SolenoidController {
+public:
+  void reset(unsigned long nowMs) { lastBelowTargetMs = nowMs; }
+  bool update(const ControllerInput &input, bool isOpen);
+
+private:
+  unsigned long lastBelowTargetMs = 0;
+};
+
+struct SmithPiConfig {
+  float kp;
+  float ki;
+  float modelGainPercent;
+  float modelTauMs;
+  float modelDelayMs;
+};
+
+/// @brief PI gains for a model of the stick: IMC tuning with PI_LAMBDA_MS, the integral time is tau plus delay.
+SmithPiConfig smithPiConfigFor(float gainPercent, float tauMs, float delayMs);
+
+/*
+ * PI on the duty cycle of the valve, with a Smith predictor for the transport delay.
+ *
+ * The cells only see a change after the gas has travelled through the stick, a plain
+ * PI keeps adding oxygen in that time and overshoots. The predictor runs a model of
+ * the stick fed with the actual valve state. The model without delay minus the model
+ * with delay is what is already on the way to the cells, adding it to the measurement
+ * lets the PI act on where the mix is heading.
+ *
+ * The duty is applied as time-proportioning over DUTY_WINDOW_MS windows, the integral
+ * only moves while the duty is not saturated (anti-windup).
+ *
+ * The model can be wrong, so the measurement has the last word: at or above the
+ * set-point, or above O2_LIMIT_PERCENT, the valve closes at once and the rest of the
+ * window stays closed. The PI aims PI_TARGET_MARGIN_PERCENT below the set-point so this
+ * only happens on overshoot.
+ */
+class SmithPiController : public SolenoidController {
+public:
+  SmithPiController();
+
+  void configure(const SmithPiConfig &config);
+
+  void reset(unsigned long nowMs);
+  bool update(const ControllerInput &input, bool isOpen);
+
+  float getDuty() const { return duty; }
+  float getPredictedPercent() const { return predictedPercent; }
+
+private:
+  void stepModel(unsigned long nowMs, bool isOpen);
+
+  SmithPiConfig config;
+  int delaySteps = 0;
+
+  float integral = 0;
+  float duty = 0;
+  float predictedPercent = 0;
+
+  float model = 0;                     // O2 % above air the valve causes, without delay.
+  float modelHistory[MODEL_DELAY_STEPS];
+  int historyIndex = 0;
+  unsigned long lastModelStepMs = 0;
+  unsigned long lastUpdateMs = 0;
+
+  unsigned long windowStartedMs = 0;
+  unsigned long onTimeMs = 0;
+};
+
+/// @brief Read the Smith PI settings from NVS, falling back to the defaults above.
+SmithPiConfig loadSmithPiConfig();
+void persistSmithPiConfig(const SmithPiConfig &config);
+/// @brief Whether a stick model is stored, the defaults only fit the stick they came from.
+bool hasSmithPiModel();
+
+#define IDENT_BASELINE_MS 5000     // The O2 has to hold still this long before the pulse.
+#define IDENT_STILL_PERCENT 0.3f   // Largest spread of a still baseline.
+#define IDENT_PULSE_MS 2000        // Valve open time.
+#define IDENT_RISE_PERCENT 0.3f    // Rise that marks the gas reaching the cells.
+#define IDENT_END_FRACTION 0.02f   // The response is over below this share of its peak.
+#define IDENT_MIN_PEAK_PERCENT 1.0f
+#define IDENT_TARGET_MARGIN_PERCENT 0.5f // The set-point has to be this much above the rise the pulse needs.
+#define IDENT_TIMEOUT_MS 120000
+
+enum IdentificationState {
+  IDENTIFICATION_IDLE,
+  IDENTIFICATION_BASELINE,
+  IDENTIFICATION_PULSE,
+  IDENTIFICATION_RESPONSE,
+  IDENTIFICATION_DONE,
+  IDENTIFICATION_FAILED
+};
+
+struct IdentificationStatus {
+  IdentificationState state;
+  uint32_t completedCount; // Goes up every time a new model is identified.
+  SmithPiConfig result;    // Valid once completedCount went up.
+};
+
+/*
+ * Identifies the stick model of the Smith PI from the response to one valve pulse.
+ *
+ * It waits for the O2 to hold still, opens the valve for IDENT_PULSE_MS and follows
+ * the cells until the response has died out. The plant is taken as linear, so:
+ * - the area under the response is the gain times the open time,
+ * - the first time the O2 is IDENT_RISE_PERCENT up is the delay,
+ * - the centroid of the response, less half the pulse, is the delay plus tau.
+ * A pulse instead of a step keeps the mix near air, the valve never stays open long
+ * enough to reach the steady-state gain. It never opens the valve unless the set-point
+ * is IDENT_MIN_PEAK_PERCENT and a margin above the baseline, and the pulse ends early
+ * once the O2 reaches the set-point. Like the calibration it is a state machine the
+ * control task advances on every cycle.
+ */
+class ModelIdentifier {
+public:
+  void start(unsigned long nowMs);
+
+  /// @brief Advance the state machine.
+  /// @param targetPercent set-point, the identification fails rather than blend past it.
+  /// @return true to open the valve.
+  bool update(float o2Percent, float targetPercent, bool isReadingError, unsigned long nowMs);
+
+  /// @brief Identifying, the valve belongs to the identifier.
+  bool isActive() const {
+    return status.state == IDENTIFICATION_BASELINE || status.state == IDENTIFICATION_PULSE ||
+      status.state == IDENTIFICATION_RESPONSE;
+  }
+
+  IdentificationStatus getStatus() const { return status; }
+
+  /// @brief Give up a running identification, the valve is needed elsewhere.
+  void cancel();
+
+private:
+  void fail();
+  void finish();
+
+  IdentificationStatus status = { IDENTIFICATION_IDLE, 0, {} };
+  unsigned long startedAtMs = 0;
+  unsigned long phaseStartedMs = 0;
+  unsigned long lastUpdateMs = 0;
+  unsigned long openMs = 0;
+  float baselineMin = 0;
+  float baselineMax = 0;
+  double baselineSum = 0;
+  uint32_t baselineCount = 0;
+  float baseline = 0;
+  float peak = 0;
+  float delayMs = -1;
+  double area = 0;   // % O2 times ms
+  double moment = 0; // % O2 times ms squared
+};
+
+const char *controllerName(uint8_t mode);
+uint8_t loadControllerMode();
+void persistControllerMode(uint8_t mode);
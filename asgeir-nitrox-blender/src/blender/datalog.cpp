@@ -0,0 +1,245 @@
+#include "datalog.h"
+
+#include <Crc16.h>
+#include <FixedPoint.h>
+#include <Varint.h>
+
+// Tag, a 5 byte time varint and three 3 byte zigzag varints.
+#define DATALOG_MAX_RECORD_SIZE 15
+#define DATALOG_TIME_ESCAPE 63
+
+bool DataLog::begin(fs::FS &fs) {
+  this->fs = &fs;
+  fs.mkdir(DATALOG_DIRECTORY);
+
+  // Carry on after the newest segment, the last batch of it may be torn.
+  uint32_t count = 0;
+  uint32_t lowest = UINT32_MAX;
+  uint32_t highest = 0;
+  File directory = fs.open(DATALOG_DIRECTORY);
+  for (File file = directory.openNextFile(); file; file = directory.openNextFile()) {
+    char *end;
+    uint32_t sequence = strtoul(file.name(), &end, 10);
+    if (strcmp(end, ".bin") != 0) {
+      continue;
+    }
+    count++;
+    if (sequence < lowest) {
+      lowest = sequence;
+    }
+    if (sequence > highest) {
+      highest = sequence;
+    }
+  }
+  directory.close();
+
+  oldestSequence = count > 0 ? lowest : 0;
+  nextSequence = count > 0 ? highest + 1 : 0;
+  segmentCount.store(count, std::memory_order_relaxed);
+
+  BaseType_t created = xTaskCreatePinnedToCore(taskLoop, "datalog", 4096, this, DATALOG_TASK_PRIORITY, &task,
+    DATALOG_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Failed to start data log task");
+    return false;
+  }
+  return true;
+}
+
+void DataLog::record(const DataLogEntry &entry) {
+  if (task == NULL) {
+    return;
+  }
+  if (entries.push(entry)) {
+    entryCount.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void DataLog::recordSample(uint32_t atMs, float cell1Mv, float cell2Mv, float o2Percent) {
+  DataLogEntry entry;
+  entry.atMs = atMs;
+  entry.type = DATALOG_SAMPLE;
+  entry.cellMv[0] = toFixed(cell1Mv, DATALOG_MV_SCALE);
+  entry.cellMv[1] = toFixed(cell2Mv, DATALOG_MV_SCALE);
+  entry.o2 = toFixed(o2Percent, DATALOG_O2_SCALE);
+  record(entry);
+}
+
+void DataLog::recordValve(uint32_t atMs, bool isOpen) {
+  DataLogEntry entry;
+  entry.atMs = atMs;
+  entry.type = isOpen ? DATALOG_VALVE_OPEN : DATALOG_VALVE_CLOSED;
+  entry.cellMv[0] = 0;
+  entry.cellMv[1] = 0;
+  entry.o2 = 0;
+  record(entry);
+}
+
+DataLogStats DataLog::stats() const {
+  DataLogStats result;
+  result.entries = entryCount.load(std::memory_order_relaxed);
+  result.dropped = droppedCount.load(std::memory_order_relaxed);
+  result.batches = batchCount.load(std::memory_order_relaxed);
+  result.bytes = byteCount.load(std::memory_order_relaxed);
+  result.writeErrors = writeErrorCount.load(std::memory_order_relaxed);
+  result.maxWriteUs = maxWriteUs.load(std::memory_order_relaxed);
+  result.segments = segmentCount.load(std::memory_order_relaxed);
+  return result;
+}
+
+void DataLog::report(Print &out) const {
+  DataLogStats s = stats();
+  // Entries still in the ring or the open batch are not written yet, close enough.
+  float bytesPerEntry = s.entries ? (float)s.bytes / s.entries : 0;
+
+  out.printf("Data log: %u entries, %u dropped, %u batches, %u bytes (%.1f per entry), %u segments\r\n",
+    (unsigned)s.entries, (unsigned)s.dropped, (unsigned)s.batches, (unsigned)s.bytes, bytesPerEntry,
+    (unsigned)s.segments);
+  out.printf("Data log: %u write errors, longest write %u us\r\n", (unsigned)s.writeErrors, (unsigned)s.maxWriteUs);
+}
+
+void DataLog::taskLoop(void *parameter) {
+  DataLog *self = (DataLog *)parameter;
+
+  for (;;) {
+    vTaskDelay(pdMS_TO_TICKS(DATALOG_FLUSH_PERIOD_MS));
+    self->drain();
+  }
+}
+
+void DataLog::drain() {
+  DataLogEntry entry;
+  while (entries.pop(entry)) {
+    encode(entry);
+  }
+}
+
+void DataLog::encode(const DataLogEntry &entry) {
+  if (batchLength + DATALOG_MAX_RECORD_SIZE > DATALOG_BATCH_SIZE) {
+    writeBatch();
+  }
+
+  uint32_t units = entry.atMs / DATALOG_TIME_UNIT_MS;
+  if (batchLength == 0) {
+    // The first record of a batch is a delta of the header.
+    lastUnits = units;
+    if (entry.type == DATALOG_SAMPLE) {
+      lastCellMv[0] = entry.cellMv[0];
+      lastCellMv[1] = entry.cellMv[1];
+      lastO2 = entry.o2;
+    }
+    startBatch();
+  }
+
+  uint8_t *out = batch + batchLength;
+  size_t length = 0;
+  uint32_t elapsed = units - lastUnits;
+
+  if (elapsed < DATALOG_TIME_ESCAPE) {
+    out[length++] = entry.type | (elapsed << 2);
+  } else {
+    out[length++] = entry.type | (DATALOG_TIME_ESCAPE << 2);
+    length += putVarint(out + length, elapsed);
+  }
+
+  if (entry.type == DATALOG_SAMPLE) {
+    length += putDelta(out + length, entry.cellMv[0], lastCellMv[0]);
+    length += putDelta(out + length, entry.cellMv[1], lastCellMv[1]);
+    length += putDelta(out + length, entry.o2, lastO2);
+    lastCellMv[0] = entry.cellMv[0];
+    lastCellMv[1] = entry.cellMv[1];
+    lastO2 = entry.o2;
+  }
+
+  lastUnits = units;
+  batchLength += length;
+}
+
+void DataLog::startBatch() {
+  DataLogBatchHeader header;
+  memset(&header, 0, sizeof(header));
+  header.atMs = lastUnits * DATALOG_TIME_UNIT_MS;
+  header.cellMv[0] = lastCellMv[0];
+  header.cellMv[1] = lastCellMv[1];
+  header.o2 = lastO2;
+  memcpy(batch, &header, sizeof(header));
+  batchLength = sizeof(header);
+}
+
+void DataLog::writeBatch() {
+  DataLogBatchHeader *header = (DataLogBatchHeader *)batch;
+  header->magic = DATALOG_MAGIC;
+  header->version = DATALOG_VERSION;
+  header->length = batchLength - sizeof(DataLogBatchHeader);
+  header->crc = crc16(batch + 4, batchLength - 4);
+
+  uint32_t startedUs = micros();
+  bool isWritten = false;
+
+  for (int attempt = 0; attempt < 2 && !isWritten; attempt++) {
+    if (attempt > 0) {
+      // Most likely the partition is full, make room and start over in a new segment.
+      removeOldestSegment();
+      segment.close();
+    }
+
+    if (!segment || segmentBytes + batchLength > DATALOG_SEGMENT_SIZE) {
+      openSegment();
+    }
+    isWritten = segment && segment.write(batch, batchLength) == batchLength;
+    if (isWritten) {
+      segment.flush();
+    } else {
+      writeErrorCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  uint32_t writeUs = micros() - startedUs;
+  if (writeUs > maxWriteUs.load(std::memory_order_relaxed)) {
+    maxWriteUs.store(writeUs, std::memory_order_relaxed);
+  }
+
+  if (isWritten) {
+    segmentBytes += batchLength;
+    batchCount.fetch_add(1, std::memory_order_relaxed);
+    byteCount.fetch_add(batchLength, std::memory_order_relaxed);
+  }
+  batchLength = 0;
+}
+
+bool DataLog::openSegment() {
+  char path[32];
+  segment.close();
+  segmentPath(nextSequence, path, sizeof(path));
+
+  segment = fs->open(path, FILE_WRITE);
+  if (!segment) {
+    return false;
+  }
+  nextSequence++;
+  segmentBytes = 0;
+
+  segmentCount.fetch_add(1, std::memory_order_relaxed);
+  while (segmentCount.load(std::memory_order_relaxed) > DATALOG_MAX_SEGMENTS && removeOldestSegment()) {
+  }
+  return true;
+}
+
+bool DataLog::removeOldestSegment() {
+  char path[32];
+  // Never the one being written.
+  while (oldestSequence + 1 < nextSequence) {
+    segmentPath(oldestSequence++, path, sizeof(path));
+    if (fs->remove(path)) {
+      segmentCount.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void DataLog::segmentPath(uint32_t sequence, char *path, size_t size) const {
+  snprintf(path, size, DATALOG_DIRECTORY "/%08lu.bin", (unsigned long)sequence);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SpscRing.h>
+
+#include <atomic>
+
+#define DATALOG_DIRECTORY "/log"
+#define DATALOG_MAGIC 0x4C44           // "DL"
+#define DATALOG_VERSION 1
+#define DATALOG_BATCH_SIZE 512         // Bytes per flash write, two program pages
+#define DATALOG_SEGMENT_SIZE 65536UL   // A segment file is closed once the next batch does not fit
+#define DATALOG_MAX_SEGMENTS 40        // 2.5 MB of the 3.4 MB partition, about 9 hours at 20 Hz
+#define DATALOG_RING_SIZE 256          // 12.8 s of samples at 20 Hz
+#define DATALOG_FLUSH_PERIOD_MS 1000
+#define DATALOG_TASK_PRIORITY 1
+#define DATALOG_TASK_CORE 1
+
+#define DATALOG_TIME_UNIT_MS 10
+#define DATALOG_MV_SCALE 100           // Cell voltage in 0.01 mV
+#define DATALOG_O2_SCALE 100           // O2 in 0.01 %
+
+#define DATALOG_SAMPLE 0
+#define DATALOG_VALVE_OPEN 1
+#define DATALOG_VALVE_CLOSED 2
+
+/// @brief What the control task hands over, already in fixed point.
+struct DataLogEntry {
+  uint32_t atMs;
+  uint8_t type;       // DATALOG_SAMPLE, DATALOG_VALVE_OPEN or DATALOG_VALVE_CLOSED
+  int16_t cellMv[2];  // DATALOG_MV_SCALE, samples only
+  int16_t o2;         // DATALOG_O2_SCALE, samples only
+};
+
+/*
+ * On flash the log is a series of segment files, /log/00000042.bin, holding batches
+ * of at most DATALOG_BATCH_SIZE bytes. Every batch stands on its own: the header holds
+ * the absolute time and values the first record is a delta of, and a CRC16 over the
+ * rest of the batch. A batch torn by a power cut is dropped on its own.
+ *
+ * A record starts with a tag byte, the type in bits 0-1 and the time since the previous
+ * record in DATALOG_TIME_UNIT_MS in bits 2-7. 63 means the time follows as a varint. A
+ * sample continues with the changes of both cells and the O2 as zigzag varints, so a
+ * steady sample takes 4 bytes. Valve records have no payload.
+ */
+struct __attribute__((packed)) DataLogBatchHeader {
+  uint16_t magic;
+  uint16_t crc;       // Over everything after this field, records included.
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t length;    // Bytes of records after the header
+  uint32_t atMs;      // Multiple of DATALOG_TIME_UNIT_MS
+  int16_t cellMv[2];
+  int16_t o2;
+};
+
+struct DataLogStats {
+  uint32_t entries;
+  uint32_t dropped;       // Ring was full, the writer task fell behind.
+  uint32_t batches;
+  uint32_t bytes;         // Written to flash, headers included.
+  uint32_t writeErrors;   // Failed writes, the batch is retried once in a new segment.
+  uint32_t maxWriteUs;    // Longest flash write, erase included.
+  uint16_t segments;
+};
+
+/*
+ * Append-only history of the readings and the valve, kept across reboots.
+ *
+ * The control task only pushes entries into a lock-free ring. A low priority task on
+ * the UI core encodes them and writes whole batches, so flash erase and program time
+ * never lands in the control loop. The oldest segment is deleted once there are
+ * DATALOG_MAX_SEGMENTS, which bounds the space and spreads the wear over the partition.
+ */
+class DataLog {
+public:
+  /// @brief Start a new segment after the ones already on fs and start the writer task.
+  bool begin(fs::FS &fs);
+
+  /// @brief Control task: queue an entry, dropped if the writer falls behind.
+  void record(const DataLogEntry &entry);
+  void recordSample(uint32_t atMs, float cell1Mv, float cell2Mv, float o2Percent);
+  void recordValve(uint32_t atMs, bool isOpen);
+
+  DataLogStats stats() const;
+  void report(Print &out) const;
+
+private:
+  static void taskLoop(void *parameter);
+
+  void drain();
+  void encode(const DataLogEntry &entry);
+  void startBatch();
+  void writeBatch();
+  bool openSegment();
+  bool removeOldestSegment();
+  void segmentPath(uint32_t sequence, char *path, size_t size) const;
+
+  fs::FS *fs = NULL;
+  TaskHandle_t task = NULL;
+  SpscRing<DataLogEntry, DATALOG_RING_SIZE> entries;
+
+  // Writer task only.
+  File segment;
+  size_t segmentBytes = 0;
+  uint32_t oldestSequence = 0;
+  uint32_t nextSequence = 0;
+  uint8_t batch[DATALOG_BATCH_SIZE];
+  size_t batchLength = 0;
+  uint32_t lastUnits = 0;
+  int16_t lastCellMv[2] = { 0, 0 };
+  int16_t lastO2 = 0;
+
+  std::atomic<uint32_t> entryCount { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+  std::atomic<uint32_t> batchCount { 0 };
+  std::atomic<uint32_t> byteCount { 0 };
+  std::atomic<uint32_t> writeErrorCount { 0 };
+  std::atomic<uint32_t> maxWriteUs { 0 };
+  std::atomic<uint16_t> segmentCount { 0 };
+};
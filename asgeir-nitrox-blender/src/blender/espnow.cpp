@@ -0,0 +1,92 @@
+#include "espnow.h"
+
+#include <WiFi.h>
+#include <Protocol.h>
+
+static const uint8_t broadcastAddress[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+EspNowTransport *EspNowTransport::instance = NULL;
+
+bool EspNowTransport::begin(TransportReceiveHook receiveHook) {
+  this->receiveHook = receiveHook;
+  instance = this;
+
+  // Set device as a Wi-Fi Station
+  WiFi.mode(WIFI_STA);
+
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("Error initializing ESP-NOW");
+    return false;
+  }
+  esp_now_register_send_cb(onSent);
+  esp_now_register_recv_cb(onReceive);
+
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, broadcastAddress, ESP_NOW_ETH_ALEN);
+  peerInfo.channel = 0;
+  peerInfo.encrypt = false;
+  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+    Serial.println("Failed to add peer");
+    return false;
+  }
+  return radio.begin(onAttempt);
+}
+
+bool EspNowTransport::sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) {
+  uint8_t macs[PEER_MAX][ESP_NOW_ETH_ALEN];
+  size_t peerCount = peers.addresses(macs, PEER_MAX, kind == TRANSPORT_KIND_SAMPLES);
+  uint8_t radioKind = kind == TRANSPORT_KIND_STATUS ? RADIO_KIND_STATUS : RADIO_KIND_ONCE;
+
+  bool isQueued = true;
+  for (size_t i = 0; i < count; i++) {
+    if (peerCount == 0) {
+      isQueued = kind == TRANSPORT_KIND_STATUS && radio.send(broadcastAddress, frames[i].data, frames[i].length,
+        radioKind) && isQueued;
+    }
+    for (size_t peer = 0; peer < peerCount; peer++) {
+      isQueued = radio.send(macs[peer], frames[i].data, frames[i].length, radioKind) && isQueued;
+    }
+  }
+  return isQueued;
+}
+
+void EspNowTransport::poll() {
+  peers.update();
+}
+
+void EspNowTransport::report(Print &out) const {
+  radio.report(out);
+  peers.report(out);
+}
+
+// Runs in the WiFi task.
+void EspNowTransport::onReceive(const uint8_t *mac, const uint8_t *data, int len) {
+  FrameHeader header;
+  const uint8_t *payload;
+  if (decodeFrame(data, len, header, payload) != FRAME_OK) {
+    return;
+  }
+
+  // A client that wants the samples has to be registered to get them.
+  if (header.type == FRAME_HELLO) {
+    instance->peers.heard(mac);
+  } else if (header.type == FRAME_STREAM_REQUEST && header.length == sizeof(StreamRequestPayload)) {
+    StreamRequestPayload request;
+    memcpy(&request, payload, sizeof(request));
+    instance->peers.streamRequested(mac, request.leaseMs);
+  }
+  if (instance->receiveHook != NULL) {
+    instance->receiveHook(data, len);
+  }
+}
+
+// Runs in the WiFi task.
+void EspNowTransport::onSent(const uint8_t *mac, esp_now_send_status_t status) {
+  instance->radio.onSent(status);
+}
+
+// Per client delivery statistics, runs in the radio task.
+void EspNowTransport::onAttempt(const uint8_t *mac, bool isDelivered, uint32_t rttUs) {
+  instance->peers.recordAttempt(mac, isDelivered, rttUs);
+}
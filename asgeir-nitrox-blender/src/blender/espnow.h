@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_now.h>
+
+#include "transport.h"
+#include "radio.h"
+#include "peers.h"
+
+/*
+ * ESP-NOW to the client displays, at most ESP_NOW_MAX_DATA_LEN per frame.
+ *
+ * Every frame of a batch goes through the radio queue (radio.h) on its own, unicast to
+ * each registered client (peers.h). A client registers with a FRAME_HELLO, and asking
+ * for samples registers it too. The samples only go to the clients whose stream lease
+ * runs. While none is registered, a status goes out as a broadcast so new clients find
+ * the blender, and everything else is not sent at all.
+ */
+class EspNowTransport : public Transport {
+public:
+  const char *name() const override { return "ESP-NOW"; }
+  bool begin(TransportReceiveHook receiveHook) override;
+  size_t mtu() const override { return ESP_NOW_MAX_DATA_LEN; }
+  bool sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) override;
+
+  /// @brief Registers the clients heard since the last call and drops the silent ones.
+  void poll() override;
+
+  int32_t streamLeaseMs() const override { return peers.streamLeaseMs(); }
+
+  void report(Print &out) const override;
+
+private:
+  // ESP-NOW has no context pointer in its callbacks, there is only one radio anyway.
+  static EspNowTransport *instance;
+
+  static void onReceive(const uint8_t *mac, const uint8_t *data, int len);
+  static void onSent(const uint8_t *mac, esp_now_send_status_t status);
+  static void onAttempt(const uint8_t *mac, bool isDelivered, uint32_t rttUs);
+
+  TransportReceiveHook receiveHook = NULL;
+  RadioQueue radio;
+  PeerRegistry peers;
+};
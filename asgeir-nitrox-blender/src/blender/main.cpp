@@ -1,41 +1,39 @@
 #include <Arduino.h>
 #include <Preferences.h>
+#include <LittleFS.h>
 #include <ezButton.h>
 #include "TFT_eSPI.h" /* Please use the TFT library provided in the library. */
 #include "img_logo.h"
 #include "pin_config.h"
 #include <Adafruit_ADS1X15.h>
-#include <RunningAverage.h>
-#include <esp_now.h>
-#include <WiFi.h>
-
-#define FONT_LARGE &Dialog_plain_100 // Key label font 2
+#include <Protocol.h>
+#include <MainScreen.h>
+#include "profiler.h"
+#include "status.h"
+#include "control.h"
+#include "scheduler.h"
+#include "transport.h"
 
 TFT_eSPI tft = TFT_eSPI();
 
-TFT_eSprite tft_percent = TFT_eSprite(&tft); // Sprite object graph1
-TFT_eSprite tft_percent_cell = TFT_eSprite(&tft); // Sprite object graph1
 TFT_eSprite tft_menu = TFT_eSprite(&tft);
+MainScreen mainScreen(tft);
 
-esp_now_peer_info_t Client;
-#define CHANNEL 1
-#define PRINTSCANRESULTS 0
-#define DELETEBEFOREPAIR 0
-
-
-#define CELL_WIDTH 120
-#define CELL_SPACING 5
-#define CELL_PADDING_LEFT 40
-#define HEADER_ROW_Y 92
 
 #define O2_I2Caddress 0x48
 
-#define RA_SIZE 40
 #define SOLENOID_O2_LIMIT 35
 
-#define SENSOR_THRESHOLD_MILLIVOLT_MIN 7
-#define SENSOR_THRESHOLD_MILLIVOLT_MAX 20
-#define SOLENOID_CLOSE_DELAY 300 // milliseconds
+#define PROFILE_REPORT_INTERVAL 10000 // milliseconds
+#define BUTTONS_PERIOD_MS 10
+#define SCREEN_PERIOD_MS 500
+#define TELEMETRY_PERIOD_MS 100     // Checked this often, sent only on a change
+#define TELEMETRY_HEARTBEAT_MS 2000 // and at least this often
+#define SERIAL_PERIOD_MS 100
+#define TRACE_PERIOD_MS 100
+#define CALIBRATION_MESSAGE_MS 2000 // How long DONE/FAILED stays on screen
+#define CALIBRATION_TITLE_Y 36
+#define CALIBRATION_BAR_WIDTH 280
 
 #define MENU_ITEM_CLOSE 0
 #define MENU_ITEM_CLEAR_CALIBRATION 1
@@ -44,41 +42,6 @@ esp_now_peer_info_t Client;
 
 bool isMenuMode = false;
 
-struct SolenoidStatus {
-  int maxO2Percent;
-  bool isOpen;
-  long solenoidClosedAt;
-};
-
-struct CellCalibration {
-  float value;
-  long calibratedAtMs;
-  
-  /// @brief If the cell is calibrated at an "reasonable" voltage.. E.g. if calibration was performed when cell was misbehaving.
-  /// @return true if calibration value is within acceptable range.
-  bool isValid() {
-    return value > SENSOR_THRESHOLD_MILLIVOLT_MIN && value < SENSOR_THRESHOLD_MILLIVOLT_MAX;
-  };
-};
-
-struct SensorReading {
-  float avgMv;
-  float o2Percent;
-  bool sensorWarning;
-  bool isDisabledByMenu;
-
-  /// @brief If the cell reading at an "reasonable" voltage.. E.g. if calibration was performed when cell was misbehaving.
-  /// @return true if calibration value is within acceptable range.
-  bool isValid() {
-    return avgMv > SENSOR_THRESHOLD_MILLIVOLT_MIN && avgMv < SENSOR_THRESHOLD_MILLIVOLT_MAX;
-  };
-};
-
-struct SystemStatus {
-  float o2;
-  bool isReadingError;
-};
-
 struct O2Reading {
   int percent;
   bool cellError;
@@ -94,38 +57,36 @@ struct MenuOption {
   int actionId;
 };
 
-struct EspNowMessage {
-  SystemStatus systemState;
-  SensorReading readingCell1;
-  SensorReading readingCell2;
-  CellCalibration cellCalibrationCell1;
-  CellCalibration cellCalibrationCell2;
-  SolenoidStatus solenoid;
-};
-
 void drawSolenoidValue();
 void drawCellInfo(int index);
 void drawMainOxygenValue();
 void drawMenu();
 void drawInitalScreen();
-void handleSensor();
 void handleButtons();
-void handlePotentiometer();
-void handleSolenoid();
 void calibrate();
-void restoreCalibration();
+void restoreCalibration(CellCalibration calibration[2]);
 void persistCalibration();
-float readOxygenCellVoltage();
+void handleCalibration();
+void handleIdentification();
+bool drawCalibration();
+void setupCalibrationWidgets();
 void menuLongClick();
 void menuShortClick();
+void handleSerialCommands();
+void reportProfile();
+void updateScreen();
+void sendTelemetry();
+void buttonsJob();
+void flushTrace();
+const ControlStats *reportProfiles();
+void applySettings();
+void streamSamples();
+bool sendFrame(uint8_t type, const void *payload, size_t length, uint8_t kind);
 
 Preferences preferences;
 ezButton calibrateButton(PIN_CALIBRATE_BUTTON); 
 Adafruit_ADS1115 ads1115;  // Construct an ads1115
 
-float gain = 0.0625F;
-
-const char* cellHeader[2] = { "CELL 1", "CELL 2" };
 MenuOption menuOptions[] = {
   { "Close", MENU_ITEM_CLOSE },
   { "Clear Calibration", MENU_ITEM_CLEAR_CALIBRATION },
@@ -134,21 +95,35 @@ MenuOption menuOptions[] = {
 };
 Menu menuState;
 
-SystemStatus systemState;
-SensorReading sensorValue[2];
-CellCalibration cellCalibration[2];
-SolenoidStatus solenoid;
-RunningAverage cellReadings[2] = { RunningAverage(RA_SIZE), RunningAverage(RA_SIZE) };
-EspNowMessage espMessageData;
-
-// DE DA 0C 5A 51 24
-uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-esp_now_peer_info_t peerInfo;
-
-// callback when data is sent
-void OnDataSent(const uint8_t *mac_addr, esp_now_send_status_t status) {
-  Serial.print("\r\nLast Packet Send Status:\t");
-  Serial.println(status == ESP_NOW_SEND_SUCCESS ? "Delivery Success" : "Delivery Fail");
+// Latest state published by the control task, refreshed at the start of every loop().
+ControlSnapshot status;
+// Owned by loop(), published to the control task with applySettings().
+ControlSettings settings;
+StatusPayload lastSentStatus;
+uint32_t lastSentStatusAtMs = 0;
+bool hasSentStatus = false;
+uint16_t frameSequence = 0;
+uint16_t sampleSequence = 0; // FRAME_SAMPLES only go to the streaming clients, see Protocol.h
+LoopProfiler profiler;
+Scheduler uiScheduler;
+Transport &transport = telemetryTransport();
+ProfilePayload profilePayload;
+
+// callback when a frame is received, runs in the context of the transport
+void OnFrameReceived(const uint8_t *data, size_t len) {
+  FrameHeader header;
+  const uint8_t *payload;
+  if (decodeFrame(data, len, header, payload) != FRAME_OK) {
+    return;
+  }
+
+  // With a lease per client the transport keeps them, see streamSamples().
+  if (header.type == FRAME_STREAM_REQUEST && header.length == sizeof(StreamRequestPayload) &&
+    transport.streamLeaseMs() < 0) {
+    StreamRequestPayload request;
+    memcpy(&request, payload, sizeof(request));
+    sampleStream.request(request.leaseMs);
+  }
 }
 
 void setup()
@@ -167,6 +142,7 @@ void setup()
 
   // Setup amp
   Wire.begin(PIN_IIC_SDA, PIN_IIC_SCL);
+  Wire.setClock(400000); // Keeps the transactions in the acquisition task short
   ads1115.setGain(GAIN_TWO);
   ads1115.setDataRate(RATE_ADS1115_64SPS);
   ads1115.begin();
@@ -185,148 +161,278 @@ void setup()
   ledcAttachPin(PIN_LCD_BL, 0);
   ledcWrite(0, 255);
 
+  mainScreen.begin();
   drawInitalScreen();
-
-  tft_percent.setColorDepth(8);
-  tft_percent.createSprite(340, 90);
-  tft_percent.setFreeFont(FONT_LARGE);
-
-  tft_percent_cell.setColorDepth(8);
-  tft_percent_cell.createSprite(CELL_WIDTH - 50, 30);
-  tft_percent_cell.setFreeFont(&FreeSerif18pt7b);
+  setupCalibrationWidgets();
 
   tft_menu.setColorDepth(8);
   tft_menu.createSprite(300, 150);
 
+  // History of the readings, see datalog.h
+  if (LittleFS.begin(true)) {
+    dataLog.begin(LittleFS);
+  } else {
+    Serial.println("Failed to mount LittleFS, nothing is logged");
+  }
+
   // LOAD CALIBRATION
-  restoreCalibration(); 
+  CellCalibration storedCalibration[2];
+  restoreCalibration(storedCalibration); 
+
+  // Read the cells and drive the solenoid on core 0
+  settings.controllerMode = loadControllerMode();
+  Serial.printf("Solenoid controller: %s\r\n", controllerName(settings.controllerMode));
+  applySettings();
+  startControlTask(ads1115, PIN_ADS_ALERT, storedCalibration);
+  status = controlSnapshot.read();
+
+  // Telemetry is offset by half a period so it does not go out right behind a repaint.
+  uiScheduler.addJob("buttons", buttonsJob, BUTTONS_PERIOD_MS * 1000UL, 3);
+  uiScheduler.addJob("telemetry", sendTelemetry, TELEMETRY_PERIOD_MS * 1000UL, 2, TELEMETRY_PERIOD_MS * 500UL);
+  uiScheduler.addJob("screen", updateScreen, SCREEN_PERIOD_MS * 1000UL, 1);
+  uiScheduler.addJob("serial", handleSerialCommands, SERIAL_PERIOD_MS * 1000UL, 0);
+  uiScheduler.addJob("trace", flushTrace, TRACE_PERIOD_MS * 1000UL, 0);
+  uiScheduler.addJob("stream", streamSamples, STREAM_PERIOD_MS * 1000UL, 1);
+  uiScheduler.addJob("report", reportProfile, PROFILE_REPORT_INTERVAL * 1000UL, 0, PROFILE_REPORT_INTERVAL * 1000UL);
 
   /* Communication */
 
-  // Set device as a Wi-Fi Station
-  WiFi.mode(WIFI_STA);
-
-  // Init ESP-NOW
-  if (esp_now_init() != ESP_OK) {
-    Serial.println("Error initializing ESP-NOW");
-  }
-  esp_now_register_send_cb(OnDataSent);
-  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
-  peerInfo.channel = 0;  
-  peerInfo.encrypt = false;
-  
-  // Add peer        
-  if (esp_now_add_peer(&peerInfo) != ESP_OK){
-    Serial.println("Failed to add peer");
+  if (!transport.begin(OnFrameReceived)) {
+    Serial.printf("Failed to start the %s transport\r\n", transport.name());
     return;
   }
-}
-
 
-long lastScreenUpdate = 0;
+  profiler.reset();
+}
 
 void loop()
 {
-  handleSensor();
-  handlePotentiometer();
-
-  if (!isMenuMode) {
-    handleButtons();
-  }
-  handleSolenoid();
+  uint32_t loopStart = profiler.now();
 
-  // Update Screen
+  status = controlSnapshot.read();
+  handleCalibration();
+  handleIdentification();
 
-  if ((millis() - lastScreenUpdate) > 500)
-  {
+  uiScheduler.runPending();
 
-    if (menuState.isMenuMode) {
-      drawMenu();
-    } else {
-      drawMainOxygenValue();
+  profiler.record(PHASE_LOOP, loopStart);
 
-      tft.setTextColor(TFT_GREEN, TFT_BLACK);    
+  uiScheduler.sleepUntilNextRelease();
+}
 
-      drawCellInfo(0);
-      drawCellInfo(1);
-      drawSolenoidValue();
-    }
+void buttonsJob() {
+  if (!isMenuMode) {
+    PROFILE(profiler, PHASE_BUTTONS, handleButtons());
+  }
+}
 
-    lastScreenUpdate = millis();
-
-    // Construct message
-
-    espMessageData.cellCalibrationCell1 = cellCalibration[0];
-    espMessageData.cellCalibrationCell2 = cellCalibration[1];
-    espMessageData.readingCell1 = sensorValue[0];
-    espMessageData.readingCell2 = sensorValue[0];
-    espMessageData.solenoid = solenoid;
-    espMessageData.systemState = systemState;
-    
-    esp_err_t result = esp_now_send(broadcastAddress, (uint8_t *) &espMessageData, sizeof(espMessageData));
-   
-    if (result == ESP_OK) {
-      Serial.println("Sent with success");
-    }
-    else {
-      Serial.println("Error sending the data");
+/*
+ * Set what the screen should show, the widgets only draw what changed since the last time.
+*/
+void updateScreen() {
+  if (menuState.isMenuMode) {
+    drawMenu();
+  } else {
+    if (!drawCalibration()) {
+      PROFILE(profiler, PHASE_DRAW_OXYGEN, drawMainOxygenValue());
     }
 
+    PROFILE(profiler, PHASE_DRAW_CELLS, drawCellInfo(0));
+    PROFILE(profiler, PHASE_DRAW_CELLS, drawCellInfo(1));
+    PROFILE(profiler, PHASE_DRAW_SOLENOID, drawSolenoidValue());
   }
+#ifdef TFT_BUS_PROFILE
+  // What this update put on the panel bus, per TFT_eSPI call, when it drew anything.
+  TFT_eSPI::busProfileFrame(&Serial);
+#endif
 }
 
+StatusPayload makeStatusPayload() {
+  StatusPayload payload;
+  payload.o2 = toFixed(status.systemState.o2, PROTOCOL_O2_SCALE);
+  payload.maxO2Percent = status.solenoid.maxO2Percent;
+  payload.flags = 0;
+  if (status.systemState.isReadingError) {
+    payload.flags |= STATUS_FLAG_READING_ERROR;
+  }
+  if (status.solenoid.isOpen) {
+    payload.flags |= STATUS_FLAG_SOLENOID_OPEN;
+  }
 
-
-// Record when we last did a reading to manage when we should read the next time.
-long lastReadMillis = 0;
+  for (int i = 0; i < 2; i++) {
+    payload.cellMv[i] = toFixed(status.sensorValue[i].avgMv, PROTOCOL_MV_SCALE);
+    payload.cellO2[i] = toFixed(status.sensorValue[i].o2Percent, PROTOCOL_O2_SCALE);
+    payload.calibrationMv[i] = toFixed(status.cellCalibration[i].value, PROTOCOL_MV_SCALE);
+    if (status.sensorValue[i].sensorWarning) {
+      payload.flags |= STATUS_FLAG_CELL1_WARNING << i;
+    }
+    if (status.sensorValue[i].isDisabledByMenu) {
+      payload.flags |= STATUS_FLAG_CELL1_DISABLED << i;
+    }
+  }
+  return payload;
+}
 
 /*
- * Read a value every 50 ms
+ * Broadcast the status when it changed beyond the deadbands of Protocol.h, or as a
+ * heartbeat every TELEMETRY_HEARTBEAT_MS so the client knows the blender is alive.
 */
-void handleSensor() {
-
-  if (millis() - lastReadMillis > 50) {
+void sendTelemetry() {
+  transport.poll();
 
-    readOxygenCellVoltage();
+  StatusPayload payload = makeStatusPayload();
+  if (hasSentStatus && !statusChanged(lastSentStatus, payload) && millis() - lastSentStatusAtMs < TELEMETRY_HEARTBEAT_MS) {
+    return;
+  }
 
-    float o2Percent = 0;
-    int validReadingsCount = 0;
+  bool isQueued;
+  PROFILE(profiler, PHASE_ESP_NOW_SEND, isQueued = sendFrame(FRAME_STATUS, &payload, sizeof(payload), TRANSPORT_KIND_STATUS));
 
-    for (int cellIndex = 0; cellIndex < 2; cellIndex++) {
-      bool isCalibrated = cellCalibration[cellIndex].isValid();
-      bool dataInconsistency = (cellReadings[cellIndex].getMax() - cellReadings[cellIndex].getMin()) > 6; // Check if there is large difference in readings
-      float maxVal = cellReadings[cellIndex].getMaxInBuffer();
-      float minVal = cellReadings[cellIndex].getMinInBuffer();
-      // Serial.printf("Cell #%d: min [%f] max [%f] diff [%f] dev [%f] err [%f]", cellIndex, maxVal, minVal, (maxVal - minVal), cellReadings[cellIndex].getStandardDeviation(), cellReadings[cellIndex].getStandardError());
-      // Serial.println();
+  if (isQueued) {
+    // Compare against what the client gets, so a slow drift is sent eventually.
+    lastSentStatus = payload;
+    lastSentStatusAtMs = millis();
+    hasSentStatus = true;
+  }
+}
 
-      sensorValue[cellIndex].avgMv = abs(cellReadings[cellIndex].getAverage());
-      sensorValue[cellIndex].o2Percent = (sensorValue[cellIndex].avgMv / cellCalibration[cellIndex].value) * 20.9;
-      if (sensorValue[cellIndex].o2Percent > 99.9) {
-        sensorValue[cellIndex].o2Percent = 99.9;
-      }
+/*
+ * Send the raw samples while a client holds a stream lease, see stream.h. The frames that
+ * are ready go out as one batch, as many as fit into a packet of the transport.
+*/
+void streamSamples() {
+  // One client ending its lease must not stop the samples for another, so with a lease per
+  // client the stream runs as long as the longest of them.
+  int32_t leaseMs = transport.streamLeaseMs();
+  if (leaseMs >= 0) {
+    sampleStream.request((uint16_t)leaseMs);
+  }
 
-      bool isReadingError = !isCalibrated || !sensorValue[cellIndex].isValid();
+  uint8_t frames[STREAM_MAX_BATCH_FRAMES][PROTOCOL_MAX_FRAME_SIZE];
+  TransportFrame batch[STREAM_MAX_BATCH_FRAMES];
+  size_t count = 0;
+  size_t batchLength = 0;
+  uint8_t payload[PROTOCOL_MAX_PAYLOAD_SIZE];
+  size_t length;
+
+  while ((length = sampleStream.nextBatch(payload, sizeof(payload))) > 0) {
+    if (count == STREAM_MAX_BATCH_FRAMES || (count > 0 && batchLength + length + FRAME_OVERHEAD > transport.mtu())) {
+      transport.sendBatch(batch, count, TRANSPORT_KIND_SAMPLES);
+      count = 0;
+      batchLength = 0;
+    }
+    batch[count].data = frames[count];
+    batch[count].length = encodeFrame(FRAME_SAMPLES, sampleSequence++, micros(), payload, length, frames[count],
+      sizeof(frames[count]));
+    batchLength += batch[count].length;
+    count++;
+  }
+  if (count > 0) {
+    transport.sendBatch(batch, count, TRANSPORT_KIND_SAMPLES);
+  }
+}
 
-      sensorValue[cellIndex].sensorWarning = isReadingError;
+/// @brief Frame the payload with the next sequence number and queue it for the clients.
+bool sendFrame(uint8_t type, const void *payload, size_t length, uint8_t kind) {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  TransportFrame batch = { frame, encodeFrame(type, frameSequence++, micros(), payload, length, frame, sizeof(frame)) };
+  return batch.length > 0 && transport.sendBatch(&batch, 1, kind);
+}
 
-      if (!isReadingError && !sensorValue[cellIndex].isDisabledByMenu) {
-        o2Percent += sensorValue[cellIndex].o2Percent;
-        validReadingsCount++;
+/*
+ * Send 'p' over serial for a profile report right away, 'r' to start a new measurement window,
+ * 'c' to switch to the next solenoid controller, 't' to start or stop a trace of the sensor input,
+ * 'i' to identify the stick model of the PI controller.
+*/
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    int command = Serial.read();
+
+    if (command == 'p') {
+      reportProfiles();
+    } else if (command == 'r') {
+      profiler.reset();
+      uiScheduler.resetStats();
+      Widget::resetStats();
+#ifdef TFT_BUS_PROFILE
+      TFT_eSPI::busProfileReset();
+#endif
+      requestControlProfilerReset();
+      Serial.println("Profile reset");
+    } else if (command == 'c') {
+      settings.controllerMode = (settings.controllerMode + 1) % CONTROLLER_COUNT;
+      persistControllerMode(settings.controllerMode);
+      applySettings();
+      Serial.printf("Solenoid controller: %s\r\n", controllerName(settings.controllerMode));
+      if (settings.controllerMode == CONTROLLER_SMITH_PI && !hasSmithPiModel()) {
+        Serial.println("No stick model identified yet, press 'i' before trusting the PI");
+      }
+    } else if (command == 'i') {
+      Serial.println("Identifying the stick model, the valve opens once for a few seconds...");
+      settings.identificationRequest++;
+      applySettings();
+    } else if (command == 't') {
+      settings.isTracing = !settings.isTracing;
+      applySettings();
+      if (settings.isTracing) {
+        Serial.println("Trace started");
+      } else {
+        Serial.printf("Trace stopped, %u records sent, %u dropped\r\n", (unsigned)traceRecorder.recordsSent(),
+          (unsigned)traceRecorder.recordsDropped());
       }
-
     }
+  }
+}
 
-    // Calculate combined percentage
-    systemState.isReadingError = validReadingsCount == 0;
-    if (validReadingsCount > 0) {
-      systemState.o2 = o2Percent / validReadingsCount;
-    } else {
-      systemState.o2 = -1;
-    }
+/*
+ * Send the queued trace records, see trace.h.
+*/
+void flushTrace() {
+  traceRecorder.flush(Serial);
+}
 
-    lastReadMillis = millis();    
-  }  
+/*
+ * Print the profile every PROFILE_REPORT_INTERVAL and send a summary to the clients.
+*/
+void reportProfile() {
+  const ControlStats *controlStats = reportProfiles();
+
+  profiler.fillPayload(profilePayload);
+  // The control phases are timed by the control task.
+  ProfilePhase controlPhases[] = { PHASE_SENSOR, PHASE_POTENTIOMETER, PHASE_SOLENOID, PHASE_SOLENOID_INTERVAL };
+  for (ProfilePhase phase : controlPhases) {
+    profilePayload.phases[phase] = controlStats ? controlStats->profiler.summary(phase) : PhaseSummary();
+  }
+#if TELEMETRY_TRANSPORT == TRANSPORT_ESP_NOW
+  // Only the client displays show it.
+  sendFrame(FRAME_PROFILE, &profilePayload, sizeof(profilePayload), TRANSPORT_KIND_ONCE);
+#endif
+}
+
+const ControlStats *reportProfiles() {
+  Serial.println("UI task (core 1)");
+  profiler.report(Serial);
+  uiScheduler.report(Serial);
+  Widget::report(Serial);
+#ifdef TFT_BUS_PROFILE
+  TFT_eSPI::busProfileReport(Serial);
+#endif
+  Serial.println("Control task (core 0)");
+  const ControlStats *controlStats = copyControlStats();
+  if (controlStats) {
+    controlStats->profiler.report(Serial);
+    controlStats->scheduler.report(Serial);
+  } else {
+    Serial.println("Control task did not answer");
+  }
+
+  AcquisitionStats acquisitionStats = acquisition.stats();
+  Serial.printf("Acquisition: %u samples, %u dropped, %u timeouts\r\n", (unsigned)acquisitionStats.samples,
+    (unsigned)acquisitionStats.dropped, (unsigned)acquisitionStats.timeouts);
+  dataLog.report(Serial);
+  transport.report(Serial);
+  sampleStream.report(Serial);
+  return controlStats;
 }
 
 long pressStarted = -1;
@@ -383,227 +489,174 @@ void handleButtons() {
     hasTriggeredClear = false;
   }
 }
-void handlePotentiometer() {
-  int data = analogRead(PIN_POTENTIOMETER);
-  
-  solenoid.maxO2Percent = map(data, 0, 4095, 0, 40);  
+/*
+ * Start a calibration in the control task. It runs in the background, see handleCalibration().
+*/
+void calibrate() {
+  Serial.println("Calibrating...");
+
+  settings.calibrationRequest++;
+  applySettings();
 }
 
-void handleSolenoid() {
-  if (!systemState.isReadingError && systemState.o2 < solenoid.maxO2Percent) {
+CalibrationState lastCalibrationState = CALIBRATION_IDLE;
+unsigned long calibrationEndedAt = 0;
 
-    solenoid.solenoidClosedAt = millis();
+// Drawn over the main oxygen value while a calibration runs and a little after.
+StatusHeader calibrationBanner(0, 0, 320, 90, "CALIBRATING", 4, CALIBRATION_TITLE_Y);
+Label calibrationProgress(145, 65, 50, 16, 2, TFT_GREEN);
+Bar calibrationBar((320 - CALIBRATION_BAR_WIDTH) / 2, 84, CALIBRATION_BAR_WIDTH, 4, TFT_GREEN);
+WidgetGroup calibrationWidgets;
+bool isCalibrationShown = false;
+int drawnMenuOption = -1;   // -1: the menu is not on the screen
 
-    if (!solenoid.isOpen) {
-      digitalWrite(PIN_SOLENOID_SIGNAL, HIGH);
-      solenoid.isOpen = true;
-    }
-  } else {
-    if (solenoid.isOpen) {
-      if ((millis() - solenoid.solenoidClosedAt) > SOLENOID_CLOSE_DELAY) {
-        digitalWrite(PIN_SOLENOID_SIGNAL, LOW);
-        solenoid.isOpen = false;
-      }
-    }
+/*
+ * Follow the calibration in the control task and persist the result once it is committed.
+*/
+void handleCalibration() {
+  CalibrationState state = status.calibration.state;
+
+  if (state == lastCalibrationState) {
+    return;
   }
-}
 
-void calibrate() {
-  Serial.println("Calibrating...");
+  if (state == CALIBRATION_DONE) {
+    Serial.println("Calibration done");
+    persistCalibration();
+    calibrationEndedAt = millis();
+  } else if (state == CALIBRATION_FAILED) {
+    Serial.println("Calibration failed, no readings from the ADS1115");
+    calibrationEndedAt = millis();
+  }
 
-  // renderCalibratingStarted();
-  tft.fillRect(0, 0, 340, 90, TFT_GREEN);
-  tft.setTextColor(TFT_BLACK);
-  tft.drawString("CALIBRATING", 80, 37, 4);
+  lastCalibrationState = state;
+}
 
-  delay(3000);
+IdentificationState lastIdentificationState = IDENTIFICATION_IDLE;
 
-  for (int i = 0; i < RA_SIZE; i++) {
-    handleSensor();
+/*
+ * Follow the identification in the control task and persist the model once it is in use.
+*/
+void handleIdentification() {
+  IdentificationState state = status.identification.state;
 
-    drawCellInfo(0);
-    drawCellInfo(1);
-    
-    delay(100);
+  if (state == lastIdentificationState) {
+    return;
   }
 
-  for (int i = 0; i < 2; i++) {
-    float calibrationVoltage = sensorValue[i].avgMv;
-
-    cellCalibration[i].calibratedAtMs = millis();
-    cellCalibration[i].value = calibrationVoltage;    
+  if (state == IDENTIFICATION_DONE) {
+    const SmithPiConfig &result = status.identification.result;
+    Serial.printf("Stick model: gain %.1f %%, tau %.0f ms, delay %.0f ms, kp %.4f, ki %.4f\r\n", result.modelGainPercent,
+      result.modelTauMs, result.modelDelayMs, result.kp, result.ki);
+    persistSmithPiConfig(result);
+  } else if (state == IDENTIFICATION_FAILED) {
+    Serial.println("Identification failed, the O2 did not hold still, the set-point was too close to it or the "
+      "O2 did not answer the pulse");
   }
 
-  tft.fillRect(0, 0, 340, 90, TFT_GREEN);
-  tft.drawString("DONE", 125, 35, 4);
-  
-  delay(2000);
-
-  persistCalibration();
+  lastIdentificationState = state;
 }
 
 void persistCalibration() {
-  preferences.putFloat("cell1", cellCalibration[0].value);
-  preferences.putFloat("cell2", cellCalibration[1].value);
+  preferences.putFloat("cell1", status.cellCalibration[0].value);
+  preferences.putFloat("cell2", status.cellCalibration[1].value);
 }
-void restoreCalibration() {
-  cellCalibration[0].value = preferences.getFloat("cell1", 0);
-  cellCalibration[1].value = preferences.getFloat("cell2", 0);
+void restoreCalibration(CellCalibration calibration[2]) {
+  calibration[0].value = preferences.getFloat("cell1", 0);
+  calibration[0].calibratedAtMs = 0;
+  calibration[1].value = preferences.getFloat("cell2", 0);
+  calibration[1].calibratedAtMs = 0;
 }
 
-float readOxygenCellVoltage() {
-  float value = ads1115.readADC_Differential_0_1() * gain;
-  float value2 = ads1115.readADC_Differential_2_3() * gain;
-
-  cellReadings[0].addValue(value);
-  cellReadings[1].addValue(value2);
-
-  return value;
+/*
+ * Hand menu changes and calibration requests over to the control task.
+*/
+void applySettings() {
+  controlSettings.write(settings);
 }
 
 void drawInitalScreen() {
-  tft.fillScreen(TFT_BLACK);
-
-  // Draw headers
-  tft.setTextSize(1);
-  tft.setTextColor(TFT_BLACK);
-
-  tft.fillRect(0, 92, CELL_WIDTH, 15, TFT_GREEN);
-  tft.drawString("CELL 1", CELL_PADDING_LEFT, HEADER_ROW_Y, 2);
-
-  tft.fillRect(CELL_WIDTH + CELL_SPACING, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_GREEN);
-  tft.drawString("CELL 2", CELL_PADDING_LEFT + CELL_WIDTH + CELL_SPACING, HEADER_ROW_Y, 2);
-
-  tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_RED);
-  tft.drawString("SOLENOID", 256, HEADER_ROW_Y, 2);
+  mainScreen.clear();
+  calibrationWidgets.invalidate();
+  drawnMenuOption = -1;
 }
 
-void drawMainOxygenValue() {
-  float o2 = systemState.o2;
+void setupCalibrationWidgets() {
+  calibrationWidgets.add(calibrationBanner);
+  calibrationWidgets.add(calibrationProgress);
+  calibrationWidgets.add(calibrationBar);
+}
 
-  tft_percent.fillSprite(TFT_BLACK);
+/// @brief Draw the calibration progress in place of the main oxygen value.
+/// @return false if there is no calibration to show.
+bool drawCalibration() {
+  CalibrationStatus calibration = status.calibration;
+  bool isRunning = calibration.state == CALIBRATION_SETTLING || calibration.state == CALIBRATION_COLLECTING;
+  bool isEnded = calibration.state == CALIBRATION_DONE || calibration.state == CALIBRATION_FAILED;
+  bool isShown = isRunning || (isEnded && millis() - calibrationEndedAt < CALIBRATION_MESSAGE_MS);
+
+  if (isShown != isCalibrationShown) {
+    // Each covers the other, the one coming back has to be drawn in full.
+    calibrationWidgets.invalidate();
+    mainScreen.invalidateOxygen();
+    isCalibrationShown = isShown;
+  }
+  if (!isShown) {
+    return false;
+  }
 
-  if (o2 <0) {
-    tft_percent.setTextColor(TFT_RED);
-    tft_percent.drawString("ERR-1", 0, 0);    
+  if (calibration.state == CALIBRATION_FAILED) {
+    calibrationBanner.set("FAILED", TFT_RED);
+  } else if (calibration.state == CALIBRATION_DONE) {
+    calibrationBanner.set("DONE", TFT_GREEN);
   } else {
-    if (o2 > 40) { 
-      tft_percent.setTextColor(TFT_RED);
-    } else if (o2 > 32) {
-      tft_percent.setTextColor(TFT_ORANGE);
-    } else {
-      tft_percent.setTextColor(TFT_GREEN);
-    }
-
-    int offset = tft_percent.drawFloat(o2, 1, 0, 0);
-    tft_percent.drawString("%", offset, 0);
+    calibrationBanner.set("CALIBRATING", TFT_GREEN);
   }
-
-  tft_percent.pushSprite(0, 0);
-}
-
-// Used in drawing of the solenoid value.
-int lastSolenoidMaxValue = 0;
-bool lastSolenoidOpen = false;
-
-void drawSolenoidValue() {  
-  if (solenoid.isOpen != lastSolenoidOpen) {
-    if (solenoid.isOpen) {
-      tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_GREEN);
-    } else {
-      tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_RED);
-    }
-    tft.setTextColor(TFT_BLACK);
-    tft.drawString("SOLENOID", 256, HEADER_ROW_Y, 2);
-
-    lastSolenoidOpen = solenoid.isOpen;
+  // Banner and progress share the area, a new banner paints over the progress.
+  if (calibrationBanner.dirty()) {
+    calibrationProgress.invalidate();
+    calibrationBar.invalidate();
   }
-
-
-  if (lastSolenoidMaxValue != solenoid.maxO2Percent) {
-    if (solenoid.maxO2Percent > 34) {
-      tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-    } else {
-      tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    }
-
-    tft.setCursor(250, 115, 7);
-    tft.printf("%02d", solenoid.maxO2Percent);
+  if (isRunning) {
+    calibrationProgress.printf(TFT_BLACK, "%3d %%", calibration.progressPercent);
+    calibrationBar.set(calibration.progressPercent, 100, TFT_BLACK);
+    calibrationWidgets.update(tft);
+  } else {
+    calibrationBanner.update(tft);
   }
+  return true;
+}
 
-  lastSolenoidMaxValue = solenoid.maxO2Percent;
+void drawMainOxygenValue() {
+  mainScreen.setOxygen(status.systemState.o2);
+  mainScreen.updateOxygen();
 }
 
-int cellWasDisabled[2] = { -1, -1 };
+void drawSolenoidValue() {
+  mainScreen.setSolenoid(status.solenoid.isOpen, status.solenoid.maxO2Percent);
+  mainScreen.updateSolenoid();
+}
 
 void drawCellInfo(int index) {
-    float o2 = sensorValue[index].o2Percent;
-    float mv = sensorValue[index].avgMv;
-    float calibration = cellCalibration[index].value;
-    bool calibrationIsValid = cellCalibration[index].isValid();
-    bool isDisabled = (sensorValue[index].isValid() == false) || sensorValue[index].isDisabledByMenu;
-
-    int offsetX = index * (CELL_WIDTH + CELL_SPACING);
-
-    // Heading
-    if (cellWasDisabled[index] != (int)isDisabled) {
-      if (isDisabled) {
-        tft.fillRect(offsetX, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_RED);
-      } else {
-        tft.fillRect(offsetX, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_GREEN);
-      }
-      tft.setTextColor(TFT_BLACK);
-
-      tft.drawString(cellHeader[index], offsetX + CELL_PADDING_LEFT, HEADER_ROW_Y, 2);
-
-      cellWasDisabled[index] = (int)isDisabled;
-    }
-
-
-
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    
-    // Draw the current mv measurement
-    int xpos = offsetX;
-
-    if (mv < 7) {
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-    }
-    xpos += tft.drawFloat(mv, 2, offsetX, 112, 2);
-    tft.drawString("  ", xpos, 112, 2); // Clear out background when going from 2 to 1 digit.
-    tft.drawString("mV", offsetX + 12, 127, 2);
-    
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    
-
-    if (!calibrationIsValid) {
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-    }
-    xpos = offsetX;
-    xpos += tft.drawString("Ref: ", offsetX, 150, 1);
-    xpos += tft.drawFloat(calibration, 2, xpos, 150, 1);
-    xpos += tft.drawString(" mV", xpos, 150, 1);
-
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-
-    // Draw the o2 percent
-    if (isDisabled) {
-      tft_percent_cell.fillSprite(TFT_BLACK);
-      tft_percent_cell.setTextColor(TFT_RED);
-      tft_percent_cell.drawString("DISABLED", 0, 0, 2);
-      tft_percent_cell.pushSprite(offsetX + 50, 112);
-    } else {
-      tft_percent_cell.fillSprite(TFT_BLACK);
-      tft_percent_cell.setTextColor(TFT_GREEN);
-      tft_percent_cell.drawFloat(o2, 1, 0, 0);
-      tft_percent_cell.pushSprite(offsetX + 50, 112);
-    }
+  SensorReading &reading = status.sensorValue[index];
+  MainCell cell;
+  cell.mv = reading.avgMv;
+  cell.o2Percent = reading.o2Percent;
+  cell.calibrationMv = status.cellCalibration[index].value;
+  cell.isCalibrationValid = status.cellCalibration[index].isValid();
+  cell.isDisabled = (reading.isValid() == false) || reading.isDisabledByMenu;
+
+  mainScreen.setCell(index, cell);
+  mainScreen.updateCell(index);
 }
 
 
 void drawMenu() {
-  // 
+  if (menuState.selectedOption == drawnMenuOption) {
+    return;
+  }
+  drawnMenuOption = menuState.selectedOption;
+
   tft_menu.fillSprite(TFT_BLACK);
   tft_menu.drawRect(0, 0, 300, 150, TFT_YELLOW);
   tft_menu.drawRect(1, 1, 298, 148, TFT_YELLOW);
@@ -634,13 +687,15 @@ void menuLongClick() {
   }
 
   if (menuState.selectedOption == MENU_ITEM_DISABLE_CELL_1) {
-    sensorValue[0].isDisabledByMenu = !sensorValue[0].isDisabledByMenu;
+    settings.isCellDisabled[0] = !settings.isCellDisabled[0];
   }
 
   if (menuState.selectedOption == MENU_ITEM_DISABLE_CELL_2) {
-    sensorValue[1].isDisabledByMenu = !sensorValue[1].isDisabledByMenu;
+    settings.isCellDisabled[1] = !settings.isCellDisabled[1];
   }
   
+  applySettings();
+
   menuState.isMenuMode = false;
   drawInitalScreen();
 }
@@ -0,0 +1,168 @@
+#include "peers.h"
+
+void PeerRegistry::heard(const uint8_t *mac) {
+  push(mac, false, 0);
+}
+
+void PeerRegistry::streamRequested(const uint8_t *mac, uint16_t leaseMs) {
+  push(mac, true, leaseMs);
+}
+
+void PeerRegistry::push(const uint8_t *mac, bool isStreamRequest, uint16_t leaseMs) {
+  Hello hello;
+  memcpy(hello.mac, mac, ESP_NOW_ETH_ALEN);
+  hello.atMs = millis();
+  hello.isStreamRequest = isStreamRequest;
+  hello.leaseMs = leaseMs;
+  // A lost hello is repeated by the client soon enough, and so is a stream request.
+  hellos.push(hello);
+}
+
+void PeerRegistry::apply(Peer &peer, const Hello &hello) {
+  peer.lastHelloMs = hello.atMs;
+  peer.stats.failedInRow = 0; // It hears the blender again, or at least it is back in range.
+  if (hello.isStreamRequest) {
+    peer.streamUntilMs = hello.atMs + hello.leaseMs;
+  }
+}
+
+void PeerRegistry::update() {
+  uint32_t nowMs = millis();
+  Hello hello;
+
+  while (hellos.pop(hello)) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      int index = find(hello.mac);
+      if (index >= 0) {
+        apply(peers[index], hello);
+        continue;
+      }
+      if (count == PEER_MAX) {
+        rejected++;
+        continue;
+      }
+    }
+
+    esp_now_peer_info_t info;
+    memset(&info, 0, sizeof(info));
+    memcpy(info.peer_addr, hello.mac, ESP_NOW_ETH_ALEN);
+    info.channel = 0;
+    info.encrypt = false;
+    esp_err_t result = esp_now_add_peer(&info);
+    if (result != ESP_OK && result != ESP_ERR_ESPNOW_EXIST) {
+      std::lock_guard<std::mutex> guard(lock);
+      rejected++;
+      continue;
+    }
+
+    Peer peer;
+    memcpy(peer.mac, hello.mac, ESP_NOW_ETH_ALEN);
+    peer.registeredAtMs = hello.atMs;
+    peer.streamUntilMs = hello.atMs;
+    memset(&peer.stats, 0, sizeof(peer.stats));
+    apply(peer, hello);
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      peers[count++] = peer;
+    }
+    Serial.printf("Client %02X:%02X:%02X:%02X:%02X:%02X registered\r\n", peer.mac[0], peer.mac[1], peer.mac[2],
+      peer.mac[3], peer.mac[4], peer.mac[5]);
+  }
+
+  uint8_t expired[PEER_MAX][ESP_NOW_ETH_ALEN];
+  size_t expiredCount = 0;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (size_t i = 0; i < count;) {
+      if (nowMs - peers[i].lastHelloMs <= PEER_TIMEOUT_MS) {
+        i++;
+        continue;
+      }
+      memcpy(expired[expiredCount++], peers[i].mac, ESP_NOW_ETH_ALEN);
+      peers[i] = peers[--count];
+    }
+  }
+
+  for (size_t i = 0; i < expiredCount; i++) {
+    // Frames still queued for it fail with ESP_ERR_ESPNOW_NOT_FOUND.
+    esp_now_del_peer(expired[i]);
+    Serial.printf("Client %02X:%02X:%02X:%02X:%02X:%02X timed out\r\n", expired[i][0], expired[i][1],
+      expired[i][2], expired[i][3], expired[i][4], expired[i][5]);
+  }
+}
+
+size_t PeerRegistry::addresses(uint8_t macs[][ESP_NOW_ETH_ALEN], size_t capacity, bool isStreamOnly) const {
+  std::lock_guard<std::mutex> guard(lock);
+  uint32_t nowMs = millis();
+  size_t copied = 0;
+  for (size_t i = 0; i < count && copied < capacity; i++) {
+    if (!isReachable(peers[i]) || (isStreamOnly && !isStreaming(peers[i], nowMs))) {
+      continue;
+    }
+    memcpy(macs[copied++], peers[i].mac, ESP_NOW_ETH_ALEN);
+  }
+  return copied;
+}
+
+int32_t PeerRegistry::streamLeaseMs() const {
+  std::lock_guard<std::mutex> guard(lock);
+  uint32_t nowMs = millis();
+  int32_t longestMs = 0;
+  for (size_t i = 0; i < count; i++) {
+    int32_t leftMs = (int32_t)(peers[i].streamUntilMs - nowMs);
+    if (isReachable(peers[i]) && leftMs > longestMs) {
+      longestMs = leftMs;
+    }
+  }
+  return longestMs;
+}
+
+void PeerRegistry::recordAttempt(const uint8_t *mac, bool isDelivered, uint32_t rttUs) {
+  std::lock_guard<std::mutex> guard(lock);
+  int index = find(mac);
+  if (index < 0) {
+    return; // Broadcast, or a client that timed out meanwhile.
+  }
+
+  PeerStats &stats = peers[index].stats;
+  stats.attempts++;
+  if (!isDelivered) {
+    stats.failedInRow++;
+  } else {
+    stats.failedInRow = 0;
+    stats.delivered++;
+    stats.totalRttUs += rttUs;
+    if (rttUs > stats.maxRttUs) {
+      stats.maxRttUs = rttUs;
+    }
+  }
+}
+
+void PeerRegistry::report(Print &out) const {
+  std::lock_guard<std::mutex> guard(lock);
+  uint32_t nowMs = millis();
+
+  out.printf("Clients: %u registered, %u turned away\r\n", (unsigned)count, (unsigned)rejected);
+  for (size_t i = 0; i < count; i++) {
+    const Peer &peer = peers[i];
+    const PeerStats &s = peer.stats;
+    float deliveredPercent = s.attempts ? 100.0f * s.delivered / s.attempts : 0;
+    uint32_t avgRttUs = s.delivered ? (uint32_t)(s.totalRttUs / s.delivered) : 0;
+
+    out.printf("  %02X:%02X:%02X:%02X:%02X:%02X %u sent, %.1f%% delivered, RTT avg %u us max %u us, "
+      "up %u s, hello %u ms ago%s%s\r\n", peer.mac[0], peer.mac[1], peer.mac[2], peer.mac[3], peer.mac[4], peer.mac[5],
+      (unsigned)s.attempts, deliveredPercent, (unsigned)avgRttUs, (unsigned)s.maxRttUs,
+      (unsigned)((nowMs - peer.registeredAtMs) / 1000), (unsigned)(nowMs - peer.lastHelloMs),
+      isStreaming(peer, nowMs) ? ", streaming" : "", isReachable(peer) ? "" : ", unreachable");
+  }
+}
+
+int PeerRegistry::find(const uint8_t *mac) const {
+  for (size_t i = 0; i < count; i++) {
+    if (memcmp(peers[i].mac, mac, ESP_NOW_ETH_ALEN) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
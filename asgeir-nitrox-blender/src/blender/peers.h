@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_now.h>
+#include <SpscRing.h>
+
+#include <mutex>
+
+#define PEER_MAX 6                 // Displays around the fill station
+#define PEER_TIMEOUT_MS 10000      // A client that has not said hello for this long is dropped
+#define PEER_HELLO_RING_SIZE 8
+#define PEER_MAX_FAILED_SENDS 12   // In a row, three frames given up: the client is skipped until its next hello
+
+struct PeerStats {
+  uint32_t attempts;    // esp_now_send() calls, retries included
+  uint32_t delivered;   // Acknowledged by the client's radio
+  uint64_t totalRttUs;  // Send to callback of the delivered ones, the MAC retries included
+  uint32_t maxRttUs;
+  uint32_t failedInRow; // Attempts since the last delivered one
+};
+
+struct Peer {
+  uint8_t mac[ESP_NOW_ETH_ALEN];
+  uint32_t registeredAtMs;
+  uint32_t lastHelloMs;
+  uint32_t streamUntilMs;  // End of its stream lease, see stream.h
+  PeerStats stats;
+};
+
+/*
+ * The clients the blender sends to.
+ *
+ * A client announces itself with a broadcast FRAME_HELLO every few seconds. From then
+ * on it gets every frame unicast, so the MAC layer acknowledges and retries them and
+ * the send callback tells whether that client got it. Broadcast is left for discovery:
+ * without any registered client the status goes to everyone, unacknowledged. The raw
+ * samples only go to the clients that hold a stream lease. A client that stops
+ * acknowledging gets nothing from its PEER_MAX_FAILED_SENDS-th failed send until it
+ * says hello again, so its frames do not crowd the radio queue.
+ */
+class PeerRegistry {
+public:
+  /// @brief WiFi task: a client said hello, registered on the next update().
+  void heard(const uint8_t *mac);
+
+  /// @brief WiFi task: a client asked for the samples, which registers it as well.
+  void streamRequested(const uint8_t *mac, uint16_t leaseMs);
+
+  /// @brief UI task: register the clients heard since the last call and drop the silent ones.
+  void update();
+
+  /// @brief UI task: the registered clients to fan a frame out to.
+  /// @param isStreamOnly only the ones with a running stream lease.
+  /// @return number of MAC addresses copied to macs.
+  size_t addresses(uint8_t macs[][ESP_NOW_ETH_ALEN], size_t capacity, bool isStreamOnly = false) const;
+
+  /// @brief UI task: how much longer the longest stream lease runs, 0 if none does.
+  int32_t streamLeaseMs() const;
+
+  /// @brief Radio task: outcome of one esp_now_send() to mac.
+  void recordAttempt(const uint8_t *mac, bool isDelivered, uint32_t rttUs);
+
+  void report(Print &out) const;
+
+private:
+  struct Hello {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    uint32_t atMs;
+    bool isStreamRequest;
+    uint16_t leaseMs;
+  };
+
+  void push(const uint8_t *mac, bool isStreamRequest, uint16_t leaseMs);
+  static void apply(Peer &peer, const Hello &hello);
+  static bool isStreaming(const Peer &peer, uint32_t nowMs) { return (int32_t)(peer.streamUntilMs - nowMs) > 0; }
+  static bool isReachable(const Peer &peer) { return peer.stats.failedInRow < PEER_MAX_FAILED_SENDS; }
+  int find(const uint8_t *mac) const;
+
+  SpscRing<Hello, PEER_HELLO_RING_SIZE> hellos;
+
+  // Guards peers and count, the radio task updates the stats. Only update() changes the list,
+  // and it calls into ESP-NOW and prints without holding it.
+  mutable std::mutex lock;
+  Peer peers[PEER_MAX];
+  size_t count = 0;
+  uint32_t rejected = 0;  // Hellos while full
+};
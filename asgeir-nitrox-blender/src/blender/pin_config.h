@@ -34,4 +34,7 @@
 /*Peripherals*/
 #define PIN_CALIBRATE_BUTTON    1
 #define PIN_POTENTIOMETER       2
-#define PIN_SOLENOID_SIGNAL     3
\ No newline at end of file
+#define PIN_SOLENOID_SIGNAL     3
+#define PIN_ADS_ALERT           10
+#define PIN_UART_TX             43  // Telemetry over UART, see uart.h
+#define PIN_UART_RX             44
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "profiler.h"
+
+static uint32_t cyclesToUs(uint32_t cycles) {
+  return cycles / ESP.getCpuFreqMHz();
+}
+
+void PhaseHistogram::record(uint32_t cycles) {
+  int bucket = cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+  if (bucket >= PROFILE_BUCKETS) {
+    bucket = PROFILE_BUCKETS - 1;
+  }
+
+  buckets[bucket]++;
+  count++;
+  totalCycles += cycles;
+  if (cycles > maxCycles) {
+    maxCycles = cycles;
+  }
+}
+
+uint32_t PhaseHistogram::percentile(float percent) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  uint32_t rank = (uint32_t)ceilf(count * percent / 100.0f);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (int bucket = 0; bucket < PROFILE_BUCKETS; bucket++) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      uint32_t upperBound = bucket == 0 ? 0 : (uint32_t)((1ULL << bucket) - 1);
+      // The worst case is known exactly, never report a percentile above it.
+      return upperBound < maxCycles ? upperBound : maxCycles;
+    }
+  }
+  return maxCycles;
+}
+
+void LoopProfiler::reset() {
+  memset(phases, 0, sizeof(phases));
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    lastIntervalStart[i] = 0;
+  }
+  windowStartedMs = millis();
+}
+
+void LoopProfiler::recordInterval(ProfilePhase phase) {
+  uint32_t cycles = now();
+  if (lastIntervalStart[phase] != 0) {
+    phases[phase].record(cycles - lastIntervalStart[phase]);
+  }
+  lastIntervalStart[phase] = cycles;
+}
+
+PhaseSummary LoopProfiler::summary(ProfilePhase phase) const {
+  const PhaseHistogram &histogram = phases[phase];
+
+  PhaseSummary result;
+  result.count = histogram.count;
+  result.p50Us = cyclesToUs(histogram.percentile(50));
+  result.p99Us = cyclesToUs(histogram.percentile(99));
+  result.maxUs = cyclesToUs(histogram.maxCycles);
+  return result;
+}
+
+void LoopProfiler::fillPayload(ProfilePayload &payload) const {
+  payload.windowMs = millis() - windowStartedMs;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    payload.phases[i] = summary((ProfilePhase)i);
+  }
+}
+
+void LoopProfiler::report(Print &out) const {
+  out.printf("Loop profile, last %lu ms (p50/p99 are log2 bucket upper bounds)\r\n", millis() - windowStartedMs);
+  out.printf("%-20s %10s %10s %10s %10s %10s\r\n", "phase", "count", "avg us", "p50 us", "p99 us", "max us");
+
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    const PhaseHistogram &histogram = phases[i];
+    if (histogram.count == 0) {
+      continue; // Timed by the other task, or not reached yet.
+    }
+
+    PhaseSummary phase = summary((ProfilePhase)i);
+    uint32_t avgUs = histogram.count ? cyclesToUs((uint32_t)(histogram.totalCycles / histogram.count)) : 0;
+
+    out.printf("%-20s %10u %10u %10u %10u %10u\r\n", profilePhaseNames[i], (unsigned)phase.count, (unsigned)avgUs,
+      (unsigned)phase.p50Us, (unsigned)phase.p99Us, (unsigned)phase.maxUs);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Arduino.h>
+#include <LoopProfile.h>
+
+#define PROFILE_BUCKETS 32
+
+/// @brief Latency histogram with log2 buckets, bucket n holds durations in [2^(n-1), 2^n) cycles.
+struct PhaseHistogram {
+  uint32_t buckets[PROFILE_BUCKETS];
+  uint32_t count;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+
+  void record(uint32_t cycles);
+
+  /// @brief Upper bound of the bucket holding the given percentile.
+  /// @param percent 0-100
+  /// @return cycles, 0 if nothing has been recorded.
+  uint32_t percentile(float percent) const;
+};
+
+/*
+ * Times each phase of loop() with the CPU cycle counter. Recording is a couple of
+ * adds and a count-leading-zeros, cheap enough to leave on permanently.
+ */
+class LoopProfiler {
+public:
+  void reset();
+
+  uint32_t now() { return ESP.getCycleCount(); }
+  void record(ProfilePhase phase, uint32_t startCycles) { phases[phase].record(now() - startCycles); }
+
+  /// @brief Record the time since the previous call for the same phase, used for intervals.
+  void recordInterval(ProfilePhase phase);
+
+  PhaseSummary summary(ProfilePhase phase) const;
+  void fillPayload(ProfilePayload &payload) const;
+  void report(Print &out) const;
+
+private:
+  PhaseHistogram phases[PHASE_COUNT];
+  uint32_t lastIntervalStart[PHASE_COUNT];
+  unsigned long windowStartedMs;
+};
+
+/// @brief Run statement and record its duration against phase.
+#define PROFILE(profiler, phase, statement) \
+  do { \
+    uint32_t profileStart = (profiler).now(); \
+    statement; \
+    (profiler).record(phase, profileStart); \
+  } while (0)
@@ -0,0 +1,251 @@
+#include "radio.h"
+
+bool RadioQueue::begin(RadioAttemptHook attemptHook) {
+  this->attemptHook = attemptHook;
+  for (size_t i = 0; i < RADIO_QUEUE_SIZE; i++) {
+    order[i] = i;
+  }
+  memset(backoffs, 0, sizeof(backoffs));
+  BaseType_t created = xTaskCreatePinnedToCore(taskLoop, "radio", 4096, this, RADIO_TASK_PRIORITY, &task,
+    RADIO_TASK_CORE);
+  if (created != pdPASS) {
+    Serial.println("Failed to start radio task");
+    return false;
+  }
+  return true;
+}
+
+bool RadioQueue::send(const uint8_t *mac, const void *data, size_t length, uint8_t kind) {
+  if (task == NULL || length == 0 || length > ESP_NOW_MAX_DATA_LEN) {
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    RadioFrame *slot = NULL;
+
+    if (kind != RADIO_KIND_ONCE) {
+      // The frame on the air can no longer be replaced, the newer one queues behind it.
+      for (size_t i = 0; i < count; i++) {
+        RadioFrame &frame = frames[order[i]];
+        if (order[i] != inFlightSlot && frame.kind == kind && memcmp(frame.mac, mac, ESP_NOW_ETH_ALEN) == 0) {
+          slot = &frame;
+          coalescedCount.fetch_add(1, std::memory_order_relaxed);
+          break;
+        }
+      }
+    }
+
+    if (slot == NULL) {
+      if (count == RADIO_QUEUE_SIZE) {
+        droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      slot = &frames[order[count]];
+      count++;
+      if (count > maxQueued) {
+        maxQueued = count;
+      }
+    }
+
+    memcpy(slot->mac, mac, ESP_NOW_ETH_ALEN);
+    memcpy(slot->data, data, length);
+    slot->length = length;
+    slot->kind = kind;
+    slot->attempts = 0;
+  }
+
+  queuedCount.fetch_add(1, std::memory_order_relaxed);
+  xTaskNotifyGive(task);
+  return true;
+}
+
+void RadioQueue::onSent(esp_now_send_status_t status) {
+  sentAtUs.store(micros(), std::memory_order_relaxed);
+  sentStatus.store(status, std::memory_order_relaxed);
+  sentAttempt.store(++callbackCount, std::memory_order_release);
+  if (task != NULL) {
+    xTaskNotifyGive(task);
+  }
+}
+
+RadioStats RadioQueue::stats() const {
+  RadioStats result;
+  result.queued = queuedCount.load(std::memory_order_relaxed);
+  result.delivered = deliveredCount.load(std::memory_order_relaxed);
+  result.failed = failedCount.load(std::memory_order_relaxed);
+  result.dropped = droppedCount.load(std::memory_order_relaxed);
+  result.coalesced = coalescedCount.load(std::memory_order_relaxed);
+  result.retries = retryCount.load(std::memory_order_relaxed);
+  result.timeouts = timeoutCount.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> guard(lock);
+  result.maxQueued = maxQueued;
+  return result;
+}
+
+void RadioQueue::report(Print &out) const {
+  RadioStats s = stats();
+  out.printf("Radio: %u queued, %u delivered, %u failed, %u dropped, %u coalesced\r\n", (unsigned)s.queued,
+    (unsigned)s.delivered, (unsigned)s.failed, (unsigned)s.dropped, (unsigned)s.coalesced);
+  out.printf("Radio: %u retries, %u timeouts, at most %u of %u queued\r\n", (unsigned)s.retries,
+    (unsigned)s.timeouts, (unsigned)s.maxQueued, (unsigned)RADIO_QUEUE_SIZE);
+}
+
+void RadioQueue::taskLoop(void *parameter) {
+  RadioQueue *self = (RadioQueue *)parameter;
+  RadioFrame frame;
+
+  for (;;) {
+    TickType_t waitTicks;
+    int slot = self->takeNext(frame, waitTicks);
+    if (slot < 0) {
+      // Also woken by send(), a frame to another destination may go right away.
+      ulTaskNotifyTake(pdTRUE, waitTicks);
+      continue;
+    }
+
+    esp_now_send_status_t status = ESP_NOW_SEND_FAIL;
+    uint32_t startedUs = micros();
+    uint32_t callbackAtUs = 0;
+    bool hasCallback = false;
+    if (esp_now_send(frame.mac, frame.data, frame.length) == ESP_OK) {
+      hasCallback = self->waitForCallback(++self->acceptedSends, status, callbackAtUs);
+    }
+    bool isDelivered = hasCallback && status == ESP_NOW_SEND_SUCCESS;
+    if (self->attemptHook != NULL) {
+      // Without a callback the time is how long it was waited for.
+      self->attemptHook(frame.mac, isDelivered, (hasCallback ? callbackAtUs : micros()) - startedUs);
+    }
+    self->updateBackoff(frame.mac, isDelivered);
+    self->finish(slot, isDelivered);
+  }
+}
+
+int RadioQueue::takeNext(RadioFrame &frame, TickType_t &waitTicks) {
+  std::lock_guard<std::mutex> guard(lock);
+  uint32_t nowMs = millis();
+  uint32_t waitMs = UINT32_MAX;
+
+  for (size_t i = 0; i < count; i++) {
+    const RadioFrame &candidate = frames[order[i]];
+
+    // Frames to the same destination go out in the order they were queued.
+    bool isBehind = false;
+    for (size_t j = 0; j < i && !isBehind; j++) {
+      isBehind = memcmp(frames[order[j]].mac, candidate.mac, ESP_NOW_ETH_ALEN) == 0;
+    }
+    if (isBehind) {
+      continue;
+    }
+
+    Backoff *backoff = findBackoff(candidate.mac);
+    int32_t untilRetryMs = backoff != NULL ? (int32_t)(backoff->retryAtMs - nowMs) : 0;
+    if (untilRetryMs > 0) {
+      waitMs = min(waitMs, (uint32_t)untilRetryMs);
+      continue;
+    }
+
+    frame = candidate;
+    inFlightSlot = order[i];
+    return inFlightSlot;
+  }
+
+  waitTicks = waitMs == UINT32_MAX ? portMAX_DELAY : max(pdMS_TO_TICKS(waitMs), (TickType_t)1);
+  return -1;
+}
+
+void RadioQueue::finish(int slot, bool isDelivered) {
+  std::lock_guard<std::mutex> guard(lock);
+  RadioFrame &frame = frames[slot];
+  inFlightSlot = -1;
+  bool isDone = true;
+
+  size_t position = 0;
+  while (order[position] != slot) {
+    position++;
+  }
+
+  if (isDelivered) {
+    deliveredCount.fetch_add(1, std::memory_order_relaxed);
+  } else if (++frame.attempts >= RADIO_MAX_ATTEMPTS) {
+    failedCount.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    // No point in retrying what a queued frame already supersedes.
+    isDone = false;
+    for (size_t i = position + 1; i < count && !isDone && frame.kind != RADIO_KIND_ONCE; i++) {
+      const RadioFrame &newer = frames[order[i]];
+      isDone = newer.kind == frame.kind && memcmp(newer.mac, frame.mac, ESP_NOW_ETH_ALEN) == 0;
+    }
+    if (isDone) {
+      coalescedCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      retryCount.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  if (isDone) {
+    // The slot moves behind the queued ones, to the free slots.
+    memmove(&order[position], &order[position + 1], count - position - 1);
+    order[count - 1] = slot;
+    count--;
+  }
+}
+
+RadioQueue::Backoff *RadioQueue::findBackoff(const uint8_t *mac) {
+  for (size_t i = 0; i < RADIO_BACKOFF_SLOTS; i++) {
+    if (backoffs[i].backoffMs != 0 && memcmp(backoffs[i].mac, mac, ESP_NOW_ETH_ALEN) == 0) {
+      return &backoffs[i];
+    }
+  }
+  return NULL;
+}
+
+void RadioQueue::updateBackoff(const uint8_t *mac, bool isDelivered) {
+  Backoff *backoff = findBackoff(mac);
+  if (isDelivered) {
+    if (backoff != NULL) {
+      backoff->backoffMs = 0;
+    }
+    return;
+  }
+
+  if (backoff == NULL) {
+    // A free slot, or else the one that is due the soonest.
+    uint32_t nowMs = millis();
+    backoff = &backoffs[0];
+    for (size_t i = 0; i < RADIO_BACKOFF_SLOTS && backoff->backoffMs != 0; i++) {
+      if (backoffs[i].backoffMs == 0 ||
+        (int32_t)(backoffs[i].retryAtMs - nowMs) < (int32_t)(backoff->retryAtMs - nowMs)) {
+        backoff = &backoffs[i];
+      }
+    }
+    memcpy(backoff->mac, mac, ESP_NOW_ETH_ALEN);
+    backoff->backoffMs = 0;
+  }
+
+  // Kept after the frame is given up, the next one to the destination waits as well.
+  backoff->backoffMs = backoff->backoffMs == 0 ? RADIO_BACKOFF_MIN_MS :
+    min(backoff->backoffMs * 2, (uint32_t)RADIO_BACKOFF_MAX_MS);
+  backoff->retryAtMs = millis() + backoff->backoffMs;
+}
+
+bool RadioQueue::waitForCallback(uint32_t attempt, esp_now_send_status_t &status, uint32_t &callbackAtUs) {
+  uint32_t startedMs = millis();
+
+  for (;;) {
+    // Earlier numbers are late callbacks of attempts that already timed out.
+    if (sentAttempt.load(std::memory_order_acquire) == attempt) {
+      status = (esp_now_send_status_t)sentStatus.load(std::memory_order_relaxed);
+      callbackAtUs = sentAtUs.load(std::memory_order_relaxed);
+      return true;
+    }
+
+    uint32_t elapsedMs = millis() - startedMs;
+    if (elapsedMs >= RADIO_SEND_TIMEOUT_MS) {
+      timeoutCount.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    // Also woken by send(), the status is checked again either way.
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(RADIO_SEND_TIMEOUT_MS - elapsedMs));
+  }
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Arduino.h>
+#include <esp_now.h>
+
+#include <atomic>
+#include <mutex>
+
+#define RADIO_QUEUE_SIZE 16           // A status and a sample frame for each of PEER_MAX clients, and then some
+#define RADIO_MAX_ATTEMPTS 4          // First send and three retries, then the frame is given up
+#define RADIO_BACKOFF_MIN_MS 5        // Wait after the first failure, doubled on every further one
+#define RADIO_BACKOFF_MAX_MS 160
+#define RADIO_SEND_TIMEOUT_MS 50      // A send callback later than this counts as a failure
+#define RADIO_BACKOFF_SLOTS 8         // Destinations backing off at once, the clients and the broadcast
+#define RADIO_TASK_PRIORITY 2         // Above loop(), the task mostly waits on the callback
+#define RADIO_TASK_CORE 1
+
+// RADIO_KIND_*: frames of the same kind other than RADIO_KIND_ONCE supersede each other while queued.
+#define RADIO_KIND_ONCE 0
+#define RADIO_KIND_STATUS 1
+
+/// @brief Radio task: called after every esp_now_send(), with the time to its send callback.
+typedef void (*RadioAttemptHook)(const uint8_t *mac, bool isDelivered, uint32_t rttUs);
+
+struct RadioFrame {
+  uint8_t mac[ESP_NOW_ETH_ALEN];
+  uint8_t kind;       // RADIO_KIND_*
+  uint8_t attempts;   // Failed sends so far
+  uint8_t length;
+  uint8_t data[ESP_NOW_MAX_DATA_LEN];
+};
+
+struct RadioStats {
+  uint32_t queued;
+  uint32_t delivered;   // Confirmed by the send callback. Broadcasts are never acknowledged, so always.
+  uint32_t failed;      // Given up after RADIO_MAX_ATTEMPTS.
+  uint32_t dropped;     // Queue was full.
+  uint32_t coalesced;   // Replaced by a newer frame of the same kind before it went out.
+  uint32_t retries;
+  uint32_t timeouts;    // No send callback within RADIO_SEND_TIMEOUT_MS.
+  uint16_t maxQueued;
+};
+
+/*
+ * Asynchronous ESP-NOW transmit queue.
+ *
+ * send() copies the frame into a bounded queue and returns, it never waits on the radio.
+ * A task on the UI core hands one frame at a time to esp_now_send() and waits for the
+ * send callback before it takes the next one. A failed frame stays first in line for
+ * its destination and is retried after an exponential backoff. The backoff belongs to
+ * the destination: frames to other clients go ahead meanwhile, so one client out of
+ * range does not hold up the rest. While a status frame waits, a newer one takes its
+ * place instead of queueing behind it, so a bad link never sends stale readings.
+ */
+class RadioQueue {
+public:
+  bool begin(RadioAttemptHook attemptHook = NULL);
+
+  /// @brief Queue a frame for mac, any context except the WiFi task.
+  /// @return false if the queue is full and the frame was dropped.
+  bool send(const uint8_t *mac, const void *data, size_t length, uint8_t kind = RADIO_KIND_ONCE);
+
+  /// @brief Call from the esp_now_register_send_cb() callback.
+  void onSent(esp_now_send_status_t status);
+
+  RadioStats stats() const;
+  void report(Print &out) const;
+
+private:
+  struct Backoff {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    uint32_t backoffMs;   // 0 for a free slot
+    uint32_t retryAtMs;
+  };
+
+  static void taskLoop(void *parameter);
+
+  /// @brief The oldest frame whose destination is not backing off and has no older frame queued.
+  /// @param waitTicks when there is none, how long until a backoff ends, portMAX_DELAY if never.
+  /// @return slot of the frame, -1 if there is none.
+  int takeNext(RadioFrame &frame, TickType_t &waitTicks);
+  void finish(int slot, bool isDelivered);
+  bool waitForCallback(uint32_t attempt, esp_now_send_status_t &status, uint32_t &callbackAtUs);
+
+  // Radio task only.
+  Backoff *findBackoff(const uint8_t *mac);
+  void updateBackoff(const uint8_t *mac, bool isDelivered);
+
+  TaskHandle_t task = NULL;
+  RadioAttemptHook attemptHook = NULL;
+
+  // Guards the queue. Only held for copying frames, never across esp_now_send().
+  mutable std::mutex lock;
+  RadioFrame frames[RADIO_QUEUE_SIZE];
+  // The slots of frames, those of the queued frames first and oldest first, then the free
+  // ones. A frame leaves from anywhere in the queue by moving a few bytes here.
+  uint8_t order[RADIO_QUEUE_SIZE];
+  size_t count = 0;
+  int inFlightSlot = -1;
+
+  Backoff backoffs[RADIO_BACKOFF_SLOTS];  // Radio task only
+
+  // ESP-NOW calls back once per accepted send and in order, so the n-th callback belongs to the
+  // n-th accepted send. A late callback of an attempt that timed out is told apart by its number.
+  uint32_t acceptedSends = 0;              // Radio task only
+  uint32_t callbackCount = 0;              // WiFi task only
+  std::atomic<uint32_t> sentAttempt { 0 }; // Number of the last callback, published after the two below
+  std::atomic<int> sentStatus { -1 };      // esp_now_send_status_t of that callback
+  std::atomic<uint32_t> sentAtUs { 0 };    // micros() of that callback
+
+  std::atomic<uint32_t> queuedCount { 0 };
+  std::atomic<uint32_t> deliveredCount { 0 };
+  std::atomic<uint32_t> failedCount { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+  std::atomic<uint32_t> coalescedCount { 0 };
+  std::atomic<uint32_t> retryCount { 0 };
+  std::atomic<uint32_t> timeoutCount { 0 };
+  uint16_t maxQueued = 0;  // Under lock
+};
@@ -0,0 +1,146 @@
+#include "scheduler.h"
+
+int Scheduler::addJob(const char *name, JobFunction function, uint32_t periodUs, uint8_t priority, uint32_t offsetUs) {
+  if (jobCount >= SCHEDULER_MAX_JOBS) {
+    return -1;
+  }
+
+  if (jobCount == 0) {
+    windowTickUs = micros();
+    windowUs = 0;
+  }
+
+  Job &job = jobs[jobCount];
+  job.name = name;
+  job.function = function;
+  job.periodUs = periodUs;
+  job.priority = priority;
+  job.nextReleaseUs = micros() + offsetUs;
+  memset(&job.stats, 0, sizeof(job.stats));
+
+  return jobCount++;
+}
+
+void Scheduler::advanceWindow(uint32_t nowUs) {
+  windowUs += nowUs - windowTickUs;
+  windowTickUs = nowUs;
+}
+
+int Scheduler::runPending() {
+  advanceWindow(micros());
+
+  bool hasRun[SCHEDULER_MAX_JOBS] = { false };
+  int runCount = 0;
+
+  for (;;) {
+    uint32_t nowUs = micros();
+
+    // Highest priority job that is due, the earliest release wins a tie.
+    int next = -1;
+    for (int i = 0; i < jobCount; i++) {
+      if (hasRun[i] || !isDue(jobs[i].nextReleaseUs, nowUs)) {
+        continue;
+      }
+      if (next < 0 || jobs[i].priority > jobs[next].priority ||
+          (jobs[i].priority == jobs[next].priority && (int32_t)(jobs[i].nextReleaseUs - jobs[next].nextReleaseUs) < 0)) {
+        next = i;
+      }
+    }
+    if (next < 0) {
+      return runCount;
+    }
+
+    Job &job = jobs[next];
+    uint32_t releaseUs = job.nextReleaseUs;
+    uint32_t jitterUs = nowUs - releaseUs;
+
+    job.function();
+
+    uint32_t endUs = micros();
+    uint32_t runUs = endUs - nowUs;
+    busyUs += runUs;
+    hasRun[next] = true;
+    runCount++;
+
+    job.stats.runs++;
+    job.stats.totalRunUs += runUs;
+    if (runUs > job.stats.maxRunUs) {
+      job.stats.maxRunUs = runUs;
+    }
+    if (jitterUs > job.stats.maxJitterUs) {
+      job.stats.maxJitterUs = jitterUs;
+    }
+
+    job.nextReleaseUs = releaseUs + job.periodUs;
+    if (isDue(job.nextReleaseUs, endUs)) {
+      job.stats.overruns++;
+
+      // More than a period behind: drop the releases that already passed instead of
+      // running the job back to back to catch up.
+      uint32_t behind = (endUs - job.nextReleaseUs) / job.periodUs;
+      if (behind > 0) {
+        job.stats.missed += behind;
+        job.nextReleaseUs += behind * job.periodUs;
+      }
+    }
+  }
+}
+
+uint32_t Scheduler::untilNextReleaseUs() const {
+  uint32_t nowUs = micros();
+  uint32_t shortest = UINT32_MAX;
+
+  for (int i = 0; i < jobCount; i++) {
+    if (isDue(jobs[i].nextReleaseUs, nowUs)) {
+      return 0;
+    }
+    uint32_t untilUs = jobs[i].nextReleaseUs - nowUs;
+    if (untilUs < shortest) {
+      shortest = untilUs;
+    }
+  }
+  return shortest;
+}
+
+void Scheduler::sleepUntilNextRelease() {
+  uint32_t untilUs = untilNextReleaseUs();
+  if (untilUs == 0) {
+    return;
+  }
+
+  uint32_t startUs = micros();
+  // vTaskDelay() works in ticks, round up so the job is due when the task wakes.
+  uint32_t tickUs = 1000UL * portTICK_PERIOD_MS;
+  vTaskDelay((untilUs + tickUs - 1) / tickUs);
+  sleptUs += micros() - startUs;
+}
+
+void Scheduler::resetStats() {
+  for (int i = 0; i < jobCount; i++) {
+    memset(&jobs[i].stats, 0, sizeof(jobs[i].stats));
+  }
+  windowTickUs = micros();
+  windowUs = 0;
+  busyUs = 0;
+  sleptUs = 0;
+}
+
+void Scheduler::report(Print &out) const {
+  uint64_t elapsedUs = windowUs + (uint32_t)(micros() - windowTickUs);
+  float busyPercent = elapsedUs ? busyUs * 100.0f / elapsedUs : 0;
+  float sleptPercent = elapsedUs ? sleptUs * 100.0f / elapsedUs : 0;
+
+  out.printf("Scheduler, last %lu ms: %.1f%% in jobs, %.1f%% asleep\r\n", (unsigned long)(elapsedUs / 1000),
+    busyPercent, sleptPercent);
+  out.printf("%-12s %10s %4s %8s %8s %8s %10s %10s %10s\r\n", "job", "period us", "prio", "runs", "missed",
+    "overruns", "jitter us", "avg us", "max us");
+
+  for (int i = 0; i < jobCount; i++) {
+    const Job &job = jobs[i];
+    uint32_t avgUs = job.stats.runs ? (uint32_t)(job.stats.totalRunUs / job.stats.runs) : 0;
+
+    out.printf("%-12s %10u %4u %8u %8u %8u %10u %10u %10u\r\n", job.name, (unsigned)job.periodUs,
+      (unsigned)job.priority, (unsigned)job.stats.runs, (unsigned)job.stats.missed, (unsigned)job.stats.overruns,
+      (unsigned)job.stats.maxJitterUs, (unsigned)avgUs, (unsigned)job.stats.maxRunUs);
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define SCHEDULER_MAX_JOBS 8
+
+typedef void (*JobFunction)();
+
+struct JobStats {
+  uint32_t runs;
+  uint32_t missed;      // Releases skipped because the job was more than a period late.
+  uint32_t overruns;    // Runs that finished after their deadline, the next release.
+  uint32_t maxJitterUs; // Worst start time after the release.
+  uint32_t maxRunUs;
+  uint64_t totalRunUs;
+};
+
+/*
+ * Cooperative fixed-rate scheduler for the jobs of one task.
+ *
+ * Every job is released at exact multiples of its period (the next release is the
+ * previous one plus the period, not "now" plus the period), so execution time never
+ * makes a rate drift. Due jobs run highest priority first. Per job it keeps the start
+ * jitter, run time and overruns, and the scheduler keeps the time nothing was due, so
+ * it shows when one job eats into the budget of another.
+ *
+ * Times are micros(), differences are taken wrap-safe.
+ */
+class Scheduler {
+public:
+  /// @param priority higher runs first when several jobs are due.
+  /// @param offsetUs delay of the first release, to keep jobs with the same period apart.
+  /// @return job id, -1 if there are already SCHEDULER_MAX_JOBS jobs.
+  int addJob(const char *name, JobFunction function, uint32_t periodUs, uint8_t priority, uint32_t offsetUs = 0);
+
+  /// @brief Run every job that is due, each at most once.
+  /// @return number of jobs run.
+  int runPending();
+
+  /// @brief Microseconds until the next release, 0 if a job is due.
+  uint32_t untilNextReleaseUs() const;
+
+  /// @brief Give the CPU away until the next release. Counted as idle time.
+  void sleepUntilNextRelease();
+
+  JobStats stats(int job) const { return jobs[job].stats; }
+  void resetStats();
+  void report(Print &out) const;
+
+private:
+  struct Job {
+    const char *name;
+    JobFunction function;
+    uint32_t periodUs;
+    uint8_t priority;
+    uint32_t nextReleaseUs;
+    JobStats stats;
+  };
+
+  static bool isDue(uint32_t releaseUs, uint32_t nowUs) { return (int32_t)(nowUs - releaseUs) >= 0; }
+
+  // micros() wraps after about 71 minutes, the window is added up in 64 bits on every pass.
+  void advanceWindow(uint32_t nowUs);
+
+  Job jobs[SCHEDULER_MAX_JOBS];
+  int jobCount = 0;
+
+  uint32_t windowTickUs = 0;
+  uint64_t windowUs = 0;
+  uint64_t busyUs = 0;
+  uint64_t sleptUs = 0;
+};
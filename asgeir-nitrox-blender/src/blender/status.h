@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define SENSOR_THRESHOLD_MILLIVOLT_MIN 7
+#define SENSOR_THRESHOLD_MILLIVOLT_MAX 20
+
+struct SolenoidStatus {
+  int maxO2Percent;
+  bool isOpen;
+  long solenoidClosedAt;
+};
+
+struct CellCalibration {
+  float value;
+  long calibratedAtMs;
+  
+  /// @brief If the cell is calibrated at an "reasonable" voltage.. E.g. if calibration was performed when cell was misbehaving.
+  /// @return true if calibration value is within acceptable range.
+  bool isValid() {
+    return value > SENSOR_THRESHOLD_MILLIVOLT_MIN && value < SENSOR_THRESHOLD_MILLIVOLT_MAX;
+  };
+};
+
+struct SensorReading {
+  float avgMv;
+  float o2Percent;
+  bool sensorWarning;
+  bool isDisabledByMenu;
+
+  /// @brief If the cell reading at an "reasonable" voltage.. E.g. if calibration was performed when cell was misbehaving.
+  /// @return true if calibration value is within acceptable range.
+  bool isValid() {
+    return avgMv > SENSOR_THRESHOLD_MILLIVOLT_MIN && avgMv < SENSOR_THRESHOLD_MILLIVOLT_MAX;
+  };
+};
+
+struct SystemStatus {
+  float o2;
+  bool isReadingError;
+};
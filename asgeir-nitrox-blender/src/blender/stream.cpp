@@ -0,0 +1,55 @@
+#include "stream.h"
+
+#include <FixedPoint.h>
+
+void SampleStream::request(uint16_t leaseMs) {
+  activeUntilMs.store(millis() + leaseMs, std::memory_order_relaxed);
+  active.store(leaseMs > 0, std::memory_order_relaxed);
+}
+
+bool SampleStream::isStreaming() const {
+  return active.load(std::memory_order_relaxed) &&
+    (int32_t)(activeUntilMs.load(std::memory_order_relaxed) - millis()) > 0;
+}
+
+void SampleStream::record(uint32_t atMs, float cell1Mv, float cell2Mv) {
+  if (!isStreaming()) {
+    return;
+  }
+
+  StreamSample sample;
+  sample.atMs = atMs;
+  sample.cellMv[0] = toFixed(cell1Mv, PROTOCOL_MV_SCALE);
+  sample.cellMv[1] = toFixed(cell2Mv, PROTOCOL_MV_SCALE);
+  if (!samples.push(sample)) {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+size_t SampleStream::nextBatch(uint8_t *payload, size_t capacity) {
+  while (pendingCount < STREAM_BATCH_SAMPLES && samples.pop(pending[pendingCount])) {
+    pendingCount++;
+  }
+
+  if (pendingCount == 0 || (pendingCount < STREAM_BATCH_SAMPLES && isStreaming())) {
+    return 0;
+  }
+
+  size_t encoded;
+  size_t length = encodeSampleBatch(nextIndex, pending, pendingCount, payload, capacity, encoded);
+
+  // Samples that did not fit lead the next batch.
+  memmove(pending, pending + encoded, (pendingCount - encoded) * sizeof(StreamSample));
+  pendingCount -= encoded;
+  nextIndex += encoded;
+
+  sentCount.fetch_add(encoded, std::memory_order_relaxed);
+  batchCount.fetch_add(1, std::memory_order_relaxed);
+  return length;
+}
+
+void SampleStream::report(Print &out) const {
+  out.printf("Sample stream: %s, %u samples in %u frames, %u dropped\r\n", isStreaming() ? "on" : "off",
+    (unsigned)sentCount.load(std::memory_order_relaxed), (unsigned)batchCount.load(std::memory_order_relaxed),
+    (unsigned)droppedCount.load(std::memory_order_relaxed));
+}
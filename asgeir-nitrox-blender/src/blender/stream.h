@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Protocol.h>
+#include <SpscRing.h>
+
+#include <atomic>
+
+#define STREAM_RING_SIZE 64       // 2 s of samples at 32 Hz
+#define STREAM_BATCH_SAMPLES 16   // Half a second per frame
+#define STREAM_PERIOD_MS 100      // How often the UI task checks for a full batch
+#define STREAM_MAX_BATCH_FRAMES 4 // Frames handed to the transport at once, the ring holds as many
+
+/*
+ * Streams the raw cell samples to a client that asked for them with a
+ * FRAME_STREAM_REQUEST, for live diagnostics.
+ *
+ * While the lease runs, the control task hands every acquisition sample over without
+ * waiting. The UI task packs STREAM_BATCH_SAMPLES of them into one FRAME_SAMPLES frame,
+ * delta coded, so the client gets every sample at fewer frames than the status takes.
+ */
+class SampleStream {
+public:
+  /// @brief Start, renew or with 0 end the lease. From the receiving transport, or the UI task
+  /// for the leases the transport keeps per client.
+  void request(uint16_t leaseMs);
+  bool isStreaming() const;
+
+  /// @brief Control task: queue a sample while streaming, dropped if the UI task falls behind.
+  void record(uint32_t atMs, float cell1Mv, float cell2Mv);
+
+  /// @brief UI task: the next FRAME_SAMPLES payload once a batch is full, or what is left
+  /// once the lease ran out.
+  /// @return payload length, 0 if there is nothing to send yet.
+  size_t nextBatch(uint8_t *payload, size_t capacity);
+
+  void report(Print &out) const;
+
+private:
+  SpscRing<StreamSample, STREAM_RING_SIZE> samples;
+  std::atomic<bool> active { false };
+  std::atomic<uint32_t> activeUntilMs { 0 };
+
+  // UI task only.
+  StreamSample pending[STREAM_BATCH_SAMPLES];
+  size_t pendingCount = 0;
+  uint16_t nextIndex = 0;
+
+  std::atomic<uint32_t> sentCount { 0 };
+  std::atomic<uint32_t> batchCount { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+};
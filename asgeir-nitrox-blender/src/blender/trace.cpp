@@ -0,0 +1,57 @@
+#include "trace.h"
+
+#include <Cobs.h>
+#include <Crc16.h>
+
+void TraceRecorder::start(const TraceHeader &header) {
+  this->header = header;
+  sent.store(0, std::memory_order_relaxed);
+  dropped.store(0, std::memory_order_relaxed);
+  headerPending.store(true, std::memory_order_release);
+  recording.store(true, std::memory_order_relaxed);
+}
+
+void TraceRecorder::stop() {
+  recording.store(false, std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const TraceRecord &record) {
+  if (!isRecording()) {
+    return;
+  }
+  if (!records.push(record)) {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void TraceRecorder::flush(Print &out) {
+  if (headerPending.exchange(false, std::memory_order_acquire)) {
+    writeFrame(out, TRACE_FRAME_HEADER, &header, sizeof(header));
+  }
+
+  TraceRecord record;
+  while (records.pop(record)) {
+    writeFrame(out, TRACE_FRAME_RECORD, &record, sizeof(record));
+    sent.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static_assert(sizeof(TraceRecord) <= sizeof(TraceHeader), "frame buffer is sized for the header");
+
+void TraceRecorder::writeFrame(Print &out, uint8_t type, const void *payload, size_t length) {
+  uint8_t frame[1 + sizeof(TraceHeader) + 2];
+  uint8_t encoded[2 + sizeof(frame) + sizeof(frame) / 254 + 1];
+
+  frame[0] = type;
+  memcpy(frame + 1, payload, length);
+  uint16_t crc = crc16(frame, 1 + length);
+  frame[1 + length] = crc & 0xFF;
+  frame[2 + length] = crc >> 8;
+
+  // Leading zero ends whatever text came before, trailing zero ends the frame.
+  encoded[0] = 0;
+  size_t encodedLength = 1 + cobsEncode(frame, length + 3, encoded + 1);
+  encoded[encodedLength++] = 0;
+
+  out.write(encoded, encodedLength);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Arduino.h>
+#include <SpscRing.h>
+
+#include <atomic>
+
+#define TRACE_MAGIC 0x5254324E // "N2TR"
+#define TRACE_VERSION 1
+#define TRACE_RING_SIZE 128    // 4 s of samples at 64 SPS
+
+#define TRACE_FRAME_HEADER 'H'
+#define TRACE_FRAME_RECORD 'R'
+
+/*
+ * Binary trace of the raw sensor input, for replaying a blend session on the host
+ * (src/replay). A trace file is a TraceHeader followed by TraceRecords, little endian.
+ */
+struct __attribute__((packed)) TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t recordSize;
+  float millivoltsPerCount;
+  float calibrationMv[2];
+  uint8_t controllerMode;
+};
+
+/// @brief One acquisition sample, 10 bytes.
+struct __attribute__((packed)) TraceRecord {
+  uint32_t atMs;
+  int16_t raw[2];          // ADS1115 counts, times millivoltsPerCount is mV.
+  uint16_t potentiometer;  // analogRead() value
+};
+
+/*
+ * Streams a trace over Serial while a session runs.
+ *
+ * The control task hands over records without waiting, the UI task sends them as
+ * frames: a type byte, the header or record and a CRC16, COBS encoded and delimited by
+ * zero bytes. That keeps them apart from the text log on the same port; src/replay
+ * picks the frames out of a raw capture of the port.
+ */
+class TraceRecorder {
+public:
+  /// @brief Control task: begin a trace, the header goes out first.
+  void start(const TraceHeader &header);
+  void stop();
+  bool isRecording() const { return recording.load(std::memory_order_relaxed); }
+
+  /// @brief Control task: queue a record, dropped if the UI task falls behind.
+  void record(const TraceRecord &record);
+
+  /// @brief UI task: send everything queued.
+  void flush(Print &out);
+
+  uint32_t recordsSent() const { return sent.load(std::memory_order_relaxed); }
+  uint32_t recordsDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+  void writeFrame(Print &out, uint8_t type, const void *payload, size_t length);
+
+  SpscRing<TraceRecord, TRACE_RING_SIZE> records;
+  TraceHeader header;
+  std::atomic<bool> headerPending { false };
+  std::atomic<bool> recording { false };
+  std::atomic<uint32_t> sent { 0 };
+  std::atomic<uint32_t> dropped { 0 };
+};
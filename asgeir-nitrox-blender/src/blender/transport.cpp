@@ -0,0 +1,19 @@
+#include "transport.h"
+
+#if TELEMETRY_TRANSPORT == TRANSPORT_ESP_NOW
+#include "espnow.h"
+static EspNowTransport transport;
+#elif TELEMETRY_TRANSPORT == TRANSPORT_BLE
+#include "ble.h"
+static BleTransport transport;
+#elif TELEMETRY_TRANSPORT == TRANSPORT_UART
+#include "uart.h"
+#include "pin_config.h"
+static UartTransport transport(Serial1, PIN_UART_RX, PIN_UART_TX);
+#else
+#error "Unknown TELEMETRY_TRANSPORT"
+#endif
+
+Transport &telemetryTransport() {
+  return transport;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <Arduino.h>
+
+// TRANSPORT_*: values of TELEMETRY_TRANSPORT, set per build in platformio.ini.
+#define TRANSPORT_ESP_NOW 1   // The client displays, see espnow.h
+#define TRANSPORT_BLE 2       // A phone or PC subscribing to GATT notifications, see ble.h
+#define TRANSPORT_UART 3      // A PC on a serial cable, see uart.h
+
+#ifndef TELEMETRY_TRANSPORT
+#define TELEMETRY_TRANSPORT TRANSPORT_ESP_NOW
+#endif
+
+// TRANSPORT_KIND_*: what a batch carries, for the transports that treat them differently.
+#define TRANSPORT_KIND_ONCE 0
+#define TRANSPORT_KIND_STATUS 1   // A newer status may replace a queued one, and it doubles as the beacon
+#define TRANSPORT_KIND_SAMPLES 2  // Only for whoever asked for them with a FRAME_STREAM_REQUEST
+
+/// @brief A protocol frame (Protocol.h) in a batch.
+struct TransportFrame {
+  const uint8_t *data;
+  size_t length;
+};
+
+/// @brief Called with every frame received, in the context of the transport (WiFi task, BLE
+/// task or the UI task for the UART).
+typedef void (*TransportReceiveHook)(const uint8_t *data, size_t length);
+
+/*
+ * How the telemetry gets to whoever listens.
+ *
+ * The blender builds its frames the same way for every transport and hands them over
+ * in batches, so a transport with a large MTU can pack several into one packet. The
+ * frames carry their own length and CRC, a transport only has to deliver the bytes in
+ * order. Exactly one transport is built in, picked with TELEMETRY_TRANSPORT.
+ */
+class Transport {
+public:
+  virtual ~Transport() {}
+
+  virtual const char *name() const = 0;
+
+  /// @brief UI task: bring the link up, frames received from then on go to receiveHook.
+  virtual bool begin(TransportReceiveHook receiveHook) = 0;
+
+  /// @brief Largest packet the link carries right now, frames are packed up to it.
+  virtual size_t mtu() const = 0;
+
+  /// @brief UI task: queue the frames, in order, never waits on the link.
+  /// @return false if any of them was dropped or nobody listens.
+  virtual bool sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) = 0;
+
+  /// @brief UI task: housekeeping and, for the UART, reading what came in.
+  virtual void poll() {}
+
+  /// @brief UI task: how much longer the longest stream lease of the clients runs, for a
+  /// transport that keeps one per client. -1 if it does not, a FRAME_STREAM_REQUEST then
+  /// holds for the whole link.
+  virtual int32_t streamLeaseMs() const { return -1; }
+
+  virtual void report(Print &out) const = 0;
+};
+
+/// @brief The transport selected with TELEMETRY_TRANSPORT.
+Transport &telemetryTransport();
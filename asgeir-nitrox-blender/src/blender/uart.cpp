@@ -0,0 +1,98 @@
+#include "uart.h"
+
+#include <Cobs.h>
+
+bool UartTransport::begin(TransportReceiveHook receiveHook) {
+  this->receiveHook = receiveHook;
+  port.setTxBufferSize(UART_TX_BUFFER_SIZE);
+  port.begin(UART_BAUD, SERIAL_8N1, rxPin, txPin);
+  return true;
+}
+
+bool UartTransport::sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) {
+  uint8_t buffer[UART_MTU + UART_MTU / 254 + 2];
+  // Leading zero ends whatever a receiver got before, every frame ends with one.
+  buffer[0] = 0;
+  size_t length = 1;
+  size_t pending = 0;
+  bool isSent = true;
+
+  for (size_t i = 0; i <= count; i++) {
+    bool isLast = i == count;
+    size_t needed = isLast ? 0 : cobsMaxEncodedLength(frames[i].length) + 1;
+    if (pending > 0 && (isLast || length + needed > sizeof(buffer))) {
+      isSent = flush(buffer, length, pending) && isSent;
+      length = 1;
+      pending = 0;
+    }
+    if (isLast) {
+      break;
+    }
+    if (length + needed > sizeof(buffer)) {
+      droppedCount.fetch_add(1, std::memory_order_relaxed);
+      isSent = false;
+      continue;
+    }
+    length += cobsEncode(frames[i].data, frames[i].length, buffer + length);
+    buffer[length++] = 0;
+    pending++;
+  }
+  return isSent;
+}
+
+bool UartTransport::flush(const uint8_t *buffer, size_t length, size_t frameCount) {
+  // Never wait on the port, a PC that does not keep up loses whole batches.
+  if ((size_t)port.availableForWrite() < length) {
+    droppedCount.fetch_add(frameCount, std::memory_order_relaxed);
+    return false;
+  }
+  port.write(buffer, length);
+  sentCount.fetch_add(frameCount, std::memory_order_relaxed);
+  sentBytes.fetch_add(length, std::memory_order_relaxed);
+  return true;
+}
+
+void UartTransport::poll() {
+  while (port.available() > 0) {
+    uint8_t c = port.read();
+    if (c != 0) {
+      if (rxLength < sizeof(rxBuffer)) {
+        rxBuffer[rxLength++] = c;
+      } else {
+        isRxOverflow = true;
+      }
+      continue;
+    }
+
+    if (rxLength > 0) {
+      if (isRxOverflow) {
+        badCount.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        received(rxBuffer, rxLength);
+      }
+    }
+    rxLength = 0;
+    isRxOverflow = false;
+  }
+}
+
+void UartTransport::received(const uint8_t *data, size_t length) {
+  uint8_t frame[UART_RX_FRAME_SIZE];
+  size_t frameLength = cobsDecode(data, length, frame, sizeof(frame));
+  if (frameLength == 0) {
+    badCount.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  receivedCount.fetch_add(1, std::memory_order_relaxed);
+  if (receiveHook != NULL) {
+    receiveHook(frame, frameLength);
+  }
+}
+
+void UartTransport::report(Print &out) const {
+  out.printf("UART: %u frames sent in %u bytes, %u dropped, %u received, %u undecodable\r\n",
+    (unsigned)sentCount.load(std::memory_order_relaxed), (unsigned)sentBytes.load(std::memory_order_relaxed),
+    (unsigned)droppedCount.load(std::memory_order_relaxed), (unsigned)receivedCount.load(std::memory_order_relaxed),
+    (unsigned)badCount.load(std::memory_order_relaxed));
+}
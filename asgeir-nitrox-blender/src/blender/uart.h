@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Protocol.h>
+
+#include <atomic>
+
+#include "transport.h"
+
+#define UART_BAUD 921600
+#define UART_MTU 1024                 // Bytes per write, a batch of frames goes out in one
+#define UART_TX_BUFFER_SIZE 4096      // The driver's ring, a write only blocks once it is full
+#define UART_RX_FRAME_SIZE (PROTOCOL_MAX_FRAME_SIZE + 8)
+
+/*
+ * Protocol frames on a serial port, for a PC on a USB-UART cable.
+ *
+ * Every frame is COBS encoded and delimited by zero bytes, like the traces (trace.h),
+ * so a receiver that starts in the middle of the stream or loses a byte picks up again
+ * at the next zero. A cable has no notion of a listener, the status is always sent and
+ * the samples once the PC asked for them with a FRAME_STREAM_REQUEST.
+ */
+class UartTransport : public Transport {
+public:
+  UartTransport(HardwareSerial &port, int rxPin, int txPin) : port(port), rxPin(rxPin), txPin(txPin) {}
+
+  const char *name() const override { return "UART"; }
+  bool begin(TransportReceiveHook receiveHook) override;
+  size_t mtu() const override { return UART_MTU; }
+  bool sendBatch(const TransportFrame *frames, size_t count, uint8_t kind) override;
+
+  /// @brief Decodes the bytes received since the last call, whole frames go to the receive hook.
+  void poll() override;
+
+  void report(Print &out) const override;
+
+private:
+  bool flush(const uint8_t *buffer, size_t length, size_t frameCount);
+  void received(const uint8_t *data, size_t length);
+
+  HardwareSerial &port;
+  int rxPin;
+  int txPin;
+  TransportReceiveHook receiveHook = NULL;
+
+  // UI task only.
+  uint8_t rxBuffer[UART_RX_FRAME_SIZE];
+  size_t rxLength = 0;
+  bool isRxOverflow = false;
+
+  std::atomic<uint32_t> sentCount { 0 };
+  std::atomic<uint32_t> sentBytes { 0 };
+  std::atomic<uint32_t> droppedCount { 0 };
+  std::atomic<uint32_t> receivedCount { 0 };
+  std::atomic<uint32_t> badCount { 0 };
+};
@@ -0,0 +1,137 @@
+#include "link.h"
+
+void LinkHistogram::record(uint32_t value) {
+  int bucket = value == 0 ? 0 : 32 - __builtin_clz(value);
+  if (bucket >= LINK_BUCKETS) {
+    bucket = LINK_BUCKETS - 1;
+  }
+
+  buckets[bucket]++;
+  count++;
+  if (value > maxValue) {
+    maxValue = value;
+  }
+}
+
+uint32_t LinkHistogram::percentile(float percent) const {
+  if (count == 0) {
+    return 0;
+  }
+
+  uint32_t rank = (uint32_t)ceilf(count * percent / 100.0f);
+  if (rank == 0) {
+    rank = 1;
+  }
+
+  uint32_t seen = 0;
+  for (int bucket = 0; bucket < LINK_BUCKETS; bucket++) {
+    seen += buckets[bucket];
+    if (seen >= rank) {
+      uint32_t upperBound = bucket == 0 ? 0 : (uint32_t)((1ULL << bucket) - 1);
+      return upperBound < maxValue ? upperBound : maxValue;
+    }
+  }
+  return maxValue;
+}
+
+void LinkMonitor::record(const FrameHeader &header, uint32_t receivedAtUs, int8_t rssi) {
+  uint32_t nowMs = millis();
+  // The client's clock minus the blender's plus the time on the way, modulo 2^32 like micros().
+  uint32_t transit = receivedAtUs - header.sentAtUs;
+  int32_t gap = (int16_t)(header.sequence - current.lastSequence);
+
+  bool isResync = !hasFrame || nowMs - current.lastFrameAtMs > LINK_RESYNC_MS || abs(gap) > LINK_MAX_GAP;
+  if (isResync) {
+    resync(transit);
+  } else if (gap <= 0) {
+    current.reordered++;
+  } else if (gap > 1) {
+    current.lost += gap - 1;
+    current.gaps++;
+    current.gapLength.record(gap - 1);
+  }
+
+  if (nowMs - windowStartedMs > LINK_OFFSET_WINDOW_MS) {
+    previousMinTransit = windowMinTransit;
+    windowMinTransit = transit;
+    windowStartedMs = nowMs;
+  } else if ((int32_t)(transit - windowMinTransit) < 0) {
+    windowMinTransit = transit;
+  }
+  uint32_t offset = (int32_t)(previousMinTransit - windowMinTransit) < 0 ? previousMinTransit : windowMinTransit;
+  uint32_t latencyUs = transit - offset;
+  current.latencyUs.record(latencyUs);
+  current.lastLatencyUs = latencyUs;
+
+  if (!isResync && gap > 0) {
+    // Only between frames in order, a reordered one would count twice.
+    uint32_t change = abs((int32_t)(transit - lastTransit));
+    current.jitterUs.record(change);
+    current.jitterUsSmoothed += ((int32_t)change - (int32_t)current.jitterUsSmoothed) / 16;
+  }
+  if (isResync || gap > 0) {
+    current.lastSequence = header.sequence;
+    lastTransit = transit;
+  }
+
+  if (rssi != LINK_RSSI_UNKNOWN) {
+    int bucket = constrain((rssi - LINK_RSSI_MIN) / LINK_RSSI_STEP, 0, LINK_RSSI_BUCKETS - 1);
+    current.rssiBuckets[bucket]++;
+    if (current.minRssi == LINK_RSSI_UNKNOWN || rssi < current.minRssi) {
+      current.minRssi = rssi;
+    }
+    current.lastRssi = rssi;
+  }
+
+  current.frames++;
+  current.lastFrameAtMs = nowMs;
+  published.write(current);
+}
+
+/*
+ * Start over on the sequence and the clock offset, the histograms are kept.
+*/
+void LinkMonitor::resync(uint32_t transit) {
+  if (hasFrame) {
+    current.resyncs++;
+  }
+  hasFrame = true;
+  windowMinTransit = transit;
+  previousMinTransit = transit;
+  windowStartedMs = millis();
+}
+
+static void printHistogram(Print &out, const char *name, const LinkHistogram &histogram) {
+  out.printf("%-18s %10s\r\n", name, "count");
+  for (int bucket = 0; bucket < LINK_BUCKETS; bucket++) {
+    if (histogram.buckets[bucket] == 0) {
+      continue;
+    }
+    uint32_t low = bucket == 0 ? 0 : 1UL << (bucket - 1);
+    uint32_t high = bucket == 0 ? 0 : (uint32_t)((1ULL << bucket) - 1);
+    out.printf("%8u - %-8u %10u\r\n", (unsigned)low, (unsigned)high, (unsigned)histogram.buckets[bucket]);
+  }
+}
+
+void LinkMonitor::report(Print &out) const {
+  LinkStats s = stats();
+  out.printf("Link: %u frames, %u lost in %u gaps, %u reordered, %u resyncs, last %u ms ago\r\n",
+    (unsigned)s.frames, (unsigned)s.lost, (unsigned)s.gaps, (unsigned)s.reordered, (unsigned)s.resyncs,
+    (unsigned)(s.frames ? millis() - s.lastFrameAtMs : 0));
+  out.printf("Link: latency p50 %u us, p99 %u us, max %u us, jitter %u us\r\n",
+    (unsigned)s.latencyUs.percentile(50), (unsigned)s.latencyUs.percentile(99), (unsigned)s.latencyUs.maxValue,
+    (unsigned)s.jitterUsSmoothed);
+  out.printf("Link: RSSI %d dBm, lowest %d dBm\r\n", s.lastRssi, s.minRssi);
+
+  printHistogram(out, "Latency (us)", s.latencyUs);
+  printHistogram(out, "Jitter (us)", s.jitterUs);
+  printHistogram(out, "Gap (frames)", s.gapLength);
+
+  out.printf("%-18s %10s\r\n", "RSSI (dBm)", "count");
+  for (int bucket = 0; bucket < LINK_RSSI_BUCKETS; bucket++) {
+    if (s.rssiBuckets[bucket] > 0) {
+      int low = LINK_RSSI_MIN + bucket * LINK_RSSI_STEP;
+      out.printf("%8d - %-8d %10u\r\n", low, low + LINK_RSSI_STEP - 1, (unsigned)s.rssiBuckets[bucket]);
+    }
+  }
+}
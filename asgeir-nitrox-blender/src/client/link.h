@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Protocol.h>
+#include <Seqlock.h>
+
+#define LINK_BUCKETS 24
+#define LINK_OFFSET_WINDOW_MS 10000   // Clock offset: fastest frame of this window and the one before
+#define LINK_RESYNC_MS 5000           // Without a frame for this long the blender may have rebooted, start over
+#define LINK_MAX_GAP 1000             // A larger sequence jump is a new blender, not lost frames
+#define LINK_RSSI_MIN -100            // RSSI histogram: LINK_RSSI_STEP dB buckets from here up
+#define LINK_RSSI_STEP 5
+#define LINK_RSSI_BUCKETS 16
+#define LINK_RSSI_UNKNOWN 0           // Not an RSSI, the frame came without one
+
+/// @brief Histogram with log2 buckets, bucket n holds values in [2^(n-1), 2^n).
+struct LinkHistogram {
+  uint32_t buckets[LINK_BUCKETS];
+  uint32_t count;
+  uint32_t maxValue;
+
+  void record(uint32_t value);
+
+  /// @brief Upper bound of the bucket holding the given percentile, 0 if nothing was recorded.
+  /// @param percent 0-100
+  uint32_t percentile(float percent) const;
+};
+
+struct LinkStats {
+  LinkHistogram latencyUs;    // One way, above the fastest frame of the offset window
+  LinkHistogram jitterUs;     // Change of the one way latency from one frame to the next
+  LinkHistogram gapLength;    // Frames missing in a row
+  uint32_t rssiBuckets[LINK_RSSI_BUCKETS];
+  uint32_t frames;
+  uint32_t lost;              // Sequence numbers never seen. Includes status frames the blender replaced while queued.
+  uint32_t gaps;
+  uint32_t reordered;         // Older than the newest frame, duplicates included
+  uint32_t resyncs;
+  uint32_t jitterUsSmoothed;  // RFC 3550 estimate
+  uint16_t lastSequence;
+  int8_t lastRssi;            // LINK_RSSI_UNKNOWN until a frame came with one
+  int8_t minRssi;
+  uint32_t lastFrameAtMs;
+  uint32_t lastLatencyUs;
+};
+
+/*
+ * Link quality of the frames from the blender, from the sequence number and send time
+ * in every FrameHeader.
+ *
+ * The two clocks are not synchronized, so the one way latency is measured against the
+ * fastest frame seen lately: the smallest difference between receive and send time is
+ * taken for the clock offset, and a frame's latency is how much longer it took. Any
+ * constant part, the airtime, is not in it. The minimum is kept over two windows, so the
+ * estimate follows the drift of the two crystals, some 40 us per second.
+ */
+class LinkMonitor {
+public:
+  /// @brief WiFi task: a valid frame from the blender arrived.
+  /// @param receivedAtUs micros() on arrival
+  /// @param rssi dBm, LINK_RSSI_UNKNOWN if unknown
+  void record(const FrameHeader &header, uint32_t receivedAtUs, int8_t rssi);
+
+  /// @brief Any task: the statistics as of the last frame.
+  LinkStats stats() const { return published.read(); }
+  uint32_t version() const { return published.version(); }
+
+  void report(Print &out) const;
+
+private:
+  void resync(uint32_t transit);
+
+  // WiFi task only.
+  LinkStats current = {};
+  bool hasFrame = false;
+  uint32_t windowMinTransit = 0;
+  uint32_t previousMinTransit = 0;
+  uint32_t windowStartedMs = 0;
+  uint32_t lastTransit = 0;
+
+  Seqlock<LinkStats> published;
+};
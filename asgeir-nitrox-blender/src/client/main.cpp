@@ -5,15 +5,23 @@
 #include "img_logo.h"
 #include "pin_config.h"
 #include <esp_now.h>
+#include <esp_wifi.h>
 #include <WiFi.h>
+#include <LoopProfile.h>
+#include <Protocol.h>
+#include <Seqlock.h>
+#include <SpscRing.h>
+#include <MainScreen.h>
 
-#define FONT_LARGE &Dialog_plain_100 // Key label font 2
+#include <atomic>
+
+#include "link.h"
+#include "stations.h"
 
 TFT_eSPI tft = TFT_eSPI();
 
-TFT_eSprite tft_percent = TFT_eSprite(&tft); // Sprite object graph1
-TFT_eSprite tft_percent_cell = TFT_eSprite(&tft); // Sprite object graph1
 TFT_eSprite tft_menu = TFT_eSprite(&tft);
+MainScreen mainScreen(tft);
 
 esp_now_peer_info_t Client;
 #define CHANNEL 1
@@ -21,11 +29,6 @@ esp_now_peer_info_t Client;
 #define DELETEBEFOREPAIR 0
 
 
-#define CELL_WIDTH 120
-#define CELL_SPACING 5
-#define CELL_PADDING_LEFT 40
-#define HEADER_ROW_Y 92
-
 #define O2_I2Caddress 0x48
 
 #define RA_SIZE 40
@@ -34,6 +37,27 @@ esp_now_peer_info_t Client;
 #define SENSOR_THRESHOLD_MILLIVOLT_MIN 7
 #define SENSOR_THRESHOLD_MILLIVOLT_MAX 20
 #define SOLENOID_CLOSE_DELAY 300 // milliseconds
+#define STATUS_STALE_MS 5000     // Without a status for this long the display shows that it has none
+#define LOOP_IDLE_MS 10          // Longest loop() sleeps when no frame wakes it
+#define STREAM_LEASE_MS 10000    // The blender stops streaming this long after the last request
+#define STREAM_RENEW_MS 3000
+#define STREAM_RING_SIZE 256     // 8 s of samples at 32 Hz
+#define HELLO_PERIOD_MS 2000     // Keeps this client registered with the blender, see src/blender/peers.h
+#define DIAGNOSTICS_PERIOD_MS 500 // Redraw of the link page, it shows frame ages
+#define DIAGNOSTICS_TOP_Y 20
+#define DIAGNOSTICS_ROW_HEIGHT 18
+#define DIAGNOSTICS_VALUE_X 90
+#define DIAGNOSTICS_ROWS 7
+#define STATION_GRID_COLUMNS 8    // 8 x 4 cells hold STATION_CAPACITY stations
+#define STATION_GRID_TOP_Y 16
+#define STATION_CELL_WIDTH 40
+#define STATION_CELL_HEIGHT 38
+
+// PAGE_*: what the screen shows, PIN_BUTTON_2 goes to the next one.
+#define PAGE_MAIN 0               // The primary station, see StationTable::primary()
+#define PAGE_LINK 1
+#define PAGE_STATIONS 2
+#define PAGE_COUNT 3
 
 #define MENU_ITEM_CLOSE 0
 #define MENU_ITEM_CLEAR_CALIBRATION 1
@@ -92,24 +116,28 @@ struct MenuOption {
   int actionId;
 };
 
-struct EspNowMessage {
-  SystemStatus systemState;
-  SensorReading readingCell1;
-  SensorReading readingCell2;
-  CellCalibration cellCalibrationCell1;
-  CellCalibration cellCalibrationCell2;
-  SolenoidStatus solenoid;
-};
-
 void drawSolenoidValue();
 void drawCellInfo(int index);
 void drawMainOxygenValue();
 void drawMenu();
 void drawInitalScreen();
+void printProfile(const ProfilePayload &profile);
+void drawScreen();
+void applyStatus(const StatusPayload &status);
+void handleSerialCommands();
+void sendStreamRequest(uint16_t leaseMs);
+void sendHello();
+void printSamples();
+void handleButtons();
+void showPage(int page);
+void drawDiagnostics();
+void updateStations(bool isShown);
+void drawStations();
+void drawStationCell(int slot, uint32_t nowMs);
+void printStations();
 
 float gain = 0.0625F;
 
-const char* cellHeader[2] = { "CELL 1", "CELL 2" };
 MenuOption menuOptions[] = {
   { "Close", MENU_ITEM_CLOSE },
   { "Clear Calibration", MENU_ITEM_CLEAR_CALIBRATION },
@@ -118,22 +146,199 @@ MenuOption menuOptions[] = {
 };
 Menu menuState;
 
+/*
+ * OnDataRecv() runs in the WiFi task and only publishes what it received, through
+ * seqlocks, and wakes loop(). loop() owns everything drawn and redraws only when a
+ * new status is in or when the status goes stale. Every blender heard gets a place in
+ * the station table, the main screen follows the first one.
+ */
+StationTable stations;
+Seqlock<ProfilePayload> receivedProfile;
+TaskHandle_t loopTask = NULL;
+
+// loop() only.
 SystemStatus systemState;
 SensorReading sensorValue[2];
 CellCalibration cellCalibration[2];
 SolenoidStatus solenoid;
-EspNowMessage espMessageData;
+uint32_t drawnStatusVersion = 1;     // A seqlock starts out at version 1, holding zeros
+bool isPrimaryPeered = false;
+uint32_t printedProfileVersion = 0;
+uint32_t statusReceivedAtMs = 0;
+bool hasStatus = false;
+bool isStatusStale = true;
+
+// OnPromiscuousRecv() to OnDataRecv(), both run in the WiFi task.
+int8_t receivedRssi = LINK_RSSI_UNKNOWN;
+uint8_t receivedRssiFrom[6];
+
+std::atomic<uint32_t> acceptedFrames(0);
+std::atomic<uint32_t> staleFrames(0);
+std::atomic<uint32_t> rejectedFrames[FRAME_BAD_CRC + 1]; // Indexed by FrameError
+LinkMonitor linkMonitor;
+
+ezButton pageButton(PIN_BUTTON_2);
+int page = PAGE_MAIN;
+uint32_t diagnosticsDrawnAtMs = 0;
+
+// The rows of the link page, a value is only drawn when it changed.
+#define DIAGNOSTICS_ROW(row, x, width) \
+  Label(x, DIAGNOSTICS_TOP_Y + (row) * DIAGNOSTICS_ROW_HEIGHT, width, DIAGNOSTICS_ROW_HEIGHT, 2)
+#define DIAGNOSTICS_NAME(row) DIAGNOSTICS_ROW(row, 4, DIAGNOSTICS_VALUE_X - 4)
+#define DIAGNOSTICS_VALUE(row) DIAGNOSTICS_ROW(row, DIAGNOSTICS_VALUE_X, 320 - DIAGNOSTICS_VALUE_X)
+Label diagnosticsNames[DIAGNOSTICS_ROWS] = {
+  DIAGNOSTICS_NAME(0), DIAGNOSTICS_NAME(1), DIAGNOSTICS_NAME(2), DIAGNOSTICS_NAME(3), DIAGNOSTICS_NAME(4),
+  DIAGNOSTICS_NAME(5), DIAGNOSTICS_NAME(6),
+};
+Label diagnosticsValues[DIAGNOSTICS_ROWS] = {
+  DIAGNOSTICS_VALUE(0), DIAGNOSTICS_VALUE(1), DIAGNOSTICS_VALUE(2), DIAGNOSTICS_VALUE(3), DIAGNOSTICS_VALUE(4),
+  DIAGNOSTICS_VALUE(5), DIAGNOSTICS_VALUE(6),
+};
+
+// Station grid, loop() only.
+bool isStationStale[STATION_SLOTS];
+uint32_t nextStaleCheckAtMs = 0;  // Earliest time a station shown as fresh goes stale
+bool hasStaleCheck = false;
+size_t drawnStationCount = 0;
+uint32_t stationCellsDrawn = 0;
+uint32_t stationPasses = 0;
+uint32_t maxStationPassUs = 0;
+
+uint8_t broadcastAddress[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+esp_now_peer_info_t peerInfo;
+uint16_t frameSequence = 0;
+uint32_t lastHelloAtMs = 0;
+bool hasSentHello = false;
+
+// Raw samples from the blender, filled by OnDataRecv() and printed by loop().
+SpscRing<StreamSample, STREAM_RING_SIZE> streamSamples;
+bool isStreamRequested = false;
+uint32_t lastStreamRequestAtMs = 0;
+uint16_t nextStreamIndex = 0;
+bool hasStreamIndex = false;
+std::atomic<uint32_t> streamedSamples(0);
+std::atomic<uint32_t> lostSamples(0);    // Index gaps, frames that never arrived
+std::atomic<uint32_t> droppedSamples(0); // Ring was full, loop() fell behind
+
+void applyStatus(const StatusPayload &status) {
+  systemState.o2 = fromFixed(status.o2, PROTOCOL_O2_SCALE);
+  systemState.isReadingError = status.flags & STATUS_FLAG_READING_ERROR;
+  solenoid.maxO2Percent = status.maxO2Percent;
+  solenoid.isOpen = status.flags & STATUS_FLAG_SOLENOID_OPEN;
+
+  for (int i = 0; i < 2; i++) {
+    sensorValue[i].avgMv = fromFixed(status.cellMv[i], PROTOCOL_MV_SCALE);
+    sensorValue[i].o2Percent = fromFixed(status.cellO2[i], PROTOCOL_O2_SCALE);
+    sensorValue[i].sensorWarning = status.flags & (STATUS_FLAG_CELL1_WARNING << i);
+    sensorValue[i].isDisabledByMenu = status.flags & (STATUS_FLAG_CELL1_DISABLED << i);
+    cellCalibration[i].value = fromFixed(status.calibrationMv[i], PROTOCOL_MV_SCALE);
+  }
+}
+
+void handleSamples(const uint8_t *payload, size_t length) {
+  // Static, the WiFi task has little stack.
+  static StreamSample batch[SAMPLE_BATCH_MAX_COUNT];
+  uint16_t index;
+  size_t count = decodeSampleBatch(payload, length, index, batch, SAMPLE_BATCH_MAX_COUNT);
+  if (count == 0) {
+    rejectedFrames[FRAME_BAD_LENGTH]++;
+    return;
+  }
+
+  // The sample frames have a sequence of their own that the stations do not track, the
+  // index stands in for it: the batch before again is a retry whose ack was lost, an older
+  // one a blender that started over.
+  if (hasStreamIndex && (uint16_t)(index + count) == nextStreamIndex) {
+    staleFrames++;
+    return;
+  }
+  acceptedFrames++;
+  if (hasStreamIndex && isNewerSequence(index, nextStreamIndex)) {
+    lostSamples += (uint16_t)(index - nextStreamIndex);
+  }
+  nextStreamIndex = index + count;
+  hasStreamIndex = true;
+
+  for (size_t i = 0; i < count; i++) {
+    if (streamSamples.push(batch[i])) {
+      streamedSamples++;
+    } else {
+      droppedSamples++;
+    }
+  }
+}
+
+/*
+ * ESP-IDF 4.4 hands no RSSI to the ESP-NOW receive callback. Promiscuous mode sees the
+ * same frame just before: an action frame of the vendor specific category with
+ * Espressif's OUI, from the sender in the second address.
+*/
+void OnPromiscuousRecv(void *buf, wifi_promiscuous_pkt_type_t type) {
+  const wifi_promiscuous_pkt_t *packet = (const wifi_promiscuous_pkt_t *)buf;
+  const uint8_t *frame = packet->payload;
+  if (type != WIFI_PKT_MGMT || packet->rx_ctrl.sig_len < 28 || frame[0] != 0xD0 || frame[24] != 127 ||
+      frame[25] != 0x18 || frame[26] != 0xFE || frame[27] != 0x34) {
+    return;
+  }
+  memcpy(receivedRssiFrom, frame + 10, sizeof(receivedRssiFrom));
+  receivedRssi = packet->rx_ctrl.rssi;
+}
 
 // callback when data is received
 void OnDataRecv(const uint8_t * mac, const uint8_t *incomingData, int len) {
-  memcpy(&espMessageData, incomingData, sizeof(espMessageData));
-
-  cellCalibration[0] = espMessageData.cellCalibrationCell1;
-  cellCalibration[1] = espMessageData.cellCalibrationCell2;
-  sensorValue[0] = espMessageData.readingCell1;
-  sensorValue[1] = espMessageData.readingCell2;
-  solenoid = espMessageData.solenoid;
-  systemState = espMessageData.systemState;
+  uint32_t receivedAtUs = micros();
+
+  FrameHeader header;
+  const uint8_t *payload;
+  FrameError error = decodeFrame(incomingData, len, header, payload);
+  if (error != FRAME_OK) {
+    rejectedFrames[error]++;
+    return;
+  }
+  if (header.type == FRAME_HELLO || header.type == FRAME_STREAM_REQUEST) {
+    return; // Another client, its sequence numbers are not the blender's.
+  }
+
+  int slot = stations.claim(mac);
+  if (slot < 0) {
+    return; // Table full, counted there.
+  }
+  bool isPrimary = slot == stations.primary();
+  if (header.type == FRAME_SAMPLES) {
+    // Only sent while this client holds a lease, on a sequence apart from the other frames.
+    if (isPrimary) {
+      handleSamples(payload, header.length);
+      xTaskNotifyGive(loopTask);
+    }
+    return;
+  }
+  if (isPrimary) {
+    int8_t rssi = memcmp(mac, receivedRssiFrom, sizeof(receivedRssiFrom)) == 0 ? receivedRssi : LINK_RSSI_UNKNOWN;
+    linkMonitor.record(header, receivedAtUs, rssi);
+  }
+
+  if (!stations.accept(slot, header.sequence)) {
+    staleFrames++;
+    return;
+  }
+  acceptedFrames++;
+
+  if (header.type == FRAME_STATUS && header.length == sizeof(StatusPayload)) {
+    ReceivedStatus received;
+    memcpy(&received.status, payload, sizeof(received.status));
+    received.receivedAtMs = millis();
+    stations.publish(slot, received);
+  } else if (header.type == FRAME_PROFILE && header.length == sizeof(ProfilePayload)) {
+    if (isPrimary) {
+      ProfilePayload profile;
+      memcpy(&profile, payload, sizeof(profile));
+      receivedProfile.write(profile);
+    }
+  } else if (header.type == FRAME_STATUS || header.type == FRAME_PROFILE) {
+    rejectedFrames[FRAME_BAD_LENGTH]++;
+    return;
+  }
+  xTaskNotifyGive(loopTask);
 }
 
 void setup()
@@ -157,19 +362,19 @@ void setup()
   ledcAttachPin(PIN_LCD_BL, 0);
   ledcWrite(0, 255);
 
+  mainScreen.begin();
   drawInitalScreen();
 
-  tft_percent.setColorDepth(8);
-  tft_percent.createSprite(340, 90);
-  tft_percent.setFreeFont(FONT_LARGE);
-
-  tft_percent_cell.setColorDepth(8);
-  tft_percent_cell.createSprite(CELL_WIDTH - 50, 30);
-  tft_percent_cell.setFreeFont(&FreeSerif18pt7b);
-
   tft_menu.setColorDepth(8);
   tft_menu.createSprite(300, 150);
 
+  pageButton.setDebounceTime(50);
+
+  // Nothing received yet.
+  drawScreen();
+  printedProfileVersion = receivedProfile.version();
+  loopTask = xTaskGetCurrentTaskHandle();
+
   /* Communication */
   // Set device as a Wi-Fi Station
   WiFi.mode(WIFI_STA);
@@ -179,26 +384,169 @@ void setup()
     Serial.println("Error initializing ESP-NOW");
   }
   esp_now_register_recv_cb(OnDataRecv);
-}
 
+  // Only for the RSSI of the ESP-NOW frames, see OnPromiscuousRecv().
+  wifi_promiscuous_filter_t filter = { WIFI_PROMIS_FILTER_MASK_MGMT };
+  esp_wifi_set_promiscuous_filter(&filter);
+  esp_wifi_set_promiscuous_rx_cb(OnPromiscuousRecv);
+  esp_wifi_set_promiscuous(true);
+
+  // Hellos and stream requests go to whichever blender listens.
+  memcpy(peerInfo.peer_addr, broadcastAddress, 6);
+  peerInfo.channel = 0;
+  peerInfo.encrypt = false;
+  if (esp_now_add_peer(&peerInfo) != ESP_OK) {
+    Serial.println("Failed to add peer");
+  }
+}
 
-long lastScreenUpdate = 0;
 
 void loop()
 {
-  if ((millis() - lastScreenUpdate) > 500)
-  {
+  bool isStatusChanged = false;
+  int primary = stations.primary();
+  uint32_t statusVersion = primary >= 0 ? stations.version(primary) : drawnStatusVersion;
+  if (statusVersion != drawnStatusVersion) {
+    // A newer write during the read is picked up on the next pass.
+    drawnStatusVersion = statusVersion;
+    ReceivedStatus received = stations.read(primary);
+    applyStatus(received.status);
+    statusReceivedAtMs = received.receivedAtMs;
+    hasStatus = true;
+    isStatusStale = false;
+    isStatusChanged = true;
+  } else if (hasStatus && !isStatusStale && millis() - statusReceivedAtMs > STATUS_STALE_MS) {
+    isStatusStale = true;
+    isStatusChanged = true;
+  }
+
+  handleButtons();
+  updateStations(page == PAGE_STATIONS);
+  if (page == PAGE_LINK) {
+    if (millis() - diagnosticsDrawnAtMs >= DIAGNOSTICS_PERIOD_MS) {
+      drawDiagnostics();
+    }
+  } else if (page == PAGE_MAIN && isStatusChanged) {
+    drawScreen();
+  }
+#ifdef TFT_BUS_PROFILE
+  TFT_eSPI::busProfileFrame(&Serial);
+#endif
+
+  if (!isPrimaryPeered && primary >= 0) {
+    // Stream requests go to this blender only, the others need not stream.
+    esp_now_peer_info_t primaryPeer = {};
+    memcpy(primaryPeer.peer_addr, stations.mac(primary), ESP_NOW_ETH_ALEN);
+    isPrimaryPeered = esp_now_add_peer(&primaryPeer) == ESP_OK;
+  }
+
+  uint32_t profileVersion = receivedProfile.version();
+  if (profileVersion != printedProfileVersion) {
+    printedProfileVersion = profileVersion;
+    printProfile(receivedProfile.read());
+  }
+
+  handleSerialCommands();
+
+  if (!hasSentHello || millis() - lastHelloAtMs > HELLO_PERIOD_MS) {
+    sendHello();
+  }
+  if (isStreamRequested && millis() - lastStreamRequestAtMs > STREAM_RENEW_MS) {
+    sendStreamRequest(STREAM_LEASE_MS);
+  }
+  printSamples();
+
+  // OnDataRecv() wakes us right away, so a frame is on screen within one redraw.
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LOOP_IDLE_MS));
+}
+
+void drawScreen() {
+  drawMainOxygenValue();
+  drawCellInfo(0);
+  drawCellInfo(1);
+  drawSolenoidValue();
+}
+
+/*
+ * Send 's' over serial to start or stop streaming the raw cell samples from the blender,
+ * 'd' for the link and redraw statistics and 't' for the station table.
+*/
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    int command = Serial.read();
+
+    if (command == 's') {
+      isStreamRequested = !isStreamRequested;
+      sendStreamRequest(isStreamRequested ? STREAM_LEASE_MS : 0);
+      Serial.println(isStreamRequested ? "Stream requested" : "Stream stopped");
+    } else if (command == 'd') {
+      linkMonitor.report(Serial);
+      Widget::report(Serial);
+#ifdef TFT_BUS_PROFILE
+      TFT_eSPI::busProfileReport(Serial);
+#endif
+    } else if (command == 't') {
+      printStations();
+    }
+  }
+}
+
+void handleButtons() {
+  pageButton.loop();
+  if (pageButton.isPressed()) {
+    showPage((page + 1) % PAGE_COUNT);
+  }
+}
+
+void sendStreamRequest(uint16_t leaseMs) {
+  StreamRequestPayload request;
+  request.leaseMs = leaseMs;
+
+  uint8_t frame[sizeof(request) + FRAME_OVERHEAD];
+  size_t length = encodeFrame(FRAME_STREAM_REQUEST, frameSequence++, micros(), &request, sizeof(request), frame,
+    sizeof(frame));
+  esp_now_send(isPrimaryPeered ? stations.mac(stations.primary()) : broadcastAddress, frame, length);
+  lastStreamRequestAtMs = millis();
+}
 
-    drawMainOxygenValue();
+/*
+ * Ask the blender to send to this client unicast, so its radio acknowledges every frame.
+*/
+void sendHello() {
+  uint8_t frame[FRAME_OVERHEAD];
+  size_t length = encodeFrame(FRAME_HELLO, frameSequence++, micros(), NULL, 0, frame, sizeof(frame));
+  esp_now_send(broadcastAddress, frame, length);
+  lastHelloAtMs = millis();
+  hasSentHello = true;
+}
 
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);    
+/*
+ * Print the streamed samples as "ms,cell1 mV,cell2 mV" lines, ready for a plotter.
+*/
+void printSamples() {
+  StreamSample sample;
+  while (streamSamples.pop(sample)) {
+    Serial.printf("%lu,%.2f,%.2f\r\n", (unsigned long)sample.atMs, fromFixed(sample.cellMv[0], PROTOCOL_MV_SCALE),
+      fromFixed(sample.cellMv[1], PROTOCOL_MV_SCALE));
+  }
+}
 
-    drawCellInfo(0);
-    drawCellInfo(1);
-    drawSolenoidValue();
+void printProfile(const ProfilePayload &profile) {
+  Serial.printf("Blender loop profile, last %lu ms\r\n", (unsigned long)profile.windowMs);
+  Serial.printf("%-20s %10s %10s %10s %10s\r\n", "phase", "count", "p50 us", "p99 us", "max us");
 
-    lastScreenUpdate = millis();
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    const PhaseSummary &phase = profile.phases[i];
+    Serial.printf("%-20s %10u %10u %10u %10u\r\n", profilePhaseNames[i], (unsigned)phase.count,
+      (unsigned)phase.p50Us, (unsigned)phase.p99Us, (unsigned)phase.maxUs);
   }
+
+  Serial.printf("Frames: %u accepted, %u stale, %u foreign, %u bad version, %u bad length, %u bad CRC\r\n",
+    (unsigned)acceptedFrames, (unsigned)staleFrames, (unsigned)rejectedFrames[FRAME_FOREIGN],
+    (unsigned)rejectedFrames[FRAME_BAD_VERSION], (unsigned)(rejectedFrames[FRAME_BAD_LENGTH] + rejectedFrames[FRAME_TOO_SHORT]),
+    (unsigned)rejectedFrames[FRAME_BAD_CRC]);
+  Serial.printf("Sample stream: %u samples, %u lost, %u dropped\r\n", (unsigned)streamedSamples,
+    (unsigned)lostSamples, (unsigned)droppedSamples);
 }
 
 
@@ -211,141 +559,238 @@ long pressStarted = -1;
 bool hasTriggeredClear = false;
 
 void drawInitalScreen() {
-  tft.fillScreen(TFT_BLACK);
-
-  // Draw headers
-  tft.setTextSize(1);
-  tft.setTextColor(TFT_BLACK);
+  mainScreen.clear();
+}
 
-  tft.fillRect(0, 92, CELL_WIDTH, 15, TFT_GREEN);
-  tft.drawString("CELL 1", CELL_PADDING_LEFT, HEADER_ROW_Y, 2);
+void drawMainOxygenValue() {
+  if (isStatusStale) {
+    // No word from the blender, an old reading must not pass for the current one.
+    mainScreen.setOxygenText("----", TFT_RED);
+  } else {
+    mainScreen.setOxygen(systemState.o2);
+  }
+  mainScreen.updateOxygen();
+}
 
-  tft.fillRect(CELL_WIDTH + CELL_SPACING, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_GREEN);
-  tft.drawString("CELL 2", CELL_PADDING_LEFT + CELL_WIDTH + CELL_SPACING, HEADER_ROW_Y, 2);
+void drawSolenoidValue() {
+  mainScreen.setSolenoid(solenoid.isOpen, solenoid.maxO2Percent);
+  mainScreen.updateSolenoid();
+}
 
-  tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_RED);
-  tft.drawString("SOLENOID", 256, HEADER_ROW_Y, 2);
+void drawCellInfo(int index) {
+  MainCell cell;
+  cell.mv = sensorValue[index].avgMv;
+  cell.o2Percent = sensorValue[index].o2Percent;
+  cell.calibrationMv = cellCalibration[index].value;
+  cell.isCalibrationValid = cellCalibration[index].isValid();
+  cell.isDisabled = (sensorValue[index].isValid() == false) || sensorValue[index].isDisabledByMenu;
+
+  mainScreen.setCell(index, cell);
+  mainScreen.updateCell(index);
 }
 
-void drawMainOxygenValue() {
-  float o2 = systemState.o2;
+void showPage(int shown) {
+  page = shown;
+  if (page == PAGE_STATIONS) {
+    drawStations();
+    return;
+  }
+  if (page == PAGE_LINK) {
+    tft.fillScreen(TFT_BLACK);
+    tft.fillRect(0, 0, 320, 15, TFT_GREEN);
+    tft.setTextColor(TFT_BLACK);
+    tft.drawString("LINK", 4, 0, 2);
+    for (int row = 0; row < DIAGNOSTICS_ROWS; row++) {
+      diagnosticsNames[row].invalidate();
+      diagnosticsValues[row].invalidate();
+    }
+    drawDiagnostics();
+    return;
+  }
 
-  tft_percent.fillSprite(TFT_BLACK);
+  // Everything drawn only on change has to go on the cleared screen again.
+  drawInitalScreen();
+  drawScreen();
+}
 
-  if (o2 <0) {
-    tft_percent.setTextColor(TFT_RED);
-    tft_percent.drawString("ERR-1", 0, 0);    
-  } else {
-    if (o2 > 40) { 
-      tft_percent.setTextColor(TFT_RED);
-    } else if (o2 > 32) {
-      tft_percent.setTextColor(TFT_ORANGE);
-    } else {
-      tft_percent.setTextColor(TFT_GREEN);
-    }
+static void drawDiagnosticsRow(int row, uint16_t color, const char *label, const char *value) {
+  diagnosticsNames[row].print(label, TFT_GREEN);
+  diagnosticsNames[row].update(tft);
+  diagnosticsValues[row].print(value, color);
+  diagnosticsValues[row].update(tft);
+}
 
-    int offset = tft_percent.drawFloat(o2, 1, 0, 0);
-    tft_percent.drawString("%", offset, 0);
-  }
+/*
+ * The link page: whether frames still arrive, how late and how many go missing. A dead
+ * link shows as aging frames, a stalled blender as frames without fresh status.
+*/
+void drawDiagnostics() {
+  LinkStats s = linkMonitor.stats();
+  uint32_t nowMs = millis();
+  char value[48];
+  diagnosticsDrawnAtMs = nowMs;
+
+  bool isLinkStale = s.frames == 0 || nowMs - s.lastFrameAtMs > STATUS_STALE_MS;
+  snprintf(value, sizeof(value), "%u, last %u ms ago", (unsigned)s.frames,
+    (unsigned)(s.frames ? nowMs - s.lastFrameAtMs : 0));
+  drawDiagnosticsRow(0, isLinkStale ? TFT_RED : TFT_GREEN, "Frames", s.frames ? value : "none");
+
+  snprintf(value, sizeof(value), "%u ms ago", (unsigned)(nowMs - statusReceivedAtMs));
+  drawDiagnosticsRow(1, isStatusStale ? TFT_RED : TFT_GREEN, "Status", hasStatus ? value : "none");
+
+  snprintf(value, sizeof(value), "p50 %.1f  p99 %.1f  max %.1f ms", s.latencyUs.percentile(50) / 1000.0f,
+    s.latencyUs.percentile(99) / 1000.0f, s.latencyUs.maxValue / 1000.0f);
+  drawDiagnosticsRow(2, TFT_GREEN, "Latency", value);
+
+  snprintf(value, sizeof(value), "%.2f ms", s.jitterUsSmoothed / 1000.0f);
+  drawDiagnosticsRow(3, TFT_GREEN, "Jitter", value);
+
+  float lostPercent = s.frames + s.lost ? 100.0f * s.lost / (s.frames + s.lost) : 0;
+  snprintf(value, sizeof(value), "%u (%.1f %%) in %u gaps", (unsigned)s.lost, lostPercent, (unsigned)s.gaps);
+  drawDiagnosticsRow(4, lostPercent > 10 ? TFT_ORANGE : TFT_GREEN, "Lost", value);
+
+  snprintf(value, sizeof(value), "%u, %u resyncs", (unsigned)s.reordered, (unsigned)s.resyncs);
+  drawDiagnosticsRow(5, TFT_GREEN, "Reordered", value);
+
+  snprintf(value, sizeof(value), "%d dBm, lowest %d", s.lastRssi, s.minRssi);
+  drawDiagnosticsRow(6, s.lastRssi < -80 ? TFT_ORANGE : TFT_GREEN, "RSSI",
+    s.lastRssi != LINK_RSSI_UNKNOWN ? value : "unknown");
+}
 
-  tft_percent.pushSprite(0, 0);
+static void scheduleStaleCheck(uint32_t atMs) {
+  if (!hasStaleCheck || (int32_t)(atMs - nextStaleCheckAtMs) < 0) {
+    nextStaleCheckAtMs = atMs;
+    hasStaleCheck = true;
+  }
 }
 
-// Used in drawing of the solenoid value.
-int lastSolenoidMaxValue = 0;
-bool lastSolenoidOpen = false;
+/*
+ * Redraw the stations that sent a status and those that just went stale, so the cost
+ * goes with what changed and not with the number of stations: the changed ones come
+ * from the table's dirty bits, and the stations are only checked for staleness once
+ * the earliest of their deadlines has passed.
+*/
+void updateStations(bool isShown) {
+  int changed[STATION_SLOTS];
+  size_t changedCount = stations.takeChanged(changed, STATION_SLOTS);
+  if (!isShown) {
+    return; // drawStations() starts from scratch when the grid is shown.
+  }
 
-void drawSolenoidValue() {  
-  if (solenoid.isOpen != lastSolenoidOpen) {
-    if (solenoid.isOpen) {
-      tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_GREEN);
-    } else {
-      tft.fillRect(250, HEADER_ROW_Y, 90, 15, TFT_RED);
-    }
-    tft.setTextColor(TFT_BLACK);
-    tft.drawString("SOLENOID", 256, HEADER_ROW_Y, 2);
+  uint32_t startedUs = micros();
+  uint32_t nowMs = millis();
+  size_t drawnBefore = stationCellsDrawn;
 
-    lastSolenoidOpen = solenoid.isOpen;
+  if (stations.count() != drawnStationCount) {
+    drawnStationCount = stations.count();
+    char header[32];
+    snprintf(header, sizeof(header), "STATIONS %u", (unsigned)drawnStationCount);
+    tft.setTextColor(TFT_BLACK, TFT_GREEN);
+    tft.drawString(header, 4, 0, 2);
   }
 
+  for (size_t i = 0; i < changedCount; i++) {
+    drawStationCell(changed[i], nowMs);
+  }
 
-  if (lastSolenoidMaxValue != solenoid.maxO2Percent) {
-    if (solenoid.maxO2Percent > 34) {
-      tft.setTextColor(TFT_ORANGE, TFT_BLACK);
-    } else {
-      tft.setTextColor(TFT_GREEN, TFT_BLACK);
+  if (hasStaleCheck && (int32_t)(nowMs - nextStaleCheckAtMs) >= 0) {
+    hasStaleCheck = false;
+    for (size_t position = 0; position < stations.count(); position++) {
+      int slot = stations.slotAt(position);
+      if (isStationStale[slot]) {
+        continue;
+      }
+      uint32_t receivedAtMs = stations.read(slot).receivedAtMs;
+      if (nowMs - receivedAtMs > STATUS_STALE_MS) {
+        drawStationCell(slot, nowMs);
+      } else {
+        scheduleStaleCheck(receivedAtMs + STATUS_STALE_MS + 1);
+      }
     }
-
-    tft.setCursor(250, 115, 7);
-    tft.printf("%02d", solenoid.maxO2Percent);
   }
 
-  lastSolenoidMaxValue = solenoid.maxO2Percent;
+  if (stationCellsDrawn != drawnBefore) {
+    uint32_t passUs = micros() - startedUs;
+    stationPasses++;
+    if (passUs > maxStationPassUs) {
+      maxStationPassUs = passUs;
+    }
+  }
 }
 
-int cellWasDisabled[2] = { -1, -1 };
+void drawStations() {
+  tft.fillScreen(TFT_BLACK);
+  tft.fillRect(0, 0, 320, 15, TFT_GREEN);
+  drawnStationCount = 0;
+  hasStaleCheck = false;
 
-void drawCellInfo(int index) {
-    float o2 = sensorValue[index].o2Percent;
-    float mv = sensorValue[index].avgMv;
-    float calibration = cellCalibration[index].value;
-    bool calibrationIsValid = cellCalibration[index].isValid();
-    bool isDisabled = (sensorValue[index].isValid() == false) || sensorValue[index].isDisabledByMenu;
-
-    int offsetX = index * (CELL_WIDTH + CELL_SPACING);
-
-    // Heading
-    if (cellWasDisabled[index] != (int)isDisabled) {
-      if (isDisabled) {
-        tft.fillRect(offsetX, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_RED);
-      } else {
-        tft.fillRect(offsetX, HEADER_ROW_Y, CELL_WIDTH, 15, TFT_GREEN);
-      }
-      tft.setTextColor(TFT_BLACK);
+  uint32_t nowMs = millis();
+  for (size_t position = 0; position < stations.count(); position++) {
+    drawStationCell(stations.slotAt(position), nowMs);
+  }
+  updateStations(true);
+}
 
-      tft.drawString(cellHeader[index], offsetX + CELL_PADDING_LEFT, HEADER_ROW_Y, 2);
+/*
+ * One cell of the grid: the last two bytes of the MAC, the O2 and a mark while the valve
+ * is open. Red when stale or without a reading, orange on a cell warning.
+*/
+void drawStationCell(int slot, uint32_t nowMs) {
+  size_t position = stations.positionOf(slot);
+  ReceivedStatus received = stations.read(slot);
+  const StatusPayload &status = received.status;
+  const uint8_t *mac = stations.mac(slot);
+
+  bool isStale = nowMs - received.receivedAtMs > STATUS_STALE_MS;
+  isStationStale[slot] = isStale;
+  if (!isStale) {
+    scheduleStaleCheck(received.receivedAtMs + STATUS_STALE_MS + 1);
+  }
 
-      cellWasDisabled[index] = (int)isDisabled;
-    }
+  uint16_t color = TFT_GREEN;
+  if (isStale || status.o2 < 0 || (status.flags & STATUS_FLAG_READING_ERROR)) {
+    color = TFT_RED;
+  } else if (status.flags & (STATUS_FLAG_CELL1_WARNING | STATUS_FLAG_CELL2_WARNING)) {
+    color = TFT_ORANGE;
+  }
 
+  int x = (position % STATION_GRID_COLUMNS) * STATION_CELL_WIDTH;
+  int y = STATION_GRID_TOP_Y + (position / STATION_GRID_COLUMNS) * STATION_CELL_HEIGHT;
+  char text[12];
 
+  tft.drawRect(x, y, STATION_CELL_WIDTH - 2, STATION_CELL_HEIGHT - 2, color);
+  tft.setTextColor(color, TFT_BLACK);
+  snprintf(text, sizeof(text), "%02X%02X", mac[4], mac[5]);
+  tft.drawString(text, x + 3, y + 3, 1);
 
-    tft.setTextSize(1);
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    
-    // Draw the current mv measurement
-    int xpos = offsetX;
+  // Padded, the spaces clear what a longer value left behind.
+  if (isStale) {
+    snprintf(text, sizeof(text), "---- ");
+  } else if (status.o2 < 0) {
+    snprintf(text, sizeof(text), "ERR  ");
+  } else {
+    snprintf(text, sizeof(text), "%.1f ", fromFixed(status.o2, PROTOCOL_O2_SCALE));
+  }
+  tft.drawString(text, x + 3, y + 16, 2);
 
-    if (mv < 7) {
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-    }
-    xpos += tft.drawFloat(mv, 2, offsetX, 112, 2);
-    tft.drawString("  ", xpos, 112, 2); // Clear out background when going from 2 to 1 digit.
-    tft.drawString("mV", offsetX + 12, 127, 2);
-    
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-    
-
-    if (!calibrationIsValid) {
-      tft.setTextColor(TFT_RED, TFT_BLACK);
-    }
-    xpos = offsetX;
-    xpos += tft.drawString("Ref: ", offsetX, 150, 1);
-    xpos += tft.drawFloat(calibration, 2, xpos, 150, 1);
-    xpos += tft.drawString(" mV", xpos, 150, 1);
-
-    tft.setTextColor(TFT_GREEN, TFT_BLACK);
-
-    // Draw the o2 percent
-    if (isDisabled) {
-      tft_percent_cell.fillSprite(TFT_BLACK);
-      tft_percent_cell.setTextColor(TFT_RED);
-      tft_percent_cell.drawString("DISABLED", 0, 0, 2);
-      tft_percent_cell.pushSprite(offsetX + 50, 112);
-    } else {
-      tft_percent_cell.fillSprite(TFT_BLACK);
-      tft_percent_cell.setTextColor(TFT_GREEN);
-      tft_percent_cell.drawFloat(o2, 1, 0, 0);
-      tft_percent_cell.pushSprite(offsetX + 50, 112);
-    }
+  bool isOpen = !isStale && (status.flags & STATUS_FLAG_SOLENOID_OPEN);
+  tft.fillRect(x + STATION_CELL_WIDTH - 9, y + 3, 5, 5, isOpen ? TFT_GREEN : TFT_BLACK);
+  stationCellsDrawn++;
+}
+
+void printStations() {
+  uint32_t nowMs = millis();
+  Serial.printf("Stations: %u of %u, %u turned away\r\n", (unsigned)stations.count(), (unsigned)STATION_CAPACITY,
+    (unsigned)stations.rejected());
+
+  for (size_t position = 0; position < stations.count(); position++) {
+    int slot = stations.slotAt(position);
+    const uint8_t *mac = stations.mac(slot);
+    ReceivedStatus received = stations.read(slot);
+    Serial.printf("%2u %02X:%02X:%02X:%02X:%02X:%02X %6.2f %% %8u ms ago\r\n", (unsigned)position, mac[0], mac[1],
+      mac[2], mac[3], mac[4], mac[5], fromFixed(received.status.o2, PROTOCOL_O2_SCALE),
+      (unsigned)(nowMs - received.receivedAtMs));
+  }
+  Serial.printf("Station grid: %u cells drawn in %u passes, longest pass %u us\r\n", (unsigned)stationCellsDrawn,
+    (unsigned)stationPasses, (unsigned)maxStationPassUs);
 }
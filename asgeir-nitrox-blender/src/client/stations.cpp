@@ -0,0 +1,76 @@
+#include "stations.h"
+
+uint32_t StationTable::hash(const uint8_t *mac) {
+  // FNV-1a, the vendor part of the MAC is the same for every blender.
+  uint32_t value = 2166136261u;
+  for (int i = 0; i < 6; i++) {
+    value = (value ^ mac[i]) * 16777619u;
+  }
+  return value;
+}
+
+int StationTable::claim(const uint8_t *mac) {
+  uint32_t start = hash(mac) & (STATION_SLOTS - 1);
+
+  for (uint32_t probe = 0; probe < STATION_SLOTS; probe++) {
+    int slot = (start + probe) & (STATION_SLOTS - 1);
+    Station &station = stations[slot];
+
+    if (station.isUsed.load(std::memory_order_relaxed)) {
+      if (memcmp(station.mac, mac, sizeof(station.mac)) == 0) {
+        return slot;
+      }
+      continue;
+    }
+
+    // The first free slot ends the probe run, the station is new.
+    size_t position = stationCount.load(std::memory_order_relaxed);
+    if (position >= STATION_CAPACITY) {
+      rejectedCount.fetch_add(1, std::memory_order_relaxed);
+      return -1;
+    }
+    memcpy(station.mac, mac, sizeof(station.mac));
+    station.position = position;
+    station.isUsed.store(true, std::memory_order_release);
+    order[position] = slot;
+    stationCount.store(position + 1, std::memory_order_release);
+    return slot;
+  }
+  return -1;
+}
+
+bool StationTable::accept(int slot, uint16_t sequence) {
+  Station &station = stations[slot];
+  uint32_t nowMs = millis();
+
+  bool isResync = !station.hasFrame || nowMs - station.lastFrameAtMs > STATION_RESYNC_MS;
+  if (!isResync && !isNewerSequence(sequence, station.lastSequence)) {
+    return false;
+  }
+  station.lastSequence = sequence;
+  station.lastFrameAtMs = nowMs;
+  station.hasFrame = true;
+  return true;
+}
+
+void StationTable::publish(int slot, const ReceivedStatus &received) {
+  stations[slot].status.write(received);
+  dirty[slot / 32].fetch_or(1UL << (slot % 32), std::memory_order_release);
+}
+
+size_t StationTable::takeChanged(int *slots, size_t capacity) {
+  size_t count = 0;
+  for (int word = 0; word < STATION_DIRTY_WORDS; word++) {
+    uint32_t bits = dirty[word].exchange(0, std::memory_order_acquire);
+    while (bits != 0 && count < capacity) {
+      int bit = __builtin_ctz(bits);
+      bits &= bits - 1;
+      slots[count++] = word * 32 + bit;
+    }
+    if (bits != 0) {
+      // No room, leave the rest for the next call.
+      dirty[word].fetch_or(bits, std::memory_order_relaxed);
+    }
+  }
+  return count;
+}
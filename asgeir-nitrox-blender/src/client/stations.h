@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Protocol.h>
+#include <Seqlock.h>
+
+#include <atomic>
+
+#define STATION_CAPACITY 32           // Blenders the client keeps track of, any further one is turned away
+#define STATION_SLOTS 64              // Power of two, at most half full keeps the probe runs short
+#define STATION_RESYNC_MS 5000        // Without a frame for this long any sequence is accepted, the blender may have rebooted.
+#define STATION_DIRTY_WORDS (STATION_SLOTS / 32)
+
+/// @brief A status frame as it arrived, published by OnDataRecv() for loop().
+struct ReceivedStatus {
+  StatusPayload status;
+  uint32_t receivedAtMs;
+};
+
+/*
+ * The blenders heard by the client, keyed by sender MAC.
+ *
+ * A fixed open addressing table with linear probing, no heap. Stations are never
+ * removed, a blender that goes quiet keeps its place and shows as stale, so there are
+ * no tombstones either. The WiFi task is the only writer: it claims slots and publishes
+ * each status through the slot's seqlock. Readers see a slot once isUsed is set, after
+ * its MAC. Every publish also sets the slot's dirty bit, so loop() only has to look at
+ * the stations that changed, however many there are.
+ */
+class StationTable {
+public:
+  /// @brief WiFi task: the slot of mac, a free one is claimed for a new station.
+  /// @return -1 if the table is full.
+  int claim(const uint8_t *mac);
+
+  /// @brief WiFi task: whether a frame with sequence is newer than the last one of the station.
+  /// Duplicates and frames overtaken by a newer one would make the display jump back.
+  bool accept(int slot, uint16_t sequence);
+
+  /// @brief WiFi task: publish a status of the station.
+  void publish(int slot, const ReceivedStatus &received);
+
+  /// @brief Any task: collect the slots published since the last call and clear them.
+  /// @return number of slots written to slots.
+  size_t takeChanged(int *slots, size_t capacity);
+
+  /// @brief Stations in the order they were first heard, position 0 to count() - 1.
+  size_t count() const { return stationCount.load(std::memory_order_acquire); }
+  int slotAt(size_t position) const { return order[position]; }
+  size_t positionOf(int slot) const { return stations[slot].position; }
+
+  /// @brief The first station heard, the one the main screen follows. -1 if none yet.
+  int primary() const { return count() > 0 ? order[0] : -1; }
+
+  const uint8_t *mac(int slot) const { return stations[slot].mac; }
+  ReceivedStatus read(int slot) const { return stations[slot].status.read(); }
+  uint32_t version(int slot) const { return stations[slot].status.version(); }
+  uint32_t rejected() const { return rejectedCount.load(std::memory_order_relaxed); }
+
+private:
+  struct Station {
+    std::atomic<bool> isUsed { false };
+    uint8_t mac[6];                   // Set before isUsed, never changes after
+    uint8_t position;
+    Seqlock<ReceivedStatus> status;
+
+    // WiFi task only.
+    uint16_t lastSequence = 0;
+    uint32_t lastFrameAtMs = 0;
+    bool hasFrame = false;
+  };
+
+  static uint32_t hash(const uint8_t *mac);
+
+  Station stations[STATION_SLOTS];
+  int order[STATION_CAPACITY];
+  std::atomic<size_t> stationCount { 0 };
+  std::atomic<uint32_t> dirty[STATION_DIRTY_WORDS] = {};
+  std::atomic<uint32_t> rejectedCount { 0 };
+};
@@ -0,0 +1,271 @@
+/*
+ * Host check of the ESP32-S3 parallel DMA helpers in
+ * lib/TFT_eSPI/Processors/TFT_eSPI_ESP32_S3_DMA.h.
+ *
+ * First the descriptor chains: every length up to two full screens is linked and the
+ * layout checked. Then random images, clipped and byte swapped, go through the band
+ * ring the way TFT_eSPI_ESP32_S3.c sends them, into a model of the GDMA engine. The
+ * model reads the buffers a few bytes at a time and runs the completion interrupt
+ * when a transfer ends, so a conversion buffer refilled while it is still on the bus
+ * shows up as bytes that differ from the image.
+ *
+ *   pio run -e native-dma-check && .pio/build/native-dma-check/program [images] [seed]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+#include <vector>
+
+#include <TFT_eSPI_ESP32_S3_DMA.h>
+
+// The T-Display S3 panel
+#define SCREEN_PIXELS (170 * 320)
+#define DIRECT_DESCS ((SCREEN_PIXELS * 2 + TFT_DMA_DESC_MAX_BYTES - 1) / TFT_DMA_DESC_MAX_BYTES)
+
+static std::mt19937 rng;
+
+static uint32_t randomBelow(uint32_t n) {
+  return std::uniform_int_distribution<uint32_t>(0, n - 1)(rng);
+}
+
+// What the driver keeps in TFT_eSPI_ESP32_S3.c
+static TFT_DmaRing ring;
+static TFT_DmaDescriptor *queue[TFT_DMA_BUFFERS];
+static TFT_DmaDescriptor chains[TFT_DMA_BUFFERS * TFT_DMA_BAND_DESCS];
+static TFT_DmaDescriptor direct[DIRECT_DESCS];
+static uint16_t buffers[TFT_DMA_BUFFERS][TFT_DMA_BAND_PIXELS];
+
+// The GDMA channel and LCD_CAM
+struct Engine {
+  const TFT_DmaDescriptor *desc = nullptr; // nullptr while idle
+  uint32_t offset = 0;
+  std::vector<uint8_t> bus;                // Bytes clocked out
+  uint32_t transfers = 0;
+  uint32_t errors = 0;
+};
+static Engine engine;
+
+struct Stats {
+  uint32_t images = 0;
+  uint32_t directs = 0;
+  uint32_t bands = 0;
+  uint32_t waits = 0;      // Spins for a free buffer
+  uint32_t mismatches = 0;
+};
+static Stats stats;
+
+static void engineStart(const TFT_DmaDescriptor *chain) {
+  if (engine.desc != nullptr) {
+    printf("transfer started while one is running\n");
+    engine.errors++;
+  }
+  engine.desc = chain;
+  engine.offset = 0;
+}
+
+// dmaComplete()
+static void engineInterrupt() {
+  engine.transfers++;
+  int32_t slot = tftDmaRingRetire(&ring);
+  if (slot >= 0) engineStart(queue[slot]);
+}
+
+// Clock out up to maxBytes, as the DMA and LCD_CAM do while the CPU works
+static void engineStep(uint32_t maxBytes) {
+  while (maxBytes && engine.desc != nullptr) {
+    TFT_DmaDescriptor *desc = const_cast<TFT_DmaDescriptor *>(engine.desc);
+    if (!desc->owner) {
+      printf("descriptor not owned by the DMA\n");
+      engine.errors++;
+      engine.desc = nullptr;
+      engineInterrupt();
+      return;
+    }
+    engine.bus.push_back(((const uint8_t *)desc->buffer)[engine.offset++]);
+    maxBytes--;
+    if (engine.offset < desc->length) continue;
+
+    desc->owner = 0; // auto_update_desc hands it back
+    engine.offset = 0;
+    if (desc->sucEof) {
+      engine.desc = nullptr;
+      engineInterrupt();
+    }
+    else if (desc->next == nullptr) {
+      printf("chain ends without suc_eof\n");
+      engine.errors++;
+      engine.desc = nullptr;
+      engineInterrupt();
+    }
+    else engine.desc = desc->next;
+  }
+}
+
+static void engineIdle() {
+  while (engine.desc != nullptr) engineStep(1024);
+}
+
+// The CPU spins on the ring, the engine must be working on it
+static void engineWait() {
+  if (engine.desc == nullptr) {
+    printf("ring waits for a transfer the engine does not run\nFAILED\n");
+    exit(1);
+  }
+  engineStep(1 + randomBelow(256));
+}
+
+// dmaSubmit()
+static void submit(int32_t slot, TFT_DmaDescriptor *chain) {
+  queue[slot] = chain;
+  if (tftDmaRingSubmit(&ring)) engineStart(chain);
+}
+
+// dmaSendDirect()
+static bool sendDirect(const uint16_t *image, uint32_t len, bool capable) {
+  if (!capable || tftDmaDescriptors(len << 1) > DIRECT_DESCS) return false;
+  while (!tftDmaRingIdle(&ring)) engineWait();
+  tftDmaBuildChain(direct, DIRECT_DESCS, image, len << 1);
+  submit(tftDmaRingAcquire(&ring), direct);
+  stats.directs++;
+  return true;
+}
+
+// dmaSendBands()
+static void sendBands(const uint16_t *image, uint32_t stride, uint32_t width, uint32_t len, bool swap) {
+  for (uint32_t first = 0; first < len; first += TFT_DMA_BAND_PIXELS) {
+    uint32_t count = len - first;
+    if (count > TFT_DMA_BAND_PIXELS) count = TFT_DMA_BAND_PIXELS;
+
+    int32_t slot;
+    while ((slot = tftDmaRingAcquire(&ring)) < 0) {
+      stats.waits++;
+      engineWait();
+    }
+
+    tftDmaCopy(buffers[slot], image, stride, width, first, count, swap);
+    TFT_DmaDescriptor *chain = chains + slot * TFT_DMA_BAND_DESCS;
+    tftDmaBuildChain(chain, TFT_DMA_BAND_DESCS, buffers[slot], count << 1);
+    submit(slot, chain);
+    stats.bands++;
+
+    // The CPU gets a random share of the bus time before the next band
+    engineStep(randomBelow(TFT_DMA_BAND_PIXELS * 3));
+  }
+}
+
+static uint32_t checkChains() {
+  static uint8_t data[SCREEN_PIXELS * 4];
+  static TFT_DmaDescriptor desc[2 * DIRECT_DESCS + 1];
+  uint32_t errors = 0;
+
+  for (uint32_t bytes = 1; bytes <= sizeof(data); bytes++) {
+    uint32_t used = tftDmaBuildChain(desc, 2 * DIRECT_DESCS + 1, data, bytes);
+    uint32_t sum = 0;
+    bool ok = used == tftDmaDescriptors(bytes) && used > 0;
+    for (uint32_t i = 0; ok && i < used; i++) {
+      ok = desc[i].size == desc[i].length && desc[i].length > 0 && desc[i].length <= TFT_DMA_DESC_MAX_BYTES
+        && desc[i].owner == 1 && desc[i].sucEof == (i == used - 1)
+        && desc[i].buffer == data + sum && desc[i].next == (i == used - 1 ? nullptr : &desc[i + 1])
+        && (i == used - 1 || desc[i].length == TFT_DMA_DESC_MAX_BYTES);
+      sum += desc[i].length;
+    }
+    if (!ok || sum != bytes) {
+      if (errors++ < 10) printf("bad chain for %u bytes\n", (unsigned)bytes);
+    }
+    // Too few descriptors must leave them alone
+    if (used > 1 && tftDmaBuildChain(desc, used - 1, data + 1, bytes) != 0) {
+      if (errors++ < 10) printf("chain for %u bytes built into %u descriptors\n", (unsigned)bytes, (unsigned)(used - 1));
+    }
+  }
+  if (tftDmaBuildChain(desc, 1, data, 0) != 0) errors++;
+
+  printf("chains: %u lengths checked, %u errors\n", (unsigned)sizeof(data), (unsigned)errors);
+  return errors;
+}
+
+// One pushImageDMA() or pushPixelsDMA(), returns the bytes the panel must receive
+static std::vector<uint8_t> pushRandomImage(std::vector<uint16_t> &image) {
+  uint32_t w = 1 + randomBelow(randomBelow(4) ? 170 : 340);
+  uint32_t h = 1 + randomBelow(randomBelow(4) ? 120 : 340);
+  image.resize(w * h);
+  for (uint32_t i = 0; i < w * h; i++) image[i] = (uint16_t)rng();
+
+  // Clipped to a random part, sometimes all of it
+  uint32_t dx = 0, dy = 0, dw = w, dh = h;
+  if (randomBelow(2)) {
+    dx = randomBelow(w);
+    dy = randomBelow(h);
+    dw = 1 + randomBelow(w - dx);
+    dh = 1 + randomBelow(h - dy);
+  }
+  bool swap = randomBelow(2);
+  bool capable = randomBelow(2);
+  bool copy = randomBelow(4) == 0; // A buffer was passed
+
+  std::vector<uint8_t> expected;
+  for (uint32_t y = 0; y < dh; y++) {
+    for (uint32_t x = 0; x < dw; x++) {
+      uint16_t p = image[(dy + y) * w + dx + x];
+      if (swap) p = p << 8 | p >> 8;
+      expected.push_back(p & 0xFF); // Sent in memory order
+      expected.push_back(p >> 8);
+    }
+  }
+
+  const uint16_t *first = image.data() + dx + w * dy;
+  uint32_t len = dw * dh;
+  if (copy || swap || dw != w || !sendDirect(first, len, capable)) sendBands(first, w, dw, len, swap);
+  stats.images++;
+  return expected;
+}
+
+int main(int argc, char **argv) {
+  uint32_t images = argc > 1 ? atoi(argv[1]) : 2000;
+  uint32_t seed = argc > 2 ? atoi(argv[2]) : 1;
+  rng.seed(seed);
+
+  uint32_t errors = checkChains();
+
+  // Images queue behind each other, a direct one keeps its image until it is sent
+  std::vector<uint16_t> image;
+  std::vector<std::vector<uint16_t> > retained;
+  std::vector<uint8_t> expected;
+  for (uint32_t i = 0; i < images; i++) {
+    uint32_t directs = stats.directs;
+    std::vector<uint8_t> next = pushRandomImage(image);
+    expected.insert(expected.end(), next.begin(), next.end());
+    if (randomBelow(3) == 0) engineIdle();
+    // The sketch may reuse a copied image at once, one sent in place once the DMA is done
+    if (stats.directs != directs) {
+      retained.push_back(std::vector<uint16_t>());
+      retained.back().swap(image);
+    }
+    if (tftDmaRingIdle(&ring)) retained.clear();
+  }
+  engineIdle();
+
+  size_t sent = engine.bus.size();
+  if (sent != expected.size()) {
+    printf("panel received %llu bytes, expected %llu\n", (unsigned long long)sent, (unsigned long long)expected.size());
+    stats.mismatches++;
+  }
+  for (size_t i = 0; i < sent && i < expected.size(); i++) {
+    if (engine.bus[i] != expected[i]) {
+      if (stats.mismatches++ < 10) printf("byte %llu differs\n", (unsigned long long)i);
+    }
+  }
+
+  printf("images: %u, %u sent in place, %u bands, %u waits for a buffer, %u transfers\n",
+    (unsigned)stats.images, (unsigned)stats.directs, (unsigned)stats.bands, (unsigned)stats.waits,
+    (unsigned)engine.transfers);
+  printf("bus: %llu bytes, %u mismatches, %u engine errors\n", (unsigned long long)sent,
+    (unsigned)stats.mismatches, (unsigned)engine.errors);
+
+  if (errors > 0 || stats.mismatches > 0 || engine.errors > 0 || !tftDmaRingIdle(&ring)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
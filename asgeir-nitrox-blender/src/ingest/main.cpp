@@ -0,0 +1,625 @@
+/*
+ * Host-side telemetry ingest: takes the frames of any number of blenders and keeps
+ * them in columnar files (store.h) that answer range queries without reading every row.
+ *
+ *   pio run -e native-ingest
+ *   .pio/build/native-ingest/program --out log --serial shop=/dev/ttyUSB0 --udp 47000
+ *
+ * Inputs, as many as wanted:
+ *   --serial [<name>=]<path>  UART transport, COBS frames. A tty is set to raw at --baud,
+ *                             a pty or a FIFO is read as it is, a file (the --uart1 of a
+ *                             native blender) is read to its end.
+ *   --ble [<name>=]<path>     BLE notifications as --ble-capture writes them, frames back
+ *                             to back.
+ *   --udp <port>              the UDP loopback medium of the native HAL, one stream per
+ *                             sender MAC. It listens and never acknowledges.
+ *
+ * A stream is named after its input, the path without directory and extension unless
+ * one is given. Rows of a live input are stamped with the host's clock when the frame
+ * arrived, those read from a file with the clock of the blender from the time the
+ * file was opened. Partial blocks go to disk every minute, at the end of the inputs
+ * and on SIGINT or SIGTERM.
+ *
+ * Queries read what an ingest wrote, also while it runs:
+ *   --streams                          streams with their tables, rows and time span
+ *   --query <column> [--stream <name>] min, max and average over --from .. --to
+ *   --fills [--stream <name>]          runs of the open solenoid with their O2
+ *   --dump status|samples [--stream <name>]  CSV, of every stream with a stream column first
+ * --from and --to take unix seconds or a local time like 2026-05-01T14:30.
+ */
+#include <Protocol.h>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "store.h"
+#include "telemetry.h"
+
+#define INGEST_REPORT_MS 10000
+#define INGEST_POLL_MS 100
+#define INGEST_READ_SIZE 65536
+#define INGEST_FILL_GAP_MS 60000     // Solenoid pulses closer than this belong to one fill
+
+// The datagrams of the UDP medium, see hal/native/src/esp_now.cpp.
+#define UDP_NODES 64
+#define UDP_MAGIC 0x4E4F5745          // "EWON"
+#define UDP_DATA 1
+#define UDP_MAC_LENGTH 6
+
+struct __attribute__((packed)) UdpHeader {
+  uint32_t magic;
+  uint8_t type;
+  uint8_t src[UDP_MAC_LENGTH];
+  uint8_t dest[UDP_MAC_LENGTH];
+  uint32_t id;
+  uint32_t delayUs;
+  uint64_t sentAtUs;
+};
+
+struct Input {
+  std::string path;
+  int fd;
+  bool isFile;
+  FrameSplitter splitter;
+  TelemetryStream *stream;
+
+  Input(const std::string &path, int fd, bool isFile, bool isCobs, TelemetryStream *stream)
+    : path(path), fd(fd), isFile(isFile), splitter(isCobs), stream(stream) {}
+};
+
+static std::string outDirectory;
+static int baud = 921600;
+static std::vector<Input *> inputs;
+static std::map<std::string, TelemetryStream *> streams;
+static int udpSocket = -1;
+static uint16_t udpPort = 0;
+static uint64_t udpDatagrams = 0;
+static volatile sig_atomic_t isStopping = 0;
+
+static int64_t nowMs() {
+  struct timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/// @return unix seconds or a local YYYY-MM-DD[THH:MM[:SS]] as ms, -1 if it is neither.
+static int64_t parseTime(const char *text) {
+  char *end;
+  double seconds = strtod(text, &end);
+  if (*end == 0 && end != text) {
+    return (int64_t)(seconds * 1000);
+  }
+
+  const char *formats[] = { "%Y-%m-%dT%H:%M:%S", "%Y-%m-%dT%H:%M", "%Y-%m-%d %H:%M:%S", "%Y-%m-%d %H:%M", "%Y-%m-%d" };
+  for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+    struct tm local;
+    memset(&local, 0, sizeof(local));
+    const char *rest = strptime(text, formats[i], &local);
+    if (rest != NULL && *rest == 0) {
+      local.tm_isdst = -1;
+      return (int64_t)mktime(&local) * 1000;
+    }
+  }
+  return -1;
+}
+
+static std::string formatTime(int64_t ms) {
+  time_t seconds = ms / 1000;
+  struct tm local;
+  localtime_r(&seconds, &local);
+  char text[32];
+  size_t length = strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+  snprintf(text + length, sizeof(text) - length, ".%03d", (int)(ms % 1000));
+  return text;
+}
+
+static TelemetryStream *streamNamed(const std::string &name, bool isClockFromFrames) {
+  std::map<std::string, TelemetryStream *>::iterator it = streams.find(name);
+  if (it != streams.end()) {
+    return it->second;
+  }
+  TelemetryStream *stream = new TelemetryStream(outDirectory, name, isClockFromFrames);
+  streams[name] = stream;
+  return stream;
+}
+
+static speed_t baudConstant(int rate) {
+  switch (rate) {
+  case 115200: return B115200;
+  case 230400: return B230400;
+  case 460800: return B460800;
+  case 921600: return B921600;
+  case 1000000: return B1000000;
+  case 2000000: return B2000000;
+  default: return B0;
+  }
+}
+
+/// @brief [<name>=]<path> of --serial and --ble.
+static bool addInput(const char *value, bool isCobs) {
+  std::string name;
+  std::string path = value;
+  size_t separator = path.find('=');
+  if (separator != std::string::npos) {
+    name = path.substr(0, separator);
+    path = path.substr(separator + 1);
+  } else {
+    size_t slash = path.rfind('/');
+    name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+    name = name.substr(0, name.find('.'));
+  }
+
+  int fd = open(path.c_str(), O_RDONLY | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    fprintf(stderr, "ingest: cannot open %s: %s\n", path.c_str(), strerror(errno));
+    return false;
+  }
+
+  if (isatty(fd)) {
+    struct termios settings;
+    speed_t speed = baudConstant(baud);
+    if (tcgetattr(fd, &settings) != 0 || speed == B0) {
+      fprintf(stderr, "ingest: cannot set %s to %d baud\n", path.c_str(), baud);
+      close(fd);
+      return false;
+    }
+    cfmakeraw(&settings);
+    cfsetispeed(&settings, speed);
+    cfsetospeed(&settings, speed);
+    tcsetattr(fd, TCSANOW, &settings);
+  }
+
+  struct stat info;
+  bool isFile = fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+  inputs.push_back(new Input(path, fd, isFile, isCobs, streamNamed(name, isFile)));
+  return true;
+}
+
+static bool joinUdp(uint16_t basePort) {
+  udpSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  for (int slot = 0; udpSocket >= 0 && slot < UDP_NODES; slot++) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(basePort + slot);
+    if (bind(udpSocket, (struct sockaddr *)&address, sizeof(address)) == 0) {
+      udpPort = basePort + slot;
+      fprintf(stderr, "ingest: UDP port %u\n", udpPort);
+      return true;
+    }
+  }
+  fprintf(stderr, "ingest: no free UDP port from %u\n", basePort);
+  return false;
+}
+
+static void receiveUdp() {
+  uint8_t datagram[sizeof(UdpHeader) + PROTOCOL_MAX_FRAME_SIZE];
+  for (;;) {
+    ssize_t length = recv(udpSocket, datagram, sizeof(datagram), MSG_DONTWAIT);
+    if (length < 0) {
+      return;
+    }
+    UdpHeader header;
+    if (length < (ssize_t)sizeof(header)) {
+      continue;
+    }
+    memcpy(&header, datagram, sizeof(header));
+    if (header.magic != UDP_MAGIC || header.type != UDP_DATA) {
+      continue;
+    }
+    udpDatagrams++;
+
+    char name[24];
+    snprintf(name, sizeof(name), "%02x-%02x-%02x-%02x-%02x-%02x", header.src[0], header.src[1], header.src[2],
+      header.src[3], header.src[4], header.src[5]);
+    streamNamed(name, false)->received(datagram + sizeof(header), length - sizeof(header), nowMs());
+  }
+}
+
+/// @return false once the input is done, at the end of a file or when a pty closed.
+static bool readInput(Input &input) {
+  uint8_t buffer[INGEST_READ_SIZE];
+  for (;;) {
+    ssize_t length = read(input.fd, buffer, sizeof(buffer));
+    if (length > 0) {
+      int64_t arrivedAtMs = nowMs();
+      TelemetryStream *stream = input.stream;
+      input.splitter.feed(buffer, length, [stream, arrivedAtMs](const uint8_t *frame, size_t frameLength) {
+        stream->received(frame, frameLength, arrivedAtMs);
+      });
+      if (!input.isFile) {
+        return true;
+      }
+    } else if (length < 0 && (errno == EAGAIN || errno == EINTR)) {
+      return true;
+    } else {
+      // 0 at the end of a file or a FIFO, EIO once the other side of a pty is gone.
+      return !input.isFile && length == 0 && isatty(input.fd);
+    }
+  }
+}
+
+static void report() {
+  for (std::map<std::string, TelemetryStream *>::iterator it = streams.begin(); it != streams.end(); ++it) {
+    const TelemetryStats &stats = it->second->stats();
+    if (stats.frames == 0) {
+      continue;
+    }
+    fprintf(stderr, "ingest: %s: %" PRIu64 " frames, %" PRIu64 " status and %" PRIu64 " sample rows, %" PRIu64
+      " lost, %" PRIu64 " duplicate, %" PRIu64 " bad, %" PRIu64 " resyncs, %" PRIu64 " samples lost\n",
+      it->first.c_str(), stats.frames, stats.statusRows, stats.sampleRows, stats.lostFrames, stats.duplicates,
+      stats.badFrames, stats.resyncs, stats.lostSamples);
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (inputs[i]->splitter.skippedBytes() > 0) {
+      fprintf(stderr, "ingest: %s: %" PRIu64 " bytes skipped\n", inputs[i]->path.c_str(),
+        inputs[i]->splitter.skippedBytes());
+    }
+  }
+  if (udpSocket >= 0) {
+    fprintf(stderr, "ingest: UDP: %" PRIu64 " datagrams\n", udpDatagrams);
+  }
+}
+
+static void stop(int signal) {
+  (void)signal;
+  isStopping = 1;
+}
+
+static int ingest() {
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  int64_t startedAtMs = nowMs();
+  int64_t nextReportMs = startedAtMs + INGEST_REPORT_MS;
+  uint64_t frames = 0;
+  while (!isStopping && (!inputs.empty() || udpSocket >= 0)) {
+    std::vector<struct pollfd> fds;
+    for (size_t i = 0; i < inputs.size(); i++) {
+      struct pollfd fd = { inputs[i]->fd, POLLIN, 0 };
+      fds.push_back(fd);
+    }
+    if (udpSocket >= 0) {
+      struct pollfd fd = { udpSocket, POLLIN, 0 };
+      fds.push_back(fd);
+    }
+    if (poll(&fds[0], fds.size(), INGEST_POLL_MS) < 0 && errno != EINTR) {
+      break;
+    }
+
+    for (size_t i = inputs.size(); i-- > 0;) {
+      if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !readInput(*inputs[i])) {
+        fprintf(stderr, "ingest: %s done, %" PRIu64 " bytes skipped\n", inputs[i]->path.c_str(),
+          inputs[i]->splitter.skippedBytes());
+        close(inputs[i]->fd);
+        delete inputs[i];
+        inputs.erase(inputs.begin() + i);
+      }
+    }
+    if (udpSocket >= 0 && (fds.back().revents & POLLIN)) {
+      receiveUdp();
+    }
+
+    int64_t now = nowMs();
+    for (std::map<std::string, TelemetryStream *>::iterator it = streams.begin(); it != streams.end(); ++it) {
+      it->second->flush(now);
+    }
+    if (now >= nextReportMs) {
+      report();
+      nextReportMs = now + INGEST_REPORT_MS;
+    }
+  }
+
+  int64_t now = nowMs();
+  for (std::map<std::string, TelemetryStream *>::iterator it = streams.begin(); it != streams.end(); ++it) {
+    it->second->flush(now, true);
+    frames += it->second->stats().frames;
+  }
+  report();
+  double seconds = (now - startedAtMs) / 1000.0;
+  fprintf(stderr, "ingest: %" PRIu64 " frames in %.1f s (%.0f frames/s)\n", frames, seconds,
+    seconds > 0 ? frames / seconds : 0);
+  for (std::map<std::string, TelemetryStream *>::iterator it = streams.begin(); it != streams.end(); ++it) {
+    delete it->second;
+  }
+  return 0;
+}
+
+static std::vector<std::string> streamNames(const std::string &only) {
+  std::vector<std::string> names;
+  if (!only.empty()) {
+    names.push_back(only);
+    return names;
+  }
+  DIR *directory = opendir(outDirectory.c_str());
+  if (directory == NULL) {
+    fprintf(stderr, "ingest: cannot open %s\n", outDirectory.c_str());
+    return names;
+  }
+  while (struct dirent *entry = readdir(directory)) {
+    struct stat info;
+    std::string path = outDirectory + "/" + entry->d_name;
+    if (entry->d_name[0] != '.' && stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+      names.push_back(entry->d_name);
+    }
+  }
+  closedir(directory);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+static void listStreams(const std::vector<std::string> &names) {
+  const TableSchema *schemas[] = { &statusSchema, &samplesSchema };
+  for (size_t n = 0; n < names.size(); n++) {
+    for (size_t s = 0; s < 2; s++) {
+      TableReader reader;
+      if (!reader.open(outDirectory + "/" + names[n], *schemas[s]) || reader.blockCount() == 0) {
+        continue;
+      }
+      uint64_t bytes = 0;
+      for (size_t i = 0; i < reader.blockCount(); i++) {
+        bytes += reader.block(i).length;
+      }
+      printf("%-20s %-8s %10" PRIu64 " rows %6zu blocks %10" PRIu64 " bytes (%.2f per row)  %s .. %s\n",
+        names[n].c_str(), schemas[s]->name, reader.rowCount(), reader.blockCount(), bytes,
+        (double)bytes / reader.rowCount(), formatTime(reader.block(0).columns[0].min).c_str(),
+        formatTime(reader.block(reader.blockCount() - 1).columns[0].max).c_str());
+    }
+  }
+}
+
+static int query(const std::vector<std::string> &names, const char *columnName, int64_t fromMs, int64_t toMs) {
+  int found = 0;
+  for (size_t n = 0; n < names.size(); n++) {
+    const TableSchema *schemas[] = { &statusSchema, &samplesSchema };
+    for (size_t s = 0; s < 2; s++) {
+      TableReader reader;
+      if (!reader.open(outDirectory + "/" + names[n], *schemas[s])) {
+        continue;
+      }
+      int column = reader.column(columnName);
+      RangeSummary summary;
+      if (column < 1 || !reader.summarize(column, fromMs, toMs, summary)) {
+        continue;
+      }
+      found++;
+      if (summary.rows == 0) {
+        printf("%s %s.%s: no rows\n", names[n].c_str(), schemas[s]->name, columnName);
+        continue;
+      }
+      float scale = schemas[s]->scales[column];
+      printf("%s %s.%s: %" PRIu64 " rows, min %.2f, max %.2f, avg %.2f (%u blocks from the index, %u decoded)\n",
+        names[n].c_str(), schemas[s]->name, columnName, summary.rows, summary.min / scale, summary.max / scale,
+        (double)summary.sum / summary.rows / scale, summary.blocksFromIndex, summary.blocksDecoded);
+    }
+  }
+  if (found == 0) {
+    fprintf(stderr, "ingest: no column %s\n", columnName);
+  }
+  return found > 0 ? 0 : 1;
+}
+
+/*
+ * A fill is a run of status rows with the solenoid open, pulses less than
+ * INGEST_FILL_GAP_MS apart count as one. Blocks whose flags never had the solenoid bit
+ * are skipped without inflating them, the O2 of a fill comes from summarize().
+*/
+static int fills(const std::vector<std::string> &names, int64_t fromMs, int64_t toMs) {
+  for (size_t n = 0; n < names.size(); n++) {
+    TableReader reader;
+    if (!reader.open(outDirectory + "/" + names[n], statusSchema)) {
+      continue;
+    }
+
+    struct Fill {
+      int64_t startMs;
+      int64_t endMs;
+    };
+    std::vector<Fill> found;
+    bool wanted[STORE_MAX_COLUMNS] = {};
+    wanted[STATUS_TIME] = wanted[STATUS_FLAGS] = true;
+    std::vector<int64_t> values[STORE_MAX_COLUMNS];
+    uint32_t skipped = 0;
+
+    for (size_t i = 0; i < reader.blockCount(); i++) {
+      const StoreBlockEntry &entry = reader.block(i);
+      if (entry.columns[STATUS_TIME].max < fromMs || entry.columns[STATUS_TIME].min >= toMs ||
+        !(entry.columns[STATUS_FLAGS].bits & STATUS_FLAG_SOLENOID_OPEN)) {
+        skipped++;
+        continue;
+      }
+      if (!reader.decode(i, wanted, values)) {
+        return 1;
+      }
+      for (size_t row = 0; row < entry.rows; row++) {
+        int64_t atMs = values[STATUS_TIME][row];
+        if (atMs < fromMs || atMs >= toMs || !(values[STATUS_FLAGS][row] & STATUS_FLAG_SOLENOID_OPEN)) {
+          continue;
+        }
+        if (!found.empty() && atMs - found.back().endMs < INGEST_FILL_GAP_MS) {
+          found.back().endMs = atMs;
+        } else {
+          Fill fill = { atMs, atMs };
+          found.push_back(fill);
+        }
+      }
+    }
+
+    printf("%s: %zu fills, %u of %zu blocks skipped\n", names[n].c_str(), found.size(), skipped, reader.blockCount());
+    for (size_t i = 0; i < found.size(); i++) {
+      RangeSummary summary;
+      if (!reader.summarize(STATUS_O2, found[i].startMs, found[i].endMs + 1, summary) || summary.rows == 0) {
+        continue;
+      }
+      printf("  %s  %6.0f s  O2 min %.2f, max %.2f, avg %.2f\n", formatTime(found[i].startMs).c_str(),
+        (found[i].endMs - found[i].startMs) / 1000.0, summary.min / (float)PROTOCOL_O2_SCALE,
+        summary.max / (float)PROTOCOL_O2_SCALE, (double)summary.sum / summary.rows / PROTOCOL_O2_SCALE);
+    }
+  }
+  return 0;
+}
+
+/*
+ * Without --stream every stream with the table is dumped, each row led by the name of
+ * its stream.
+*/
+static int dump(const std::vector<std::string> &names, bool hasStreamColumn, const TableSchema &schema,
+  int64_t fromMs, int64_t toMs) {
+  int dumped = 0;
+  for (size_t n = 0; n < names.size(); n++) {
+    TableReader reader;
+    if (!reader.open(outDirectory + "/" + names[n], schema)) {
+      continue;
+    }
+
+    if (dumped++ == 0) {
+      if (hasStreamColumn) {
+        fputs("stream,", stdout);
+      }
+      for (size_t column = 0; column < schema.columnCount; column++) {
+        printf(column == 0 ? "%s" : ",%s", schema.columns[column]);
+      }
+      printf("\n");
+    }
+    const char *prefix = hasStreamColumn ? names[n].c_str() : NULL;
+    bool isRead = reader.scan(fromMs, toMs, [&schema, prefix](const int64_t *row) {
+      if (prefix != NULL) {
+        printf("%s,", prefix);
+      }
+      printf("%" PRId64, row[0]);
+      for (size_t column = 1; column < schema.columnCount; column++) {
+        if (schema.scales[column] == 1) {
+          printf(",%" PRId64, row[column]);
+        } else {
+          printf(",%.2f", row[column] / schema.scales[column]);
+        }
+      }
+      printf("\n");
+    });
+    if (!isRead) {
+      return 1;
+    }
+  }
+
+  if (dumped == 0) {
+    if (hasStreamColumn) {
+      fprintf(stderr, "ingest: no %s table in %s\n", schema.name, outDirectory.c_str());
+    } else {
+      fprintf(stderr, "ingest: no %s table for stream '%s'\n", schema.name, names[0].c_str());
+    }
+    return 1;
+  }
+  return 0;
+}
+
+static void usage() {
+  fprintf(stderr,
+    "usage: ingest --out <dir> [--baud <n>] [--serial [<name>=]<path>]... [--ble [<name>=]<path>]... [--udp <port>]\n"
+    "       ingest --out <dir> --streams | --query <column> | --fills | --dump status|samples\n"
+    "              [--stream <name>] [--from <time>] [--to <time>]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::pair<std::string, bool> > inputArguments;
+  uint16_t udpBasePort = 0;
+  std::string streamName;
+  const char *queryColumn = NULL;
+  const char *dumpTable = NULL;
+  bool isListing = false;
+  bool isFills = false;
+  int64_t fromMs = INT64_MIN;
+  int64_t toMs = INT64_MAX;
+
+  for (int i = 1; i < argc; i++) {
+    const char *option = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    bool hasValue = true;
+    if (strcmp(option, "--streams") == 0) {
+      isListing = true;
+      hasValue = false;
+    } else if (strcmp(option, "--fills") == 0) {
+      isFills = true;
+      hasValue = false;
+    } else if (value == NULL) {
+      usage();
+    } else if (strcmp(option, "--out") == 0) {
+      outDirectory = value;
+    } else if (strcmp(option, "--baud") == 0) {
+      baud = atoi(value);
+    } else if (strcmp(option, "--serial") == 0 || strcmp(option, "--ble") == 0) {
+      inputArguments.push_back(std::make_pair(std::string(value), strcmp(option, "--serial") == 0));
+    } else if (strcmp(option, "--udp") == 0) {
+      udpBasePort = (uint16_t)atoi(value);
+    } else if (strcmp(option, "--stream") == 0) {
+      streamName = value;
+    } else if (strcmp(option, "--query") == 0) {
+      queryColumn = value;
+    } else if (strcmp(option, "--dump") == 0) {
+      dumpTable = value;
+    } else if (strcmp(option, "--from") == 0 || strcmp(option, "--to") == 0) {
+      int64_t ms = parseTime(value);
+      if (ms < 0) {
+        fprintf(stderr, "ingest: %s is not a time\n", value);
+        return 2;
+      }
+      (option[2] == 'f' ? fromMs : toMs) = ms;
+    } else {
+      usage();
+    }
+    i += hasValue ? 1 : 0;
+  }
+  if (outDirectory.empty()) {
+    usage();
+  }
+
+  if (isListing || isFills || queryColumn != NULL) {
+    std::vector<std::string> names = streamNames(streamName);
+    if (isListing) {
+      listStreams(names);
+      return 0;
+    }
+    return isFills ? fills(names, fromMs, toMs) : query(names, queryColumn, fromMs, toMs);
+  }
+  if (dumpTable != NULL) {
+    if (strcmp(dumpTable, "status") != 0 && strcmp(dumpTable, "samples") != 0) {
+      usage();
+    }
+    const TableSchema &schema = strcmp(dumpTable, "samples") == 0 ? samplesSchema : statusSchema;
+    return dump(streamNames(streamName), streamName.empty(), schema, fromMs, toMs);
+  }
+
+  // --baud applies to every tty, wherever it stands.
+  for (size_t i = 0; i < inputArguments.size(); i++) {
+    if (!addInput(inputArguments[i].first.c_str(), inputArguments[i].second)) {
+      return 1;
+    }
+  }
+  if (udpBasePort != 0 && !joinUdp(udpBasePort)) {
+    return 1;
+  }
+  if (inputs.empty() && udpSocket < 0) {
+    usage();
+  }
+  return ingest();
+}
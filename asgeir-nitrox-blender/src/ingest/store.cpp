@@ -0,0 +1,377 @@
+#include "store.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define VARINT64_MAX_LENGTH 10
+
+static size_t putVarint64(uint8_t *out, uint64_t value) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[length++] = value;
+  return length;
+}
+
+static size_t getVarint64(const uint8_t *data, size_t length, uint64_t &value) {
+  value = 0;
+  for (size_t i = 0; i < length && i < VARINT64_MAX_LENGTH; i++) {
+    value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+    if ((data[i] & 0x80) == 0) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+static uint64_t zigzag64(int64_t value) {
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t unzigzag64(uint64_t value) {
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static std::string tablePath(const std::string &directory, const TableSchema &schema, const char *extension) {
+  return directory + "/" + schema.name + extension;
+}
+
+static bool makeDirectories(const std::string &path) {
+  for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+    std::string prefix = path.substr(0, slash);
+    if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+      return false;
+    }
+    if (slash == std::string::npos) {
+      return true;
+    }
+  }
+}
+
+/*
+ * Load the index, every entry must lie within the .col file. A block written without
+ * its entry, or an entry cut short, is what a crash leaves behind and is dropped.
+*/
+static bool readIndex(FILE *index, const TableSchema &schema, uint64_t dataLength,
+  std::vector<StoreBlockEntry> &entries, long &validLength) {
+  StoreIndexHeader header;
+  validLength = 0;
+  if (fread(&header, sizeof(header), 1, index) != 1) {
+    return true;
+  }
+  if (header.magic != STORE_INDEX_MAGIC || header.version != STORE_VERSION || header.columnCount != schema.columnCount) {
+    fprintf(stderr, "ingest: %s.idx is not a %s table of this version\n", schema.name, schema.name);
+    return false;
+  }
+  validLength = sizeof(header);
+
+  size_t entrySize = storeEntrySize(schema.columnCount);
+  StoreBlockEntry entry;
+  while (fread(&entry, entrySize, 1, index) == 1 && entry.offset + entry.length <= dataLength) {
+    entries.push_back(entry);
+    validLength += entrySize;
+  }
+  return true;
+}
+
+bool TableWriter::open(const std::string &directory, const TableSchema &schema) {
+  close();
+  this->schema = &schema;
+  if (!makeDirectories(directory)) {
+    fprintf(stderr, "ingest: cannot create %s\n", directory.c_str());
+    return false;
+  }
+
+  std::string dataPath = tablePath(directory, schema, ".col");
+  std::string indexPath = tablePath(directory, schema, ".idx");
+  data = fopen(dataPath.c_str(), "a+b");
+  index = fopen(indexPath.c_str(), "a+b");
+  if (data == NULL || index == NULL) {
+    fprintf(stderr, "ingest: cannot open %s\n", dataPath.c_str());
+    close();
+    return false;
+  }
+
+  fseek(data, 0, SEEK_END);
+  uint64_t fileLength = ftell(data);
+  std::vector<StoreBlockEntry> entries;
+  long indexLength;
+  rewind(index);
+  if (!readIndex(index, schema, fileLength, entries, indexLength)) {
+    close();
+    return false;
+  }
+  // Reads and writes of a stream need a seek in between.
+  fseek(index, 0, SEEK_END);
+
+  // Cut whatever follows the last complete block.
+  dataLength = entries.empty() ? 0 : entries.back().offset + entries.back().length;
+  if (dataLength != fileLength && ftruncate(fileno(data), dataLength) != 0) {
+    close();
+    return false;
+  }
+  if (indexLength == 0) {
+    StoreIndexHeader header = { STORE_INDEX_MAGIC, STORE_VERSION, (uint16_t)schema.columnCount };
+    if (ftruncate(fileno(index), 0) != 0 || fwrite(&header, sizeof(header), 1, index) != 1) {
+      close();
+      return false;
+    }
+  } else if (ftruncate(fileno(index), indexLength) != 0) {
+    close();
+    return false;
+  }
+  fflush(index);
+
+  for (size_t column = 0; column < schema.columnCount; column++) {
+    columns[column].clear();
+    columns[column].reserve(STORE_BLOCK_ROWS);
+  }
+  rowCount = 0;
+  return true;
+}
+
+bool TableWriter::append(const int64_t *row) {
+  for (size_t column = 0; column < schema->columnCount; column++) {
+    columns[column].push_back(row[column]);
+  }
+  rowCount++;
+  return rowCount < STORE_BLOCK_ROWS || flush();
+}
+
+bool TableWriter::flush() {
+  if (data == NULL || rowCount == 0) {
+    return data != NULL;
+  }
+
+  StoreBlockEntry entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.offset = dataLength;
+  entry.rows = rowCount;
+
+  StoreBlockHeader header = { STORE_BLOCK_MAGIC, (uint32_t)rowCount, (uint16_t)schema->columnCount };
+  std::vector<uint8_t> block((const uint8_t *)&header, (const uint8_t *)(&header + 1));
+  size_t lengthsAt = block.size();
+  block.resize(block.size() + schema->columnCount * sizeof(uint32_t));
+
+  std::vector<uint8_t> raw(rowCount * VARINT64_MAX_LENGTH);
+  for (size_t column = 0; column < schema->columnCount; column++) {
+    const std::vector<int64_t> &values = columns[column];
+    StoreColumnStats &stats = entry.columns[column];
+    stats.min = stats.max = values[0];
+
+    size_t rawLength = 0;
+    int64_t previous = 0;
+    for (size_t row = 0; row < rowCount; row++) {
+      int64_t value = values[row];
+      rawLength += putVarint64(&raw[rawLength], zigzag64(value - previous));
+      previous = value;
+      stats.min = value < stats.min ? value : stats.min;
+      stats.max = value > stats.max ? value : stats.max;
+      stats.sum += value;
+      stats.bits |= (uint32_t)value;
+    }
+
+    uLongf compressedLength = compressBound(rawLength);
+    size_t at = block.size();
+    block.resize(at + compressedLength);
+    if (compress2(&block[at], &compressedLength, &raw[0], rawLength, STORE_COMPRESSION_LEVEL) != Z_OK) {
+      return false;
+    }
+    block.resize(at + compressedLength);
+    stats.length = compressedLength;
+    uint32_t length = compressedLength;
+    memcpy(&block[lengthsAt + column * sizeof(uint32_t)], &length, sizeof(length));
+  }
+  entry.length = block.size();
+
+  // The block first, an entry never points at a block that is not there.
+  if (fwrite(&block[0], block.size(), 1, data) != 1 || fflush(data) != 0 ||
+    fwrite(&entry, storeEntrySize(schema->columnCount), 1, index) != 1 || fflush(index) != 0) {
+    fprintf(stderr, "ingest: cannot write %s block\n", schema->name);
+    return false;
+  }
+
+  dataLength += block.size();
+  writtenRows += rowCount;
+  writtenBytes += block.size();
+  for (size_t column = 0; column < schema->columnCount; column++) {
+    columns[column].clear();
+  }
+  rowCount = 0;
+  return true;
+}
+
+void TableWriter::close() {
+  if (data != NULL) {
+    flush();
+    fclose(data);
+    data = NULL;
+  }
+  if (index != NULL) {
+    fclose(index);
+    index = NULL;
+  }
+}
+
+TableReader::~TableReader() {
+  if (data != NULL) {
+    fclose(data);
+  }
+}
+
+bool TableReader::open(const std::string &directory, const TableSchema &schema) {
+  this->schema = &schema;
+  entries.clear();
+  dataPath = tablePath(directory, schema, ".col");
+  if (data != NULL) {
+    fclose(data);
+  }
+
+  data = fopen(dataPath.c_str(), "rb");
+  FILE *index = fopen(tablePath(directory, schema, ".idx").c_str(), "rb");
+  bool isOpen = data != NULL && index != NULL;
+  if (isOpen) {
+    fseek(data, 0, SEEK_END);
+    long indexLength;
+    isOpen = readIndex(index, schema, ftell(data), entries, indexLength);
+  }
+  if (index != NULL) {
+    fclose(index);
+  }
+  return isOpen;
+}
+
+uint64_t TableReader::rowCount() const {
+  uint64_t rows = 0;
+  for (size_t i = 0; i < entries.size(); i++) {
+    rows += entries[i].rows;
+  }
+  return rows;
+}
+
+int TableReader::column(const char *name) const {
+  for (size_t column = 0; column < schema->columnCount; column++) {
+    if (strcmp(schema->columns[column], name) == 0) {
+      return column;
+    }
+  }
+  return -1;
+}
+
+bool TableReader::decode(size_t i, const bool *wanted, std::vector<int64_t> *values) {
+  const StoreBlockEntry &entry = entries[i];
+  std::vector<uint8_t> block(entry.length);
+  bool isRead = fseek(data, entry.offset, SEEK_SET) == 0 && fread(&block[0], entry.length, 1, data) == 1;
+  StoreBlockHeader header;
+  memcpy(&header, &block[0], sizeof(header));
+  if (!isRead || header.magic != STORE_BLOCK_MAGIC || header.rows != entry.rows) {
+    fprintf(stderr, "ingest: %s is damaged at %llu\n", dataPath.c_str(), (unsigned long long)entry.offset);
+    return false;
+  }
+
+  size_t at = sizeof(header) + schema->columnCount * sizeof(uint32_t);
+  std::vector<uint8_t> raw(entry.rows * VARINT64_MAX_LENGTH);
+  for (size_t column = 0; column < schema->columnCount; column++) {
+    uint32_t length = entry.columns[column].length;
+    if (wanted[column]) {
+      uLongf rawLength = raw.size();
+      if (uncompress(&raw[0], &rawLength, &block[at], length) != Z_OK) {
+        return false;
+      }
+
+      values[column].resize(entry.rows);
+      size_t position = 0;
+      int64_t previous = 0;
+      for (size_t row = 0; row < entry.rows; row++) {
+        uint64_t delta;
+        size_t used = getVarint64(&raw[position], rawLength - position, delta);
+        if (used == 0) {
+          return false;
+        }
+        position += used;
+        previous += unzigzag64(delta);
+        values[column][row] = previous;
+      }
+    }
+    at += length;
+  }
+  return true;
+}
+
+bool TableReader::summarize(int column, int64_t fromMs, int64_t toMs, RangeSummary &summary) {
+  memset(&summary, 0, sizeof(summary));
+  bool wanted[STORE_MAX_COLUMNS] = {};
+  wanted[0] = true;
+  wanted[column] = true;
+  std::vector<int64_t> values[STORE_MAX_COLUMNS];
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    const StoreBlockEntry &entry = entries[i];
+    const StoreColumnStats &time = entry.columns[0];
+    if (time.max < fromMs || time.min >= toMs) {
+      continue;
+    }
+
+    if (time.min >= fromMs && time.max < toMs) {
+      const StoreColumnStats &stats = entry.columns[column];
+      summary.min = summary.rows == 0 || stats.min < summary.min ? stats.min : summary.min;
+      summary.max = summary.rows == 0 || stats.max > summary.max ? stats.max : summary.max;
+      summary.sum += stats.sum;
+      summary.bits |= stats.bits;
+      summary.rows += entry.rows;
+      summary.blocksFromIndex++;
+      continue;
+    }
+
+    if (!decode(i, wanted, values)) {
+      return false;
+    }
+    summary.blocksDecoded++;
+    for (size_t row = 0; row < entry.rows; row++) {
+      if (values[0][row] < fromMs || values[0][row] >= toMs) {
+        continue;
+      }
+      int64_t value = values[column][row];
+      summary.min = summary.rows == 0 || value < summary.min ? value : summary.min;
+      summary.max = summary.rows == 0 || value > summary.max ? value : summary.max;
+      summary.sum += value;
+      summary.bits |= (uint32_t)value;
+      summary.rows++;
+    }
+  }
+  return true;
+}
+
+bool TableReader::scan(int64_t fromMs, int64_t toMs, const std::function<void(const int64_t *row)> &row) {
+  bool wanted[STORE_MAX_COLUMNS];
+  for (size_t column = 0; column < STORE_MAX_COLUMNS; column++) {
+    wanted[column] = column < schema->columnCount;
+  }
+  std::vector<int64_t> values[STORE_MAX_COLUMNS];
+  int64_t current[STORE_MAX_COLUMNS];
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    const StoreColumnStats &time = entries[i].columns[0];
+    if (time.max < fromMs || time.min >= toMs) {
+      continue;
+    }
+    if (!decode(i, wanted, values)) {
+      return false;
+    }
+    for (size_t r = 0; r < entries[i].rows; r++) {
+      if (values[0][r] < fromMs || values[0][r] >= toMs) {
+        continue;
+      }
+      for (size_t column = 0; column < schema->columnCount; column++) {
+        current[column] = values[column][r];
+      }
+      row(current);
+    }
+  }
+  return true;
+}
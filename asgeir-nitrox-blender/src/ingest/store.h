@@ -0,0 +1,145 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#define STORE_BLOCK_MAGIC 0x4B4C4258 // "XBLK"
+#define STORE_INDEX_MAGIC 0x58444958 // "XIDX"
+#define STORE_VERSION 1
+#define STORE_BLOCK_ROWS 4096        // Rows per block, the unit a query decompresses
+#define STORE_MAX_COLUMNS 10
+#define STORE_COMPRESSION_LEVEL 6    // zlib
+
+/*
+ * Columnar time series files, one table per stream and frame type.
+ *
+ *   <dir>/<stream>/<table>.col  blocks of up to STORE_BLOCK_ROWS rows
+ *   <dir>/<stream>/<table>.idx  a StoreIndexHeader and one StoreBlockEntry per block
+ *
+ * Column 0 is the time in ms since the epoch, the others are the fixed point values of
+ * the protocol. Within a block every column is stored on its own: the difference to the
+ * previous row as a zigzag varint, deflated. A slowly changing reading then costs well
+ * under a byte per row, and a query only inflates the columns it reads.
+ *
+ * The index holds the offset, the time span and the min, max, sum and OR of every column
+ * of each block. A range query reads the index and only decodes the blocks that straddle
+ * the start or the end of the range, the ones in between are answered from their entry.
+ * Blocks are appended to the .col file before their entry goes into the .idx file, so
+ * after a crash the writer drops the block without an entry and carries on.
+ */
+
+struct TableSchema {
+  const char *name;
+  size_t columnCount;
+  const char *columns[STORE_MAX_COLUMNS];
+  float scales[STORE_MAX_COLUMNS];  // Stored value / scale is the value in its unit
+};
+
+struct __attribute__((packed)) StoreIndexHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t columnCount;
+};
+
+struct __attribute__((packed)) StoreColumnStats {
+  int64_t min;
+  int64_t max;
+  int64_t sum;
+  uint32_t bits;    // OR of all values, tells which flags were ever set
+  uint32_t length;  // Compressed bytes in the block
+};
+
+struct __attribute__((packed)) StoreBlockEntry {
+  uint64_t offset;  // Of the block in the .col file
+  uint32_t length;
+  uint32_t rows;
+  StoreColumnStats columns[STORE_MAX_COLUMNS];  // Only columnCount of them are stored
+};
+
+struct __attribute__((packed)) StoreBlockHeader {
+  uint32_t magic;
+  uint32_t rows;
+  uint16_t columnCount;
+};
+
+/// @brief The entry as it is stored, without the unused columns.
+inline size_t storeEntrySize(size_t columnCount) {
+  return offsetof(StoreBlockEntry, columns) + columnCount * sizeof(StoreColumnStats);
+}
+
+/// @brief Appends rows to a table, one block at a time.
+class TableWriter {
+public:
+  ~TableWriter() { close(); }
+
+  /// @brief Open or create <directory>/<schema.name>.*, after the last complete block.
+  bool open(const std::string &directory, const TableSchema &schema);
+
+  /// @brief row holds schema.columnCount values, the time first.
+  /// @return false if a full block could not be written.
+  bool append(const int64_t *row);
+
+  /// @brief Write the rows buffered so far as a block, however few.
+  bool flush();
+  void close();
+
+  size_t bufferedRows() const { return rowCount; }
+  uint64_t rowsWritten() const { return writtenRows; }
+  uint64_t bytesWritten() const { return writtenBytes; }
+
+private:
+  const TableSchema *schema = NULL;
+  FILE *data = NULL;
+  FILE *index = NULL;
+  uint64_t dataLength = 0;
+
+  std::vector<int64_t> columns[STORE_MAX_COLUMNS];
+  size_t rowCount = 0;
+  uint64_t writtenRows = 0;
+  uint64_t writtenBytes = 0;
+};
+
+struct RangeSummary {
+  uint64_t rows;
+  int64_t min;
+  int64_t max;
+  int64_t sum;
+  uint32_t bits;
+  uint32_t blocksFromIndex;  // Answered from the index entry alone
+  uint32_t blocksDecoded;
+};
+
+/// @brief Reads a table written by TableWriter.
+class TableReader {
+public:
+  ~TableReader();
+
+  bool open(const std::string &directory, const TableSchema &schema);
+
+  size_t blockCount() const { return entries.size(); }
+  const StoreBlockEntry &block(size_t i) const { return entries[i]; }
+  uint64_t rowCount() const;
+
+  /// @return index of the named column, -1 if the table has none.
+  int column(const char *name) const;
+
+  /// @brief min, max, sum and count of a column over the rows with fromMs <= time < toMs.
+  bool summarize(int column, int64_t fromMs, int64_t toMs, RangeSummary &summary);
+
+  /// @brief Calls row() with every row in fromMs <= time < toMs, in file order.
+  bool scan(int64_t fromMs, int64_t toMs, const std::function<void(const int64_t *row)> &row);
+
+  /// @brief Inflate and undo the deltas of the wanted columns of block i, values[column][row].
+  bool decode(size_t i, const bool *wanted, std::vector<int64_t> *values);
+
+private:
+  const TableSchema *schema = NULL;
+  std::string dataPath;
+  FILE *data = NULL;
+  std::vector<StoreBlockEntry> entries;
+};
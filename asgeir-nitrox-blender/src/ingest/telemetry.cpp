@@ -0,0 +1,213 @@
+#include "telemetry.h"
+
+#include <Cobs.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+const TableSchema statusSchema = {
+  "status", STATUS_COLUMNS,
+  { "time", "o2", "cell1Mv", "cell2Mv", "cell1O2", "cell2O2", "calibration1Mv", "calibration2Mv", "maxO2", "flags" },
+  { 1, PROTOCOL_O2_SCALE, PROTOCOL_MV_SCALE, PROTOCOL_MV_SCALE, PROTOCOL_O2_SCALE, PROTOCOL_O2_SCALE,
+    PROTOCOL_MV_SCALE, PROTOCOL_MV_SCALE, 1, 1 },
+};
+
+const TableSchema samplesSchema = {
+  "samples", SAMPLES_COLUMNS,
+  { "time", "cell1Mv", "cell2Mv" },
+  { 1, PROTOCOL_MV_SCALE, PROTOCOL_MV_SCALE },
+};
+
+TelemetryStream::TelemetryStream(const std::string &directory, const std::string &name, bool isClockFromFrames)
+  : directory(directory + "/" + name), streamName(name), isClockFromFrames(isClockFromFrames) {
+}
+
+bool TelemetryStream::accept(const FrameHeader &header, int64_t arrivedAtMs, int64_t &atMs) {
+  int32_t sentDeltaUs = (int32_t)(header.sentAtUs - lastSentAtUs);
+  int64_t silenceMs = isClockFromFrames ? sentDeltaUs / 1000 : arrivedAtMs - lastArrivedAtMs;
+  // The samples are counted apart from the other frames, see Protocol.h.
+  bool isSamples = header.type == FRAME_SAMPLES;
+  bool &hasSequence = isSamples ? hasSampleSequence : hasStatusSequence;
+  uint16_t &lastSequence = isSamples ? lastSampleSequence : lastStatusSequence;
+  int16_t step = (int16_t)(header.sequence - lastSequence);
+
+  bool isResync = !hasFrame || silenceMs > TELEMETRY_RESYNC_MS || silenceMs < -TELEMETRY_RESYNC_MS ||
+    (hasSequence && (step > TELEMETRY_MAX_GAP || step < -TELEMETRY_MAX_GAP));
+  if (isResync) {
+    counters.resyncs += hasFrame ? 1 : 0;
+    hasSampleIndex = false;
+    hasStatusSequence = false;
+    hasSampleSequence = false;
+  } else if (!hasSequence) {
+    // The first frame of this kind, nothing to compare with.
+  } else if (step <= 0) {
+    counters.duplicates++;
+    return false;
+  } else {
+    counters.lostFrames += step - 1;
+  }
+
+  if (isClockFromFrames) {
+    if (!hasFrame) {
+      clockBaseMs = arrivedAtMs;
+      clockUs = 0;
+    } else if (sentDeltaUs >= 0) {
+      clockUs += sentDeltaUs;
+    } else {
+      // The blender rebooted, its clock starts over. Carry on from the last frame.
+      clockBaseMs = lastFrameAtMs;
+      clockUs = 0;
+    }
+    atMs = clockBaseMs + clockUs / 1000;
+  } else {
+    atMs = arrivedAtMs;
+  }
+
+  hasFrame = true;
+  hasSequence = true;
+  lastSequence = header.sequence;
+  lastSentAtUs = header.sentAtUs;
+  lastArrivedAtMs = arrivedAtMs;
+  lastFrameAtMs = atMs;
+  return true;
+}
+
+void TelemetryStream::received(const uint8_t *data, size_t length, int64_t arrivedAtMs) {
+  FrameHeader header;
+  const uint8_t *payload;
+  if (decodeFrame(data, length, header, payload) != FRAME_OK) {
+    counters.badFrames++;
+    return;
+  }
+  counters.frames++;
+  if (lastFlushMs == 0) {
+    lastFlushMs = arrivedAtMs;
+  }
+
+  int64_t atMs;
+  if (header.type != FRAME_STATUS && header.type != FRAME_SAMPLES) {
+    counters.ignored++;
+  } else if (accept(header, arrivedAtMs, atMs)) {
+    if (header.type == FRAME_STATUS) {
+      writeStatus(payload, header.length, atMs);
+    } else {
+      writeSamples(payload, header.length, atMs);
+    }
+  }
+}
+
+void TelemetryStream::open(TableWriter &writer, bool &isOpen, const TableSchema &schema) {
+  if (isOpen) {
+    return;
+  }
+  // Without its files the tool is of no use, better stop than lose data silently.
+  if (!writer.open(directory, schema)) {
+    exit(1);
+  }
+  isOpen = true;
+}
+
+void TelemetryStream::writeStatus(const uint8_t *payload, size_t length, int64_t atMs) {
+  StatusPayload status;
+  if (length != sizeof(status)) {
+    counters.badFrames++;
+    return;
+  }
+  memcpy(&status, payload, sizeof(status));
+
+  int64_t row[STATUS_COLUMNS] = {
+    atMs, status.o2, status.cellMv[0], status.cellMv[1], status.cellO2[0], status.cellO2[1],
+    status.calibrationMv[0], status.calibrationMv[1], status.maxO2Percent, status.flags,
+  };
+  open(this->status, isStatusOpen, statusSchema);
+  this->status.append(row);
+  counters.statusRows++;
+}
+
+void TelemetryStream::writeSamples(const uint8_t *payload, size_t length, int64_t atMs) {
+  StreamSample batch[SAMPLE_BATCH_MAX_COUNT];
+  uint16_t index;
+  size_t count = decodeSampleBatch(payload, length, index, batch, SAMPLE_BATCH_MAX_COUNT);
+  if (count == 0) {
+    counters.badFrames++;
+    return;
+  }
+
+  if (hasSampleIndex && isNewerSequence(index, nextSampleIndex)) {
+    counters.lostSamples += (uint16_t)(index - nextSampleIndex);
+  }
+  hasSampleIndex = true;
+  nextSampleIndex = index + count;
+
+  // The frame left right after its last sample was taken.
+  open(samples, isSamplesOpen, samplesSchema);
+  uint32_t lastAtMs = batch[count - 1].atMs;
+  for (size_t i = 0; i < count; i++) {
+    int64_t row[SAMPLES_COLUMNS] = {
+      atMs - (int64_t)(lastAtMs - batch[i].atMs), batch[i].cellMv[0], batch[i].cellMv[1],
+    };
+    samples.append(row);
+  }
+  counters.sampleRows += count;
+}
+
+void TelemetryStream::flush(int64_t nowMs, bool force) {
+  if (!force && nowMs - lastFlushMs < TELEMETRY_FLUSH_MS) {
+    return;
+  }
+  lastFlushMs = nowMs;
+  if (isStatusOpen) {
+    status.flush();
+  }
+  if (isSamplesOpen) {
+    samples.flush();
+  }
+}
+
+void FrameSplitter::feed(const uint8_t *data, size_t length, const FrameHandler &handler) {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+
+  if (isCobs) {
+    // Whatever does not decode, the log text of a Serial shared with the frames, is skipped.
+    size_t maxEncoded = cobsMaxEncodedLength(PROTOCOL_MAX_FRAME_SIZE);
+    for (size_t i = 0; i < length; i++) {
+      if (data[i] != 0) {
+        if (buffer.size() <= maxEncoded) {
+          buffer.push_back(data[i]);
+        } else {
+          skipped++;
+        }
+        continue;
+      }
+      size_t frameLength = buffer.size() <= maxEncoded && !buffer.empty() ?
+        cobsDecode(&buffer[0], buffer.size(), frame, sizeof(frame)) : 0;
+      if (frameLength > 0) {
+        handler(frame, frameLength);
+      } else {
+        skipped += buffer.size();
+      }
+      buffer.clear();
+    }
+    return;
+  }
+
+  buffer.insert(buffer.end(), data, data + length);
+  size_t at = 0;
+  while (buffer.size() - at >= sizeof(FrameHeader)) {
+    size_t frameLength = ::frameLength(&buffer[at], buffer.size() - at);
+    if (frameLength > 0 && frameLength > buffer.size() - at) {
+      break;
+    }
+
+    FrameHeader header;
+    const uint8_t *payload;
+    if (frameLength == 0 || decodeFrame(&buffer[at], frameLength, header, payload) != FRAME_OK) {
+      at++;
+      skipped++;
+      continue;
+    }
+    handler(&buffer[at], frameLength);
+    at += frameLength;
+  }
+  buffer.erase(buffer.begin(), buffer.begin() + at);
+}
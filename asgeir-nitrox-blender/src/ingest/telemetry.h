@@ -0,0 +1,114 @@
+#pragma once
+
+#include <Protocol.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "store.h"
+
+#define TELEMETRY_RESYNC_MS 5000      // After this long without a frame any sequence is accepted, the blender may have rebooted
+#define TELEMETRY_MAX_GAP 1000        // A larger jump in the sequence is a reboot too, not lost frames
+#define TELEMETRY_FLUSH_MS 60000      // A partial block goes to disk after this long, a crash loses at most that
+
+// Columns of the tables, STATUS_* and SAMPLES_* index a row.
+#define STATUS_TIME 0
+#define STATUS_O2 1
+#define STATUS_FLAGS 9
+#define STATUS_COLUMNS 10
+#define SAMPLES_COLUMNS 3
+
+extern const TableSchema statusSchema;
+extern const TableSchema samplesSchema;
+
+struct TelemetryStats {
+  uint64_t frames;
+  uint64_t statusRows;
+  uint64_t sampleRows;
+  uint64_t lostFrames;       // Sequence numbers skipped
+  uint64_t lostSamples;      // Sample indexes skipped
+  uint64_t duplicates;       // Sequence seen already, or older than the last one
+  uint64_t resyncs;
+  uint64_t badFrames;        // CRC, length or version wrong
+  uint64_t ignored;          // Valid, but not a status or samples (hello, stream request, ...)
+};
+
+/*
+ * The frames of one blender, checked and written to <directory>/<name>.
+ *
+ * Like the client, a stream only takes frames with a newer sequence number than the
+ * last one of their kind (the samples are numbered apart), counts the skipped ones as
+ * lost and starts over after a silence or a jump.
+ * Rows are stamped with the time a frame arrived or, for a capture read from a file,
+ * with the blender's clock from the first frame on. A sample batch is placed so its
+ * last sample falls on the time of the frame.
+ */
+class TelemetryStream {
+public:
+  TelemetryStream(const std::string &directory, const std::string &name, bool isClockFromFrames);
+
+  /// @brief A frame as it came off the input, checked here.
+  void received(const uint8_t *data, size_t length, int64_t arrivedAtMs);
+
+  /// @brief Write partial blocks once they are TELEMETRY_FLUSH_MS old, or now with force.
+  void flush(int64_t nowMs, bool force = false);
+
+  const std::string &name() const { return streamName; }
+  const TelemetryStats &stats() const { return counters; }
+
+private:
+  /// @brief Check the sequence and work out the time of the frame.
+  bool accept(const FrameHeader &header, int64_t arrivedAtMs, int64_t &atMs);
+  void open(TableWriter &writer, bool &isOpen, const TableSchema &schema);
+  void writeStatus(const uint8_t *payload, size_t length, int64_t atMs);
+  void writeSamples(const uint8_t *payload, size_t length, int64_t atMs);
+
+  std::string directory;
+  std::string streamName;
+  bool isClockFromFrames;
+
+  TableWriter status;
+  TableWriter samples;
+  bool isStatusOpen = false;
+  bool isSamplesOpen = false;
+  int64_t lastFlushMs = 0;
+
+  bool hasFrame = false;
+  bool hasStatusSequence = false;
+  uint16_t lastStatusSequence = 0;
+  bool hasSampleSequence = false;
+  uint16_t lastSampleSequence = 0;
+  int64_t lastArrivedAtMs = 0;
+  int64_t lastFrameAtMs = 0;
+  bool hasSampleIndex = false;
+  uint16_t nextSampleIndex = 0;
+
+  // The blender clock for isClockFromFrames, unwrapped since the last resync.
+  int64_t clockBaseMs = 0;
+  int64_t clockUs = 0;
+  uint32_t lastSentAtUs = 0;
+
+  TelemetryStats counters = {};
+};
+
+/*
+ * Picks the frames out of a byte stream: COBS frames between zero bytes from the UART
+ * transport, or the frames back to back of a BLE capture, where a byte that does not
+ * start a valid frame is skipped until one does.
+ */
+class FrameSplitter {
+public:
+  typedef std::function<void(const uint8_t *frame, size_t length)> FrameHandler;
+
+  explicit FrameSplitter(bool isCobs) : isCobs(isCobs) {}
+
+  void feed(const uint8_t *data, size_t length, const FrameHandler &handler);
+
+  uint64_t skippedBytes() const { return skipped; }
+
+private:
+  bool isCobs;
+  std::vector<uint8_t> buffer;
+  uint64_t skipped = 0;
+};
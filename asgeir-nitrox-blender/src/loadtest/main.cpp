@@ -0,0 +1,163 @@
+/*
+ * Load test for the client's station table (src/client/stations.h): a whole shop of
+ * blenders in one host process on the UDP medium of the native HAL.
+ *
+ * Every simulated blender has its own MAC and sends a status frame at --rate-hz, to
+ * each client it heard a hello from, like src/blender/peers.h, and as a broadcast
+ * before that. The stations start out of phase and their O2 drifts, so every frame
+ * changes the client's grid.
+ *
+ *   pio run -e native-loadtest -e native-client
+ *   .pio/build/native-loadtest/program --esp-now-udp 47000 --duration 30 &
+ *   .pio/build/native-client/program --esp-now-udp 47000 --duration 30 \
+ *     --press 14@1 --press 14@2 --send 29=t --send 29=d
+ *
+ * Every 5 s it prints the frames sent and how many the clients acknowledged.
+ */
+#include <Arduino.h>
+#include <esp_now.h>
+#include <WiFi.h>
+#include <Protocol.h>
+#include <Simulator.h>
+
+#include <math.h>
+
+#define LOADTEST_MAX_STATIONS 64
+#define LOADTEST_MAX_CLIENTS 4
+#define LOADTEST_REPORT_MS 5000
+
+int stationCount = 32;
+float rateHz = 20;
+
+static bool registerOptions() {
+  sim::addOption("--stations", "blenders to simulate (default: 32, at most 64)",
+    [](const char *value) { stationCount = constrain(atoi(value), 1, LOADTEST_MAX_STATIONS); });
+  sim::addOption("--rate-hz", "status frames per second of each blender (default: 20)",
+    [](const char *value) { rateHz = atof(value); });
+  return true;
+}
+static bool optionsRegistered = registerOptions();
+
+struct Station {
+  uint8_t mac[ESP_NOW_ETH_ALEN];
+  uint16_t sequence;
+  uint64_t nextSendUs;
+};
+
+Station stations[LOADTEST_MAX_STATIONS];
+uint8_t clients[LOADTEST_MAX_CLIENTS][ESP_NOW_ETH_ALEN];
+size_t clientCount = 0;
+uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// Simulator context, one at a time like the WiFi task.
+uint32_t framesSent = 0;
+uint32_t framesDelivered = 0;
+uint32_t framesFailed = 0;
+uint32_t lastReportAtMs = 0;
+uint32_t framesSentAtReport = 0;
+
+void OnDataSent(const uint8_t *mac, esp_now_send_status_t status) {
+  if (status == ESP_NOW_SEND_SUCCESS) {
+    framesDelivered++;
+  } else {
+    framesFailed++;
+  }
+}
+
+void OnDataRecv(const uint8_t *mac, const uint8_t *data, int len) {
+  FrameHeader header;
+  const uint8_t *payload;
+  if (decodeFrame(data, len, header, payload) != FRAME_OK || header.type != FRAME_HELLO) {
+    return;
+  }
+  for (size_t i = 0; i < clientCount; i++) {
+    if (memcmp(clients[i], mac, ESP_NOW_ETH_ALEN) == 0) {
+      return;
+    }
+  }
+  if (clientCount < LOADTEST_MAX_CLIENTS) {
+    memcpy(clients[clientCount++], mac, ESP_NOW_ETH_ALEN);
+    Serial.printf("Client %02X:%02X:%02X:%02X:%02X:%02X registered\r\n", mac[0], mac[1], mac[2], mac[3], mac[4],
+      mac[5]);
+  }
+}
+
+/*
+ * A plausible status: O2 slowly moving between 21 and 33 %, out of phase between the
+ * stations, and the valve open below the set-point.
+*/
+void fillStatus(int index, StatusPayload &status) {
+  float o2 = 27 + 6 * sinf(millis() / 3000.0f + index);
+  memset(&status, 0, sizeof(status));
+  status.o2 = toFixed(o2, PROTOCOL_O2_SCALE);
+  for (int cell = 0; cell < 2; cell++) {
+    status.cellMv[cell] = toFixed(o2 / 2, PROTOCOL_MV_SCALE);
+    status.cellO2[cell] = status.o2;
+    status.calibrationMv[cell] = toFixed(10.45f, PROTOCOL_MV_SCALE);
+  }
+  status.maxO2Percent = 32;
+  status.flags = o2 < 32 ? STATUS_FLAG_SOLENOID_OPEN : 0;
+}
+
+void sendStatus(Station &station, int index) {
+  StatusPayload status;
+  fillStatus(index, status);
+
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = encodeFrame(FRAME_STATUS, station.sequence++, micros(), &status, sizeof(status), frame,
+    sizeof(frame));
+  if (clientCount == 0) {
+    sim::espNowSendFrom(station.mac, broadcastAddress, frame, length);
+    framesSent++;
+  }
+  for (size_t i = 0; i < clientCount; i++) {
+    sim::espNowSendFrom(station.mac, clients[i], frame, length);
+    framesSent++;
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+  WiFi.mode(WIFI_STA);
+
+  uint64_t periodUs = (uint64_t)(1e6 / rateHz);
+  for (int i = 0; i < stationCount; i++) {
+    Station &station = stations[i];
+    uint8_t mac[ESP_NOW_ETH_ALEN] = { 0x02, 0x42, 0x4C, 0x00, 0x00, (uint8_t)(i + 1) };
+    memcpy(station.mac, mac, sizeof(mac));
+    station.sequence = 0;
+    station.nextSendUs = periodUs * i / stationCount;
+    sim::espNowAddAddress(station.mac);
+  }
+
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("Error initializing ESP-NOW");
+    return;
+  }
+  esp_now_register_recv_cb(OnDataRecv);
+  esp_now_register_send_cb(OnDataSent);
+  Serial.printf("%d blenders at %.0f Hz\r\n", stationCount, rateHz);
+}
+
+void loop() {
+  uint64_t periodUs = (uint64_t)(1e6 / rateHz);
+  uint64_t nowUs = sim::nowUs();
+
+  for (int i = 0; i < stationCount; i++) {
+    Station &station = stations[i];
+    if (nowUs >= station.nextSendUs) {
+      sendStatus(station, i);
+      // Fixed rate, a late tick does not shift the schedule.
+      station.nextSendUs += periodUs;
+    }
+  }
+
+  if (millis() - lastReportAtMs >= LOADTEST_REPORT_MS) {
+    Serial.printf("Load: %u frames sent (%.0f per second), %u acknowledged, %u failed, %u clients\r\n",
+      (unsigned)framesSent, (framesSent - framesSentAtReport) * 1000.0f / LOADTEST_REPORT_MS,
+      (unsigned)framesDelivered, (unsigned)framesFailed, (unsigned)clientCount);
+    lastReportAtMs = millis();
+    framesSentAtReport = framesSent;
+  }
+  delay(1);
+}
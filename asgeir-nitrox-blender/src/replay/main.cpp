@@ -0,0 +1,267 @@
+/*
+ * Replays a sensor trace (see src/blender/trace.h) through the blender control task on
+ * the native HAL: the samples feed the simulated ADS1115 and the potentiometer, and
+ * handleSensor(), handlePotentiometer() and handleSolenoid() run exactly as on the
+ * board, on virtual time.
+ *
+ * The output is CSV: the O2 estimate every 50 ms and every valve transition.
+ *
+ *   pio run -e native-replay
+ *   .pio/build/native-replay/program --quiet --trace session.raw --csv session.csv
+ *
+ * --trace takes a trace file or a raw capture of the serial port with trace frames in
+ * it, --save-trace writes the frames of a capture out as a trace file.
+ */
+#include <Arduino.h>
+#include <Wire.h>
+#include <Adafruit_ADS1X15.h>
+#include <Cobs.h>
+#include <Crc16.h>
+#include <Simulator.h>
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../blender/control.h"
+#include "../blender/pin_config.h"
+#include "../blender/trace.h"
+
+#define REPLAY_REPORT_MS 50
+#define REPLAY_REPORT_OFFSET_MS 5 // Between control task releases, so the read never races a write.
+#define REPLAY_TAIL_MS 1000 // Keep running a little after the last sample.
+
+std::string tracePath;
+std::string csvPath;
+std::string saveTracePath;
+int controllerOverride = -1;
+
+static bool registerOptions() {
+  sim::addOption("--trace", "trace file or raw serial capture to replay", [](const char *value) { tracePath = value; });
+  sim::addOption("--csv", "write the CSV here instead of stdout", [](const char *value) { csvPath = value; });
+  sim::addOption("--save-trace", "write the replayed trace as a trace file", [](const char *value) { saveTracePath = value; });
+  sim::addOption("--controller", "0 = bang-bang, 1 = smith-pi (default: as recorded)",
+    [](const char *value) { controllerOverride = atoi(value); });
+  return true;
+}
+static bool optionsRegistered = registerOptions();
+
+TraceHeader header;
+std::vector<TraceRecord> records;
+
+Adafruit_ADS1115 ads1115;
+FILE *csv = stdout;
+uint64_t replayStartUs = 0;
+uint32_t firstRecordMs = 0;
+uint64_t nextReportUs = REPLAY_REPORT_OFFSET_MS * 1000;
+
+std::mutex &replayMutex = *new std::mutex();
+size_t replayIndex = 0;
+uint32_t valveTransitions = 0;
+uint64_t valveOpenedAtUs = 0;
+uint64_t valveOpenUs = 0;
+
+/*
+ * Pick the trace frames out of a raw serial capture, the text log around them fails
+ * to decode or fails the CRC and is skipped.
+*/
+bool extractFrames(const std::vector<uint8_t> &capture) {
+  bool hasHeader = false;
+  uint32_t badFrames = 0;
+  size_t start = 0;
+
+  for (size_t i = 0; i <= capture.size(); i++) {
+    if (i < capture.size() && capture[i] != 0) {
+      continue;
+    }
+
+    size_t length = i - start;
+    uint8_t frame[1 + sizeof(TraceHeader) + 2];
+    size_t frameLength = length > 0 ? cobsDecode(&capture[start], length, frame, sizeof(frame)) : 0;
+    start = i + 1;
+
+    if (frameLength < 3) {
+      continue;
+    }
+    uint16_t crc = frame[frameLength - 2] | (frame[frameLength - 1] << 8);
+    if (crc16(frame, frameLength - 2) != crc) {
+      badFrames++;
+      continue;
+    }
+
+    size_t payloadLength = frameLength - 3;
+    if (frame[0] == TRACE_FRAME_HEADER && payloadLength == sizeof(TraceHeader)) {
+      if (hasHeader) {
+        fprintf(stderr, "replay: capture holds more than one trace, using the first\n");
+        break;
+      }
+      memcpy(&header, frame + 1, sizeof(header));
+      hasHeader = true;
+    } else if (frame[0] == TRACE_FRAME_RECORD && payloadLength == sizeof(TraceRecord) && hasHeader) {
+      TraceRecord record;
+      memcpy(&record, frame + 1, sizeof(record));
+      records.push_back(record);
+    }
+  }
+
+  if (badFrames > 0) {
+    fprintf(stderr, "replay: skipped %u frames with a bad CRC\n", (unsigned)badFrames);
+  }
+  return hasHeader;
+}
+
+bool loadTrace(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "replay: cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  fclose(file);
+
+  uint32_t magic = 0;
+  if (data.size() >= sizeof(magic)) {
+    memcpy(&magic, data.data(), sizeof(magic));
+  }
+
+  if (magic != TRACE_MAGIC) {
+    return extractFrames(data);
+  }
+
+  if (data.size() < sizeof(TraceHeader)) {
+    return false;
+  }
+  memcpy(&header, data.data(), sizeof(header));
+  if (header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+    fprintf(stderr, "replay: unsupported trace version %u\n", header.version);
+    return false;
+  }
+  for (size_t offset = sizeof(header); offset + sizeof(TraceRecord) <= data.size(); offset += sizeof(TraceRecord)) {
+    TraceRecord record;
+    memcpy(&record, &data[offset], sizeof(record));
+    records.push_back(record);
+  }
+  return true;
+}
+
+void saveTrace(const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "replay: cannot write %s\n", path);
+    return;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+  fwrite(records.data(), sizeof(TraceRecord), records.size(), file);
+  fclose(file);
+}
+
+/// @brief Record in effect at virtual time atUs, the trace is sample-and-hold.
+const TraceRecord &recordAt(uint64_t atUs) {
+  uint64_t traceMs = atUs > replayStartUs ? (atUs - replayStartUs) / 1000 + firstRecordMs : firstRecordMs;
+
+  std::lock_guard<std::mutex> lock(replayMutex);
+  while (replayIndex + 1 < records.size() && records[replayIndex + 1].atMs <= traceMs) {
+    replayIndex++;
+  }
+  return records[replayIndex];
+}
+
+void printReplaySummary() {
+  double seconds = (records.back().atMs - firstRecordMs) / 1000.0;
+  fprintf(stderr, "\n--- replay ---\n");
+  fprintf(stderr, "trace            : %u records, %.1f s, controller %s\n", (unsigned)records.size(), seconds,
+    controllerName(controllerOverride >= 0 ? controllerOverride : header.controllerMode));
+  fprintf(stderr, "valve            : %u transitions, open %.1f s\n", (unsigned)valveTransitions, valveOpenUs / 1e6);
+}
+
+void setup() {
+  if (tracePath.empty()) {
+    fprintf(stderr, "replay: --trace is required\n");
+    exit(2);
+  }
+  if (!loadTrace(tracePath.c_str()) || records.empty()) {
+    fprintf(stderr, "replay: no trace in %s\n", tracePath.c_str());
+    exit(1);
+  }
+  if (!saveTracePath.empty()) {
+    saveTrace(saveTracePath.c_str());
+  }
+  if (!csvPath.empty()) {
+    csv = fopen(csvPath.c_str(), "w");
+    if (csv == NULL) {
+      fprintf(stderr, "replay: cannot write %s\n", csvPath.c_str());
+      exit(1);
+    }
+  }
+
+  firstRecordMs = records.front().atMs;
+  replayStartUs = sim::nowUs();
+  sim::options().durationUs = replayStartUs + (uint64_t)(records.back().atMs - firstRecordMs + REPLAY_TAIL_MS) * 1000;
+
+  sim::setCellSource([](int cell, uint64_t atUs) {
+    return recordAt(atUs).raw[cell] * header.millivoltsPerCount;
+  });
+  sim::setAnalogInput(PIN_POTENTIOMETER, records.front().potentiometer);
+  for (size_t i = 1; i < records.size(); i++) {
+    if (records[i].potentiometer != records[i - 1].potentiometer) {
+      uint16_t value = records[i].potentiometer;
+      sim::schedule(replayStartUs + (uint64_t)(records[i].atMs - firstRecordMs) * 1000,
+        [value]() { sim::setAnalogInput(PIN_POTENTIOMETER, value); });
+    }
+  }
+
+  sim::onPinWrite([](uint8_t pin, int level, uint64_t atUs) {
+    if (pin != PIN_SOLENOID_SIGNAL) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(replayMutex);
+    if (level == HIGH) {
+      valveOpenedAtUs = atUs;
+    } else {
+      valveOpenUs += atUs - valveOpenedAtUs;
+    }
+    valveTransitions++;
+    fprintf(csv, "%llu,valve,,,,,%d\n", (unsigned long long)((atUs - replayStartUs) / 1000), level == HIGH);
+  });
+
+  pinMode(PIN_SOLENOID_SIGNAL, OUTPUT);
+  pinMode(PIN_POTENTIOMETER, INPUT);
+
+  Wire.begin(PIN_IIC_SDA, PIN_IIC_SCL);
+  ads1115.setGain(GAIN_TWO);
+  ads1115.setDataRate(RATE_ADS1115_64SPS);
+  ads1115.begin();
+
+  ControlSettings settings = {};
+  settings.controllerMode = controllerOverride >= 0 ? controllerOverride : header.controllerMode;
+  controlSettings.write(settings);
+
+  CellCalibration calibration[2];
+  for (int i = 0; i < 2; i++) {
+    calibration[i].value = header.calibrationMv[i];
+    calibration[i].calibratedAtMs = 0;
+  }
+  startControlTask(ads1115, PIN_ADS_ALERT, calibration);
+
+  fprintf(csv, "time_ms,event,o2,cell1_mv,cell2_mv,target,valve\n");
+  atexit(printReplaySummary);
+}
+
+void loop() {
+  uint64_t elapsedUs = sim::nowUs() - replayStartUs;
+  if (elapsedUs >= nextReportUs) {
+    ControlSnapshot snapshot = controlSnapshot.read();
+    std::lock_guard<std::mutex> lock(replayMutex);
+    fprintf(csv, "%llu,o2,%.2f,%.3f,%.3f,%d,%d\n", (unsigned long long)(elapsedUs / 1000), snapshot.systemState.o2,
+      snapshot.sensorValue[0].avgMv, snapshot.sensorValue[1].avgMv, snapshot.solenoid.maxO2Percent,
+      snapshot.solenoid.isOpen);
+    nextReportUs += REPLAY_REPORT_MS * 1000;
+  }
+
+  delayMicroseconds(nextReportUs - elapsedUs);
+}
@@ -0,0 +1,128 @@
+/*
+ * Host stress test for lib/NitroxCore/Seqlock.h.
+ *
+ * One writer thread publishes a snapshot the size of ControlSnapshot as fast as it
+ * can while reader threads copy it. Every field of a published value is derived from
+ * the same counter, so a torn copy shows up as fields that disagree.
+ *
+ *   pio run -e native-seqlock && .pio/build/native-seqlock/program [seconds] [readers]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <Seqlock.h>
+
+struct Payload {
+  uint32_t counter;
+  float values[16];
+  bool flags[4];
+  uint32_t check;
+};
+
+static Payload makePayload(uint32_t counter) {
+  Payload payload;
+  payload.counter = counter;
+  for (int i = 0; i < 16; i++) {
+    payload.values[i] = (float)(counter + i);
+  }
+  for (int i = 0; i < 4; i++) {
+    payload.flags[i] = ((counter >> i) & 1) != 0;
+  }
+  payload.check = ~counter;
+  return payload;
+}
+
+static bool isConsistent(const Payload &payload) {
+  Payload expected = makePayload(payload.counter);
+  for (int i = 0; i < 16; i++) {
+    if (payload.values[i] != expected.values[i]) {
+      return false;
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    if (payload.flags[i] != expected.flags[i]) {
+      return false;
+    }
+  }
+  return payload.check == expected.check;
+}
+
+static Seqlock<Payload> snapshot;
+static std::atomic<bool> stop(false);
+
+struct ReaderStats {
+  uint64_t reads = 0;
+  uint64_t retries = 0;
+  uint64_t torn = 0;
+  uint64_t wentBackwards = 0;
+};
+
+int main(int argc, char **argv) {
+  int seconds = argc > 1 ? atoi(argv[1]) : 5;
+  int readerCount = argc > 2 ? atoi(argv[2]) : 3;
+
+  snapshot.write(makePayload(0));
+
+  uint64_t writes = 0;
+  std::thread writer([&writes]() {
+    uint32_t counter = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+      snapshot.write(makePayload(++counter));
+      writes++;
+    }
+  });
+
+  std::vector<ReaderStats> stats(readerCount);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < readerCount; r++) {
+    readers.push_back(std::thread([&stats, r]() {
+      ReaderStats &mine = stats[r];
+      uint32_t last = 0;
+      Payload payload;
+      while (!stop.load(std::memory_order_relaxed)) {
+        if (!snapshot.tryRead(payload)) {
+          mine.retries++;
+          continue;
+        }
+        mine.reads++;
+        if (!isConsistent(payload)) {
+          mine.torn++;
+        }
+        if (payload.counter < last) {
+          mine.wentBackwards++;
+        }
+        last = payload.counter;
+      }
+    }));
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(seconds));
+  stop.store(true);
+  writer.join();
+  for (size_t r = 0; r < readers.size(); r++) {
+    readers[r].join();
+  }
+
+  uint64_t torn = 0;
+  uint64_t wentBackwards = 0;
+  printf("writes: %llu\n", (unsigned long long)writes);
+  for (int r = 0; r < readerCount; r++) {
+    printf("reader %d: %llu reads, %llu retries, %llu torn, %llu out of order\n", r,
+      (unsigned long long)stats[r].reads, (unsigned long long)stats[r].retries, (unsigned long long)stats[r].torn,
+      (unsigned long long)stats[r].wentBackwards);
+    torn += stats[r].torn;
+    wentBackwards += stats[r].wentBackwards;
+  }
+
+  if (torn > 0 || wentBackwards > 0) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * CRC16, varints and COBS of lib/NitroxCore, run with `pio test -e native-test`.
+ */
+#include <string.h>
+#include <unity.h>
+
+#include <Cobs.h>
+#include <Crc16.h>
+#include <Varint.h>
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc16_check_value() {
+  const char *check = "123456789";
+  TEST_ASSERT_EQUAL_HEX16(0x29B1, crc16((const uint8_t *)check, strlen(check)));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, crc16(NULL, 0));
+}
+
+void test_crc16_continues_over_parts() {
+  const uint8_t data[] = { 0x4E, 0x58, 0x02, 0x01, 0x00, 0x00, 0xFF, 0x10 };
+  uint16_t whole = crc16(data, sizeof(data));
+  TEST_ASSERT_EQUAL_HEX16(whole, crc16(data + 3, sizeof(data) - 3, crc16(data, 3)));
+}
+
+void test_varint_round_trip() {
+  const uint32_t values[] = { 0, 1, 127, 128, 16383, 16384, 2097151, 2097152, 268435455, 268435456, UINT32_MAX };
+  const size_t lengths[] = { 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5 };
+
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    uint8_t buffer[VARINT_MAX_LENGTH];
+    size_t length = putVarint(buffer, values[i]);
+    TEST_ASSERT_EQUAL_UINT32(lengths[i], length);
+
+    uint32_t decoded;
+    TEST_ASSERT_EQUAL_UINT32(length, getVarint(buffer, length, decoded));
+    TEST_ASSERT_EQUAL_UINT32(values[i], decoded);
+  }
+}
+
+void test_varint_truncated() {
+  uint8_t buffer[VARINT_MAX_LENGTH];
+  size_t length = putVarint(buffer, 300000);
+  uint32_t decoded;
+
+  for (size_t cut = 0; cut < length; cut++) {
+    TEST_ASSERT_EQUAL_UINT32(0, getVarint(buffer, cut, decoded));
+  }
+}
+
+void test_varint_too_long() {
+  const uint8_t tooLong[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+  uint32_t decoded;
+  TEST_ASSERT_EQUAL_UINT32(0, getVarint(tooLong, sizeof(tooLong), decoded));
+}
+
+void test_zigzag() {
+  TEST_ASSERT_EQUAL_UINT32(0, zigzag(0));
+  TEST_ASSERT_EQUAL_UINT32(1, zigzag(-1));
+  TEST_ASSERT_EQUAL_UINT32(2, zigzag(1));
+  TEST_ASSERT_EQUAL_UINT32(3, zigzag(-2));
+
+  for (int32_t value = -65536; value <= 65536; value += 7) {
+    TEST_ASSERT_EQUAL_INT32(value, unzigzag(zigzag(value)));
+  }
+}
+
+void test_delta_is_short_for_noise() {
+  uint8_t buffer[VARINT_MAX_LENGTH];
+  TEST_ASSERT_EQUAL_UINT32(1, putDelta(buffer, 1003, 1000));
+  TEST_ASSERT_EQUAL_UINT32(1, putDelta(buffer, 997, 1000));
+  TEST_ASSERT_EQUAL_UINT32(3, putDelta(buffer, INT16_MIN, INT16_MAX));
+}
+
+static void checkCobsRoundTrip(const uint8_t *data, size_t length) {
+  uint8_t encoded[700];
+  uint8_t decoded[600];
+
+  size_t encodedLength = cobsEncode(data, length, encoded);
+  TEST_ASSERT_TRUE(encodedLength <= cobsMaxEncodedLength(length));
+  for (size_t i = 0; i < encodedLength; i++) {
+    TEST_ASSERT_NOT_EQUAL(0, encoded[i]);
+  }
+
+  TEST_ASSERT_EQUAL_UINT32(length, cobsDecode(encoded, encodedLength, decoded, sizeof(decoded)));
+  if (length > 0) {
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, decoded, length);
+  }
+}
+
+void test_cobs_round_trip() {
+  const uint8_t zero[] = { 0 };
+  const uint8_t zeros[] = { 0, 0, 0 };
+  const uint8_t mixed[] = { 0x11, 0, 0x22, 0x33, 0, 0, 0x44 };
+  checkCobsRoundTrip(NULL, 0);
+  checkCobsRoundTrip(zero, sizeof(zero));
+  checkCobsRoundTrip(zeros, sizeof(zeros));
+  checkCobsRoundTrip(mixed, sizeof(mixed));
+
+  // Runs of 253 to 255 non-zero bytes end a block without a zero.
+  uint8_t block[600];
+  for (size_t length = 252; length <= 256; length++) {
+    memset(block, 0x5A, length);
+    checkCobsRoundTrip(block, length);
+  }
+
+  uint32_t state = 1;
+  for (size_t i = 0; i < sizeof(block); i++) {
+    state = state * 1664525UL + 1013904223UL;
+    block[i] = (state >> 24) & 0x07 ? state >> 16 : 0;
+  }
+  checkCobsRoundTrip(block, sizeof(block));
+}
+
+void test_cobs_rejects_zero_in_input() {
+  const uint8_t data[] = { 0x11, 0x22, 0x33 };
+  uint8_t encoded[8];
+  uint8_t decoded[8];
+  size_t length = cobsEncode(data, sizeof(data), encoded);
+
+  encoded[2] = 0;
+  TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(encoded, length, decoded, sizeof(decoded)));
+
+  const uint8_t zeroCode[] = { 0x00, 0x11 };
+  TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(zeroCode, sizeof(zeroCode), decoded, sizeof(decoded)));
+}
+
+void test_cobs_rejects_code_past_end() {
+  const uint8_t overrun[] = { 0x05, 0x11, 0x22 };
+  uint8_t decoded[8];
+  TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(overrun, sizeof(overrun), decoded, sizeof(decoded)));
+}
+
+void test_cobs_rejects_small_output() {
+  const uint8_t data[] = { 0x11, 0, 0x22, 0x33 };
+  uint8_t encoded[8];
+  uint8_t decoded[8];
+  size_t length = cobsEncode(data, sizeof(data), encoded);
+
+  for (size_t capacity = 0; capacity < sizeof(data); capacity++) {
+    TEST_ASSERT_EQUAL_UINT32(0, cobsDecode(encoded, length, decoded, capacity));
+  }
+  TEST_ASSERT_EQUAL_UINT32(sizeof(data), cobsDecode(encoded, length, decoded, sizeof(data)));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc16_check_value);
+  RUN_TEST(test_crc16_continues_over_parts);
+  RUN_TEST(test_varint_round_trip);
+  RUN_TEST(test_varint_truncated);
+  RUN_TEST(test_varint_too_long);
+  RUN_TEST(test_zigzag);
+  RUN_TEST(test_delta_is_short_for_noise);
+  RUN_TEST(test_cobs_round_trip);
+  RUN_TEST(test_cobs_rejects_zero_in_input);
+  RUN_TEST(test_cobs_rejects_code_past_end);
+  RUN_TEST(test_cobs_rejects_small_output);
+  return UNITY_END();
+}
@@ -0,0 +1,293 @@
+/*
+ * Frames and payloads of lib/NitroxCore/src/Protocol.h, run with `pio test -e native-test`.
+ */
+#include <string.h>
+#include <unity.h>
+
+#include <LoopProfile.h>
+#include <Protocol.h>
+
+void setUp() {}
+void tearDown() {}
+
+static StatusPayload makeStatus() {
+  StatusPayload status;
+  status.o2 = 3210;
+  status.cellMv[0] = 1234;
+  status.cellMv[1] = -1;
+  status.cellO2[0] = 3205;
+  status.cellO2[1] = 3215;
+  status.calibrationMv[0] = 1001;
+  status.calibrationMv[1] = 998;
+  status.maxO2Percent = 32;
+  status.flags = STATUS_FLAG_SOLENOID_OPEN | STATUS_FLAG_CELL2_WARNING;
+  return status;
+}
+
+/// @brief A valid status frame to break in the error tests.
+static size_t makeStatusFrame(uint8_t *frame, size_t capacity) {
+  StatusPayload status = makeStatus();
+  return encodeFrame(FRAME_STATUS, 7, 123456, &status, sizeof(status), frame, capacity);
+}
+
+void test_status_round_trip() {
+  StatusPayload status = makeStatus();
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = encodeFrame(FRAME_STATUS, 0xFFFE, 0xDEADBEEF, &status, sizeof(status), frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_UINT32(FRAME_OVERHEAD + sizeof(status), length);
+
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+  TEST_ASSERT_EQUAL(FRAME_OK, decodeFrame(frame, length, header, payload));
+  TEST_ASSERT_EQUAL_HEX16(PROTOCOL_MAGIC, header.magic);
+  TEST_ASSERT_EQUAL_UINT8(PROTOCOL_VERSION, header.version);
+  TEST_ASSERT_EQUAL_UINT8(FRAME_STATUS, header.type);
+  TEST_ASSERT_EQUAL_UINT16(0xFFFE, header.sequence);
+  TEST_ASSERT_EQUAL_HEX32(0xDEADBEEF, header.sentAtUs);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(status), header.length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY((const uint8_t *)&status, payload, sizeof(status));
+  TEST_ASSERT_EQUAL_UINT32(length, frameLength(frame, length));
+}
+
+void test_hello_and_stream_request() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  size_t length = encodeFrame(FRAME_HELLO, 1, 0, NULL, 0, frame, sizeof(frame));
+  TEST_ASSERT_EQUAL_UINT32(FRAME_OVERHEAD, length);
+  TEST_ASSERT_EQUAL(FRAME_OK, decodeFrame(frame, length, header, payload));
+  TEST_ASSERT_EQUAL_UINT8(FRAME_HELLO, header.type);
+  TEST_ASSERT_EQUAL_UINT8(0, header.length);
+
+  StreamRequestPayload request = { 60000 };
+  length = encodeFrame(FRAME_STREAM_REQUEST, 2, 0, &request, sizeof(request), frame, sizeof(frame));
+  TEST_ASSERT_EQUAL(FRAME_OK, decodeFrame(frame, length, header, payload));
+  StreamRequestPayload decoded;
+  memcpy(&decoded, payload, sizeof(decoded));
+  TEST_ASSERT_EQUAL_UINT16(60000, decoded.leaseMs);
+}
+
+void test_profile_round_trip() {
+  ProfilePayload profile;
+  profile.windowMs = 10001;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    profile.phases[i].count = 1000 + i;
+    profile.phases[i].p50Us = 2 * i;
+    profile.phases[i].p99Us = 30 * i;
+    profile.phases[i].maxUs = 0xFFFFFFF0 + i;
+  }
+
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = encodeFrame(FRAME_PROFILE, 9, 0, &profile, sizeof(profile), frame, sizeof(frame));
+  TEST_ASSERT_NOT_EQUAL(0, length);
+
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+  TEST_ASSERT_EQUAL(FRAME_OK, decodeFrame(frame, length, header, payload));
+  TEST_ASSERT_EQUAL_UINT8(FRAME_PROFILE, header.type);
+  TEST_ASSERT_EQUAL_UINT8(sizeof(profile), header.length);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY((const uint8_t *)&profile, payload, sizeof(profile));
+}
+
+void test_encode_does_not_overflow() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  uint8_t payload[256] = { 0 };
+  StatusPayload status = makeStatus();
+
+  TEST_ASSERT_EQUAL_UINT32(0, encodeFrame(FRAME_STATUS, 0, 0, &status, sizeof(status), frame,
+    FRAME_OVERHEAD + sizeof(status) - 1));
+  TEST_ASSERT_EQUAL_UINT32(0, encodeFrame(FRAME_SAMPLES, 0, 0, payload, 256, frame, sizeof(frame)));
+}
+
+void test_error_too_short() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = makeStatusFrame(frame, sizeof(frame));
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  TEST_ASSERT_EQUAL(FRAME_TOO_SHORT, decodeFrame(frame, 0, header, payload));
+  TEST_ASSERT_EQUAL(FRAME_TOO_SHORT, decodeFrame(frame, FRAME_OVERHEAD - 1, header, payload));
+  TEST_ASSERT_EQUAL_UINT32(0, frameLength(frame, sizeof(FrameHeader) - 1));
+  TEST_ASSERT_EQUAL_UINT32(length, frameLength(frame, sizeof(FrameHeader)));
+}
+
+void test_error_foreign() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = makeStatusFrame(frame, sizeof(frame));
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  frame[0] ^= 0x01;
+  TEST_ASSERT_EQUAL(FRAME_FOREIGN, decodeFrame(frame, length, header, payload));
+  TEST_ASSERT_EQUAL_UINT32(0, frameLength(frame, length));
+}
+
+void test_error_bad_version() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = makeStatusFrame(frame, sizeof(frame));
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  frame[offsetof(FrameHeader, version)] = PROTOCOL_VERSION + 1;
+  TEST_ASSERT_EQUAL(FRAME_BAD_VERSION, decodeFrame(frame, length, header, payload));
+}
+
+void test_error_bad_length() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = makeStatusFrame(frame, sizeof(frame));
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  // A byte more or less than the header says.
+  TEST_ASSERT_EQUAL(FRAME_BAD_LENGTH, decodeFrame(frame, length + 1, header, payload));
+  TEST_ASSERT_EQUAL(FRAME_BAD_LENGTH, decodeFrame(frame, length - 1, header, payload));
+
+  frame[offsetof(FrameHeader, length)] = 255;
+  TEST_ASSERT_EQUAL(FRAME_BAD_LENGTH, decodeFrame(frame, length, header, payload));
+}
+
+void test_error_bad_crc() {
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  size_t length = makeStatusFrame(frame, sizeof(frame));
+  FrameHeader header;
+  const uint8_t *payload = NULL;
+
+  // Every single bit flip past the fields checked before the CRC.
+  for (size_t byte = offsetof(FrameHeader, type); byte < length; byte++) {
+    if (byte == offsetof(FrameHeader, length)) {
+      continue;
+    }
+    for (int bit = 0; bit < 8; bit++) {
+      frame[byte] ^= 1 << bit;
+      TEST_ASSERT_EQUAL(FRAME_BAD_CRC, decodeFrame(frame, length, header, payload));
+      frame[byte] ^= 1 << bit;
+    }
+  }
+  TEST_ASSERT_EQUAL(FRAME_OK, decodeFrame(frame, length, header, payload));
+}
+
+static size_t makeSamples(StreamSample *samples, size_t count) {
+  uint32_t state = 1;
+  uint32_t atMs = 0xFFFFFF00; // millis() wraps within the batch
+  int16_t cell[2] = { 1000, -1000 };
+
+  for (size_t i = 0; i < count; i++) {
+    state = state * 1664525UL + 1013904223UL;
+    atMs += 50 + (state >> 28);
+    cell[0] += (int16_t)((state >> 8) & 0x0F) - 8;
+    cell[1] += (int16_t)((state >> 12) & 0x0F) - 8;
+    if (i == count / 2) {
+      cell[0] = INT16_MAX - 1000; // A jump that needs a 3 byte delta.
+      atMs += 70000;              // And a 3 byte gap.
+    }
+    samples[i].atMs = atMs;
+    samples[i].cellMv[0] = cell[0];
+    samples[i].cellMv[1] = cell[1];
+  }
+  return count;
+}
+
+void test_sample_batch_round_trip() {
+  StreamSample samples[20];
+  makeSamples(samples, 20);
+
+  uint8_t payload[PROTOCOL_MAX_PAYLOAD_SIZE];
+  size_t encoded = 0;
+  size_t length = encodeSampleBatch(0xFFFF, samples, 20, payload, sizeof(payload), encoded);
+  TEST_ASSERT_EQUAL_UINT32(20, encoded);
+
+  StreamSample decoded[20];
+  uint16_t index = 0;
+  TEST_ASSERT_EQUAL_UINT32(20, decodeSampleBatch(payload, length, index, decoded, 20));
+  TEST_ASSERT_EQUAL_UINT16(0xFFFF, index);
+  for (size_t i = 0; i < 20; i++) {
+    TEST_ASSERT_EQUAL_UINT32(samples[i].atMs, decoded[i].atMs);
+    TEST_ASSERT_EQUAL_INT16(samples[i].cellMv[0], decoded[i].cellMv[0]);
+    TEST_ASSERT_EQUAL_INT16(samples[i].cellMv[1], decoded[i].cellMv[1]);
+  }
+}
+
+void test_sample_batch_fills_a_frame() {
+  StreamSample samples[200];
+  makeSamples(samples, 200);
+
+  uint8_t payload[PROTOCOL_MAX_PAYLOAD_SIZE];
+  size_t encoded = 0;
+  size_t length = encodeSampleBatch(3, samples, 200, payload, sizeof(payload), encoded);
+  TEST_ASSERT_TRUE(encoded > 1 && encoded < 200);
+  TEST_ASSERT_TRUE(encoded <= SAMPLE_BATCH_MAX_COUNT);
+  TEST_ASSERT_TRUE(length <= sizeof(payload));
+
+  StreamSample decoded[SAMPLE_BATCH_MAX_COUNT];
+  uint16_t index = 0;
+  TEST_ASSERT_EQUAL_UINT32(encoded, decodeSampleBatch(payload, length, index, decoded, SAMPLE_BATCH_MAX_COUNT));
+  TEST_ASSERT_EQUAL_UINT32(samples[encoded - 1].atMs, decoded[encoded - 1].atMs);
+
+  uint8_t frame[PROTOCOL_MAX_FRAME_SIZE];
+  TEST_ASSERT_NOT_EQUAL(0, encodeFrame(FRAME_SAMPLES, 0, 0, payload, length, frame, sizeof(frame)));
+}
+
+void test_sample_batch_malformed() {
+  StreamSample samples[10];
+  makeSamples(samples, 10);
+
+  uint8_t payload[PROTOCOL_MAX_PAYLOAD_SIZE];
+  size_t encoded = 0;
+  size_t length = encodeSampleBatch(0, samples, 10, payload, sizeof(payload), encoded);
+
+  StreamSample decoded[10];
+  uint16_t index = 0;
+  // Truncated varint in the last record.
+  TEST_ASSERT_EQUAL_UINT32(0, decodeSampleBatch(payload, length - 1, index, decoded, 10));
+  // Trailing byte.
+  payload[length] = 0;
+  TEST_ASSERT_EQUAL_UINT32(0, decodeSampleBatch(payload, length + 1, index, decoded, 10));
+  // More samples than the caller has room for.
+  TEST_ASSERT_EQUAL_UINT32(0, decodeSampleBatch(payload, length, index, decoded, 9));
+  // Header cut short.
+  TEST_ASSERT_EQUAL_UINT32(0, decodeSampleBatch(payload, sizeof(SampleBatchHeader) - 1, index, decoded, 10));
+}
+
+void test_sequence_wraps() {
+  TEST_ASSERT_TRUE(isNewerSequence(1, 0));
+  TEST_ASSERT_TRUE(isNewerSequence(0, 0xFFFF));
+  TEST_ASSERT_FALSE(isNewerSequence(0xFFFF, 0));
+  TEST_ASSERT_FALSE(isNewerSequence(5, 5));
+}
+
+void test_status_deadbands() {
+  StatusPayload a = makeStatus();
+  StatusPayload b = a;
+  TEST_ASSERT_FALSE(statusChanged(a, b));
+
+  b.o2 += STATUS_DEADBAND_O2;
+  b.cellMv[1] -= STATUS_DEADBAND_MV;
+  TEST_ASSERT_FALSE(statusChanged(a, b));
+
+  b.o2 += 1;
+  TEST_ASSERT_TRUE(statusChanged(a, b));
+
+  b = a;
+  b.flags ^= STATUS_FLAG_READING_ERROR;
+  TEST_ASSERT_TRUE(statusChanged(a, b));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_status_round_trip);
+  RUN_TEST(test_hello_and_stream_request);
+  RUN_TEST(test_profile_round_trip);
+  RUN_TEST(test_encode_does_not_overflow);
+  RUN_TEST(test_error_too_short);
+  RUN_TEST(test_error_foreign);
+  RUN_TEST(test_error_bad_version);
+  RUN_TEST(test_error_bad_length);
+  RUN_TEST(test_error_bad_crc);
+  RUN_TEST(test_sample_batch_round_trip);
+  RUN_TEST(test_sample_batch_fills_a_frame);
+  RUN_TEST(test_sample_batch_malformed);
+  RUN_TEST(test_sequence_wraps);
+  RUN_TEST(test_status_deadbands);
+  return UNITY_END();
+}